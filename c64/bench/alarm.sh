@@ -0,0 +1,29 @@
+#!/bin/sh
+
+# Compares two builds of x64 that differ in the alarm code, e.g. one with
+# the linear scan of the pending alarms and one with the binary heap.
+#
+#	alarm.sh old-x64 new-x64 [frames]
+#
+# Both emulators run the reference workloads of suite.sh for the given
+# number of frames (default 3000) and their reports are printed one after
+# the other.  The script fails if the frame or sound hashes of the second
+# emulator differ from the ones of the first.
+
+if [ $# -lt 2 ] ; then
+	echo "usage: $0 old-x64 new-x64 [frames]" >&2
+	exit 2
+fi
+
+SUITE=`dirname $0`/suite.sh
+FRAMES=${3:-3000}
+
+SCRATCH="${TMPDIR:-/tmp}/vice-alarm.$$"
+mkdir "$SCRATCH" || exit 1
+trap 'rm -rf "$SCRATCH"' 0
+trap 'exit 1' 1 2 15
+
+echo "old: $1"
+sh "$SUITE" "$1" $FRAMES "$SCRATCH/hashes" || exit 1
+echo "new: $2"
+sh "$SUITE" "$2" $FRAMES "$SCRATCH/hashes"
@@ -0,0 +1,123 @@
+/*
+ * alarmops.c - Time setting, unsetting and dispatching alarms.
+ *
+ * Built and run by alarmops.sh.
+ *
+ *	alarmops alarms dispatches
+ *
+ * The given number of alarms is put in one alarm context and the context
+ * is run by hand as the CPU would, until the given number of alarms has
+ * been dispatched.  Each callback moves its own alarm a pseudo-random
+ * number of cycles ahead, and every fourth one also unsets another alarm
+ * and sets it again, so each dispatch costs about one and a half sets and
+ * a quarter of an unset.  All delays are multiples of the number of
+ * alarms and alarm `i' is only ever due on clocks that leave `i' when
+ * divided by it, so no two alarms are ever due on the same clock and the
+ * order of dispatch doesn't depend on how the pending alarms are kept.
+ *
+ * The program prints the number of operations per second and a hash of
+ * the dispatched alarms and clocks.
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alarm.h"
+#include "types.h"
+
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME        16777619U
+
+#define MAX_ALARMS 64
+
+static alarm_context_t *context;
+static alarm_t *alarms[MAX_ALARMS];
+static DWORD seeds[MAX_ALARMS];
+static unsigned int num_alarms;
+static CLOCK clk;
+static DWORD hash = FNV_OFFSET_BASIS;
+static unsigned long sets, unsets, dispatches;
+
+/* ------------------------------------------------------------------------- */
+
+void *lib_malloc(size_t size) { return malloc(size ? size : 1); }
+void lib_free(const void *p) { free((void *)p); }
+char *lib_stralloc(const char *s) { return strcpy(malloc(strlen(s) + 1), s); }
+int log_error(int log, const char *format, ...) { return 0; }
+
+/* ------------------------------------------------------------------------- */
+
+static CLOCK next_delay(unsigned int i)
+{
+    seeds[i] = seeds[i] * 1103515245 + 12345;
+    return (CLOCK)(1 + (seeds[i] >> 16) % 200) * num_alarms;
+}
+
+static void alarm_callback(CLOCK offset, void *data)
+{
+    unsigned int i = (unsigned int)(size_t)data;
+    unsigned int other;
+    CLOCK due = clk - offset;
+
+    hash = (hash ^ i) * FNV_PRIME;
+    hash = (hash ^ (DWORD)due) * FNV_PRIME;
+    dispatches++;
+
+    alarm_set(alarms[i], due + next_delay(i));
+    sets++;
+
+    if ((seeds[i] >> 8) % 4 == 0) {
+        other = (i + 1 + (seeds[i] >> 20) % (num_alarms - 1)) % num_alarms;
+        if (alarms[other]->pending_idx >= 0) {
+            alarm_unset(alarms[other]);
+            unsets++;
+            alarm_set(alarms[other], due + next_delay(other) + other - i);
+            sets++;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long count;
+    unsigned int i;
+    char name[16];
+    struct timespec start, end;
+    double seconds;
+
+    if (argc != 3 || (num_alarms = (unsigned int)atoi(argv[1])) < 2
+        || num_alarms > MAX_ALARMS || (count = strtoul(argv[2], NULL, 10)) == 0) {
+        fprintf(stderr, "usage: %s alarms(2-%d) dispatches\n", argv[0],
+                MAX_ALARMS);
+        return 2;
+    }
+
+    context = alarm_context_new("bench");
+    for (i = 0; i < num_alarms; i++) {
+        sprintf(name, "alarm%u", i);
+        alarms[i] = alarm_new(context, name, alarm_callback,
+                              (void *)(size_t)i);
+        seeds[i] = i + 1;
+        alarm_set(alarms[i], i + next_delay(i));
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (dispatches < count) {
+        clk = alarm_context_next_pending_clk(context);
+        alarm_context_dispatch(context, clk);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%2u alarms: %.1f Mops/s (%lu sets, %lu unsets, %lu dispatches), "
+           "hash %08x\n", num_alarms,
+           (sets + unsets + dispatches) / seconds / 1e6, sets, unsets,
+           dispatches, (unsigned int)hash);
+
+    alarm_context_destroy(context);
+    return 0;
+}
@@ -0,0 +1,50 @@
+#!/bin/sh
+
+# Times the alarm code of two VICE source trees on its own, e.g. before
+# and after a change to alarm.c or alarm.h.
+#
+#	alarmops.sh old-vice-src new-vice-src [config-dir] [dispatches]
+#
+# alarmops.c is compiled with alarm.c of each source directory.
+# config-dir is where configure put config.h (default: the new source
+# directory).  Both programs dispatch the given number of alarms (default
+# 20000000) from contexts with 4, 16 and 64 alarms and print how many
+# sets, unsets and dispatches they did per second.  The script fails if
+# the alarms were dispatched in a different order.  CC and CFLAGS are
+# taken from the environment; the include paths assume a Unix build.
+
+if [ $# -lt 2 ] ; then
+	echo "usage: $0 old-vice-src new-vice-src [config-dir] [dispatches]" >&2
+	exit 2
+fi
+
+OLD=$1
+NEW=$2
+CONFIG=${3:-$2}
+COUNT=${4:-20000000}
+
+SCRATCH="${TMPDIR:-/tmp}/vice-alarmops.$$"
+mkdir "$SCRATCH" || exit 1
+trap 'rm -rf "$SCRATCH"' 0
+trap 'exit 1' 1 2 15
+
+for TREE in old new ; do
+	if [ $TREE = old ] ; then SRC=$OLD ; else SRC=$NEW ; fi
+	${CC:-cc} ${CFLAGS:--O2} -I"$SRC" -I"$CONFIG" -I"$SRC/arch/unix" \
+		-o "$SCRATCH/$TREE" `dirname $0`/alarmops.c "$SRC/alarm.c" ||
+		exit 1
+done
+
+STATUS=0
+for ALARMS in 4 16 64 ; do
+	for TREE in old new ; do
+		"$SCRATCH/$TREE" $ALARMS $COUNT > "$SCRATCH/$TREE.out" || exit 1
+		echo "$TREE: `cat \"$SCRATCH/$TREE.out\"`"
+		sed 's/:.*(/(/' "$SCRATCH/$TREE.out" > "$SCRATCH/$TREE.hash"
+	done
+	if ! cmp -s "$SCRATCH/old.hash" "$SCRATCH/new.hash" ; then
+		echo "$ALARMS alarms: dispatch order differs" >&2
+		STATUS=1
+	fi
+done
+exit $STATUS
@@ -0,0 +1,189 @@
+/*
+ * archive.c - Write zipcode and Lynx test images.
+ *
+ * Built and run by archive.sh.
+ *
+ *	archive zipcode image.d64 dir/name
+ *	archive lynx archive.lnx name file [name file...]
+ *
+ * `zipcode' splits a 35 track D64 image into the four files `1!name' to
+ * `4!name'.  Sectors filled with one byte are packed, the others stored.
+ * `lynx' packs the given files into a Lynx archive as PRG files with the
+ * given names, which should be in upper case.  The files must not be
+ * empty.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define D64_SIZE 174848
+#define LYNX_BLOCK 254
+
+static int sectors_per_track(int track)
+{
+    return (track <= 17) ? 21 : (track <= 24) ? 19 : (track <= 30) ? 18 : 17;
+}
+
+static unsigned char *read_all(const char *name, long *size)
+{
+    FILE *f;
+    unsigned char *data;
+
+    f = fopen(name, "rb");
+    if (f == NULL || fseek(f, 0, SEEK_END) != 0 || (*size = ftell(f)) < 0) {
+        perror(name);
+        exit(1);
+    }
+    data = malloc(*size > 0 ? *size : 1);
+    rewind(f);
+    if (data == NULL || fread(data, 1, *size, f) != (size_t)*size) {
+        perror(name);
+        exit(1);
+    }
+    fclose(f);
+    return data;
+}
+
+static int zipcode(const char *image_name, const char *prefix)
+{
+    unsigned char *image;
+    long size;
+    char *part_name;
+    const char *base;
+    FILE *f = NULL;
+    int track, sector, i;
+    long offset = 0;
+
+    image = read_all(image_name, &size);
+    if (size != D64_SIZE) {
+        fprintf(stderr, "%s: not a 35 track D64 image\n", image_name);
+        return 1;
+    }
+
+    base = strrchr(prefix, '/');
+    base = (base == NULL) ? prefix : base + 1;
+    part_name = malloc(strlen(prefix) + 3);
+    memcpy(part_name, prefix, base - prefix);
+    sprintf(part_name + (base - prefix), "1!%s", base);
+
+    for (track = 1; track <= 35; track++) {
+        if (track == 1 || track == 9 || track == 17 || track == 26) {
+            if (f != NULL) {
+                fclose(f);
+            }
+            f = fopen(part_name, "wb");
+            if (f == NULL) {
+                perror(part_name);
+                return 1;
+            }
+            part_name[base - prefix]++;
+            /* The load address, and the disk ID in the first part.  */
+            if (track == 1) {
+                fputc(0xfe, f);
+                fputc(0x03, f);
+                fputc(image[0x16500 + 0xa2], f);
+                fputc(image[0x16500 + 0xa3], f);
+            } else {
+                fputc(0x00, f);
+                fputc(0x04, f);
+            }
+        }
+        for (sector = 0; sector < sectors_per_track(track); sector++) {
+            const unsigned char *data = image + offset + sector * 256;
+
+            for (i = 1; i < 256 && data[i] == data[0]; i++) {
+            }
+            if (i == 256) {
+                fputc(track | 0x40, f);
+                fputc(sector, f);
+                fputc(data[0], f);
+            } else {
+                fputc(track, f);
+                fputc(sector, f);
+                fwrite(data, 1, 256, f);
+            }
+        }
+        offset += sectors_per_track(track) * 256;
+    }
+    fclose(f);
+    return 0;
+}
+
+/* 10 PRINT"LYNX", which ends with the three zeros that end the stub.  */
+static const unsigned char lynx_stub[] = {
+    0x01, 0x08, 0x0e, 0x08, 0x0a, 0x00, 0x99, 0x22, 0x4c, 0x59, 0x4e, 0x58,
+    0x22, 0x00, 0x00, 0x00
+};
+
+static int lynx(const char *archive_name, int nfiles, char **args)
+{
+    FILE *f;
+    unsigned char **data;
+    long *size, blocks, pos;
+    int i, dir_blocks;
+    char header[4096];
+    int len, name_len;
+
+    data = malloc(nfiles * sizeof(*data));
+    size = malloc(nfiles * sizeof(*size));
+    for (i = 0; i < nfiles; i++) {
+        data[i] = read_all(args[2 * i + 1], &size[i]);
+    }
+
+    /* The number of directory blocks comes before the directory, so try
+       until it fits.  */
+    for (dir_blocks = 1; ; dir_blocks++) {
+        memcpy(header, lynx_stub, sizeof(lynx_stub));
+        len = sizeof(lynx_stub);
+        len += sprintf(header + len, "\r %d  *LYNX BENCH\r %d \r",
+                       dir_blocks, nfiles);
+        for (i = 0; i < nfiles; i++) {
+            /* Names are padded to 16 characters with shifted spaces.  */
+            name_len = sprintf(header + len, "%.16s", args[2 * i]);
+            memset(header + len + name_len, 0xa0, 16 - name_len);
+            len += 16;
+            blocks = (size[i] + LYNX_BLOCK - 1) / LYNX_BLOCK;
+            len += sprintf(header + len, "\r %ld \rP\r %ld \r", blocks,
+                           size[i] - (blocks - 1) * LYNX_BLOCK + 1);
+        }
+        if (len <= dir_blocks * LYNX_BLOCK) {
+            break;
+        }
+    }
+
+    f = fopen(archive_name, "wb");
+    if (f == NULL) {
+        perror(archive_name);
+        return 1;
+    }
+    fwrite(header, 1, len, f);
+    for (pos = len; pos < dir_blocks * LYNX_BLOCK; pos++) {
+        fputc(0, f);
+    }
+    /* Every file is padded to whole blocks, which the last one need not
+       be.  */
+    for (i = 0; i < nfiles; i++) {
+        fwrite(data[i], 1, size[i], f);
+        blocks = (size[i] + LYNX_BLOCK - 1) / LYNX_BLOCK;
+        for (pos = size[i]; pos < blocks * LYNX_BLOCK; pos++) {
+            fputc(0, f);
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 4 && strcmp(argv[1], "zipcode") == 0) {
+        return zipcode(argv[2], argv[3]);
+    }
+    if (argc >= 5 && argc % 2 == 1 && strcmp(argv[1], "lynx") == 0) {
+        return lynx(argv[2], (argc - 3) / 2, argv + 3);
+    }
+    fprintf(stderr, "usage: %s zipcode image.d64 dir/name\n"
+            "       %s lynx archive.lnx name file [name file...]\n",
+            argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,75 @@
+#!/bin/sh
+
+# Compares how two builds of c1541 read compressed and archived disk
+# images, e.g. one that spawns gzip, unzip and c1541 for them and one that
+# reads them itself.
+#
+#	archive.sh old-c1541 new-c1541
+#
+# A D64 image with three files is made with the new c1541 and turned into
+# a gzip file, a deflated and a stored zip archive, a zipcode disk and a
+# Lynx archive; archive.c writes the last two.  Every one of them is
+# attached with both builds, which list it and read back the largest file.
+# The old build finds the helper programs in the PATH, with itself as
+# c1541; the new one runs with an empty PATH, so it has to do without.
+# The script fails if a listing differs between the two builds or if a
+# file read back differs from the one written.  zip, gzip and a C compiler
+# (CC, default cc) are needed.
+
+if [ $# -ne 2 ] ; then
+	echo "usage: $0 old-c1541 new-c1541" >&2
+	exit 2
+fi
+
+OLD=`cd \`dirname $1\` && pwd`/`basename $1`
+NEW=`cd \`dirname $2\` && pwd`/`basename $2`
+
+SCRATCH="${TMPDIR:-/tmp}/vice-archive.$$"
+mkdir "$SCRATCH" || exit 1
+trap 'rm -rf "$SCRATCH"' 0
+trap 'exit 1' 1 2 15
+
+mkdir "$SCRATCH/old" "$SCRATCH/empty" "$SCRATCH/zipcode" || exit 1
+ln -s "$OLD" "$SCRATCH/old/c1541" || exit 1
+${CC:-cc} ${CFLAGS:--O2} -o "$SCRATCH/archive" `dirname $0`/archive.c || exit 1
+
+# One file smaller than a block, one of exactly a block and one of several.
+dd if=/dev/urandom of="$SCRATCH/first.prg" bs=100 count=1 2> /dev/null
+dd if=/dev/urandom of="$SCRATCH/second.prg" bs=254 count=1 2> /dev/null
+dd if=/dev/urandom of="$SCRATCH/third.prg" bs=1000 count=3 2> /dev/null
+
+cd "$SCRATCH" || exit 1
+"$NEW" -format "archive,ab" d64 disk.d64 -write first.prg first \
+	-write second.prg second -write third.prg third > /dev/null 2>&1 || exit 1
+gzip -c disk.d64 > disk.d64.gz || exit 1
+zip -q disk.zip disk.d64 || exit 1
+zip -q -0 stored.zip disk.d64 || exit 1
+./archive zipcode disk.d64 zipcode/disk || exit 1
+./archive lynx disk.lnx FIRST first.prg SECOND second.prg \
+	THIRD third.prg || exit 1
+
+STATUS=0
+for IMAGE in disk.d64.gz disk.zip stored.zip 'zipcode/1!disk' disk.lnx ; do
+	# The helpers print to the same output, so keep the listing only.
+	PATH="$SCRATCH/old:$PATH" "$OLD" -attach "$IMAGE" -dir 2>&1 |
+		grep '^[0-9]' > old.dir
+	rm -f old.prg new.prg
+	PATH="$SCRATCH/old:$PATH" "$OLD" -attach "$IMAGE" \
+		-read third old.prg > /dev/null 2>&1
+	PATH="$SCRATCH/empty" "$NEW" -attach "$IMAGE" -dir 2>&1 |
+		grep '^[0-9]' > new.dir
+	PATH="$SCRATCH/empty" "$NEW" -attach "$IMAGE" \
+		-read third new.prg > /dev/null 2>&1
+
+	echo "$IMAGE:"
+	cat new.dir
+	if [ ! -s old.dir ] || ! diff old.dir new.dir ; then
+		echo "$IMAGE: listings differ" >&2
+		STATUS=1
+	fi
+	if ! cmp -s third.prg old.prg || ! cmp -s third.prg new.prg ; then
+		echo "$IMAGE: file read back differs" >&2
+		STATUS=1
+	fi
+done
+exit $STATUS
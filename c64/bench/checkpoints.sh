@@ -0,0 +1,52 @@
+#!/bin/sh
+
+# Emulation speed of x64 with 0, 10 and 100 monitor checkpoints set.
+#
+#	checkpoints.sh x64 [frames]
+#
+# x64 runs a BASIC loop that reads and writes memory in warp mode for the
+# given number of frames (default 3000) and logs the speed it reached.
+# The checkpoints are breakpoints and load and store watchpoints in
+# $c000-$cfff, which the loop never touches, so they cost time but never
+# stop the emulation.  petcat is taken from the directory of x64.
+
+if [ $# -lt 1 ] ; then
+	echo "usage: $0 x64 [frames]" >&2
+	exit 2
+fi
+
+X64=`cd \`dirname $1\` && pwd`/`basename $1`
+PETCAT=`dirname $X64`/petcat
+DATA=`dirname $X64`/../data
+FRAMES=${2:-3000}
+
+SCRATCH="${TMPDIR:-/tmp}/vice-checkpoints.$$"
+mkdir "$SCRATCH" || exit 1
+trap 'rm -rf "$SCRATCH"' 0
+trap 'exit 1' 1 2 15
+
+cat > "$SCRATCH/loop.bas" <<EOF
+10 fori=0to255:pokei+8192,i:a=peek(i+8192):next:goto10
+EOF
+"$PETCAT" -w2 -o "$SCRATCH/loop.prg" -- "$SCRATCH/loop.bas" > /dev/null 2>&1 || exit 1
+
+for N in 0 10 100 ; do
+	: > "$SCRATCH/commands"
+	I=0
+	while [ $I -lt $N ] ; do
+		ADDR=`printf '%04x' \`expr 49152 + $I \* 37\``
+		case `expr $I % 3` in
+		0)	echo "break $ADDR" ;;
+		1)	echo "watch load $ADDR" ;;
+		2)	echo "watch store $ADDR" ;;
+		esac >> "$SCRATCH/commands"
+		I=`expr $I + 1`
+	done
+
+	printf '%3d checkpoints: ' $N
+	"$X64" -default -console -directory "$DATA/C64:$DATA/DRIVES" \
+		-sounddev dummy -warp -limitframes $FRAMES \
+		-moncommands "$SCRATCH/commands" \
+		-autostart "$SCRATCH/loop.prg" 2>&1 |
+		sed -n 's/^Frame limit: //p'
+done
@@ -0,0 +1,62 @@
+#!/bin/sh
+
+# Checks that the drive thread keeps true drive emulation cycle-identical
+# and times the disk load with and without it.
+#
+#	drivethread.sh x64 [frames [runs]]
+#
+# The reference workloads of suite.sh are run for the given number of
+# frames (default 3000), once with the drives on the main thread
+# (`+drivethread') and once with the per-frame catch-up on the drive
+# thread (`-drivethread').  The script fails if any frame or sound hash
+# differs between the two runs.  The suite is then run again until each
+# setting has been run the given number of times (default 3), and the
+# best time of the disk workload, which loads a file with true drive
+# emulation, is printed for both settings.  Only the per-frame catch-up
+# runs on the thread, so the gain is bounded by the share of drive time
+# that is left to it and needs a second core.
+
+if [ $# -lt 1 ] ; then
+	echo "usage: $0 x64 [frames [runs]]" >&2
+	exit 2
+fi
+
+SUITE=`dirname $0`/suite.sh
+FRAMES=${2:-3000}
+RUNS=${3:-3}
+
+SCRATCH="${TMPDIR:-/tmp}/vice-drivethread.$$"
+mkdir "$SCRATCH" || exit 1
+trap 'rm -rf "$SCRATCH"' 0
+trap 'exit 1' 1 2 15
+
+echo "+drivethread:"
+sh "$SUITE" "$1" $FRAMES "$SCRATCH/hashes" +drivethread > "$SCRATCH/serial.out"
+STATUS=$?
+cat "$SCRATCH/serial.out"
+[ $STATUS = 0 ] || exit 1
+echo "-drivethread:"
+sh "$SUITE" "$1" $FRAMES "$SCRATCH/hashes" -drivethread > "$SCRATCH/thread.out"
+STATUS=$?
+cat "$SCRATCH/thread.out"
+
+RUN=1
+while [ $RUN -lt $RUNS ] ; do
+	sh "$SUITE" "$1" $FRAMES "" +drivethread >> "$SCRATCH/serial.out"
+	sh "$SUITE" "$1" $FRAMES "" -drivethread >> "$SCRATCH/thread.out"
+	RUN=`expr $RUN + 1`
+done
+
+for MODE in serial thread ; do
+	sed -n 's/^disk: .* frames in \([0-9.]*\) s.*/\1/p' "$SCRATCH/$MODE.out" |
+		sort -n | head -1 > "$SCRATCH/$MODE.best"
+done
+SERIAL=`cat "$SCRATCH/serial.best"`
+THREAD=`cat "$SCRATCH/thread.best"`
+if [ -z "$SERIAL" ] || [ -z "$THREAD" ] ; then
+	echo "disk: no timing" >&2
+	exit 1
+fi
+echo "disk load, best of $RUNS: +drivethread $SERIAL s, -drivethread $THREAD s" \
+	"(`echo $SERIAL $THREAD | awk '{ printf "%.2fx", $1 / $2 }'`)"
+exit $STATUS
@@ -0,0 +1,38 @@
+#!/bin/sh
+
+# Compares the sound output of FastSID in two builds of x64, e.g. one with
+# the sample-at-a-time renderer and one with the blocked renderer.
+#
+#	fastsid.sh old-x64 new-x64 [frames]
+#
+# Both emulators run the reference workloads of suite.sh for the given
+# number of frames (default 3000) with `-sidengine 0', once with and once
+# without SID filters, and their reports are printed one after the other.
+# The script fails if the frame or sound hashes of the second emulator
+# differ from the ones of the first.  The `digi' workload is the one that
+# keeps FastSID busy.
+
+if [ $# -lt 2 ] ; then
+	echo "usage: $0 old-x64 new-x64 [frames]" >&2
+	exit 2
+fi
+
+SUITE=`dirname $0`/suite.sh
+FRAMES=${3:-3000}
+
+SCRATCH="${TMPDIR:-/tmp}/vice-fastsid.$$"
+mkdir "$SCRATCH" || exit 1
+trap 'rm -rf "$SCRATCH"' 0
+trap 'exit 1' 1 2 15
+
+STATUS=0
+for FILTERS in -sidfilters +sidfilters ; do
+	echo "old: $1 $FILTERS"
+	sh "$SUITE" "$1" $FRAMES "$SCRATCH/hashes$FILTERS" \
+		-sidengine 0 $FILTERS || exit 1
+	echo "new: $2 $FILTERS"
+	sh "$SUITE" "$2" $FRAMES "$SCRATCH/hashes$FILTERS" \
+		-sidengine 0 $FILTERS || STATUS=1
+done
+
+exit $STATUS
@@ -0,0 +1,147 @@
+/*
+ * fastsidrate.c - Time how fast FastSID renders samples.
+ *
+ * Built and run by fastsidrate.sh.
+ *
+ *	fastsidrate tune|digi filters seconds
+ *
+ * One FastSID chip is opened at 44100 Hz with PAL timing, with the SID
+ * filters on if `filters' is 1, and is made to render the given number
+ * of seconds of sound:
+ *
+ *	tune	three voices whose frequencies, waveforms, envelopes and
+ *		the filter are changed with pseudo-random values once every
+ *		frame, so samples are asked for in blocks of a frame
+ *	digi	a tone with the volume register written every 8 samples,
+ *		as digitized sound players do, so samples are asked for in
+ *		blocks of 8
+ *
+ * The program prints the samples rendered per second and a hash of them.
+ * sid/fastsid.c is linked in and everything else it uses is stubbed out
+ * here.
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fastsid.h"
+#include "sid.h"
+#include "types.h"
+
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME        16777619U
+
+#define SAMPLE_RATE     44100
+#define CYCLES_PER_SEC  985248
+#define FRAME_SAMPLES   (SAMPLE_RATE / 50)
+#define DIGI_SAMPLES    8
+
+CLOCK maincpu_clk = 0;
+static int filters;
+
+/* ------------------------------------------------------------------------- */
+
+void *lib_calloc(size_t nmemb, size_t size) { return calloc(nmemb, size); }
+void lib_free(const void *p) { free((void *)p); }
+char *lib_stralloc(const char *s) { return strcpy(malloc(strlen(s) + 1), s); }
+long sound_sample_position(void) { return 0; }
+
+int resources_get_int(const char *name, int *value)
+{
+    *value = (strcmp(name, "SidFilters") == 0) ? filters : 0;
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static DWORD seed = 1;
+
+static BYTE next_byte(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (BYTE)(seed >> 16);
+}
+
+static void store(sound_t *psid, WORD addr, BYTE byte)
+{
+    fastsid_hooks.store(psid, addr, byte);
+}
+
+int main(int argc, char **argv)
+{
+    static const BYTE waveforms[] = { 0x10, 0x20, 0x40, 0x80 };
+    BYTE sidstate[32];
+    SWORD buf[FRAME_SAMPLES];
+    sound_t *psid;
+    int digi, seconds, block, delta_t = 0, voice, i;
+    long samples, total;
+    DWORD hash = FNV_OFFSET_BASIS;
+    struct timespec start, end;
+    double elapsed;
+
+    if (argc != 4 || (strcmp(argv[1], "tune") != 0
+                      && strcmp(argv[1], "digi") != 0)
+        || (seconds = atoi(argv[3])) <= 0) {
+        fprintf(stderr, "usage: %s tune|digi filters seconds\n", argv[0]);
+        return 2;
+    }
+    digi = (strcmp(argv[1], "digi") == 0);
+    filters = atoi(argv[2]);
+
+    memset(sidstate, 0, sizeof(sidstate));
+    psid = fastsid_hooks.open(sidstate);
+    if (!fastsid_hooks.init(psid, SAMPLE_RATE, CYCLES_PER_SEC)) {
+        fprintf(stderr, "%s: cannot initialize FastSID\n", argv[0]);
+        return 1;
+    }
+    store(psid, 0x18, 0x1f);
+    if (digi) {
+        store(psid, 0x00, 0x00);
+        store(psid, 0x01, 0x10);
+        store(psid, 0x05, 0x00);
+        store(psid, 0x06, 0xf0);
+        store(psid, 0x04, 0x21);
+    }
+
+    block = digi ? DIGI_SAMPLES : FRAME_SAMPLES;
+    total = (long)seconds * SAMPLE_RATE;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (samples = 0; samples < total; samples += block) {
+        if (digi) {
+            store(psid, 0x18, (BYTE)(0x10 | ((samples / block) & 0x0f)));
+        } else {
+            for (voice = 0; voice < 3; voice++) {
+                store(psid, (WORD)(voice * 7 + 0), next_byte());
+                store(psid, (WORD)(voice * 7 + 1), next_byte());
+                store(psid, (WORD)(voice * 7 + 2), next_byte());
+                store(psid, (WORD)(voice * 7 + 3), (BYTE)(next_byte() & 0x0f));
+                store(psid, (WORD)(voice * 7 + 5), next_byte());
+                store(psid, (WORD)(voice * 7 + 6), next_byte());
+                store(psid, (WORD)(voice * 7 + 4),
+                      (BYTE)(waveforms[next_byte() & 3] | (next_byte() & 1)));
+            }
+            store(psid, 0x15, next_byte());
+            store(psid, 0x16, next_byte());
+            store(psid, 0x17, next_byte());
+            store(psid, 0x18, (BYTE)(next_byte() | 0x0f));
+        }
+        fastsid_hooks.calculate_samples(psid, buf, block, 1, &delta_t);
+        maincpu_clk += (CLOCK)block * CYCLES_PER_SEC / SAMPLE_RATE;
+        for (i = 0; i < block; i++) {
+            hash = (hash ^ (DWORD)(WORD)buf[i]) * FNV_PRIME;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%s, filters %s: %.2f Msamples/s (%ld samples), hash %08x\n",
+           argv[1], filters ? "on" : "off", samples / elapsed / 1e6, samples,
+           (unsigned int)hash);
+
+    fastsid_hooks.close(psid);
+    return 0;
+}
@@ -0,0 +1,53 @@
+#!/bin/sh
+
+# Times FastSID of two VICE source trees on its own, e.g. before and
+# after a change to sid/fastsid.c.
+#
+#	fastsidrate.sh old-vice-src new-vice-src [config-dir] [seconds]
+#
+# fastsidrate.c is compiled with sid/fastsid.c of each source directory.
+# config-dir is where configure put config.h (default: the new source
+# directory).  Both programs render the given number of seconds of sound
+# (default 600) for the `tune' and the `digi' workload, with and without
+# SID filters, and print the samples they rendered per second.  The
+# script fails if the samples differ.  CC and CFLAGS are taken from the
+# environment; the include paths assume a Unix build.
+
+if [ $# -lt 2 ] ; then
+	echo "usage: $0 old-vice-src new-vice-src [config-dir] [seconds]" >&2
+	exit 2
+fi
+
+OLD=$1
+NEW=$2
+CONFIG=${3:-$2}
+DURATION=${4:-600}
+
+SCRATCH="${TMPDIR:-/tmp}/vice-fastsidrate.$$"
+mkdir "$SCRATCH" || exit 1
+trap 'rm -rf "$SCRATCH"' 0
+trap 'exit 1' 1 2 15
+
+for TREE in old new ; do
+	if [ $TREE = old ] ; then SRC=$OLD ; else SRC=$NEW ; fi
+	${CC:-cc} ${CFLAGS:--O2} -I"$SRC" -I"$CONFIG" -I"$SRC/arch/unix" \
+		-I"$SRC/sid" -o "$SCRATCH/$TREE" `dirname $0`/fastsidrate.c \
+		"$SRC/sid/fastsid.c" -lm || exit 1
+done
+
+STATUS=0
+for WORKLOAD in tune digi ; do
+	for FILTERS in 0 1 ; do
+		for TREE in old new ; do
+			"$SCRATCH/$TREE" $WORKLOAD $FILTERS $DURATION \
+				> "$SCRATCH/$TREE.out" || exit 1
+			echo "$TREE: `cat \"$SCRATCH/$TREE.out\"`"
+			sed 's/:.*(/(/' "$SCRATCH/$TREE.out" > "$SCRATCH/$TREE.hash"
+		done
+		if ! cmp -s "$SCRATCH/old.hash" "$SCRATCH/new.hash" ; then
+			echo "$WORKLOAD: samples differ" >&2
+			STATUS=1
+		fi
+	done
+done
+exit $STATUS
@@ -0,0 +1,43 @@
+#!/bin/sh
+
+# Emulation speed of x64 on a loop that does nothing but I/O accesses.
+#
+#	io.sh x64 [frames]
+#
+# The loop reads $d41b, $de1b and $df00 and writes $de20 and $df02, once
+# with no cartridges and once with a REU at $df00, a second SID at $de00
+# and a DigiMAX at $de20.  x64 runs it in warp mode for the given number
+# of frames (default 3000) and logs the speed it reached.
+
+if [ $# -lt 1 ] ; then
+	echo "usage: $0 x64 [frames]" >&2
+	exit 2
+fi
+
+X64=`cd \`dirname $1\` && pwd`/`basename $1`
+DATA=`dirname $X64`/../data
+FRAMES=${2:-3000}
+
+SCRATCH="${TMPDIR:-/tmp}/vice-io.$$"
+mkdir "$SCRATCH" || exit 1
+trap 'rm -rf "$SCRATCH"' 0
+trap 'exit 1' 1 2 15
+
+# 10 SYS2061
+# 080d  LDA $D41B / LDA $DE1B / LDA $DF00 / STA $DE20 / STA $DF02 / JMP $080D
+printf '\001\010\013\010\012\000\236\062\060\066\061\000\000\000' > "$SCRATCH/io.prg"
+printf '\255\033\324\255\033\336\255\000\337' >> "$SCRATCH/io.prg"
+printf '\215\040\336\215\002\337\114\015\010' >> "$SCRATCH/io.prg"
+
+for CARTS in none "-reu -sidstereo 1 -sidstereoaddress 0xde00 -digimax -digimaxbase 0xde20" ; do
+	if [ "$CARTS" = none ] ; then
+		printf 'no cartridges: '
+		CARTS=
+	else
+		printf 'REU, SID, DigiMAX: '
+	fi
+	"$X64" -default -console -directory "$DATA/C64:$DATA/DRIVES" \
+		-sounddev dummy -warp -limitframes $FRAMES $CARTS \
+		-autostart "$SCRATCH/io.prg" 2>&1 |
+		sed -n 's/^Frame limit: //p'
+done
@@ -0,0 +1,208 @@
+/*
+ * render.c - Compare the RGB kernels of the 1x1 and 2x2 PAL renderers.
+ *
+ * Built and run by render.sh.  Renders random frames at 16 and 32 bpp with
+ * the per-pixel renderers and, if the CPU has AVX2, with the AVX2 kernels,
+ * and checks that both give exactly the same pixels.  The speed of each is
+ * printed as frames per second.
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log.h"
+#include "render1x1pal.h"
+#include "render2x2pal.h"
+#include "rendersimd.h"
+#include "types.h"
+#include "video.h"
+#include "video-color.h"
+
+#define WIDTH 384
+#define HEIGHT 272
+#define CHECK_FRAMES 32
+
+DWORD gamma_red[256 * 3];
+DWORD gamma_grn[256 * 3];
+DWORD gamma_blu[256 * 3];
+DWORD gamma_red_fac[256 * 3 * 2];
+DWORD gamma_grn_fac[256 * 3 * 2];
+DWORD gamma_blu_fac[256 * 3 * 2];
+DWORD alpha = 0xff000000;
+
+int log_message(log_t log, const char *format, ...)
+{
+    return 0;
+}
+
+typedef void render_func_t(video_render_color_tables_t *color_tab,
+                           const BYTE *src, BYTE *trg,
+                           const unsigned int width, const unsigned int height,
+                           const unsigned int xs, const unsigned int ys,
+                           const unsigned int xt, const unsigned int yt,
+                           const unsigned int pitchs, const unsigned int pitcht,
+                           video_render_config_t *config);
+
+static video_render_config_t config;
+static viewport_t viewport;
+static BYTE src[(HEIGHT + 2) * WIDTH];
+static BYTE trg[HEIGHT * 2 * WIDTH * 2 * 4];
+static unsigned int seed = 1;
+
+static unsigned int rnd(unsigned int n)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % n;
+}
+
+static void init_tables(void)
+{
+    video_render_color_tables_t *ct = &config.color_tables;
+    unsigned int i;
+
+    for (i = 0; i < 256 * 3; i++) {
+        gamma_red[i] = rnd(0x10000) << 16 | rnd(0x10000);
+        gamma_grn[i] = rnd(0x10000) << 16 | rnd(0x10000);
+        gamma_blu[i] = rnd(0x10000) << 16 | rnd(0x10000);
+    }
+    for (i = 0; i < 256 * 3 * 2; i++) {
+        gamma_red_fac[i] = rnd(0x10000) << 16 | rnd(0x10000);
+        gamma_grn_fac[i] = rnd(0x10000) << 16 | rnd(0x10000);
+        gamma_blu_fac[i] = rnd(0x10000) << 16 | rnd(0x10000);
+    }
+    for (i = 0; i < 256; i++) {
+        ct->ytableh[i] = rnd(128 << 16) / 2;
+        ct->ytablel[i] = rnd(128 << 16) / 4;
+        ct->cbtable[i] = (SDWORD)rnd(65536) - 32768;
+        ct->cbtable_odd[i] = (SDWORD)rnd(65536) - 32768;
+        ct->crtable[i] = (SDWORD)rnd(65536) - 32768;
+        ct->crtable_odd[i] = (SDWORD)rnd(65536) - 32768;
+    }
+    config.video_resources.pal_oddlines_offset = 1000;
+    config.video_resources.pal_scanlineshade = 667;
+    viewport.first_line = 0;
+    viewport.last_line = HEIGHT * 2;
+    for (i = 0; i < sizeof(src); i++) {
+        src[i] = (BYTE)rnd(16);
+    }
+}
+
+static void render_16_2x2(video_render_color_tables_t *color_tab,
+                          const BYTE *src, BYTE *trg,
+                          const unsigned int width, const unsigned int height,
+                          const unsigned int xs, const unsigned int ys,
+                          const unsigned int xt, const unsigned int yt,
+                          const unsigned int pitchs, const unsigned int pitcht,
+                          video_render_config_t *config)
+{
+    render_16_2x2_pal(color_tab, src, trg, width, height, xs, ys, xt, yt,
+                      pitchs, pitcht, &viewport, config);
+}
+
+static void render_32_2x2(video_render_color_tables_t *color_tab,
+                          const BYTE *src, BYTE *trg,
+                          const unsigned int width, const unsigned int height,
+                          const unsigned int xs, const unsigned int ys,
+                          const unsigned int xt, const unsigned int yt,
+                          const unsigned int pitchs, const unsigned int pitcht,
+                          video_render_config_t *config)
+{
+    render_32_2x2_pal(color_tab, src, trg, width, height, xs, ys, xt, yt,
+                      pitchs, pitcht, &viewport, config);
+}
+
+/* Render `frames' frames of random size and position and append them to
+   `out', or render full frames when `out' is NULL.  Sizes and target
+   positions are multiplied by `scale'.  */
+static void render(render_func_t *func, unsigned int bpp, unsigned int scale,
+                   unsigned int frames, BYTE *out)
+{
+    unsigned int i;
+
+    seed = 2;
+    for (i = 0; i < frames; i++) {
+        unsigned int xs = out ? rnd(8) : 0;
+        unsigned int ys = out ? 1 + rnd(4) : 1;
+        unsigned int xt = out ? rnd(5 * scale) : 0;
+        unsigned int yt = out ? rnd(3 * scale) : 0;
+        unsigned int w = (out ? 100 + rnd(WIDTH - 120) : WIDTH - 16) * scale;
+        unsigned int h = (out ? 10 + rnd(200) : HEIGHT - 8) * scale;
+
+        memset(trg, 0, sizeof(trg));
+        memset(config.color_tables.line_yuv_0, 0,
+               sizeof(config.color_tables.line_yuv_0));
+        memset(config.color_tables.prevrgbline, 0,
+               sizeof(config.color_tables.prevrgbline));
+        func(&config.color_tables, src + WIDTH, trg, w, h, xs, ys, xt, yt,
+             WIDTH, WIDTH * 2 * bpp, &config);
+        if (out) {
+            memcpy(out + i * sizeof(trg), trg, sizeof(trg));
+        }
+    }
+}
+
+static const char *level_name(int level)
+{
+    return level == RENDER_SIMD_AVX2 ? "AVX2" : "per pixel";
+}
+
+int main(int argc, char **argv)
+{
+    static const struct {
+        const char *name;
+        render_func_t *func;
+        unsigned int bpp;
+        unsigned int scale;
+    } renderers[] = {
+        { "1x1 16 bpp", render_16_1x1_pal, 2, 1 },
+        { "1x1 32 bpp", render_32_1x1_pal, 4, 1 },
+        { "2x2 16 bpp", render_16_2x2, 2, 2 },
+        { "2x2 32 bpp", render_32_2x2, 4, 2 }
+    };
+    unsigned int frames = argc > 1 ? (unsigned int)atoi(argv[1]) : 1000;
+    unsigned int r;
+    int level;
+    int status = 0;
+    BYTE *ref = malloc(CHECK_FRAMES * sizeof(trg));
+    BYTE *out = malloc(CHECK_FRAMES * sizeof(trg));
+
+    if (ref == NULL || out == NULL) {
+        return 2;
+    }
+
+    init_tables();
+
+    for (r = 0; r < sizeof(renderers) / sizeof(renderers[0]); r++) {
+        for (level = RENDER_SIMD_NONE; level <= RENDER_SIMD_AVX2; level++) {
+            clock_t start;
+            double secs;
+
+            render_simd_init(level);
+            if (render_simd_level() != level) {
+                continue;
+            }
+
+            render(renderers[r].func, renderers[r].bpp, renderers[r].scale,
+                   CHECK_FRAMES, level == RENDER_SIMD_NONE ? ref : out);
+            if (level != RENDER_SIMD_NONE
+                && memcmp(ref, out, CHECK_FRAMES * sizeof(trg)) != 0) {
+                printf("%s %s: pixels differ\n", renderers[r].name,
+                       level_name(level));
+                status = 1;
+            }
+
+            start = clock();
+            render(renderers[r].func, renderers[r].bpp, renderers[r].scale,
+                   frames, NULL);
+            secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+            printf("%s %s: %.0f frames/s\n", renderers[r].name,
+                   level_name(level), secs > 0 ? frames / secs : 0.0);
+        }
+    }
+
+    return status;
+}
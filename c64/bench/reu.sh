@@ -0,0 +1,43 @@
+#!/bin/sh
+
+# Emulation speed of x64 while a REU moves blocks of memory.
+#
+#	reu.sh x64 [frames]
+#
+# x64 runs a BASIC loop that has a 512K REU stash, fetch, swap and verify
+# blocks of up to 40K in warp mode for the given number of frames (default
+# 3000) and logs the speed it reached.  Most of the blocks are in plain
+# RAM; one goes to the screen in the VIC-II bank and one is filled from
+# a fixed REU address.
+# petcat is taken from the directory of x64.
+
+if [ $# -lt 1 ] ; then
+	echo "usage: $0 x64 [frames]" >&2
+	exit 2
+fi
+
+X64=`cd \`dirname $1\` && pwd`/`basename $1`
+PETCAT=`dirname $X64`/petcat
+DATA=`dirname $X64`/../data
+FRAMES=${2:-3000}
+
+SCRATCH="${TMPDIR:-/tmp}/vice-reu.$$"
+mkdir "$SCRATCH" || exit 1
+trap 'rm -rf "$SCRATCH"' 0
+trap 'exit 1' 1 2 15
+
+# The registers $df02-$df08 (host address, REU address and bank, length),
+# the address control register and the command for every operation.
+cat > "$SCRATCH/loop.bas" <<EOF
+10 forj=1to8:fork=2to8:readv:poke57088+k,v:next
+20 reada,c:poke57098,a:poke57089,c:next:restore:goto10
+30 data0,64,0,0,0,0,128,0,144,0,64,0,0,0,0,128,0,145,0,64,0,0,0,0,128,0,147
+40 data0,128,0,0,1,0,32,0,146,0,32,0,0,2,0,160,0,144,0,32,0,0,2,0,160,0,145
+50 data0,4,0,0,2,0,4,0,145,0,192,0,0,3,0,16,64,145
+EOF
+"$PETCAT" -w2 -o "$SCRATCH/loop.prg" -- "$SCRATCH/loop.bas" > /dev/null 2>&1 || exit 1
+
+"$X64" -default -console -directory "$DATA/C64:$DATA/DRIVES" \
+	-sounddev dummy -warp -limitframes $FRAMES -reu -reusize 512 \
+	-autostart "$SCRATCH/loop.prg" 2>&1 |
+	sed -n 's/^Frame limit: //p'
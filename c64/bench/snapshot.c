@@ -0,0 +1,357 @@
+/*
+ * snapshot.c - Time saving and restoring a snapshot.
+ *
+ * Built and run by snapshot.sh.
+ *
+ *	snapshot [-disk] [-compress] [-async] iterations file
+ *
+ * A snapshot shaped like the one of a C64 with a 1541 (CPU registers, RAM
+ * and ROMs, chip registers written byte by byte, the drive's RAM and ROM)
+ * is saved to `file' and restored from it the given number of times.
+ * With `-disk' a GCR image of 84 half tracks is added, as with a disk
+ * image attached.  The memory contents are made of runs, repeated pages
+ * and random bytes, roughly like those of a running machine.  The program
+ * prints the average time until snapshot_close() returns after saving,
+ * the average time to restore, and the size of the file.  It fails if the
+ * data read back differs from the data written.
+ *
+ * snapshot.c is linked in from the VICE source tree and everything else it
+ * uses is stubbed out here.  `-compress' and `-async' set the resources of
+ * the in-memory snapshot code; with older trees, which have none, they
+ * make the program exit with status 3.
+ */
+
+#include "vice.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "resources.h"
+#include "snapshot.h"
+#include "types.h"
+
+#define GCR_TRACK_SIZE  7928
+#define GCR_TRACKS      84
+
+static BYTE ram[0x10000], basic[0x2000], kernal[0x2000], chargen[0x1000];
+static BYTE drive_ram[0x800], drive_rom[0x4000];
+static BYTE gcr[GCR_TRACKS * GCR_TRACK_SIZE];
+static BYTE chip_regs[4][64];
+static DWORD seed = 1;
+
+static const resource_int_t *snapshot_resources;
+
+/* Only newer trees have the resources.  */
+extern int snapshot_resources_init(void) __attribute__((weak));
+extern void snapshot_write_sync(void) __attribute__((weak));
+
+/* ------------------------------------------------------------------------- */
+
+void *lib_malloc(size_t size) { return malloc(size ? size : 1); }
+void *lib_calloc(size_t nmemb, size_t size) { return calloc(nmemb ? nmemb : 1, size ? size : 1); }
+void *lib_realloc(void *p, size_t size) { return realloc(p, size ? size : 1); }
+void lib_free(const void *p) { free((void *)p); }
+char *lib_stralloc(const char *s) { return strcpy(malloc(strlen(s) + 1), s); }
+int ioutil_remove(const char *name) { return unlink(name); }
+void vsync_suspend_speed_eval(void) {}
+FILE *zfile_fopen(const char *name, const char *mode) { return fopen(name, mode); }
+int zfile_fclose(FILE *stream) { return fclose(stream); }
+int cmdline_register_options(const void *options) { return 0; }
+int util_check_null_string(const char *string) { return string == NULL; }
+size_t util_file_length(FILE *fd) { return 0; }
+
+int log_error(int log, const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    return 0;
+}
+
+int log_warning(int log, const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    return 0;
+}
+
+int resources_register_int(const resource_int_t *r)
+{
+    snapshot_resources = r;
+    return 0;
+}
+
+static int set_resource(const char *name, int value)
+{
+    const resource_int_t *r;
+
+    for (r = snapshot_resources; r != NULL && r->name != NULL; r++) {
+        if (strcmp(r->name, name) == 0) {
+            return r->set_func(value, r->param);
+        }
+    }
+    return -1;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static BYTE rnd(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (BYTE)(seed >> 16);
+}
+
+/* Fill `p' with zero runs, copies of earlier pages and random bytes.  */
+static void fill(BYTE *p, size_t size)
+{
+    size_t i, j, n;
+
+    for (i = 0; i < size; i += n) {
+        n = 256;
+        if (n > size - i) {
+            n = size - i;
+        }
+        switch (rnd() % 4) {
+          case 0:
+            memset(p + i, 0, n);
+            break;
+          case 1:
+            if (i >= 256) {
+                memcpy(p + i, p + i - 256 * (1 + rnd() % (i / 256)), n);
+                break;
+            }
+            /* fall through */
+          case 2:
+            for (j = 0; j < n; j++) {
+                p[i + j] = rnd();
+            }
+            break;
+          default:
+            memset(p + i, rnd(), n);
+            break;
+        }
+    }
+}
+
+static void write_chip(snapshot_t *s, const char *name, const BYTE *regs)
+{
+    snapshot_module_t *m = snapshot_module_create(s, name, 1, 0);
+    int i;
+
+    /* Chip modules write their state one value at a time.  */
+    for (i = 0; i < 64; i++) {
+        snapshot_module_write_byte(m, regs[i]);
+    }
+    for (i = 0; i < 16; i++) {
+        snapshot_module_write_word(m, (WORD)(regs[i] * 257));
+        snapshot_module_write_dword(m, (DWORD)regs[i] << 12);
+    }
+    snapshot_module_close(m);
+}
+
+static int read_chip(snapshot_t *s, const char *name, const BYTE *regs)
+{
+    BYTE major, minor, b;
+    WORD w;
+    DWORD d;
+    snapshot_module_t *m = snapshot_module_open(s, name, &major, &minor);
+    int i, bad = 0;
+
+    if (m == NULL) {
+        return 1;
+    }
+    for (i = 0; i < 64; i++) {
+        bad |= snapshot_module_read_byte(m, &b) < 0 || b != regs[i];
+    }
+    for (i = 0; i < 16; i++) {
+        bad |= snapshot_module_read_word(m, &w) < 0
+               || w != (WORD)(regs[i] * 257);
+        bad |= snapshot_module_read_dword(m, &d) < 0
+               || d != (DWORD)regs[i] << 12;
+    }
+    snapshot_module_close(m);
+    return bad;
+}
+
+static void write_memory(snapshot_t *s, const char *name, int ndata,
+                         const BYTE **data, const size_t *size)
+{
+    snapshot_module_t *m = snapshot_module_create(s, name, 1, 0);
+    int i;
+
+    for (i = 0; i < ndata; i++) {
+        snapshot_module_write_byte_array(m, data[i], (unsigned int)size[i]);
+    }
+    snapshot_module_close(m);
+}
+
+static int read_memory(snapshot_t *s, const char *name, int ndata,
+                       const BYTE **data, const size_t *size, BYTE *buf)
+{
+    BYTE major, minor;
+    snapshot_module_t *m = snapshot_module_open(s, name, &major, &minor);
+    int i, bad = 0;
+
+    if (m == NULL) {
+        return 1;
+    }
+    for (i = 0; i < ndata; i++) {
+        bad |= snapshot_module_read_byte_array(m, buf, (unsigned int)size[i]) < 0
+               || memcmp(buf, data[i], size[i]) != 0;
+    }
+    snapshot_module_close(m);
+    return bad;
+}
+
+static const char *chip_names[4] = { "VIC-II", "CIA1", "CIA2", "SID" };
+
+static const BYTE *c64_data[4] = { ram, basic, kernal, chargen };
+static const size_t c64_size[4] = {
+    sizeof(ram), sizeof(basic), sizeof(kernal), sizeof(chargen)
+};
+static const BYTE *drive_data[2] = { drive_ram, drive_rom };
+static const size_t drive_size[2] = { sizeof(drive_ram), sizeof(drive_rom) };
+static const BYTE *gcr_data[1] = { gcr };
+static const size_t gcr_size[1] = { sizeof(gcr) };
+
+static int save(const char *name, int disk)
+{
+    snapshot_t *s = snapshot_create(name, 1, 1, "C64");
+    int i;
+
+    if (s == NULL) {
+        return 1;
+    }
+    for (i = 0; i < 4; i++) {
+        write_chip(s, chip_names[i], chip_regs[i]);
+    }
+    write_memory(s, "C64MEM", 4, c64_data, c64_size);
+    write_memory(s, "DRIVE", 2, drive_data, drive_size);
+    if (disk) {
+        write_memory(s, "GCRIMAGE", 1, gcr_data, gcr_size);
+    }
+    return snapshot_close(s) < 0;
+}
+
+static int restore(const char *name, int disk, BYTE *buf)
+{
+    BYTE major, minor;
+    snapshot_t *s = snapshot_open(name, &major, &minor, "C64");
+    int i, bad = 0;
+
+    if (s == NULL) {
+        return 1;
+    }
+    for (i = 0; i < 4; i++) {
+        bad |= read_chip(s, chip_names[i], chip_regs[i]);
+    }
+    bad |= read_memory(s, "C64MEM", 4, c64_data, c64_size, buf);
+    bad |= read_memory(s, "DRIVE", 2, drive_data, drive_size, buf);
+    if (disk) {
+        bad |= read_memory(s, "GCRIMAGE", 1, gcr_data, gcr_size, buf);
+    }
+    snapshot_close(s);
+    return bad;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    int disk = 0, compress = 0, async = 0, iterations, i;
+    double save_time = 0.0, restore_time = 0.0, start;
+    const char *name;
+    BYTE *buf = malloc(sizeof(gcr));
+    FILE *f;
+    long size;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-disk") == 0) {
+            disk = 1;
+        } else if (strcmp(argv[i], "-compress") == 0) {
+            compress = 1;
+        } else if (strcmp(argv[i], "-async") == 0) {
+            async = 1;
+        } else {
+            break;
+        }
+    }
+    if (argc - i != 2 || (iterations = atoi(argv[i])) <= 0) {
+        fprintf(stderr, "usage: %s [-disk] [-compress] [-async] "
+                "iterations file\n", argv[0]);
+        return 2;
+    }
+    name = argv[i + 1];
+
+    if (compress || async) {
+        if (snapshot_resources_init == NULL) {
+            return 3;
+        }
+        snapshot_resources_init();
+        if (set_resource("SnapshotCompress", compress) < 0
+            || set_resource("SnapshotAsyncWrite", async) < 0) {
+            return 3;
+        }
+    }
+
+    fill(ram, sizeof(ram));
+    fill(basic, sizeof(basic));
+    fill(kernal, sizeof(kernal));
+    fill(chargen, sizeof(chargen));
+    fill(drive_ram, sizeof(drive_ram));
+    fill(drive_rom, sizeof(drive_rom));
+    fill(gcr, sizeof(gcr));
+    for (i = 0; i < 4; i++) {
+        fill(chip_regs[i], sizeof(chip_regs[i]));
+    }
+
+    for (i = 0; i < iterations; i++) {
+        start = now();
+        if (save(name, disk)) {
+            fprintf(stderr, "%s: cannot save\n", name);
+            return 1;
+        }
+        save_time += now() - start;
+
+        /* Let a background write finish outside the measured times.  */
+        if (snapshot_write_sync != NULL) {
+            snapshot_write_sync();
+        }
+
+        start = now();
+        if (restore(name, disk, buf)) {
+            fprintf(stderr, "%s: restored data differs\n", name);
+            return 1;
+        }
+        restore_time += now() - start;
+    }
+
+    f = fopen(name, "rb");
+    if (f == NULL || fseek(f, 0, SEEK_END) < 0 || (size = ftell(f)) < 0) {
+        perror(name);
+        return 1;
+    }
+    fclose(f);
+
+    printf("save %.3f ms, restore %.3f ms, %ld bytes\n",
+           save_time * 1000.0 / iterations,
+           restore_time * 1000.0 / iterations, size);
+    return 0;
+}
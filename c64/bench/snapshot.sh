@@ -0,0 +1,72 @@
+#!/bin/sh
+
+# Compares how fast two VICE source trees save and restore snapshots,
+# e.g. before and after a change to snapshot.c.
+#
+#	snapshot.sh old-vice-src new-vice-src [config-dir [iterations]]
+#
+# snapshot.c is compiled with snapshot.c of each source directory, and
+# with zdeflate.c, zinflate.c and crc32.c where the tree has them.
+# config-dir is where configure put config.h (default: the new source
+# directory); zlib is linked in if it defines HAVE_ZLIB.  Both programs
+# save and restore a C64 and 1541 snapshot the given number of times
+# (default 200), without and with a GCR disk image, in the scratch
+# directory, and print the average save and restore times and the size
+# of the file.  The new program also does so with SnapshotCompress,
+# SnapshotAsyncWrite and both where the tree has them.  The script fails
+# if any snapshot does not read back what was written.  CC and CFLAGS are
+# taken from the environment; the include paths assume a Unix build, and
+# background writing needs -DHAVE_PTHREAD_H if config.h lacks it.
+
+if [ $# -lt 2 ] ; then
+	echo "usage: $0 old-vice-src new-vice-src [config-dir [iterations]]" >&2
+	exit 2
+fi
+
+OLD=$1
+NEW=$2
+CONFIG=${3:-$2}
+ITERATIONS=${4:-200}
+
+LIBS=-lpthread
+if grep '^#define HAVE_ZLIB' "$CONFIG/config.h" > /dev/null 2>&1 ; then
+	LIBS="$LIBS -lz"
+fi
+
+SCRATCH="${TMPDIR:-/tmp}/vice-snapshot.$$"
+mkdir "$SCRATCH" || exit 1
+trap 'rm -rf "$SCRATCH"' 0
+trap 'exit 1' 1 2 15
+
+for TREE in old new ; do
+	if [ $TREE = old ] ; then SRC=$OLD ; else SRC=$NEW ; fi
+	EXTRA=
+	for FILE in zdeflate.c zinflate.c crc32.c ; do
+		if [ -f "$SRC/$FILE" ] ; then
+			EXTRA="$EXTRA $SRC/$FILE"
+		fi
+	done
+	${CC:-cc} ${CFLAGS:--O2} -I"$SRC" -I"$CONFIG" -I"$SRC/arch/unix" \
+		-o "$SCRATCH/$TREE" `dirname $0`/snapshot.c "$SRC/snapshot.c" \
+		$EXTRA $LIBS || exit 1
+done
+
+STATUS=0
+for DISK in "" -disk ; do
+	for MODE in old "" -compress -async "-compress -async" ; do
+		if [ "$MODE" = old ] ; then
+			TREE=old
+			MODE=
+		else
+			TREE=new
+		fi
+		"$SCRATCH/$TREE" $DISK $MODE $ITERATIONS "$SCRATCH/snapshot.vsf" \
+			> "$SCRATCH/out"
+		case $? in
+		  0) echo "$TREE ${DISK:-no disk} ${MODE:-plain}: `cat \"$SCRATCH/out\"`" ;;
+		  3) ;;
+		  *) STATUS=1 ;;
+		esac
+	done
+done
+exit $STATUS
@@ -0,0 +1,114 @@
+#!/bin/sh
+
+# Reference workloads for the `-benchmark' mode of x64 and x64sc.
+#
+#	suite.sh x64 [frames [hashes [options...]]]
+#
+# Every workload is autostarted and run for the given number of frames
+# (default 3000), and the speed, time breakdown and hashes logged by
+# `-benchmark' are printed:
+#
+#	basic	a BASIC loop that calculates and prints
+#	raster	a raster interrupt that splits the screen in four colours
+#	disk	the raster program with 8K of data loaded from a disk image
+#		with true drive emulation
+#	digi	a sawtooth played through the volume register at $d418
+#
+# With a hash file, the frame and sound hashes are compared with the ones
+# in the file and the script fails if any differs; if the file does not
+# exist yet it is written.  The hashes depend on the emulator and on the
+# number of frames; x64.hashes next to this script holds the ones of x64
+# at 3000 frames.  Further options are passed to x64, e.g.
+# `-drivethread' to run the disk workload with the drive thread.
+# petcat and c1541 are taken from the directory of x64.
+
+if [ $# -lt 1 ] ; then
+	echo "usage: $0 x64 [frames [hashes [options...]]]" >&2
+	exit 2
+fi
+
+X64=`cd \`dirname $1\` && pwd`/`basename $1`
+PETCAT=`dirname $X64`/petcat
+C1541=`dirname $X64`/c1541
+DATA=`dirname $X64`/../data
+FRAMES=${2:-3000}
+HASHES=$3
+if [ $# -gt 3 ] ; then
+	shift 3
+else
+	set --
+fi
+
+SCRATCH="${TMPDIR:-/tmp}/vice-suite.$$"
+mkdir "$SCRATCH" || exit 1
+trap 'rm -rf "$SCRATCH"' 0
+trap 'exit 1' 1 2 15
+
+cat > "$SCRATCH/basic.bas" <<'EOF'
+10 fori=1to100:a=sin(i/10)*i:b$=str$(int(a)):printi;b$;a*a:next:goto10
+EOF
+"$PETCAT" -w2 -o "$SCRATCH/basic.prg" -- "$SCRATCH/basic.bas" > /dev/null 2>&1 || exit 1
+
+# 10 SYS2061
+# 080d  SEI / LDA #$00 / STA $02 / LDA #$7F / STA $DC0D / LDA $DC0D
+#       LDA #$01 / STA $D01A / LDA #$1B / STA $D011 / LDA #$40 / STA $D012
+#       LDA #$3A / STA $0314 / LDA #$08 / STA $0315 / CLI
+# 0834  INC $0400 / JMP $0834
+# 083a  LDA #$01 / STA $D019 / LDX $02 / LDA $0859,X / STA $D020 / STA $D021
+#       LDA $085D,X / STA $D012 / INX / TXA / AND #$03 / STA $02 / JMP $EA81
+# 0859  colours 2 5 6 7, next raster lines $70 $A0 $D0 $40
+printf '\001\010\013\010\012\000\236\062\060\066\061\000\000\000' > "$SCRATCH/raster.prg"
+printf '\170\251\000\205\002\251\177\215\015\334\255\015\334\251' >> "$SCRATCH/raster.prg"
+printf '\001\215\032\320\251\033\215\021\320\251\100\215\022\320' >> "$SCRATCH/raster.prg"
+printf '\251\072\215\024\003\251\010\215\025\003\130\356\000\004' >> "$SCRATCH/raster.prg"
+printf '\114\064\010\251\001\215\031\320\246\002\275\131\010\215' >> "$SCRATCH/raster.prg"
+printf '\040\320\215\041\320\275\135\010\215\022\320\350\212\051' >> "$SCRATCH/raster.prg"
+printf '\003\205\002\114\201\352\002\005\006\007\160\240\320\100' >> "$SCRATCH/raster.prg"
+
+cp "$SCRATCH/raster.prg" "$SCRATCH/disk.prg"
+dd if=/dev/zero bs=1024 count=8 2> /dev/null >> "$SCRATCH/disk.prg"
+"$C1541" -format "bench,01" d64 "$SCRATCH/disk.d64" \
+	-write "$SCRATCH/disk.prg" disk > /dev/null 2>&1 || exit 1
+
+# 10 SYS2061
+# 080d  SEI / LDX #$00
+# 0810  TXA / LSR / LSR / LSR / LSR / STA $D418 / LDY #$08
+# 081b  DEY / BNE $081B / INX / JMP $0810
+printf '\001\010\013\010\012\000\236\062\060\066\061\000\000\000' > "$SCRATCH/digi.prg"
+printf '\170\242\000\212\112\112\112\112\215\030\324\240\010\210' >> "$SCRATCH/digi.prg"
+printf '\320\375\350\114\020\010' >> "$SCRATCH/digi.prg"
+
+STATUS=0
+for WORKLOAD in basic raster disk digi ; do
+	if [ $WORKLOAD = disk ] ; then
+		IMAGE="$SCRATCH/disk.d64"
+		DRIVE=-truedrive
+	else
+		IMAGE="$SCRATCH/$WORKLOAD.prg"
+		DRIVE=+truedrive
+	fi
+	"$X64" -default -console -directory "$DATA/C64:$DATA/DRIVES" \
+		-benchmark $FRAMES $DRIVE "$@" -autostart "$IMAGE" 2>&1 |
+		sed -n 's/^Frame limit: //p; s/^Benchmark: //p' > "$SCRATCH/report"
+	if [ ! -s "$SCRATCH/report" ] ; then
+		echo "$WORKLOAD: no report" >&2
+		STATUS=1
+		continue
+	fi
+	sed "s/^/$WORKLOAD: /" "$SCRATCH/report"
+	sed -n "s/^frame hash \([0-9a-f]*\|none\), sound hash \([0-9a-f]*\).*/$WORKLOAD \1 \2/p" \
+		"$SCRATCH/report" >> "$SCRATCH/hashes"
+done
+
+if [ -n "$HASHES" ] ; then
+	if [ -f "$HASHES" ] ; then
+		if ! diff "$HASHES" "$SCRATCH/hashes" ; then
+			echo "hashes differ from $HASHES" >&2
+			STATUS=1
+		fi
+	else
+		cp "$SCRATCH/hashes" "$HASHES"
+	fi
+fi
+
+exit $STATUS
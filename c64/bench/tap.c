@@ -0,0 +1,340 @@
+/*
+ * tap.c - Play and record TAP images through the datasette.
+ *
+ * Built and run by tap.sh.
+ *
+ *	tap -make v0|v1|c16v1|c16v2 image.tap
+ *	tap image.tap
+ *
+ * `-make' writes a TAP image with pseudo-random pulses, long ones among
+ * them.  Given an image, the program plays it to the end and prints a
+ * hash of the clocks of all flux changes.  Then it records a fixed set of
+ * pulses in the middle of the tape, plays the tape again from the start
+ * and prints the hash of the flux changes again, and the hash of the
+ * image file after it has been closed.  C16 images are played as on a
+ * Plus/4.
+ *
+ * datasette.c and tape/tap.c are linked in, and everything else they use
+ * is stubbed out here.  There is only the datasette alarm, so the alarm
+ * context is run by hand.
+ */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alarm.h"
+#include "datasette.h"
+#include "machine.h"
+#include "resources.h"
+#include "tap.h"
+#include "types.h"
+
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME        16777619U
+
+CLOCK maincpu_clk = 0;
+static alarm_context_t alarm_context;
+alarm_context_t *maincpu_alarm_context = &alarm_context;
+void *maincpu_clk_guard = NULL;
+int machine_class = VICE_MACHINE_C64;
+int autostart_ignore_reset = 0;
+
+static alarm_t datasette_alarm;
+static CLOCK start_clk;
+static unsigned long flux_count;
+static DWORD flux_hash;
+
+/* ------------------------------------------------------------------------- */
+
+alarm_t *alarm_new(alarm_context_t *context, const char *name,
+                   alarm_callback_t callback, void *data)
+{
+    datasette_alarm.context = context;
+    datasette_alarm.callback = callback;
+    datasette_alarm.pending_idx = -1;
+    return &datasette_alarm;
+}
+
+void alarm_unset(alarm_t *alarm)
+{
+    if (alarm->pending_idx >= 0) {
+        alarm_context.num_pending_alarms = 0;
+        alarm_context.next_pending_alarm_clk = ~(CLOCK)0;
+        alarm->pending_idx = -1;
+    }
+}
+
+void alarm_log_too_many_alarms(void) {}
+void clk_guard_add_callback(void *guard, void *callback, void *data) {}
+int cmdline_register_options(const void *options) { return 0; }
+void datasette_set_tape_sense(int sense) {}
+
+void datasette_trigger_flux_change(unsigned int on)
+{
+    DWORD clk = (DWORD)(maincpu_clk - start_clk);
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        flux_hash = (flux_hash ^ ((clk >> (i * 8)) & 0xff)) * FNV_PRIME;
+    }
+    flux_count++;
+}
+
+int event_playback_active(void) { return 0; }
+void event_record(unsigned int type, void *data, unsigned int size) {}
+void *lib_malloc(size_t size) { return malloc(size ? size : 1); }
+void *lib_calloc(size_t nmemb, size_t size) { return calloc(nmemb, size); }
+void *lib_realloc(void *p, size_t size) { return realloc(p, size); }
+void lib_free(const void *p) { free((void *)p); }
+char *lib_stralloc(const char *s) { return strcpy(malloc(strlen(s) + 1), s); }
+int log_error(int log, const char *format, ...) { return 0; }
+int log_debug(const char *format, ...) { return 0; }
+int log_open(const char *name) { return 0; }
+long machine_get_cycles_per_second(void) { return 985248; }
+int network_connected(void) { return 0; }
+void network_event_record(unsigned int type, void *data, unsigned int size) {}
+
+int resources_get_int(const char *name, int *value)
+{
+    *value = 1;
+    return 0;
+}
+
+int resources_register_int(const resource_int_t *r)
+{
+    for (; r->name != NULL; r++) {
+        r->set_func(r->factory_value, r->param);
+    }
+    return 0;
+}
+
+void *snapshot_module_create() { return NULL; }
+int snapshot_module_close() { return 0; }
+void *snapshot_module_open() { return NULL; }
+int snapshot_module_read_byte_into_int() { return 0; }
+int snapshot_module_read_dword() { return 0; }
+int snapshot_module_read_dword_into_int() { return 0; }
+int snapshot_module_write_byte() { return 0; }
+int snapshot_module_write_dword() { return 0; }
+void ui_display_tape_control_status(int control) {}
+void ui_display_tape_counter(int counter) {}
+void ui_display_tape_motor_status(int motor) {}
+void ui_set_tape_status(int status) {}
+FILE *zfile_fopen(const char *name, const char *mode) { return fopen(name, mode); }
+int zfile_fclose(FILE *stream) { return fclose(stream); }
+
+size_t util_file_length(FILE *fd)
+{
+    long pos = ftell(fd), size;
+
+    fseek(fd, 0, SEEK_END);
+    size = ftell(fd);
+    fseek(fd, pos, SEEK_SET);
+    return (size_t)size;
+}
+
+int util_fpread(FILE *fd, void *buf, size_t num, long offset)
+{
+    return (fseek(fd, offset, SEEK_SET) < 0 || fread(buf, num, 1, fd) < 1)
+           ? -1 : 0;
+}
+
+int util_fpwrite(FILE *fd, const void *buf, size_t num, long offset)
+{
+    return (fseek(fd, offset, SEEK_SET) < 0 || fwrite(buf, num, 1, fd) < 1)
+           ? -1 : 0;
+}
+
+void util_dword_to_le_buf(BYTE *buf, DWORD data)
+{
+    buf[0] = (BYTE)(data & 0xff);
+    buf[1] = (BYTE)((data >> 8) & 0xff);
+    buf[2] = (BYTE)((data >> 16) & 0xff);
+    buf[3] = (BYTE)((data >> 24) & 0xff);
+}
+
+extern int datasette_resources_init(void);
+
+/* ------------------------------------------------------------------------- */
+
+static void run_until(CLOCK end)
+{
+    CLOCK clk;
+
+    while (alarm_context.num_pending_alarms > 0
+           && alarm_context.pending_alarms[0].clk <= end) {
+        clk = alarm_context.pending_alarms[0].clk;
+        if (clk > maincpu_clk) {
+            maincpu_clk = clk;
+        }
+        datasette_alarm.callback(maincpu_clk - clk, NULL);
+    }
+    if (maincpu_clk < end) {
+        maincpu_clk = end;
+    }
+}
+
+/* Run in the mode `control' until the tape stops or has been wound to
+   `pos', one alarm at a time.  */
+static void wind(tap_t *tap, int control, int pos)
+{
+    datasette_control(control);
+    while (tap->mode == control
+           && (control == DATASETTE_CONTROL_REWIND
+               ? tap->current_file_seek_position > pos
+               : tap->current_file_seek_position < pos)) {
+        if (alarm_context.num_pending_alarms > 0) {
+            run_until(alarm_context.pending_alarms[0].clk);
+        } else {
+            run_until(maincpu_clk + 10000);
+        }
+    }
+    datasette_control(DATASETTE_CONTROL_STOP);
+}
+
+static void play(tap_t *tap, const char *what)
+{
+    start_clk = maincpu_clk;
+    flux_count = 0;
+    flux_hash = FNV_OFFSET_BASIS;
+    wind(tap, DATASETTE_CONTROL_START, tap->size);
+    printf("%s: flux hash %08x (%lu changes)\n", what, (unsigned int)flux_hash,
+           flux_count);
+}
+
+/* Cycles between the write bits, across the short, long and overlong
+   pulses of all versions.  */
+static const CLOCK record_gaps[] = {
+    3, 400, 800, 1200, 2047, 2048, 2055, 2100, 5000, 300000, 640, 100, 384
+};
+
+static int test(const char *name)
+{
+    unsigned int read_only = 0;
+    tap_t *tap;
+    FILE *fd;
+    DWORD hash = FNV_OFFSET_BASIS;
+    long size = 0;
+    int c, i;
+
+    tap = tap_open(name, &read_only);
+    if (tap == NULL || read_only) {
+        fprintf(stderr, "%s: cannot open for writing\n", name);
+        return 1;
+    }
+    if (tap->system == 2) {
+        machine_class = VICE_MACHINE_PLUS4;
+    }
+
+    alarm_context.next_pending_alarm_clk = ~(CLOCK)0;
+    datasette_init();
+    datasette_resources_init();
+    datasette_set_tape_image(tap);
+    datasette_set_motor(1);
+
+    play(tap, "play");
+
+    wind(tap, DATASETTE_CONTROL_REWIND, 0);
+    wind(tap, DATASETTE_CONTROL_START, tap->size / 3);
+    datasette_control(DATASETTE_CONTROL_RECORD);
+    datasette_toggle_write_bit(1);
+    for (i = 0; i < (int)(sizeof(record_gaps) / sizeof(record_gaps[0]));
+         i++) {
+        maincpu_clk += record_gaps[i];
+        datasette_toggle_write_bit(1);
+    }
+    datasette_control(DATASETTE_CONTROL_STOP);
+
+    wind(tap, DATASETTE_CONTROL_REWIND, 0);
+    play(tap, "record");
+    tap_close(tap);
+
+    fd = fopen(name, "rb");
+    if (fd == NULL) {
+        perror(name);
+        return 1;
+    }
+    while ((c = getc(fd)) != EOF) {
+        hash = (hash ^ (DWORD)c) * FNV_PRIME;
+        size++;
+    }
+    fclose(fd);
+    printf("file: hash %08x (%ld bytes)\n", (unsigned int)hash, size);
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int make(const char *type, const char *name)
+{
+    BYTE header[20];
+    FILE *fd;
+    DWORD seed = 1, gap;
+    int version, c16, i, size = 0;
+
+    if (strcmp(type, "v0") == 0 || strcmp(type, "v1") == 0) {
+        c16 = 0;
+    } else if (strcmp(type, "c16v1") == 0 || strcmp(type, "c16v2") == 0) {
+        c16 = 1;
+    } else {
+        return 2;
+    }
+    version = type[strlen(type) - 1] - '0';
+
+    fd = fopen(name, "wb");
+    if (fd == NULL) {
+        perror(name);
+        return 1;
+    }
+    memset(header, 0, sizeof(header));
+    memcpy(header, c16 ? "C16-TAPE-RAW" : "C64-TAPE-RAW", 12);
+    header[12] = (BYTE)version;
+    header[13] = (BYTE)(c16 ? 2 : 0);
+    fwrite(header, 1, sizeof(header), fd);
+
+    for (i = 0; i < 20000; i++) {
+        seed = seed * 1103515245 + 12345;
+        if ((seed >> 16) % 500 == 0) {
+            /* A pause, overflowing in version 0.  */
+            gap = 5000 + (seed >> 8) % 200000;
+            putc(0, fd);
+            size++;
+            if (version > 0) {
+                putc((int)(gap & 0xff), fd);
+                putc((int)((gap >> 8) & 0xff), fd);
+                putc((int)((gap >> 16) & 0xff), fd);
+                size += 3;
+            }
+        } else {
+            putc((int)(0x20 + (seed >> 16) % 0x40), fd);
+            size++;
+        }
+    }
+
+    util_dword_to_le_buf(header + 16, (DWORD)size);
+    fseek(fd, 16, SEEK_SET);
+    fwrite(header + 16, 1, 4, fd);
+    fclose(fd);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int result;
+
+    if (argc == 4 && strcmp(argv[1], "-make") == 0) {
+        result = make(argv[2], argv[3]);
+        if (result != 2) {
+            return result;
+        }
+    }
+    if (argc == 2 && argv[1][0] != '-') {
+        return test(argv[1]);
+    }
+    fprintf(stderr, "usage: %s -make v0|v1|c16v1|c16v2 image.tap\n"
+            "       %s image.tap\n", argv[0], argv[0]);
+    return 2;
+}
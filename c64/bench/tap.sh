@@ -0,0 +1,52 @@
+#!/bin/sh
+
+# Compares the flux timing of the datasette in two VICE source trees, e.g.
+# before and after a change to datasette.c or tape/tap.c.
+#
+#	tap.sh old-vice-src new-vice-src [config-dir]
+#
+# tap.c is compiled with datasette.c and tape/tap.c of each source
+# directory.  config-dir is where configure put config.h (default: the new
+# source directory).  The new program writes a version 0 and a version 1
+# C64 TAP image and a version 1 and a version 2 C16 one.  Both programs
+# play every image, record pulses in the middle of it and play it again,
+# and the script fails if the flux changes or the recorded image differ
+# between them.  CC and CFLAGS are taken from the environment; the
+# include paths assume a Unix build.
+
+if [ $# -lt 2 ] ; then
+	echo "usage: $0 old-vice-src new-vice-src [config-dir]" >&2
+	exit 2
+fi
+
+OLD=$1
+NEW=$2
+CONFIG=${3:-$2}
+
+SCRATCH="${TMPDIR:-/tmp}/vice-tap.$$"
+mkdir "$SCRATCH" || exit 1
+trap 'rm -rf "$SCRATCH"' 0
+trap 'exit 1' 1 2 15
+
+for TREE in old new ; do
+	if [ $TREE = old ] ; then SRC=$OLD ; else SRC=$NEW ; fi
+	${CC:-cc} ${CFLAGS:--O2} -I"$SRC" -I"$CONFIG" -I"$SRC/arch/unix" \
+		-I"$SRC/tape" -o "$SCRATCH/$TREE" `dirname $0`/tap.c \
+		"$SRC/datasette.c" "$SRC/tape/tap.c" -lm || exit 1
+done
+
+STATUS=0
+for TYPE in v0 v1 c16v1 c16v2 ; do
+	"$SCRATCH/new" -make $TYPE "$SCRATCH/$TYPE.tap" || exit 1
+	for TREE in old new ; do
+		cp "$SCRATCH/$TYPE.tap" "$SCRATCH/$TREE.tap"
+		"$SCRATCH/$TREE" "$SCRATCH/$TREE.tap" > "$SCRATCH/$TREE.out" ||
+			STATUS=1
+	done
+	sed "s/^/$TYPE: /" "$SCRATCH/new.out"
+	if ! diff "$SCRATCH/old.out" "$SCRATCH/new.out" ; then
+		echo "$TYPE: flux timing differs" >&2
+		STATUS=1
+	fi
+done
+exit $STATUS
@@ -341,7 +341,9 @@
                     IMPORT_REGISTERS();                               \
                 if (monitor_mask[CALLER])                             \
                     EXPORT_REGISTERS();                               \
-                if (monitor_mask[CALLER] & (MI_BREAK)) {              \
+                if ((monitor_mask[CALLER] & (MI_BREAK))               \
+                    && MONITOR_MAP_TEST(monitor_exec_map,             \
+                                        CALLER, reg_pc)) {            \
                     if (monitor_check_breakpoints(CALLER,             \
                         (WORD)reg_pc)) {                              \
                         monitor_startup(CALLER);                      \
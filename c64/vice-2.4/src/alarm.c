@@ -91,10 +91,9 @@ void alarm_context_time_warp(alarm_context_t *context, CLOCK warp_amount,
             context->pending_alarms[i].clk -= warp_amount;
     }
 
-    if (warp_direction > 0)
-        context->next_pending_alarm_clk += warp_amount;
-    else
-        context->next_pending_alarm_clk -= warp_amount;
+    /* Shifting every pending clock by the same amount keeps the heap
+       ordered, so only the cached head needs refreshing.  */
+    alarm_context_update_next_pending(context);
 }
 
 /* ------------------------------------------------------------------------ */
@@ -161,6 +160,7 @@ void alarm_unset(alarm_t *alarm)
 {
     alarm_context_t *context;
     int idx;
+    unsigned int last;
 
     idx = alarm->pending_idx;
 
@@ -169,32 +169,27 @@ void alarm_unset(alarm_t *alarm)
 
     context = alarm->context;
 
-    if (context->num_pending_alarms > 1) {
-        int last;
+    last = --context->num_pending_alarms;
 
-        last = --context->num_pending_alarms;
+    if (last != (unsigned int)idx) {
+        CLOCK removed_clk = context->pending_alarms[idx].clk;
 
-        if (last != idx) {
-            /* Let's copy the struct by hand to make sure stupid compilers
-               don't do stupid things.  */
-            context->pending_alarms[idx].alarm
-                = context->pending_alarms[last].alarm;
-            context->pending_alarms[idx].clk
-                = context->pending_alarms[last].clk;
+        /* Fill the hole with the last heap entry and restore the heap
+           property from there.  Let's copy the struct by hand to make sure
+           stupid compilers don't do stupid things.  */
+        context->pending_alarms[idx].alarm
+            = context->pending_alarms[last].alarm;
+        context->pending_alarms[idx].clk
+            = context->pending_alarms[last].clk;
 
-            context->pending_alarms[idx].alarm->pending_idx = idx;
-        }
-
-        if (context->next_pending_alarm_idx == idx)
-            alarm_context_update_next_pending(context);
-        else if (context->next_pending_alarm_idx == last)
-            context->next_pending_alarm_idx = idx;
-    } else {
-        context->num_pending_alarms = 0;
-        context->next_pending_alarm_clk = (CLOCK) ~0L;
-        context->next_pending_alarm_idx = -1;
+        if (context->pending_alarms[idx].clk < removed_clk)
+            alarm_context_sift_up(context, (unsigned int)idx);
+        else
+            alarm_context_sift_down(context, (unsigned int)idx);
     }
 
+    alarm_context_update_next_pending(context);
+
     alarm->pending_idx = -1;
 }
 
@@ -74,16 +74,16 @@ struct alarm_context_s {
     /* Alarm list.  */
     struct alarm_s *alarms;
 
-    /* Pending alarm array.  Statically allocated because it's slightly
-       faster this way.  */
+    /* Pending alarm array, kept as a binary min-heap ordered by `clk', so
+       the next alarm to be dispatched is always at index 0.  Alarms due
+       on the same clock are dispatched in no particular order.  Statically
+       allocated because it's slightly faster this way.  */
     pending_alarms_t pending_alarms[ALARM_CONTEXT_MAX_PENDING_ALARMS];
     unsigned int num_pending_alarms;
 
-    /* Clock tick for the next pending alarm.  */
+    /* Clock tick for the next pending alarm (cached copy of
+       `pending_alarms[0].clk', or ~0 if nothing is pending).  */
     CLOCK next_pending_alarm_clk;
-
-    /* Pending alarm number.  */
-    int next_pending_alarm_idx;
 };
 typedef struct alarm_context_s alarm_context_t;
 
@@ -111,36 +111,80 @@ inline static CLOCK alarm_context_next_pending_clk(alarm_context_t *context)
 
 inline static void alarm_context_update_next_pending(alarm_context_t *context)
 {
-    CLOCK next_pending_alarm_clk = (CLOCK)~0L;
-    unsigned int next_pending_alarm_idx;
-    unsigned int i;
+    if (context->num_pending_alarms > 0)
+        context->next_pending_alarm_clk = context->pending_alarms[0].clk;
+    else
+        context->next_pending_alarm_clk = (CLOCK)~0L;
+}
 
-    next_pending_alarm_idx = context->next_pending_alarm_idx;
+/* Move the pending entry at `idx' towards the root of the heap until its
+   parent is not later than it.  */
+inline static void alarm_context_sift_up(alarm_context_t *context,
+                                         unsigned int idx)
+{
+    pending_alarms_t *heap = context->pending_alarms;
+    alarm_t *alarm = heap[idx].alarm;
+    CLOCK clk = heap[idx].clk;
 
-    for (i = 0; i < context->num_pending_alarms; i++) {
-        CLOCK pending_clk = context->pending_alarms[i].clk;
+    while (idx > 0) {
+        unsigned int parent = (idx - 1) >> 1;
 
-        if (pending_clk <= next_pending_alarm_clk) {
-            next_pending_alarm_clk = pending_clk;
-            next_pending_alarm_idx = i;
-        }
+        if (heap[parent].clk <= clk)
+            break;
+
+        heap[idx].alarm = heap[parent].alarm;
+        heap[idx].clk = heap[parent].clk;
+        heap[idx].alarm->pending_idx = idx;
+        idx = parent;
     }
 
-    context->next_pending_alarm_clk = next_pending_alarm_clk;
-    context->next_pending_alarm_idx = next_pending_alarm_idx;
+    heap[idx].alarm = alarm;
+    heap[idx].clk = clk;
+    alarm->pending_idx = idx;
+}
+
+/* Move the pending entry at `idx' away from the root of the heap until
+   neither of its children is earlier than it.  */
+inline static void alarm_context_sift_down(alarm_context_t *context,
+                                           unsigned int idx)
+{
+    pending_alarms_t *heap = context->pending_alarms;
+    unsigned int num = context->num_pending_alarms;
+    alarm_t *alarm = heap[idx].alarm;
+    CLOCK clk = heap[idx].clk;
+
+    while (1) {
+        unsigned int child = (idx << 1) + 1;
+
+        if (child >= num)
+            break;
+
+        /* Pick the earlier child without a hard-to-predict branch.  */
+        child += (child + 1 < num && heap[child + 1].clk < heap[child].clk);
+
+        if (clk <= heap[child].clk)
+            break;
+
+        heap[idx].alarm = heap[child].alarm;
+        heap[idx].clk = heap[child].clk;
+        heap[idx].alarm->pending_idx = idx;
+        idx = child;
+    }
+
+    heap[idx].alarm = alarm;
+    heap[idx].clk = clk;
+    alarm->pending_idx = idx;
 }
 
 inline static void alarm_context_dispatch(alarm_context_t *context,
                                           CLOCK cpu_clk)
 {
     CLOCK offset;
-    unsigned int idx;
     alarm_t *alarm;
 
     offset = (CLOCK)(cpu_clk - context->next_pending_alarm_clk);
 
-    idx = context->next_pending_alarm_idx;
-    alarm = context->pending_alarms[idx].alarm;
+    alarm = context->pending_alarms[0].alarm;
 
     (alarm->callback)(offset, alarm->data);
 }
@@ -169,20 +213,20 @@ inline static void alarm_set(alarm_t *alarm, CLOCK cpu_clk)
 
         context->num_pending_alarms++;
 
-        if (cpu_clk < context->next_pending_alarm_clk) {
-            context->next_pending_alarm_clk = cpu_clk;
-            context->next_pending_alarm_idx = new_idx;
-        }
-
-        alarm->pending_idx = new_idx;
+        alarm_context_sift_up(context, new_idx);
     } else {
         /* Already pending: modify.  */
 
+        CLOCK old_clk = context->pending_alarms[idx].clk;
+
         context->pending_alarms[idx].clk = cpu_clk;
-        if (context->next_pending_alarm_clk > cpu_clk
-            || idx == context->next_pending_alarm_idx)
-            alarm_context_update_next_pending(context);
+        if (cpu_clk < old_clk)
+            alarm_context_sift_up(context, (unsigned int)idx);
+        else if (cpu_clk > old_clk)
+            alarm_context_sift_down(context, (unsigned int)idx);
     }
+
+    context->next_pending_alarm_clk = context->pending_alarms[0].clk;
 }
 
 #endif
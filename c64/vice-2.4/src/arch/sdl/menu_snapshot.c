@@ -36,11 +36,13 @@
 #include "menu_common.h"
 #include "menu_snapshot.h"
 #include "resources.h"
+#include "rewind.h"
 #include "ui.h"
 #include "uifilereq.h"
 #include "uimenu.h"
 #include "util.h"
 #include "vice-event.h"
+#include "vsync.h"
 
 static int save_disks = 1;
 static int save_roms = 0;
@@ -229,6 +231,44 @@ static UI_MENU_CALLBACK(select_history_files_callback)
     return NULL;
 }
 
+UI_MENU_DEFINE_TOGGLE(Rewind)
+
+static UI_MENU_CALLBACK(rewind_callback)
+{
+    if (activated) {
+        double frames = vice_ptr_to_uint(param) * vsync_get_refresh_frequency();
+
+        /* Hotkeys get here outside of a trap, so schedule it.  */
+        if (rewind_trigger((unsigned int)(frames + 0.5)) < 0) {
+            ui_error("Nothing to rewind to.");
+        } else {
+            return sdl_menu_text_exit_ui;
+        }
+    }
+    return NULL;
+}
+
+const ui_menu_entry_t rewind_menu[] = {
+    { "Keep rewind history",
+      MENU_ENTRY_RESOURCE_TOGGLE,
+      toggle_Rewind_callback,
+      NULL },
+    SDL_MENU_ITEM_SEPARATOR,
+    { "Rewind 1 second",
+      MENU_ENTRY_OTHER,
+      rewind_callback,
+      (ui_callback_data_t)1 },
+    { "Rewind 5 seconds",
+      MENU_ENTRY_OTHER,
+      rewind_callback,
+      (ui_callback_data_t)5 },
+    { "Rewind 30 seconds",
+      MENU_ENTRY_OTHER,
+      rewind_callback,
+      (ui_callback_data_t)30 },
+    SDL_MENU_LIST_END
+};
+
 static const ui_menu_entry_t save_snapshot_menu[] = {
     { "Save currently attached disk images",
       MENU_ENTRY_OTHER,
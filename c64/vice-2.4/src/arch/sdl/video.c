@@ -68,6 +68,15 @@ static int sdl_bitdepth;
 static int sdl_limit_mode;
 static int sdl_ui_finalized;
 
+/* Pixels converted per refresh, optionally logged to check how much the
+   partial refresh saves.  */
+#define SDL_REFRESH_STATS_FRAMES 250
+
+static int sdl_refresh_stats;
+static unsigned long sdl_refresh_pixels_frame = 0;
+static unsigned long sdl_refresh_pixels_total = 0;
+static unsigned int sdl_refresh_frames = 0;
+
 /* Custom w/h, used for fullscreen and limiting*/
 static int sdl_custom_width = 0;
 static int sdl_custom_height = 0;
@@ -85,6 +94,11 @@ video_canvas_t *sdl_active_canvas = NULL;
 static int sdl_gl_mode;
 static GLint screen_texture;
 
+/* Canvas and size the texture was last fully uploaded for.  */
+static video_canvas_t *sdl_gl_texture_canvas = NULL;
+static unsigned int sdl_gl_texture_width = 0;
+static unsigned int sdl_gl_texture_height = 0;
+
 static int sdl_gl_aspect_mode;
 static char *aspect_ratio_s = NULL;
 static double aspect_ratio;
@@ -127,6 +141,14 @@ static int set_sdl_bitdepth(int d, void *param)
     return -1;
 }
 
+static int set_sdl_refresh_stats(int v, void *param)
+{
+    sdl_refresh_stats = v ? 1 : 0;
+    sdl_refresh_pixels_total = 0;
+    sdl_refresh_frames = 0;
+    return 0;
+}
+
 static int set_sdl_limit_mode(int v, void *param)
 {
     if ((v < SDL_LIMIT_MODE_OFF) || (v > SDL_LIMIT_MODE_FIXED)) {
@@ -296,6 +318,8 @@ static const resource_int_t resources_int[] = {
       &sdl_window_width, set_sdl_window_width, NULL },
     { "SDLWindowHeight", 0, RES_EVENT_NO, NULL,
       &sdl_window_height, set_sdl_window_height, NULL },
+    { "SDLRefreshStats", 0, RES_EVENT_NO, NULL,
+      &sdl_refresh_stats, set_sdl_refresh_stats, NULL },
 #ifdef HAVE_HWSCALE
     { "SDLGLAspectMode", SDL_ASPECT_MODE_TRUE, RES_EVENT_NO, NULL,
       &sdl_gl_aspect_mode, set_sdl_gl_aspect_mode, NULL },
@@ -340,6 +364,12 @@ static const cmdline_option_t cmdline_options[] = {
     { "-sdlcustomh", SET_RESOURCE, 1, NULL, NULL, "SDLCustomHeight", NULL,
       USE_PARAM_STRING, USE_DESCRIPTION_STRING, IDCLS_UNUSED, IDCLS_UNUSED,
       "<height>", "Set custom resolution height" },
+    { "-sdlrefreshstats", SET_RESOURCE, 0, NULL, NULL, "SDLRefreshStats", (resource_value_t)1,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING, IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Log the number of pixels converted per frame" },
+    { "+sdlrefreshstats", SET_RESOURCE, 0, NULL, NULL, "SDLRefreshStats", (resource_value_t)0,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING, IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Do not log the number of pixels converted per frame" },
 #ifdef HAVE_HWSCALE
     { "-sdlaspectmode", SET_RESOURCE, 1, NULL, NULL, "SDLGLAspectMode", NULL,
       USE_PARAM_STRING, USE_DESCRIPTION_STRING, IDCLS_UNUSED, IDCLS_UNUSED,
@@ -621,6 +651,7 @@ static video_canvas_t *sdl_canvas_create(video_canvas_t *canvas, unsigned int *w
             }
 
             canvas->hwscale_screen = new_screen;
+            sdl_gl_texture_canvas = NULL;
             new_screen = SDL_CreateRGBSurface(SDL_SWSURFACE, new_width, new_height, sdl_bitdepth, rmask, gmask, bmask, amask);
             sdl_gl_set_viewport(new_width, new_height, actual_width, actual_height);
             lightpen_updated = 1;
@@ -708,32 +739,77 @@ video_canvas_t *video_canvas_create(video_canvas_t *canvas, unsigned int *width,
     return canvas;
 }
 
+/* Account for `pixels' converted in this refresh and log the average every
+   `SDL_REFRESH_STATS_FRAMES' refreshes if asked to.  */
+static void sdl_refresh_stats_update(video_canvas_t *canvas, unsigned long pixels)
+{
+    sdl_refresh_pixels_frame = pixels;
+
+    if (!sdl_refresh_stats) {
+        return;
+    }
+
+    sdl_refresh_pixels_total += pixels;
+    if (++sdl_refresh_frames >= SDL_REFRESH_STATS_FRAMES) {
+        unsigned long avg = sdl_refresh_pixels_total / sdl_refresh_frames;
+        unsigned long full = (unsigned long)canvas->width * canvas->height;
+
+        log_message(sdlvideo_log, "Refresh: %lu pixels converted per frame (%lu%% of %ux%u).",
+                    avg, full ? (avg * 100) / full : 0, canvas->width, canvas->height);
+        sdl_refresh_pixels_total = 0;
+        sdl_refresh_frames = 0;
+    }
+}
+
+unsigned long sdl_video_refresh_pixels(void)
+{
+    return sdl_refresh_pixels_frame;
+}
+
 void video_canvas_refresh(struct video_canvas_s *canvas, unsigned int xs, unsigned int ys, unsigned int xi, unsigned int yi, unsigned int w, unsigned int h)
 {
+    SDL_Rect rects[VIDEO_REFRESH_SPANS_MAX];
+    const video_refresh_span_t *spans;
+    unsigned int i, num_spans, sx = 1, sy = 1;
+    unsigned long pixels = 0;
+    int partial;
+
     if ((canvas == NULL) || (canvas->screen == NULL)) {
         return;
     }
 
+    /* Only the lines in `spans' have changed since the last refresh.  The
+       overlays are drawn over the whole area, so redraw all of it then.  */
+    spans = canvas->draw_buffer->refresh_spans;
+    num_spans = canvas->draw_buffer->refresh_span_count;
+
     if (sdl_vsid_state & SDL_VSID_ACTIVE) {
         sdl_vsid_draw();
+        num_spans = 0;
     }
 
     if (sdl_vkbd_state & SDL_VKBD_ACTIVE) {
         sdl_vkbd_draw();
+        num_spans = 0;
     }
 
     if (uistatusbar_state & UISTATUSBAR_ACTIVE) {
         uistatusbar_draw();
+        num_spans = 0;
     }
 
+    partial = (num_spans > 0);
+
     if (canvas->videoconfig->doublesizex) {
-        xi *= (canvas->videoconfig->doublesizex + 1);
-        w *= (canvas->videoconfig->doublesizex + 1);
+        sx = canvas->videoconfig->doublesizex + 1;
+        xi *= sx;
+        w *= sx;
     }
 
     if (canvas->videoconfig->doublesizey) {
-        yi *= (canvas->videoconfig->doublesizey + 1);
-        h *= (canvas->videoconfig->doublesizey + 1);
+        sy = canvas->videoconfig->doublesizey + 1;
+        yi *= sy;
+        h *= sy;
     }
 
     w = MIN(w, canvas->width);
@@ -753,12 +829,43 @@ void video_canvas_refresh(struct video_canvas_s *canvas, unsigned int xs, unsign
         canvas->videoconfig->readable = !(canvas->screen->flags & SDL_HWSURFACE);
     }
 
-    video_canvas_render(canvas, (BYTE *)canvas->screen->pixels, w, h, xs, ys, xi, yi, canvas->screen->pitch, canvas->screen->format->BitsPerPixel);
+    if (!partial) {
+        video_canvas_render(canvas, (BYTE *)canvas->screen->pixels, w, h, xs, ys, xi, yi, canvas->screen->pitch, canvas->screen->format->BitsPerPixel);
+        rects[0].x = xi;
+        rects[0].y = yi;
+        rects[0].w = w;
+        rects[0].h = h;
+        pixels = (unsigned long)w * h;
+        num_spans = 1;
+    } else {
+        unsigned int n = 0;
+
+        for (i = 0; i < num_spans; i++) {
+            unsigned int span_yi = yi + (spans[i].ys - ys) * sy;
+            unsigned int span_h = spans[i].h * sy;
+
+            if (span_yi >= yi + h) {
+                break;
+            }
+            span_h = MIN(span_h, yi + h - span_yi);
+
+            video_canvas_render(canvas, (BYTE *)canvas->screen->pixels, w, span_h, xs, spans[i].ys, xi, span_yi, canvas->screen->pitch, canvas->screen->format->BitsPerPixel);
+            rects[n].x = xi;
+            rects[n].y = span_yi;
+            rects[n].w = w;
+            rects[n].h = span_h;
+            pixels += (unsigned long)w * span_h;
+            n++;
+        }
+        num_spans = n;
+    }
 
     if (SDL_MUSTLOCK(canvas->screen)) {
         SDL_UnlockSurface(canvas->screen);
     }
 
+    sdl_refresh_stats_update(canvas, pixels);
+
 #ifdef HAVE_HWSCALE
     if (canvas->videoconfig->hwscale) {
         const float *v = &(sdl_gl_vertex_coord[sdl_gl_vertex_base]);
@@ -794,7 +901,22 @@ void video_canvas_refresh(struct video_canvas_s *canvas, unsigned int xs, unsign
         glBindTexture(GL_TEXTURE_RECTANGLE_EXT, screen_texture);
         glTexParameteri(GL_TEXTURE_RECTANGLE_EXT, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_RECTANGLE_EXT, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexImage2D (GL_TEXTURE_RECTANGLE_EXT, 0, sdl_gl_mode, canvas->width, canvas->height, 0, sdl_gl_mode, GL_UNSIGNED_BYTE, canvas->screen->pixels);
+
+        /* Only the changed lines need to be uploaded once the texture
+           holds the whole surface.  */
+        if (!partial
+            || sdl_gl_texture_canvas != canvas
+            || sdl_gl_texture_width != canvas->width
+            || sdl_gl_texture_height != canvas->height) {
+            glTexImage2D (GL_TEXTURE_RECTANGLE_EXT, 0, sdl_gl_mode, canvas->width, canvas->height, 0, sdl_gl_mode, GL_UNSIGNED_BYTE, canvas->screen->pixels);
+            sdl_gl_texture_canvas = canvas;
+            sdl_gl_texture_width = canvas->width;
+            sdl_gl_texture_height = canvas->height;
+        } else {
+            for (i = 0; i < num_spans; i++) {
+                glTexSubImage2D(GL_TEXTURE_RECTANGLE_EXT, 0, 0, rects[i].y, canvas->width, rects[i].h, sdl_gl_mode, GL_UNSIGNED_BYTE, (BYTE *)canvas->screen->pixels + rects[i].y * canvas->screen->pitch);
+            }
+        }
 
         glBegin(GL_QUADS);
 
@@ -819,7 +941,7 @@ void video_canvas_refresh(struct video_canvas_s *canvas, unsigned int xs, unsign
         SDL_GL_SwapBuffers();
     } else
 #endif
-    SDL_UpdateRect(canvas->screen, xi, yi, w, h);
+    SDL_UpdateRects(canvas->screen, (int)num_spans, rects);
 }
 
 int video_canvas_set_palette(struct video_canvas_s *canvas, struct palette_s *palette)
@@ -904,6 +1026,7 @@ static void sdl_video_resize(unsigned int w, unsigned int h)
 
         SDL_EventState(SDL_VIDEORESIZE, SDL_IGNORE);
         sdl_active_canvas->hwscale_screen = SDL_SetVideoMode((int)w, (int)h, sdl_bitdepth, flags);
+        sdl_gl_texture_canvas = NULL;
         SDL_EventState(SDL_VIDEORESIZE, SDL_ENABLE);
 
 #ifdef SDL_DEBUG
@@ -1021,6 +1144,12 @@ void video_canvas_destroy(struct video_canvas_s *canvas)
         }
     }
 
+#ifdef HAVE_HWSCALE
+    if (sdl_gl_texture_canvas == canvas) {
+        sdl_gl_texture_canvas = NULL;
+    }
+#endif
+
     lib_free(canvas->fullscreenconfig);
 }
 
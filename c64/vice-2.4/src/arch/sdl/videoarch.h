@@ -90,6 +90,9 @@ extern int sdl_active_canvas_num;
 
 extern void sdl_ui_init_finalize(void);
 
+/* Number of pixels converted by the last refresh */
+extern unsigned long sdl_video_refresh_pixels(void);
+
 /* Modes of resolution limitation */
 #define SDL_LIMIT_MODE_OFF   0
 #define SDL_LIMIT_MODE_MAX   1
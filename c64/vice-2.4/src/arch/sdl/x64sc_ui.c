@@ -94,6 +94,10 @@ static const ui_menu_entry_t x64sc_main_menu[] = {
       MENU_ENTRY_SUBMENU,
       submenu_callback,
       (ui_callback_data_t)snapshot_menu },
+    { "Rewind",
+      MENU_ENTRY_SUBMENU,
+      submenu_callback,
+      (ui_callback_data_t)rewind_menu },
     { "Screenshot",
       MENU_ENTRY_SUBMENU,
       submenu_callback,
@@ -0,0 +1,261 @@
+/*
+ * benchmark.c - Run a fixed number of frames as fast as possible and report.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* `-benchmark <frames>' runs the machine in warp mode with the dummy sound
+   device, draws every frame, and quits after the given number of frames
+   like `-limitframes', which also logs the speed.  On top of that, it logs
+   where the time went and FNV-1a hashes of the last frame and of all the
+   sound samples calculated.  The hashes only depend on the emulation, so
+   two builds that emulate the same give the same hashes.
+
+   The time breakdown samples `benchmark_component' on every SIGPROF, where
+   the system has a profiling timer.  The drive thread is turned off, so the
+   drives run on the thread that is sampled.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "benchmark.h"
+#include "cmdline.h"
+#include "log.h"
+#include "machine.h"
+#include "resources.h"
+#include "screenshot.h"
+#include "translate.h"
+#include "types.h"
+#include "vsync.h"
+
+/* Microseconds between two samples of the time breakdown.  */
+#define BENCHMARK_SAMPLE_USEC 1000
+
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME        16777619U
+
+int benchmark_enabled = 0;
+volatile int benchmark_component = BENCHMARK_CPU;
+
+static const char *component_names[BENCHMARK_NUM] = {
+    "CPU", "VIC-II", "SID", "drive"
+};
+
+static struct video_canvas_s *benchmark_canvas = NULL;
+
+/* Set once the first frame has been run.  */
+static int benchmark_started = 0;
+
+static DWORD sound_hash = FNV_OFFSET_BASIS;
+static unsigned long sound_count = 0;
+
+/* Samples of the time breakdown taken in every component.  */
+static volatile unsigned long component_samples[BENCHMARK_NUM];
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef BENCHMARK_SAMPLING
+static void benchmark_sample(int signo)
+{
+    component_samples[benchmark_component]++;
+}
+#endif
+
+static void benchmark_sampling_start(void)
+{
+#ifdef BENCHMARK_SAMPLING
+    struct itimerval timer;
+
+    signal(SIGPROF, benchmark_sample);
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = BENCHMARK_SAMPLE_USEC;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, NULL);
+#endif
+}
+
+static void benchmark_sampling_stop(void)
+{
+#ifdef BENCHMARK_SAMPLING
+    struct itimerval timer;
+
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 0;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, NULL);
+    signal(SIGPROF, SIG_DFL);
+#endif
+}
+
+static DWORD fnv_hash(DWORD hash, const BYTE *data, unsigned int len)
+{
+    unsigned int i;
+
+    for (i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/* Hash the colour indices of the whole last frame, borders included.  */
+static int benchmark_frame_hash(DWORD *hash)
+{
+    screenshot_t screenshot;
+    unsigned int line;
+
+    if (benchmark_canvas == NULL
+        || machine_screenshot(&screenshot, benchmark_canvas) < 0
+        || screenshot.draw_buffer == NULL) {
+        return -1;
+    }
+
+    *hash = FNV_OFFSET_BASIS;
+    for (line = screenshot.first_displayed_line;
+         line <= screenshot.last_displayed_line; line++) {
+        *hash = fnv_hash(*hash, screenshot.draw_buffer
+                         + line * screenshot.draw_buffer_line_size
+                         + screenshot.x_offset, screenshot.max_width);
+    }
+    return 0;
+}
+
+void benchmark_report(double seconds, CLOCK clocks)
+{
+    unsigned long total = 0;
+    char breakdown[256];
+    int len = 0;
+    int i;
+    DWORD frame_hash;
+
+    if (!benchmark_enabled) {
+        return;
+    }
+
+    benchmark_sampling_stop();
+
+    log_message(LOG_DEFAULT, "Benchmark: %.0f cycles, %.3f MHz.",
+                (double)clocks, clocks / seconds / 1000000.0);
+
+    for (i = 0; i < BENCHMARK_NUM; i++) {
+        total += component_samples[i];
+    }
+    if (total > 0) {
+        for (i = 0; i < BENCHMARK_NUM; i++) {
+            len += sprintf(breakdown + len, "%s%s %.1f%% (%.3f s)",
+                           i ? ", " : "", component_names[i],
+                           100.0 * component_samples[i] / total,
+                           seconds * component_samples[i] / total);
+        }
+        log_message(LOG_DEFAULT, "Benchmark: %s, %lu samples.",
+                    breakdown, total);
+    } else {
+        log_message(LOG_DEFAULT, "Benchmark: no time breakdown on this system.");
+    }
+
+    if (benchmark_frame_hash(&frame_hash) < 0) {
+        log_message(LOG_DEFAULT, "Benchmark: frame hash none, sound hash %08x (%lu samples).",
+                    (unsigned int)sound_hash, sound_count);
+    } else {
+        log_message(LOG_DEFAULT, "Benchmark: frame hash %08x, sound hash %08x (%lu samples).",
+                    (unsigned int)frame_hash, (unsigned int)sound_hash, sound_count);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+void benchmark_init(struct video_canvas_s *canvas)
+{
+    benchmark_canvas = canvas;
+}
+
+void benchmark_start(void)
+{
+    int i;
+
+    if (!benchmark_enabled) {
+        return;
+    }
+
+    benchmark_started = 1;
+    sound_hash = FNV_OFFSET_BASIS;
+    sound_count = 0;
+    for (i = 0; i < BENCHMARK_NUM; i++) {
+        component_samples[i] = 0;
+    }
+    benchmark_sampling_start();
+}
+
+/* The samples are hashed as little endian 16 bit values.  */
+void benchmark_sound_samples(const SWORD *samples, int count)
+{
+    BYTE bytes[2];
+    int i;
+
+    if (!benchmark_started) {
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        bytes[0] = (BYTE)(samples[i] & 0xff);
+        bytes[1] = (BYTE)((samples[i] >> 8) & 0xff);
+        sound_hash = fnv_hash(sound_hash, bytes, 2);
+    }
+    sound_count += count;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_benchmark(const char *param, void *extra_param)
+{
+    int frames = atoi(param);
+
+    if (frames < 1) {
+        return -1;
+    }
+
+    if (resources_set_int("WarpMode", 1) < 0
+        || resources_set_int("RefreshRate", 1) < 0
+        || resources_set_int("Sound", 1) < 0
+        || resources_set_string("SoundDeviceName", "dummy") < 0) {
+        return -1;
+    }
+    resources_set_int("DriveThread", 0);
+
+    vsync_set_frame_limit(frames);
+    benchmark_enabled = 1;
+
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] = {
+    { "-benchmark", CALL_FUNCTION, 1,
+      set_benchmark, NULL, NULL, NULL,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      "<frames>", "Run <frames> frames at full speed without sound output, report the speed and hashes and quit" },
+    { NULL }
+};
+
+int benchmark_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
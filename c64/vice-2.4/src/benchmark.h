@@ -0,0 +1,90 @@
+/*
+ * benchmark.h - Run a fixed number of frames as fast as possible and report.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_BENCHMARK_H
+#define VICE_BENCHMARK_H
+
+#include <signal.h>
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
+#include "types.h"
+
+#if defined(ITIMER_PROF) && defined(SIGPROF)
+#define BENCHMARK_SAMPLING
+#endif
+
+struct video_canvas_s;
+
+/* What the emulator is busy with, for the time breakdown.  Everything that
+   does not say otherwise counts as the CPU.  */
+#define BENCHMARK_CPU   0
+#define BENCHMARK_VIDEO 1
+#define BENCHMARK_SOUND 2
+#define BENCHMARK_DRIVE 3
+#define BENCHMARK_NUM   4
+
+/* Set by `-benchmark', before the emulation starts.  */
+extern int benchmark_enabled;
+extern volatile int benchmark_component;
+
+/* Count the time until the matching `BENCHMARK_LEAVE()' as `component'.
+   `saved' is an int that keeps the component to go back to.  Without a
+   profiling timer there is no time breakdown and they do nothing; the
+   VIC-II of x64sc goes through them on every cycle.  */
+#ifdef BENCHMARK_SAMPLING
+#define BENCHMARK_ENTER(saved, component)        \
+    do {                                         \
+        if (benchmark_enabled) {                 \
+            (saved) = benchmark_component;       \
+            benchmark_component = (component);   \
+        }                                        \
+    } while (0)
+
+#define BENCHMARK_LEAVE(saved)                   \
+    do {                                         \
+        if (benchmark_enabled) {                 \
+            benchmark_component = (saved);       \
+        }                                        \
+    } while (0)
+#else
+#define BENCHMARK_ENTER(saved, component) ((void)(saved))
+#define BENCHMARK_LEAVE(saved) ((void)(saved))
+#endif
+
+/* Called by machines that support benchmarking with the canvas whose last
+   frame is hashed.  */
+extern void benchmark_init(struct video_canvas_s *canvas);
+extern int benchmark_cmdline_options_init(void);
+
+/* Called by the `-limitframes' code at the first frame and with the time
+   and the cycles run when the last frame is done.  */
+extern void benchmark_start(void);
+extern void benchmark_report(double seconds, CLOCK clocks);
+
+/* To be called with every block of sound samples that has been
+   calculated.  */
+extern void benchmark_sound_samples(const SWORD *samples, int count);
+
+#endif
@@ -154,9 +154,30 @@ static void watch_store(WORD addr, BYTE value)
     mem_write_tab[vbank][mem_config][addr >> 8](addr, value);
 }
 
+/* Only the pages holding a watched address go through the watch
+   functions, the others keep the functions of the current configuration.  */
+static void mem_update_tab_watch(void)
+{
+    int i;
+
+    for (i = 0; i <= 0x100; i++) {
+        if (monitor_load_pages[e_comp_space][i & 0xff]) {
+            mem_read_tab_watch[i] = watch_read;
+        } else {
+            mem_read_tab_watch[i] = mem_read_tab[mem_config][i];
+        }
+        if (monitor_store_pages[e_comp_space][i & 0xff]) {
+            mem_write_tab_watch[i] = watch_store;
+        } else {
+            mem_write_tab_watch[i] = mem_write_tab[vbank][mem_config][i];
+        }
+    }
+}
+
 void mem_toggle_watchpoints(int flag, void *context)
 {
     if (flag) {
+        mem_update_tab_watch();
         _mem_read_tab_ptr = mem_read_tab_watch;
         _mem_write_tab_ptr = mem_write_tab_watch;
     } else {
@@ -189,6 +210,7 @@ void mem_update_config(int config)
     mem_config = config;
 
     if (watchpoints_active) {
+        mem_update_tab_watch();
         _mem_read_tab_ptr = mem_read_tab_watch;
         _mem_write_tab_ptr = mem_write_tab_watch;
     } else {
@@ -240,6 +262,9 @@ void mem_set_machine_type(unsigned type)
 void mem_set_vbank(int new_vbank)
 {
     vbank = (vbank & ~3) | new_vbank;
+    if (watchpoints_active) {
+        mem_update_tab_watch();
+    }
     vicii_set_vbank(new_vbank & 3);
 }
 
@@ -477,6 +502,19 @@ void ram_store(WORD addr, BYTE value)
     ram_bank[addr] = value;
 }
 
+/* The RAM the page of `addr' is read from (stored to) by `ram_read()'
+   (`ram_store()'), if those are the functions in use for the page, NULL
+   otherwise.  DMA can move blocks through these pages directly.  */
+BYTE *mem_ram_read_base(WORD addr)
+{
+    return _mem_read_tab_ptr[addr >> 8] == ram_read ? ram_bank : NULL;
+}
+
+BYTE *mem_ram_store_base(WORD addr)
+{
+    return _mem_write_tab_ptr[addr >> 8] == ram_store ? ram_bank : NULL;
+}
+
 void ram_hi_store(WORD addr, BYTE value)
 {
     if (vbank == 3) {
@@ -615,11 +653,6 @@ void mem_initialize_memory(void)
 
     mem_limit_init(mem_read_limit_tab);
 
-    for (i = 0; i <= 0x100; i++) {
-        mem_read_tab_watch[i] = watch_read;
-        mem_write_tab_watch[i] = watch_store;
-    }
-
     c128meminit();
 
     /* C64 mode configuration.  */
@@ -749,6 +782,10 @@ void mem_initialize_memory(void)
     c64pla_pport_reset();
 
     cartridge_init_config();
+
+    if (watchpoints_active) {
+        mem_update_tab_watch();
+    }
 }
 
 #ifdef _MSC_VER
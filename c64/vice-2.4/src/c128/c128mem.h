@@ -75,6 +75,8 @@ extern void mem_read_base_set(unsigned int base, unsigned int index, BYTE *mem_p
 
 extern BYTE ram_read(WORD addr);
 extern void ram_store(WORD addr, BYTE value);
+extern BYTE *mem_ram_read_base(WORD addr);
+extern BYTE *mem_ram_store_base(WORD addr);
 
 extern BYTE one_read(WORD addr);
 extern void one_store(WORD addr, BYTE value);
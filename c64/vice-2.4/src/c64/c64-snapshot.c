@@ -37,7 +37,6 @@
 #include "drive-snapshot.h"
 #include "drive.h"
 #include "drivecpu.h"
-#include "ioutil.h"
 #include "joystick.h"
 #include "keyboard.h"
 #include "log.h"
@@ -54,15 +53,9 @@
 #define SNAP_MAJOR 1
 #define SNAP_MINOR 1
 
-int c64_snapshot_write(const char *name, int save_roms, int save_disks, int event_mode)
+/* Write the machine state into `s'.  */
+int c64_snapshot_write_modules(snapshot_t *s, int save_roms, int save_disks, int event_mode)
 {
-    snapshot_t *s;
-
-    s = snapshot_create(name, ((BYTE)(SNAP_MAJOR)), ((BYTE)(SNAP_MINOR)), machine_get_name());
-    if (s == NULL) {
-        return -1;
-    }
-
     sound_snapshot_prepare();
 
     /* Execute drive CPUs to get in sync with the main CPU.  */
@@ -80,30 +73,16 @@ int c64_snapshot_write(const char *name, int save_roms, int save_disks, int even
         || tape_snapshot_write_module(s, save_disks) < 0
         || keyboard_snapshot_write_module(s)
         || joystick_snapshot_write_module(s)) {
-        snapshot_close(s);
-        ioutil_remove(name);
         return -1;
     }
 
-    snapshot_close(s);
     return 0;
 }
 
-int c64_snapshot_read(const char *name, int event_mode)
+/* Restore the machine state from `s'.  On failure the machine is left
+   half restored and has to be reset.  */
+int c64_snapshot_read_modules(snapshot_t *s, int event_mode)
 {
-    snapshot_t *s;
-    BYTE minor, major;
-
-    s = snapshot_open(name, &major, &minor, machine_get_name());
-    if (s == NULL) {
-        return -1;
-    }
-
-    if (major != SNAP_MAJOR || minor != SNAP_MINOR) {
-        log_error(LOG_DEFAULT, "Snapshot version (%d.%d) not valid: expecting %d.%d.", major, minor, SNAP_MAJOR, SNAP_MINOR);
-        goto fail;
-    }
-
     vicii_snapshot_prepare();
 
     if (maincpu_snapshot_read_module(s) < 0
@@ -118,6 +97,45 @@ int c64_snapshot_read(const char *name, int event_mode)
         || tape_snapshot_read_module(s) < 0
         || keyboard_snapshot_read_module(s) < 0
         || joystick_snapshot_read_module(s) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int c64_snapshot_write(const char *name, int save_roms, int save_disks, int event_mode)
+{
+    snapshot_t *s;
+
+    s = snapshot_create(name, ((BYTE)(SNAP_MAJOR)), ((BYTE)(SNAP_MINOR)), machine_get_name());
+    if (s == NULL) {
+        return -1;
+    }
+
+    if (c64_snapshot_write_modules(s, save_roms, save_disks, event_mode) < 0) {
+        snapshot_abort(s);
+        return -1;
+    }
+
+    return snapshot_close(s);
+}
+
+int c64_snapshot_read(const char *name, int event_mode)
+{
+    snapshot_t *s;
+    BYTE minor, major;
+
+    s = snapshot_open(name, &major, &minor, machine_get_name());
+    if (s == NULL) {
+        return -1;
+    }
+
+    if (major != SNAP_MAJOR || minor != SNAP_MINOR) {
+        log_error(LOG_DEFAULT, "Snapshot version (%d.%d) not valid: expecting %d.%d.", major, minor, SNAP_MAJOR, SNAP_MINOR);
+        goto fail;
+    }
+
+    if (c64_snapshot_read_modules(s, event_mode) < 0) {
         goto fail;
     }
 
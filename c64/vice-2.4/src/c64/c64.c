@@ -32,6 +32,7 @@
 #include <stdlib.h>
 
 #include "autostart.h"
+#include "benchmark.h"
 #include "c64-cmdline-options.h"
 #include "c64-resources.h"
 #include "c64-snapshot.h"
@@ -63,6 +64,7 @@
 #include "drive.h"
 #include "drivecpu.h"
 #include "imagecontents.h"
+#include "init.h"
 #include "kbdbuf.h"
 #include "keyboard.h"
 #include "lightpen.h"
@@ -82,6 +84,7 @@
 #include "printer.h"
 #include "psid.h"
 #include "resources.h"
+#include "rewind.h"
 #include "rs232drv.h"
 #include "rsuser.h"
 #include "screenshot.h"
@@ -89,6 +92,7 @@
 #include "sid-cmdline-options.h"
 #include "sid-resources.h"
 #include "sid.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "tape.h"
 #include "traps.h"
@@ -387,7 +391,8 @@ int machine_resources_init(void)
         || c64_glue_resources_init() < 0
         || userport_rtc_resources_init() < 0
         || cartio_resources_init() < 0
-        || cartridge_resources_init() < 0) {
+        || cartridge_resources_init() < 0
+        || rewind_resources_init() < 0) {
         return -1;
     }
     return 0;
@@ -440,7 +445,9 @@ int machine_cmdline_options_init(void)
         || c64_glue_cmdline_options_init() < 0
         || userport_rtc_cmdline_options_init() < 0
         || cartio_cmdline_options_init() < 0
-        || cartridge_cmdline_options_init() < 0) {
+        || cartridge_cmdline_options_init() < 0
+        || rewind_cmdline_options_init() < 0
+        || benchmark_cmdline_options_init() < 0) {
         return -1;
     }
     return 0;
@@ -476,6 +483,22 @@ void machine_setup_context(void)
     machine_printer_setup_context(&machine_context);
 }
 
+/* The rewind history leaves out ROMs and disk images.  */
+static int c64_rewind_write(snapshot_t *s)
+{
+    return c64_snapshot_write_modules(s, 0, 0, 0);
+}
+
+static int c64_rewind_read(snapshot_t *s)
+{
+    if (c64_snapshot_read_modules(s, 0) < 0) {
+        return -1;
+    }
+
+    sound_snapshot_finish();
+    return 0;
+}
+
 /* C64-specific initialization.  */
 int machine_specific_init(void)
 {
@@ -483,9 +506,11 @@ int machine_specific_init(void)
 
     c64_log = log_open("C64");
 
+    init_profile_begin(INIT_PROFILE_ROM_LOAD);
     if (mem_load() < 0) {
         return -1;
     }
+    init_profile_end(INIT_PROFILE_ROM_LOAD);
 
     /* Setup trap handling.  */
     traps_init();
@@ -545,6 +570,12 @@ int machine_specific_init(void)
     vsync_init(machine_vsync_hook);
     vsync_set_machine_parameter(machine_timing.rfsh_per_sec, machine_timing.cycles_per_sec);
 
+    /* Initialize the rewind history.  */
+    rewind_init(c64_rewind_write, c64_rewind_read);
+
+    /* Hash the VIC-II frames when benchmarking.  */
+    benchmark_init(vicii_get_canvas());
+
     /* Initialize native sound chip */
     sid_sound_chip_init();
 
@@ -649,6 +680,8 @@ void machine_specific_powerup(void)
 
 void machine_specific_shutdown(void)
 {
+    rewind_shutdown();
+
     /* and the tape */
     tape_image_detach_internal(1);
 
@@ -694,6 +727,8 @@ static void machine_vsync_hook(void)
 
     screenshot_record();
 
+    rewind_vsync_hook();
+
     sub = clk_guard_prevent_overflow(maincpu_clk_guard);
 
     /* The drive has to deal both with our overflowing and its own one, so
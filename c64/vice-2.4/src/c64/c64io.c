@@ -67,16 +67,30 @@ static unsigned int order = 0;
 
 /* ---------------------------------------------------------------------------------------------------------- */
 
-static io_source_list_t c64io_d000_head = { NULL, NULL, NULL };
-static io_source_list_t c64io_d100_head = { NULL, NULL, NULL };
-static io_source_list_t c64io_d200_head = { NULL, NULL, NULL };
-static io_source_list_t c64io_d300_head = { NULL, NULL, NULL };
-static io_source_list_t c64io_d400_head = { NULL, NULL, NULL };
-static io_source_list_t c64io_d500_head = { NULL, NULL, NULL };
-static io_source_list_t c64io_d600_head = { NULL, NULL, NULL };
-static io_source_list_t c64io_d700_head = { NULL, NULL, NULL };
-static io_source_list_t c64io_de00_head = { NULL, NULL, NULL };
-static io_source_list_t c64io_df00_head = { NULL, NULL, NULL };
+/* The devices of one page of the I/O area.  For every address of the page
+   the tables count the devices that can be read or written there (up to 2)
+   and point at the device when there is only one, so io_read() and
+   io_store() only need to walk the list where devices overlap.  The tables
+   are rebuilt whenever a device is registered or unregistered.  */
+typedef struct io_source_page_s {
+    io_source_list_t head;
+    WORD base;
+    BYTE read_count[0x100];
+    BYTE store_count[0x100];
+    io_source_t *read_device[0x100];
+    io_source_t *store_device[0x100];
+} io_source_page_t;
+
+static io_source_page_t c64io_d000_page = { { NULL, NULL, NULL }, 0xd000 };
+static io_source_page_t c64io_d100_page = { { NULL, NULL, NULL }, 0xd100 };
+static io_source_page_t c64io_d200_page = { { NULL, NULL, NULL }, 0xd200 };
+static io_source_page_t c64io_d300_page = { { NULL, NULL, NULL }, 0xd300 };
+static io_source_page_t c64io_d400_page = { { NULL, NULL, NULL }, 0xd400 };
+static io_source_page_t c64io_d500_page = { { NULL, NULL, NULL }, 0xd500 };
+static io_source_page_t c64io_d600_page = { { NULL, NULL, NULL }, 0xd600 };
+static io_source_page_t c64io_d700_page = { { NULL, NULL, NULL }, 0xd700 };
+static io_source_page_t c64io_de00_page = { { NULL, NULL, NULL }, 0xde00 };
+static io_source_page_t c64io_df00_page = { { NULL, NULL, NULL }, 0xdf00 };
 
 static void io_source_detach(io_source_detach_t *source)
 {
@@ -294,9 +308,11 @@ static void io_source_log_collisions(WORD addr, int amount, io_source_list_t *st
     }
 }
 
-static inline BYTE io_read(io_source_list_t *list, WORD addr)
+static inline BYTE io_read(io_source_page_t *page, WORD addr)
 {
+    io_source_list_t *list = &page->head;
     io_source_list_t *current = list->next;
+    io_source_t *device;
     int io_source_counter = 0;
     BYTE realval = 0;
     BYTE retval = 0;
@@ -304,6 +320,19 @@ static inline BYTE io_read(io_source_list_t *list, WORD addr)
 
     vicii_handle_pending_alarms_external(0);
 
+    /* no device or a single one, the same as the walk below */
+    switch (page->read_count[addr & 0xff]) {
+        case 0:
+            return vicii_read_phi1();
+        case 1:
+            device = page->read_device[addr & 0xff];
+            retval = device->read((WORD)(addr & device->address_mask));
+            if (device->io_source_valid && device->io_source_prio != IO_PRIO_LOW) {
+                return retval;
+            }
+            return vicii_read_phi1();
+    }
+
     while (current) {
         if (current->device->read != NULL) {
             if ((addr >= current->device->start_address) && (addr <= current->device->end_address)) {
@@ -356,9 +385,9 @@ static inline BYTE io_read(io_source_list_t *list, WORD addr)
 }
 
 /* peek from i/o area with no side-effects */
-static inline BYTE io_peek(io_source_list_t *list, WORD addr)
+static inline BYTE io_peek(io_source_page_t *page, WORD addr)
 {
-    io_source_list_t *current = list->next;
+    io_source_list_t *current = page->head.next;
 
     while (current) {
         if (addr >= current->device->start_address && addr <= current->device->end_address) {
@@ -374,15 +403,26 @@ static inline BYTE io_peek(io_source_list_t *list, WORD addr)
     return vicii_read_phi1();
 }
 
-static inline void io_store(io_source_list_t *list, WORD addr, BYTE value)
+static inline void io_store(io_source_page_t *page, WORD addr, BYTE value)
 {
     int writes = 0;
     WORD addy = 0xffff;
-    io_source_list_t *current = list->next;
+    io_source_list_t *current = page->head.next;
+    io_source_t *device;
     void (*store)(WORD address, BYTE data) = NULL;
 
     vicii_handle_pending_alarms_external_write();
 
+    /* no device or a single one, the same as the walk below */
+    switch (page->store_count[addr & 0xff]) {
+        case 0:
+            return;
+        case 1:
+            device = page->store_device[addr & 0xff];
+            device->store((WORD)(addr & device->address_mask), value);
+            return;
+    }
+
     while (current) {
         if (current->device->store != NULL) {
             if (addr >= current->device->start_address && addr <= current->device->end_address) {
@@ -406,8 +446,39 @@ static inline void io_store(io_source_list_t *list, WORD addr, BYTE value)
 
 /* ---------------------------------------------------------------------------------------------------------- */
 
+/* Count the devices covering each address of a page.  */
+static void io_source_page_update(io_source_page_t *page)
+{
+    io_source_list_t *current;
+    io_source_t *device;
+    unsigned int i;
+    WORD addr;
+
+    memset(page->read_count, 0, sizeof(page->read_count));
+    memset(page->store_count, 0, sizeof(page->store_count));
+
+    for (current = page->head.next; current; current = current->next) {
+        device = current->device;
+        for (i = 0; i < 0x100; i++) {
+            addr = (WORD)(page->base + i);
+            if (addr < device->start_address || addr > device->end_address) {
+                continue;
+            }
+            if (device->read != NULL && page->read_count[i] < 2) {
+                page->read_count[i]++;
+                page->read_device[i] = device;
+            }
+            if (device->store != NULL && page->store_count[i] < 2) {
+                page->store_count[i]++;
+                page->store_device[i] = device;
+            }
+        }
+    }
+}
+
 io_source_list_t *io_source_register(io_source_t *device)
 {
+    io_source_page_t *page = NULL;
     io_source_list_t *current = NULL;
     io_source_list_t *retval = lib_malloc(sizeof(io_source_list_t));
 
@@ -416,37 +487,38 @@ io_source_list_t *io_source_register(io_source_t *device)
 
     switch (device->start_address & 0xff00) {
         case 0xd000:
-            current = &c64io_d000_head;
+            page = &c64io_d000_page;
             break;
         case 0xd100:
-            current = &c64io_d100_head;
+            page = &c64io_d100_page;
             break;
         case 0xd200:
-            current = &c64io_d200_head;
+            page = &c64io_d200_page;
             break;
         case 0xd300:
-            current = &c64io_d300_head;
+            page = &c64io_d300_page;
             break;
         case 0xd400:
-            current = &c64io_d400_head;
+            page = &c64io_d400_page;
             break;
         case 0xd500:
-            current = &c64io_d500_head;
+            page = &c64io_d500_page;
             break;
         case 0xd600:
-            current = &c64io_d600_head;
+            page = &c64io_d600_page;
             break;
         case 0xd700:
-            current = &c64io_d700_head;
+            page = &c64io_d700_page;
             break;
         case 0xde00:
-            current = &c64io_de00_head;
+            page = &c64io_de00_page;
             break;
         case 0xdf00:
-            current = &c64io_df00_head;
+            page = &c64io_df00_page;
             break;
     }
 
+    current = &page->head;
     while (current->next != NULL) {
         current = current->next;
     }
@@ -456,16 +528,26 @@ io_source_list_t *io_source_register(io_source_t *device)
     retval->next = NULL;
     retval->device->order = order++;
 
+    io_source_page_update(page);
+
     return retval;
 }
 
 void io_source_unregister(io_source_list_t *device)
 {
     io_source_list_t *prev;
+    io_source_list_t *head;
 
     assert(device != NULL);
     DBG(("IO: unregister id:%d name:%s\n", device->device->cart_id, device->device->name));
 
+    /* the device may have been moved since it was registered, so find its
+       page through the list instead of its address */
+    head = device->previous;
+    while (head->previous != NULL) {
+        head = head->previous;
+    }
+
     prev = device->previous;
     prev->next = device->next;
 
@@ -480,70 +562,72 @@ void io_source_unregister(io_source_list_t *device)
     }
 
     lib_free(device);
+
+    io_source_page_update((io_source_page_t *)head);
 }
 
 void cartio_shutdown(void)
 {
     io_source_list_t *current;
 
-    current = c64io_d000_head.next;
+    current = c64io_d000_page.head.next;
     while (current) {
         io_source_unregister(current);
-        current = c64io_d000_head.next;
+        current = c64io_d000_page.head.next;
     }
 
-    current = c64io_d100_head.next;
+    current = c64io_d100_page.head.next;
     while (current) {
         io_source_unregister(current);
-        current = c64io_d100_head.next;
+        current = c64io_d100_page.head.next;
     }
 
-    current = c64io_d200_head.next;
+    current = c64io_d200_page.head.next;
     while (current) {
         io_source_unregister(current);
-        current = c64io_d200_head.next;
+        current = c64io_d200_page.head.next;
     }
 
-    current = c64io_d300_head.next;
+    current = c64io_d300_page.head.next;
     while (current) {
         io_source_unregister(current);
-        current = c64io_d300_head.next;
+        current = c64io_d300_page.head.next;
     }
 
-    current = c64io_d400_head.next;
+    current = c64io_d400_page.head.next;
     while (current) {
         io_source_unregister(current);
-        current = c64io_d400_head.next;
+        current = c64io_d400_page.head.next;
     }
 
-    current = c64io_d500_head.next;
+    current = c64io_d500_page.head.next;
     while (current) {
         io_source_unregister(current);
-        current = c64io_d500_head.next;
+        current = c64io_d500_page.head.next;
     }
 
-    current = c64io_d600_head.next;
+    current = c64io_d600_page.head.next;
     while (current) {
         io_source_unregister(current);
-        current = c64io_d600_head.next;
+        current = c64io_d600_page.head.next;
     }
 
-    current = c64io_d700_head.next;
+    current = c64io_d700_page.head.next;
     while (current) {
         io_source_unregister(current);
-        current = c64io_d700_head.next;
+        current = c64io_d700_page.head.next;
     }
 
-    current = c64io_de00_head.next;
+    current = c64io_de00_page.head.next;
     while (current) {
         io_source_unregister(current);
-        current = c64io_de00_head.next;
+        current = c64io_de00_page.head.next;
     }
 
-    current = c64io_df00_head.next;
+    current = c64io_df00_page.head.next;
     while (current) {
         io_source_unregister(current);
-        current = c64io_df00_head.next;
+        current = c64io_df00_page.head.next;
     }
 }
 
@@ -557,181 +641,181 @@ void cartio_set_highest_order(unsigned int nr)
 BYTE c64io_d000_read(WORD addr)
 {
     DBGRW(("IO: io-d000 r %04x\n", addr));
-    return io_read(&c64io_d000_head, addr);
+    return io_read(&c64io_d000_page, addr);
 }
 
 BYTE c64io_d000_peek(WORD addr)
 {
     DBGRW(("IO: io-d000 p %04x\n", addr));
-    return io_peek(&c64io_d000_head, addr);
+    return io_peek(&c64io_d000_page, addr);
 }
 
 void c64io_d000_store(WORD addr, BYTE value)
 {
     DBGRW(("IO: io-d000 w %04x %02x\n", addr, value));
-    io_store(&c64io_d000_head, addr, value);
+    io_store(&c64io_d000_page, addr, value);
 }
 
 BYTE c64io_d100_read(WORD addr)
 {
     DBGRW(("IO: io-d100 r %04x\n", addr));
-    return io_read(&c64io_d100_head, addr);
+    return io_read(&c64io_d100_page, addr);
 }
 
 BYTE c64io_d100_peek(WORD addr)
 {
     DBGRW(("IO: io-d100 p %04x\n", addr));
-    return io_peek(&c64io_d100_head, addr);
+    return io_peek(&c64io_d100_page, addr);
 }
 
 void c64io_d100_store(WORD addr, BYTE value)
 {
     DBGRW(("IO: io-d100 w %04x %02x\n", addr, value));
-    io_store(&c64io_d100_head, addr, value);
+    io_store(&c64io_d100_page, addr, value);
 }
 
 BYTE c64io_d200_read(WORD addr)
 {
     DBGRW(("IO: io-d200 r %04x\n", addr));
-    return io_read(&c64io_d200_head, addr);
+    return io_read(&c64io_d200_page, addr);
 }
 
 BYTE c64io_d200_peek(WORD addr)
 {
     DBGRW(("IO: io-d200 p %04x\n", addr));
-    return io_peek(&c64io_d200_head, addr);
+    return io_peek(&c64io_d200_page, addr);
 }
 
 void c64io_d200_store(WORD addr, BYTE value)
 {
     DBGRW(("IO: io-d200 w %04x %02x\n", addr, value));
-    io_store(&c64io_d200_head, addr, value);
+    io_store(&c64io_d200_page, addr, value);
 }
 
 BYTE c64io_d300_read(WORD addr)
 {
     DBGRW(("IO: io-d300 r %04x\n", addr));
-    return io_read(&c64io_d300_head, addr);
+    return io_read(&c64io_d300_page, addr);
 }
 
 BYTE c64io_d300_peek(WORD addr)
 {
     DBGRW(("IO: io-d300 p %04x\n", addr));
-    return io_peek(&c64io_d300_head, addr);
+    return io_peek(&c64io_d300_page, addr);
 }
 
 void c64io_d300_store(WORD addr, BYTE value)
 {
     DBGRW(("IO: io-d300 w %04x %02x\n", addr, value));
-    io_store(&c64io_d300_head, addr, value);
+    io_store(&c64io_d300_page, addr, value);
 }
 
 BYTE c64io_d400_read(WORD addr)
 {
     DBGRW(("IO: io-d400 r %04x\n", addr));
-    return io_read(&c64io_d400_head, addr);
+    return io_read(&c64io_d400_page, addr);
 }
 
 BYTE c64io_d400_peek(WORD addr)
 {
     DBGRW(("IO: io-d400 p %04x\n", addr));
-    return io_peek(&c64io_d400_head, addr);
+    return io_peek(&c64io_d400_page, addr);
 }
 
 void c64io_d400_store(WORD addr, BYTE value)
 {
     DBGRW(("IO: io-d400 w %04x %02x\n", addr, value));
-    io_store(&c64io_d400_head, addr, value);
+    io_store(&c64io_d400_page, addr, value);
 }
 
 BYTE c64io_d500_read(WORD addr)
 {
     DBGRW(("IO: io-d500 r %04x\n", addr));
-    return io_read(&c64io_d500_head, addr);
+    return io_read(&c64io_d500_page, addr);
 }
 
 BYTE c64io_d500_peek(WORD addr)
 {
     DBGRW(("IO: io-d500 p %04x\n", addr));
-    return io_peek(&c64io_d500_head, addr);
+    return io_peek(&c64io_d500_page, addr);
 }
 
 void c64io_d500_store(WORD addr, BYTE value)
 {
     DBGRW(("IO: io-d500 w %04x %02x\n", addr, value));
-    io_store(&c64io_d500_head, addr, value);
+    io_store(&c64io_d500_page, addr, value);
 }
 
 BYTE c64io_d600_read(WORD addr)
 {
     DBGRW(("IO: io-d600 r %04x\n", addr));
-    return io_read(&c64io_d600_head, addr);
+    return io_read(&c64io_d600_page, addr);
 }
 
 BYTE c64io_d600_peek(WORD addr)
 {
     DBGRW(("IO: io-d600 p %04x\n", addr));
-    return io_peek(&c64io_d600_head, addr);
+    return io_peek(&c64io_d600_page, addr);
 }
 
 void c64io_d600_store(WORD addr, BYTE value)
 {
     DBGRW(("IO: io-d600 w %04x %02x\n", addr, value));
-    io_store(&c64io_d600_head, addr, value);
+    io_store(&c64io_d600_page, addr, value);
 }
 
 BYTE c64io_d700_read(WORD addr)
 {
     DBGRW(("IO: io-d700 r %04x\n", addr));
-    return io_read(&c64io_d700_head, addr);
+    return io_read(&c64io_d700_page, addr);
 }
 
 BYTE c64io_d700_peek(WORD addr)
 {
     DBGRW(("IO: io-d700 p %04x\n", addr));
-    return io_peek(&c64io_d700_head, addr);
+    return io_peek(&c64io_d700_page, addr);
 }
 
 void c64io_d700_store(WORD addr, BYTE value)
 {
     DBGRW(("IO: io-d700 w %04x %02x\n", addr, value));
-    io_store(&c64io_d700_head, addr, value);
+    io_store(&c64io_d700_page, addr, value);
 }
 
 BYTE c64io_de00_read(WORD addr)
 {
     DBGRW(("IO: io-de00 r %04x\n", addr));
-    return io_read(&c64io_de00_head, addr);
+    return io_read(&c64io_de00_page, addr);
 }
 
 BYTE c64io_de00_peek(WORD addr)
 {
     DBGRW(("IO: io-de00 p %04x\n", addr));
-    return io_peek(&c64io_de00_head, addr);
+    return io_peek(&c64io_de00_page, addr);
 }
 
 void c64io_de00_store(WORD addr, BYTE value)
 {
     DBGRW(("IO: io-de00 w %04x %02x\n", addr, value));
-    io_store(&c64io_de00_head, addr, value);
+    io_store(&c64io_de00_page, addr, value);
 }
 
 BYTE c64io_df00_read(WORD addr)
 {
     DBGRW(("IO: io-df00 r %04x\n", addr));
-    return io_read(&c64io_df00_head, addr);
+    return io_read(&c64io_df00_page, addr);
 }
 
 BYTE c64io_df00_peek(WORD addr)
 {
     DBGRW(("IO: io-df00 p %04x\n", addr));
-    return io_peek(&c64io_df00_head, addr);
+    return io_peek(&c64io_df00_page, addr);
 }
 
 void c64io_df00_store(WORD addr, BYTE value)
 {
     DBGRW(("IO: io-df00 w %04x %02x\n", addr, value));
-    io_store(&c64io_df00_head, addr, value);
+    io_store(&c64io_df00_page, addr, value);
 }
 
 /* ---------------------------------------------------------------------------------------------------------- */
@@ -754,16 +838,16 @@ static void io_source_ioreg_add_onelist(struct mem_ioreg_list_s **mem_ioreg_list
 /* add all registered i/o devices to the list for the monitor */
 void io_source_ioreg_add_list(struct mem_ioreg_list_s **mem_ioreg_list)
 {
-    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d000_head.next);
-    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d100_head.next);
-    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d200_head.next);
-    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d300_head.next);
-    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d400_head.next);
-    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d500_head.next);
-    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d600_head.next);
-    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d700_head.next);
-    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_de00_head.next);
-    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_df00_head.next);
+    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d000_page.head.next);
+    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d100_page.head.next);
+    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d200_page.head.next);
+    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d300_page.head.next);
+    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d400_page.head.next);
+    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d500_page.head.next);
+    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d600_page.head.next);
+    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_d700_page.head.next);
+    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_de00_page.head.next);
+    io_source_ioreg_add_onelist(mem_ioreg_list, c64io_df00_page.head.next);
 }
 
 /* ---------------------------------------------------------------------------------------------------------- */
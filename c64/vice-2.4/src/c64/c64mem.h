@@ -54,6 +54,8 @@ extern void mem_set_vbank(int new_vbank);
 extern BYTE ram_read(WORD addr);
 extern void ram_store(WORD addr, BYTE value);
 extern void ram_hi_store(WORD addr, BYTE value);
+extern BYTE *mem_ram_read_base(WORD addr);
+extern BYTE *mem_ram_store_base(WORD addr);
 
 extern BYTE chargen_read(WORD addr);
 extern void chargen_store(WORD addr, BYTE value);
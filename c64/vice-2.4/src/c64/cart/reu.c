@@ -45,6 +45,7 @@
 
 #include "archdep.h"
 #include "c64export.h"
+#include "c64mem.h"
 #include "cartio.h"
 #include "cartridge.h"
 #include "cmdline.h"
@@ -59,6 +60,7 @@
 #include "translate.h"
 #include "types.h"
 #include "util.h"
+#include "vicii.h"
 
 #define CARTRIDGE_INCLUDE_PRIVATE_API
 #include "reu.h"
@@ -1059,6 +1061,116 @@ inline static BYTE read_from_reu(unsigned int reu_addr)
     return value;
 }
 
+/*! \brief the host memory is read in a block, see reu_dma_block() */
+#define REU_DMA_BLOCK_READ  1
+
+/*! \brief the host memory is written in a block, see reu_dma_block() */
+#define REU_DMA_BLOCK_STORE 2
+
+/*! \brief find out how many bytes a DMA operation can move in one block
+  Moving a block of bytes at once gives the same result as moving them one
+  by one as long as machine_handle_pending_alarms() has nothing to do for
+  any of them, the host accesses go to plain RAM, and the REU addresses
+  neither wrap around nor leave the DRAM.
+
+  \param host_addr
+    The host (computer) address the block starts at
+
+  \param reu_addr
+    The REU address the block starts at
+
+  \param host_step
+    The increment to use for the host address; must be either 0 or 1
+
+  \param reu_step
+    The increment to use for the REU address; must be either 0 or 1
+
+  \param len
+    The number of bytes left in the operation
+
+  \param cycles_per_byte
+    The number of cycles the operation takes for every byte
+
+  \param access
+    REU_DMA_BLOCK_READ and/or REU_DMA_BLOCK_STORE, for the accesses to
+    the host memory
+
+  \param host
+    Set to the host RAM, to be indexed with host addresses
+
+  \param reu
+    Set to the REU RAM at reu_addr
+
+  \return
+    The number of bytes in the block; 0 if the next byte must be
+    moved one by one.
+
+  \remark
+    x64sc runs the VIC-II cycle by cycle while the REU holds BA low, so
+    there are no blocks at all.
+*/
+static int reu_dma_block(WORD host_addr, unsigned int reu_addr, int host_step, int reu_step, int len,
+                         int cycles_per_byte, int access, BYTE **host, BYTE **reu)
+{
+    CLOCK alarm_clk;
+    BYTE *host_ram = NULL;
+    BYTE *host_store_ram;
+    unsigned int dram_addr;
+    unsigned int wrap_addr;
+    int n = len;
+
+    if (reu_ba.enabled) {
+        return 0;
+    }
+
+    /* the last cycle of the block must come before the next VIC-II event */
+    alarm_clk = vicii_pending_alarms_clk_external();
+    if (alarm_clk <= maincpu_clk + cycles_per_byte) {
+        return 0;
+    }
+    if ((CLOCK)n > (alarm_clk - maincpu_clk - 1) / cycles_per_byte) {
+        n = (int)((alarm_clk - maincpu_clk - 1) / cycles_per_byte);
+    }
+
+    if (access & REU_DMA_BLOCK_READ) {
+        host_ram = mem_ram_read_base(host_addr);
+        if (host_ram == NULL) {
+            return 0;
+        }
+    }
+    if (access & REU_DMA_BLOCK_STORE) {
+        host_store_ram = mem_ram_store_base(host_addr);
+        if (host_store_ram == NULL || (host_ram != NULL && host_ram != host_store_ram)) {
+            return 0;
+        }
+        host_ram = host_store_ram;
+    }
+    if (host_step && n > 0x100 - (host_addr & 0xff)) {
+        n = 0x100 - (host_addr & 0xff);
+    }
+
+    dram_addr = reu_addr & (rec_options.dram_wrap_around - 1);
+    if (dram_addr >= rec_options.not_backedup_addresses) {
+        return 0;
+    }
+    if (reu_step) {
+        wrap_addr = reu_addr & 0x0007ffff;
+        if (wrap_addr + 1 >= rec_options.wrap_around) {
+            return 0;
+        }
+        if ((unsigned int)n > rec_options.wrap_around - wrap_addr - 1) {
+            n = rec_options.wrap_around - wrap_addr - 1;
+        }
+        if ((unsigned int)n > rec_options.not_backedup_addresses - dram_addr) {
+            n = rec_options.not_backedup_addresses - dram_addr;
+        }
+    }
+
+    *host = host_ram;
+    *reu = reu_ram + dram_addr;
+    return n;
+}
+
 /* ------------------------------------------------------------------------- */
 
 /*! \brief update the REU registers after a DMA operation
@@ -1151,6 +1263,9 @@ static void reu_dma_update_regs(WORD host_addr, unsigned int reu_addr, int len,
 static void reu_dma_host_to_reu(WORD host_addr, unsigned int reu_addr, int host_step, int reu_step, int len)
 {
     BYTE value;
+    BYTE *host;
+    BYTE *reu;
+    int n;
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "copy ext $%05X %s<= main $%04X%s, $%04X (%d) bytes.",
               reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1159,6 +1274,23 @@ static void reu_dma_host_to_reu(WORD host_addr, unsigned int reu_addr, int host_
     assert(len >= 1);
 
     while (len) {
+        n = reu_dma_block(host_addr, reu_addr, host_step, reu_step, len, 1, REU_DMA_BLOCK_READ, &host, &reu);
+        if (n > 0) {
+            DEBUG_LOG(DEBUG_LEVEL_TRANSFER_LOW_LEVEL, (reu_log, "Transferring block: main $%04X to ext $%05X, %d bytes.", host_addr, reu_addr, n));
+            if (host_step && reu_step) {
+                memcpy(reu, host + host_addr, n);
+            } else if (reu_step) {
+                memset(reu, host[host_addr], n);
+            } else {
+                reu[0] = host[host_addr + (host_step ? n - 1 : 0)];
+            }
+            maincpu_clk += n;
+            host_addr = (host_addr + host_step * n) & 0xffff;
+            reu_addr += reu_step * n;
+            len -= n;
+            continue;
+        }
+
         reu_clk_inc_pre();
         machine_handle_pending_alarms(0);
         value = mem_read(host_addr);
@@ -1194,6 +1326,9 @@ static void reu_dma_host_to_reu(WORD host_addr, unsigned int reu_addr, int host_
 static void reu_dma_reu_to_host(WORD host_addr, unsigned int reu_addr, int host_step, int reu_step, int len)
 {
     BYTE value;
+    BYTE *host;
+    BYTE *reu;
+    int n;
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "copy ext $%05X %s=> main $%04X%s, $%04X (%d) bytes.",
               reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1202,6 +1337,23 @@ static void reu_dma_reu_to_host(WORD host_addr, unsigned int reu_addr, int host_
     assert(len >= 1);
 
     while (len) {
+        n = reu_dma_block(host_addr, reu_addr, host_step, reu_step, len, 1, REU_DMA_BLOCK_STORE, &host, &reu);
+        if (n > 0) {
+            DEBUG_LOG(DEBUG_LEVEL_TRANSFER_LOW_LEVEL, (reu_log, "Transferring block: ext $%05X to main $%04X, %d bytes.", reu_addr, host_addr, n));
+            if (host_step && reu_step) {
+                memcpy(host + host_addr, reu, n);
+            } else if (host_step) {
+                memset(host + host_addr, reu[0], n);
+            } else {
+                host[host_addr] = reu[reu_step ? n - 1 : 0];
+            }
+            maincpu_clk += n;
+            host_addr = (host_addr + host_step * n) & 0xffff;
+            reu_addr += reu_step * n;
+            len -= n;
+            continue;
+        }
+
         DEBUG_LOG(DEBUG_LEVEL_TRANSFER_LOW_LEVEL, (reu_log, "Transferring byte: %x from ext $%05X to main $%04X.", reu_ram[reu_addr % reu_size], reu_addr, host_addr));
         reu_clk_inc_pre();
         value = read_from_reu(reu_addr);
@@ -1237,6 +1389,9 @@ static void reu_dma_swap(WORD host_addr, unsigned int reu_addr, int host_step, i
 {
     BYTE value_from_reu;
     BYTE value_from_c64;
+    BYTE *host;
+    BYTE *reu;
+    int i, n;
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "swap ext $%05X %s<=> main $%04X%s, $%04X (%d) bytes.",
               reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1245,6 +1400,22 @@ static void reu_dma_swap(WORD host_addr, unsigned int reu_addr, int host_step, i
     assert(len >= 1);
 
     while (len) {
+        n = reu_dma_block(host_addr, reu_addr, host_step, reu_step, len, 2, REU_DMA_BLOCK_READ | REU_DMA_BLOCK_STORE, &host, &reu);
+        if (n > 0) {
+            DEBUG_LOG(DEBUG_LEVEL_TRANSFER_LOW_LEVEL, (reu_log, "Exchanging block: main $%04X with ext $%05X, %d bytes.", host_addr, reu_addr, n));
+            host += host_addr;
+            for (i = 0; i < n; i++) {
+                value_from_reu = reu[i * reu_step];
+                reu[i * reu_step] = host[i * host_step];
+                host[i * host_step] = value_from_reu;
+            }
+            maincpu_clk += 2 * n;
+            host_addr = (host_addr + host_step * n) & 0xffff;
+            reu_addr += reu_step * n;
+            len -= n;
+            continue;
+        }
+
         value_from_reu = read_from_reu(reu_addr);
         reu_clk_inc_pre();
         machine_handle_pending_alarms(0);
@@ -1286,6 +1457,10 @@ static void reu_dma_compare(WORD host_addr, unsigned int reu_addr, int host_step
     BYTE value_from_reu;
     BYTE value_from_c64;
 
+    BYTE *host;
+    BYTE *reu;
+    int i, n;
+
     BYTE new_status_or_mask = 0;
 
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "compare ext $%05X %s<=> main $%04X%s, $%04X (%d) bytes.",
@@ -1301,6 +1476,24 @@ static void reu_dma_compare(WORD host_addr, unsigned int reu_addr, int host_step
     /* rec.status &= ~ (REU_REG_R_STATUS_VERIFY_ERROR | REU_REG_R_STATUS_END_OF_BLOCK); */
 
     while (len) {
+        /* the block ends before the first difference, which is handled below */
+        n = reu_dma_block(host_addr, reu_addr, host_step, reu_step, len, 1, REU_DMA_BLOCK_READ, &host, &reu);
+        if (n > 0) {
+            host += host_addr;
+            i = 0;
+            while (i < n && reu[i * reu_step] == host[i * host_step]) {
+                i++;
+            }
+            if (i > 0) {
+                DEBUG_LOG(DEBUG_LEVEL_TRANSFER_LOW_LEVEL, (reu_log, "Comparing block: main $%04X with ext $%05X, %d equal bytes.", host_addr, reu_addr, i));
+                maincpu_clk += i;
+                host_addr = (host_addr + host_step * i) & 0xffff;
+                reu_addr += reu_step * i;
+                len -= i;
+                continue;
+            }
+        }
+
         reu_clk_inc_pre();
         machine_handle_pending_alarms(0);
         value_from_reu = read_from_reu(reu_addr);
@@ -38,7 +38,6 @@
 #include "drive-snapshot.h"
 #include "drive.h"
 #include "drivecpu.h"
-#include "ioutil.h"
 #include "joystick.h"
 #include "keyboard.h"
 #include "log.h"
@@ -78,13 +77,11 @@ int c64_snapshot_write(const char *name, int save_roms, int save_disks, int even
         || c64_glue_snapshot_write_module(s) < 0
         || event_snapshot_write_module(s, event_mode) < 0
         || keyboard_snapshot_write_module(s)) {
-        snapshot_close(s);
-        ioutil_remove(name);
+        snapshot_abort(s);
         return -1;
     }
 
-    snapshot_close(s);
-    return 0;
+    return snapshot_close(s);
 }
 
 int c64_snapshot_read(const char *name, int event_mode)
@@ -128,9 +128,30 @@ static void store_watch(WORD addr, BYTE value)
     mem_write_tab[vbank][mem_config][addr >> 8](addr, value);
 }
 
+/* Only the pages holding a watched address go through the watch
+   functions, the others keep the functions of the current configuration.  */
+static void mem_update_tab_watch(void)
+{
+    int i;
+
+    for (i = 0; i <= 0x100; i++) {
+        if (monitor_load_pages[e_comp_space][i & 0xff]) {
+            mem_read_tab_watch[i] = read_watch;
+        } else {
+            mem_read_tab_watch[i] = mem_read_tab[mem_config][i];
+        }
+        if (monitor_store_pages[e_comp_space][i & 0xff]) {
+            mem_write_tab_watch[i] = store_watch;
+        } else {
+            mem_write_tab_watch[i] = mem_write_tab[vbank][mem_config][i];
+        }
+    }
+}
+
 void mem_toggle_watchpoints(int flag, void *context)
 {
     if (flag) {
+        mem_update_tab_watch();
         _mem_read_tab_ptr = mem_read_tab_watch;
         _mem_write_tab_ptr = mem_write_tab_watch;
     } else {
@@ -189,6 +210,7 @@ void mem_pla_config_changed(void)
     c64pla_config_changed(tape_sense, 1, 0x17);
 
     if (watchpoints_active) {
+        mem_update_tab_watch();
         _mem_read_tab_ptr = mem_read_tab_watch;
         _mem_write_tab_ptr = mem_write_tab_watch;
     } else {
@@ -308,6 +330,19 @@ void ram_store(WORD addr, BYTE value)
     mem_ram[addr] = value;
 }
 
+/* The RAM the page of `addr' is read from (stored to) by `ram_read()'
+   (`ram_store()'), if those are the functions in use for the page, NULL
+   otherwise.  DMA can move blocks through these pages directly.  */
+BYTE *mem_ram_read_base(WORD addr)
+{
+    return _mem_read_tab_ptr[addr >> 8] == ram_read ? mem_ram : NULL;
+}
+
+BYTE *mem_ram_store_base(WORD addr)
+{
+    return _mem_write_tab_ptr[addr >> 8] == ram_store ? mem_ram : NULL;
+}
+
 void ram_hi_store(WORD addr, BYTE value)
 {
     if (vbank == 3) {
@@ -402,11 +437,6 @@ void mem_initialize_memory(void)
     mem_limit_init(mem_read_limit_tab);
 
     /* Default is RAM.  */
-    for (i = 0; i <= 0x100; i++) {
-        mem_read_tab_watch[i] = read_watch;
-        mem_write_tab_watch[i] = store_watch;
-    }
-
     for (i = 0; i < NUM_CONFIGS; i++) {
         mem_set_write_hook(i, 0, zero_store);
         mem_read_tab[i][0] = zero_read;
@@ -515,6 +545,8 @@ void mem_set_vbank(int new_vbank)
     /* Do not override watchpoints on vbank switches.  */
     if (_mem_write_tab_ptr != mem_write_tab_watch) {
         _mem_write_tab_ptr = mem_write_tab[new_vbank][mem_config];
+    } else {
+        mem_update_tab_watch();
     }
 
     vicii_set_vbank(new_vbank);
@@ -38,6 +38,7 @@
 #include "cia.h"
 #include "diskimage.h"
 #include "drive.h"
+#include "drivethread.h"
 #include "drivetypes.h"
 #include "fileio.h"
 #include "gfxoutput.h"
@@ -162,6 +163,10 @@ void machine_drive_stub(void)
 {
 }
 
+void drivethread_sync(void)
+{
+}
+
 /*******************************************************************************
     Cartridge system
 *******************************************************************************/
@@ -663,6 +668,11 @@ int tap_seek_start(tap_t *tap)
     return 0;
 }
 
+int tap_write(tap_t *tap, const BYTE *buf, size_t size)
+{
+    return -1;
+}
+
 int tape_image_create(const char *name, unsigned int type)
 {
     return 0;
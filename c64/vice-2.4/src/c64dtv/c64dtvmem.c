@@ -145,9 +145,30 @@ static void store_watch(WORD addr, BYTE value)
     mem_write_tab[vbank][mem_config][addr >> 8](addr, value);
 }
 
+/* Only the pages holding a watched address go through the watch
+   functions, the others keep the functions of the current configuration.  */
+static void mem_update_tab_watch(void)
+{
+    int i;
+
+    for (i = 0; i <= 0x100; i++) {
+        if (monitor_load_pages[e_comp_space][i & 0xff]) {
+            mem_read_tab_watch[i] = read_watch;
+        } else {
+            mem_read_tab_watch[i] = mem_read_tab[mem_config][i];
+        }
+        if (monitor_store_pages[e_comp_space][i & 0xff]) {
+            mem_write_tab_watch[i] = store_watch;
+        } else {
+            mem_write_tab_watch[i] = mem_write_tab[vbank][mem_config][i];
+        }
+    }
+}
+
 void mem_toggle_watchpoints(int flag, void *context)
 {
     if (flag) {
+        mem_update_tab_watch();
         _mem_read_tab_ptr = mem_read_tab_watch;
         _mem_write_tab_ptr = mem_write_tab_watch;
     } else {
@@ -166,6 +187,7 @@ void mem_pla_config_changed(void)
     c64pla_config_changed(0, 1, 0x17);
 
     if (watchpoints_active) {
+        mem_update_tab_watch();
         _mem_read_tab_ptr = mem_read_tab_watch;
         _mem_write_tab_ptr = mem_write_tab_watch;
     } else {
@@ -293,11 +315,6 @@ void mem_initialize_memory(void)
     mem_color_ram_vicii = NULL;
 
     /* Default is RAM.  */
-    for (i = 0; i <= 0x100; i++) {
-        mem_read_tab_watch[i] = read_watch;
-        mem_write_tab_watch[i] = store_watch;
-    }
-
     for (i = 0; i < NUM_CONFIGS; i++) {
         mem_set_write_hook(i, 0, zero_store);
         mem_read_tab[i][0] = zero_read;
@@ -363,6 +380,10 @@ void mem_initialize_memory(void)
     /* Setup initial memory configuration.  */
     mem_pla_config_changed();
     c64dtvmem_init_config();
+
+    if (watchpoints_active) {
+        mem_update_tab_watch();
+    }
 }
 
 void mem_mmu_translate(unsigned int addr, BYTE **base, int *start, int *limit) {
@@ -443,7 +464,14 @@ void mem_powerup(void)
 void mem_set_vbank(int new_vbank)
 {
     vbank = new_vbank;
-    _mem_write_tab_ptr = mem_write_tab[new_vbank][mem_config];
+
+    /* Do not override watchpoints on vbank switches.  */
+    if (_mem_write_tab_ptr != mem_write_tab_watch) {
+        _mem_write_tab_ptr = mem_write_tab[new_vbank][mem_config];
+    } else {
+        mem_update_tab_watch();
+    }
+
     vicii_set_vbank(new_vbank);
 }
 
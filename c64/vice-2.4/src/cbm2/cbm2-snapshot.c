@@ -38,7 +38,6 @@
 #include "drive-snapshot.h"
 #include "drive.h"
 #include "drivecpu.h"
-#include "ioutil.h"
 #include "joystick.h"
 #include "keyboard.h"
 #include "log.h"
@@ -81,13 +80,11 @@ int cbm2_snapshot_write(const char *name, int save_roms, int save_disks,
         || tape_snapshot_write_module(s, save_disks) < 0
         || keyboard_snapshot_write_module(s)
         || joystick_snapshot_write_module(s)) {
-        snapshot_close(s);
-        ioutil_remove(name);
+        snapshot_abort(s);
         return -1;
     }
 
-    snapshot_close(s);
-    return 0;
+    return snapshot_close(s);
 }
 
 int cbm2_snapshot_read(const char *name, int event_mode)
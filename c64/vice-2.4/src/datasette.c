@@ -35,6 +35,7 @@
 #include "clkguard.h"
 #include "cmdline.h"
 #include "datasette.h"
+#include "lib.h"
 #include "log.h"
 #include "machine.h"
 #include "maincpu.h"
@@ -49,20 +50,34 @@
 
 
 #define MOTOR_DELAY         32000
-#define TAP_BUFFER_LENGTH   100000
 
 /* at least every DATASETTE_MAX_GAP cycle there should be an alarm */ 
 #define DATASETTE_MAX_GAP   100000
 
+/* the index has an entry every DATASETTE_INDEX_STEP pulses */
+#define DATASETTE_INDEX_STEP 256
+
 
 /* Attached TAP tape image.  */
 static tap_t *current_image = NULL;
 
-/* Buffer for the TAP */
-static BYTE tap_buffer[TAP_BUFFER_LENGTH];
+/* Position and tape counter every DATASETTE_INDEX_STEP pulses of the image,
+   to find positions and wind the tape without reading every gap.  */
+typedef struct datasette_index_s {
+    int position;
+    int cycle_counter;
+} datasette_index_t;
+
+static datasette_index_t *datasette_index = NULL;
+static unsigned int datasette_index_size = 0;
+static unsigned int datasette_index_alloc = 0;
 
-/* Pointer and length of the tap-buffer */
-static long next_tap, last_tap;
+/* The index has to be built again after recording or a change of the gap
+   resources.  */
+static int datasette_index_valid = 0;
+
+/* Position in the image the datasette has moved the tape to.  */
+static int datasette_position = 0;
 
 /* State of the datasette motor.  */
 static int datasette_motor = 0;
@@ -105,6 +120,7 @@ static CLOCK fullwave_gap;
 static log_t datasette_log = LOG_ERR;
 
 static void datasette_control_internal(int command);
+static void datasette_index_update(void);
 
 
 static int set_reset_datasette_with_maincpu(int val, void *param)
@@ -116,12 +132,18 @@ static int set_reset_datasette_with_maincpu(int val, void *param)
 static int set_datasette_zero_gap_delay(int val, void *param)
 {
     datasette_zero_gap_delay = val;
+    datasette_index_valid = 0;
+    if (current_image != NULL)
+        datasette_index_update();
     return 0;
 }
 
 static int set_datasette_speed_tuning(int val, void *param)
 {
     datasette_speed_tuning = val;
+    datasette_index_valid = 0;
+    if (current_image != NULL)
+        datasette_index_update();
     return 0;
 }
 
@@ -217,216 +239,280 @@ void datasette_reset_counter(void)
 }
 
 
-inline static int datasette_move_buffer_forward(int offset)
+/* Decode the gap at `position' of the image into `gap'.  Return the length
+   of the gap in bytes, 0 if there is none.  */
+inline static int fetch_gap(int position, CLOCK *gap)
 {
-    /* reads buffer to fit the next gap-read
-       tap_buffer[next_tap] ~ current_file_seek_position
-    */
-    if (next_tap + offset >= last_tap) {
-        if (fseek(current_image->fd, current_image->current_file_seek_position
-            + current_image->offset, SEEK_SET)) {
-            log_error(datasette_log,"Cannot read in tap-file.");
-            return 0;
-        }
-        last_tap = (long)fread(tap_buffer, 1, TAP_BUFFER_LENGTH, current_image->fd);
-        next_tap = 0;
-        if (next_tap >= last_tap)
-            return 0;
+    const BYTE *data = current_image->data;
+
+    if ((position < 0) || (position >= current_image->size))
+        return 0;
+
+    *gap = data[position];
+
+    if ((current_image->version == 0) || *gap) {
+        *gap = (*gap ? (CLOCK)(*gap * 8) : (CLOCK)datasette_zero_gap_delay)
+        + (CLOCK)datasette_speed_tuning;
+        return 1;
     }
-    return 1;
+
+    if (position + 4 > current_image->size)
+        return 0;
+
+    *gap = data[position + 1]
+         + (data[position + 2] << 8)
+         + (data[position + 3] << 16);
+    if (!(*gap))
+        *gap = (CLOCK)datasette_zero_gap_delay;
+
+    return 4;
 }
 
-inline static int datasette_move_buffer_back(int offset)
+/* The change of the tape counter when the datasette plays the pulse `gap'
+   of the image, see datasette_read_gap().  */
+inline static int pulse_counter(CLOCK gap)
 {
-    /* reads buffer to fit the next gap-read at current_file_seek_position-1
-       tap_buffer[next_tap] ~ current_file_seek_position
-    */
-    if (next_tap+offset < 0) {
-        if (current_image->current_file_seek_position >= TAP_BUFFER_LENGTH)
-            next_tap = TAP_BUFFER_LENGTH;
-        else
-            next_tap = current_image->current_file_seek_position;
-        if (fseek(current_image->fd, current_image->current_file_seek_position
-            - next_tap + current_image->offset, SEEK_SET)) {
-            log_error(datasette_log,"Cannot read in tap-file.");
-            return 0;
-        }
-        last_tap = (long)fread(tap_buffer, 1, TAP_BUFFER_LENGTH, current_image->fd);
-        if (next_tap > last_tap)
-            return 0;
+    if (current_image->system != 2)
+        return (int)(gap / 8);
+    if (current_image->version == 1)
+        return (int)(gap / 8) * 2;
+    return (int)(gap * 2 / 8);
+}
+
+static void datasette_index_add(int position, int cycle_counter)
+{
+    if (datasette_index_size == datasette_index_alloc) {
+        datasette_index_alloc = datasette_index_alloc * 2 + 256;
+        datasette_index = lib_realloc(datasette_index, datasette_index_alloc
+                                      * sizeof(datasette_index_t));
     }
-    return 1;
+    datasette_index[datasette_index_size].position = position;
+    datasette_index[datasette_index_size].cycle_counter = cycle_counter;
+    datasette_index_size++;
 }
 
-inline static int fetch_gap(CLOCK *gap, int *direction, long read_tap)
+static void datasette_index_update(void)
 {
-    if ((read_tap >= last_tap) || (read_tap < 0))
-        return -1;
+    int position = 0, counter = 0, len;
+    unsigned int pulses = 0;
+    CLOCK gap;
 
-    *gap = tap_buffer[read_tap];
+    if (datasette_index_valid)
+        return;
 
-    if ((current_image->version == 0) || *gap) {
-        *gap = (*gap ? (CLOCK)(*gap * 8) : (CLOCK)datasette_zero_gap_delay)
-        + (CLOCK)datasette_speed_tuning;
-    } else {
-        if (read_tap >= last_tap - 3) {
-            return -1;
+    datasette_index_size = 0;
+    datasette_index_add(0, 0);
+
+    /* C16 TAPs are only played in version 1 and 2.  */
+    if (current_image->system != 2 || current_image->version == 1
+        || current_image->version == 2) {
+        while ((len = fetch_gap(position, &gap)) > 0 && gap) {
+            position += len;
+            counter += pulse_counter(gap);
+            if (++pulses % DATASETTE_INDEX_STEP == 0)
+                datasette_index_add(position, counter);
         }
-        *direction *= 4;
-        *gap = tap_buffer[read_tap + 1]
-             + (tap_buffer[read_tap + 2] << 8)
-             + (tap_buffer[read_tap + 3] << 16);
-        if (!(*gap))
-            *gap = (CLOCK)datasette_zero_gap_delay;
     }
 
-    return 0;
+    /* We need the length of tape for realistic counter. */
+    current_image->cycle_counter_total = counter;
+    datasette_index_valid = 1;
 }
 
-inline static void read_gap_forward(long *read_tap)
+/* Return the last index entry at or before `position'.  */
+static unsigned int datasette_index_find(int position)
 {
-    *read_tap = next_tap;
-}
+    unsigned int low = 0, high = datasette_index_size;
 
-inline static void read_gap_backward_v0(long *read_tap)
-{
-    *read_tap = next_tap - 1;
+    while (high - low > 1) {
+        unsigned int mid = (low + high) / 2;
+
+        if (datasette_index[mid].position <= position)
+            low = mid;
+        else
+            high = mid;
+    }
+    return low;
 }
 
-inline static int read_gap_backward_v1(long *read_tap)
+/* Return the tape counter at `position' of the image.  */
+static int datasette_counter_at(int position)
 {
-    /* examine, if previous gap was long
-       by rewinding until 3 non-zero-values
-       in a row found, then reading forward (FIXME???)
-    */
-    int non_zeros_in_a_row = 0;
-    long remember_file_seek_position;
+    unsigned int k;
+    int pos, counter, len;
+    CLOCK gap;
 
-    remember_file_seek_position = current_image->current_file_seek_position;
+    datasette_index_update();
 
-    current_image->current_file_seek_position -= 4;
-    next_tap -= 4;
+    k = datasette_index_find(position);
+    pos = datasette_index[k].position;
+    counter = datasette_index[k].cycle_counter;
 
-    while ((non_zeros_in_a_row < 3)
-        && current_image->current_file_seek_position) {
-        if (!datasette_move_buffer_back(-1))
-            return 1;
-        current_image->current_file_seek_position--;
-        next_tap--;
-        if (tap_buffer[next_tap])
-            non_zeros_in_a_row++;
-        else
-            non_zeros_in_a_row = 0;
+    while (pos < position && (len = fetch_gap(pos, &gap)) > 0) {
+        pos += len;
+        counter += pulse_counter(gap);
     }
+    return counter;
+}
 
-    /* now forward */
-    while (current_image->current_file_seek_position
-        < remember_file_seek_position - 4) {
-        if (!datasette_move_buffer_forward(1))
-            return -1;
-        if (tap_buffer[next_tap]) {
-            current_image->current_file_seek_position++;
-            next_tap++;
-        } else {
-            current_image->current_file_seek_position += 4;
-            next_tap += 4;
-        }
-    }
-    if (!datasette_move_buffer_forward(4))
+/* Return the start of the gap that ends at `position', -1 at the start of
+   the tape.  */
+static int datasette_previous_gap(int position)
+{
+    int pos, len;
+    CLOCK gap;
+
+    if (position <= 0)
         return -1;
 
-    *read_tap = next_tap;
-    next_tap += (remember_file_seek_position
-                - current_image->current_file_seek_position);
-    current_image->current_file_seek_position = remember_file_seek_position;
+    /* Only long gaps take more than one byte, and they start with a zero.  */
+    if ((current_image->version == 0) || (position < 4)
+        || current_image->data[position - 4])
+        return position - 1;
 
-    return 0;
+    /* The zero may as well be part of another gap, so go forward from the
+       index entry before.  */
+    datasette_index_update();
+    pos = datasette_index[datasette_index_find(position - 1)].position;
+    while ((len = fetch_gap(pos, &gap)) > 0 && pos + len < position)
+        pos += len;
+
+    return pos;
 }
 
 static CLOCK datasette_read_gap(int direction)
 {
     /* direction 1: forward, -1: rewind */
-    long read_tap = 0;
+    int position, len;
     CLOCK gap = 0;
 
-/*    if (current_image->system != 2 || current_image->version != 1
-        || !fullwave) {*/
-    if (current_image->system != 2 ) {
-        if ((direction < 0) && !datasette_move_buffer_back(direction * 4))
-            return 0;
-        if ((direction > 0 ) && !datasette_move_buffer_forward(direction * 4))
-            return 0;
-
-        if (direction > 0) {
-            read_gap_forward(&read_tap);
-        } else {
-            if ((current_image->version == 0) || (next_tap < 4)
-                || tap_buffer[next_tap-4]) {
-                read_gap_backward_v0(&read_tap);
-            } else {
-                if (read_gap_backward_v1(&read_tap) < 0)
-                    return 0;
-            }
+    if (current_image->system == 2) {
+        if (current_image->version == 1 && fullwave) {
+            fullwave ^= 1;
+            return fullwave_gap;
         }
-        if (fetch_gap(&gap, &direction, read_tap) < 0)
+        if (current_image->version != 1 && current_image->version != 2)
             return 0;
-        next_tap += direction;
-        current_image->current_file_seek_position += direction;
     }
 
-    if (current_image->system == 2 && current_image->version == 1) {
-        if (!fullwave) {
-            if ((direction < 0) && !datasette_move_buffer_back(direction * 4))
-                return 0;
-            if ((direction > 0 ) && !datasette_move_buffer_forward(direction * 4))
-                return 0;
+    position = current_image->current_file_seek_position;
+    if (direction < 0)
+        position = datasette_previous_gap(position);
 
-            if (direction > 0) {
-                read_gap_forward(&read_tap);
-            } else {
-                if ((current_image->version == 0) || (next_tap < 4)
-                    || tap_buffer[next_tap-4]) {
-                    read_gap_backward_v0(&read_tap);
-                } else {
-                    if (read_gap_backward_v1(&read_tap) < 0)
-                        return 0;
-                }
-            }
-            if (fetch_gap(&gap, &direction, read_tap) < 0)
-                return 0;
+    len = fetch_gap(position, &gap);
+    if (len == 0)
+        return 0;
+
+    if (direction > 0)
+        position += len;
+    current_image->current_file_seek_position = position;
+    datasette_position = position;
 
+    if (current_image->system == 2) {
+        if (current_image->version == 1)
             fullwave_gap = gap;
-            next_tap += direction;
-            current_image->current_file_seek_position += direction;
-        } else {
-            gap = fullwave_gap;
-        }
+        else
+            gap *= 2;
         fullwave ^= 1;
-    } else if (current_image->system == 2 && current_image->version == 2) {
-        if ((direction < 0) && !datasette_move_buffer_back(direction * 4))
-            return 0;
-        if ((direction > 0 ) && !datasette_move_buffer_forward(direction * 4))
-            return 0;
+    }
+    return gap;
+}
 
-        if (direction > 0) {
-            read_gap_forward(&read_tap);
-        } else {
-            if ((current_image->version == 0) || (next_tap < 4)
-                || tap_buffer[next_tap-4]) {
-                read_gap_backward_v0(&read_tap);
-            } else {
-                if (read_gap_backward_v1(&read_tap) < 0)
-                    return 0;
+/* Wind the tape in `direction' by the gaps that take up to `max_gap'
+   cycles at play speed, but at least one, over whole index steps where
+   possible.  The change of the tape counter is returned in `counter_step',
+   taken from the index to keep the counter right, and the last gap wound
+   in `last_gap'.  Return the cycles wound, 0 at the end of the tape.  */
+static CLOCK datasette_wind(int direction, CLOCK max_gap, int *counter_step,
+                            CLOCK *last_gap)
+{
+    CLOCK wound = 0, gap;
+    unsigned int k, next, saved_fullwave;
+    int step, saved_position;
+    CLOCK saved_fullwave_gap;
+
+    datasette_index_update();
+
+    *counter_step = 0;
+    *last_gap = 0;
+
+    do {
+        k = datasette_index_find(current_image->current_file_seek_position);
+        next = (direction > 0) ? k + 1 : k - 1;
+        if (datasette_index[k].position
+            == current_image->current_file_seek_position
+            && !(current_image->system == 2 && fullwave
+            && current_image->version == 1)
+            && next < datasette_index_size) {
+            step = datasette_index[next].cycle_counter
+                   - datasette_index[k].cycle_counter;
+            if (step < 0)
+                step = -step;
+            if ((CLOCK)step * 8 < max_gap - wound) {
+                current_image->current_file_seek_position
+                    = datasette_index[next].position;
+                wound += (CLOCK)step * 8;
+                *counter_step += step;
+                *last_gap = 0;
+                continue;
             }
         }
-        if (fetch_gap(&gap, &direction, read_tap) < 0)
-            return 0;
-        gap *= 2;
-        fullwave ^= 1;
-        next_tap += direction;
-        current_image->current_file_seek_position += direction;
+
+        saved_position = current_image->current_file_seek_position;
+        saved_fullwave = fullwave;
+        saved_fullwave_gap = fullwave_gap;
+
+        gap = datasette_read_gap(direction);
+        if (!gap)
+            break;
+        if (wound && gap > max_gap - wound) {
+            /* Leave it for the next alarm.  */
+            current_image->current_file_seek_position = saved_position;
+            fullwave = saved_fullwave;
+            fullwave_gap = saved_fullwave_gap;
+            break;
+        }
+        wound += gap;
+        *counter_step += (int)(gap / 8);
+        *last_gap = gap;
+    } while (wound < max_gap);
+
+    datasette_position = current_image->current_file_seek_position;
+
+    if (!(current_image->system == 2 && fullwave
+        && current_image->version == 1)) {
+        *counter_step = direction
+                        * (datasette_counter_at(datasette_position)
+                        - current_image->cycle_counter);
     }
-    return gap;
+
+    if (wound && !*last_gap) {
+        /* Ended with an index step, look up its last gap.  */
+        saved_position = current_image->current_file_seek_position;
+        saved_fullwave = fullwave;
+        saved_fullwave_gap = fullwave_gap;
+        *last_gap = datasette_read_gap(-direction);
+        current_image->current_file_seek_position = saved_position;
+        fullwave = saved_fullwave;
+        fullwave_gap = saved_fullwave_gap;
+        datasette_position = saved_position;
+    }
+
+    return wound;
+}
+
+/* Follow the tape if it has been positioned with tap_seek_to_file().  */
+static void datasette_sync_position(void)
+{
+    if (current_image->current_file_seek_position == datasette_position)
+        return;
+
+    datasette_position = current_image->current_file_seek_position;
+    current_image->cycle_counter = datasette_counter_at(datasette_position);
+    datasette_long_gap_pending = 0;
+    datasette_long_gap_elapsed = 0;
+    fullwave = 0;
+    datasette_update_ui_counter();
 }
 
 
@@ -434,7 +520,9 @@ static void datasette_read_bit(CLOCK offset, void *data)
 {
     double speed_of_tape = DS_V_PLAY;
     int direction = 1;
+    int counter_step = 0, wound = 0;
     long gap;
+    CLOCK max_gap = DATASETTE_MAX_GAP, last_gap = 0, wind_time;
 
     alarm_unset(datasette_alarm);
     datasette_alarm_pending = 0;
@@ -452,6 +540,8 @@ static void datasette_read_bit(CLOCK offset, void *data)
     if (!datasette_motor)
         return;
 
+    datasette_sync_position();
+
     switch (current_image->mode) {
       case DATASETTE_CONTROL_START:
         direction = 1;
@@ -484,6 +574,17 @@ static void datasette_read_bit(CLOCK offset, void *data)
         return;
     }
 
+    if (current_image->mode != DATASETTE_CONTROL_START) {
+        /* When winding the tape an alarm every DATASETTE_MAX_GAP cycles is
+           enough, if the motor is not stopped before.  */
+        wind_time = DATASETTE_MAX_GAP;
+        if (motor_stop_clk > 0 && motor_stop_clk - maincpu_clk < wind_time)
+            wind_time = motor_stop_clk - maincpu_clk;
+        max_gap = (CLOCK)(wind_time * (speed_of_tape / DS_V_PLAY));
+        if (!max_gap)
+            max_gap = 1;
+    }
+
     if (direction + datasette_last_direction == 0) {
         /* the direction changed; read the gap from file,
         but use use only the elapsed gap */
@@ -495,7 +596,12 @@ static void datasette_read_bit(CLOCK offset, void *data)
         gap = datasette_long_gap_pending;
         datasette_long_gap_pending = 0;
     } else {
-        gap = datasette_read_gap(direction);
+        if (current_image->mode == DATASETTE_CONTROL_START) {
+            gap = datasette_read_gap(direction);
+        } else {
+            gap = datasette_wind(direction, max_gap, &counter_step, &last_gap);
+            wound = 1;
+        }
         if (gap)
             datasette_long_gap_elapsed = 0;
     }
@@ -503,17 +609,22 @@ static void datasette_read_bit(CLOCK offset, void *data)
         datasette_control(DATASETTE_CONTROL_STOP);
         return;
     }
-    if (gap > DATASETTE_MAX_GAP) {
-        datasette_long_gap_pending = gap - DATASETTE_MAX_GAP;
-        gap = DATASETTE_MAX_GAP;
+    if (gap > max_gap) {
+        datasette_long_gap_pending = gap - max_gap;
+        gap = max_gap;
+        wound = 0;
+    }
+    if (!wound) {
+        counter_step = gap / 8;
+        last_gap = gap;
     }
-    datasette_long_gap_elapsed += gap;
+    datasette_long_gap_elapsed += last_gap;
     datasette_last_direction = direction;
 
     if (direction > 0)
-        current_image->cycle_counter += gap / 8;
+        current_image->cycle_counter += counter_step;
     else
-        current_image->cycle_counter -= gap / 8;
+        current_image->cycle_counter -= counter_step;
 
     gap -= offset;
 
@@ -558,23 +669,17 @@ void datasette_init(void)
 
 void datasette_set_tape_image(tap_t *image)
 {
-    CLOCK gap;
-
     current_image = image;
-    last_tap = next_tap = 0;
+    datasette_index_valid = 0;
+    datasette_position = 0;
     datasette_internal_reset();
 
     if (image != NULL) {
-        /* We need the length of tape for realistic counter. */
-        current_image->cycle_counter_total = 0;
-        do {
-            gap = datasette_read_gap(1);
-            current_image->cycle_counter_total += gap / 8;
-        } while (gap);
-        current_image->current_file_seek_position = 0;
-        last_tap = next_tap = 0;
-        fullwave = 0;
+        datasette_index_update();
     } else {
+        lib_free(datasette_index);
+        datasette_index = NULL;
+        datasette_index_size = datasette_index_alloc = 0;
         datasette_set_tape_sense(0);
     }
 
@@ -615,8 +720,10 @@ static void datasette_internal_reset(void)
             datasette_alarm_pending = 0;
         }
         datasette_control(DATASETTE_CONTROL_STOP);
-        if (!autostart_ignore_reset)
+        if (!autostart_ignore_reset) {
             tap_seek_start(current_image);
+            datasette_position = 0;
+        }
         current_image->cycle_counter = 0;
         datasette_counter_offset = 0;
         datasette_long_gap_pending = 0;
@@ -640,8 +747,7 @@ void datasette_reset(void)
 
 static void datasette_start_motor(void)
 {
-    fseek(current_image->fd, current_image->current_file_seek_position
-          + current_image->offset, SEEK_SET);
+    datasette_sync_position();
     if (!datasette_alarm_pending) {
         alarm_set(datasette_alarm, maincpu_clk + MOTOR_DELAY);
         datasette_alarm_pending = 1;
@@ -716,8 +822,6 @@ static void datasette_control_internal(int command)
             break;
         }
         ui_display_tape_control_status(current_image->mode);
-        /* clear the tap-buffer */
-        last_tap = next_tap = 0;
     }
 }
 
@@ -758,7 +862,8 @@ void datasette_set_motor(int flag)
 inline static void bit_write(void)
 {
     CLOCK write_time;
-    BYTE write_gap;
+    BYTE write_gap[4];
+    size_t len = 1;
 
     write_time = maincpu_clk - last_write_clk;
     last_write_clk = maincpu_clk;
@@ -772,35 +877,23 @@ inline static void bit_write(void)
         return;
 
     if (write_time < (CLOCK)(255 * 8 + 7)) {
-        write_gap = (BYTE)(write_time / (CLOCK)8);
-        if (fwrite(&write_gap, 1, 1, current_image->fd) < 1) {
-            datasette_control(DATASETTE_CONTROL_STOP);
-            return;
-        }
-        current_image->current_file_seek_position++;
+        write_gap[0] = (BYTE)(write_time / (CLOCK)8);
     } else {
-        write_gap = 0;
-        if (fwrite(&write_gap, 1, 1, current_image->fd) != 1) {
-            log_debug("datasette bit_write failed.");
-        }
-        current_image->current_file_seek_position++;
+        write_gap[0] = 0;
         if (current_image->version >= 1) {
-            BYTE long_gap[3];
-            int bytes_written;
-            long_gap[0] = (BYTE)(write_time & 0xff);
-            long_gap[1] = (BYTE)((write_time >> 8) & 0xff);
-            long_gap[2] = (BYTE)((write_time >> 16) & 0xff);
+            write_gap[1] = (BYTE)(write_time & 0xff);
+            write_gap[2] = (BYTE)((write_time >> 8) & 0xff);
+            write_gap[3] = (BYTE)((write_time >> 16) & 0xff);
             write_time &= 0xffffff;
-            bytes_written = (int)fwrite(long_gap, 1, 3, current_image->fd);
-            current_image->current_file_seek_position += bytes_written;
-            if (bytes_written < 3) {
-                datasette_control(DATASETTE_CONTROL_STOP);
-                return;
-            }
+            len = 4;
         }
     }
-    if (current_image->size < current_image->current_file_seek_position)
-        current_image->size = current_image->current_file_seek_position;
+    if (tap_write(current_image, write_gap, len) < 0) {
+        datasette_control(DATASETTE_CONTROL_STOP);
+        return;
+    }
+    datasette_position = current_image->current_file_seek_position;
+    datasette_index_valid = 0;
 
     current_image->cycle_counter += write_time / 8;
 
@@ -812,8 +905,7 @@ inline static void bit_write(void)
     if (current_image->cycle_counter_total
         < current_image->cycle_counter)
         current_image->cycle_counter_total = current_image->cycle_counter;
-        current_image->has_changed = 1;
-        datasette_update_ui_counter();
+    datasette_update_ui_counter();
 }
 
 void datasette_toggle_write_bit(int write_bit)
@@ -912,6 +1004,12 @@ int datasette_read_snapshot(snapshot_t *s)
     else
         alarm_unset(datasette_alarm);
 
+    /* The counter index was made for the tape before the snapshot.  */
+    if (current_image) {
+        datasette_position = current_image->current_file_seek_position;
+        datasette_index_valid = 0;
+    }
+
     ui_set_tape_status(current_image ? 1 : 0);
     datasette_update_ui_counter();
     ui_display_tape_motor_status(datasette_motor);
@@ -924,9 +1022,6 @@ int datasette_read_snapshot(snapshot_t *s)
             datasette_set_tape_sense(0);
     }
 
-    /* reset buffer */
-    next_tap = last_tap = 0;
-
     snapshot_module_close(m);
     return 0;
 }
@@ -32,6 +32,7 @@
 #include "cmdline.h"
 #include "drive-cmdline-options.h"
 #include "drive.h"
+#include "drivethread.h"
 #include "lib.h"
 #include "machine-drive.h"
 #include "translate.h"
@@ -108,5 +109,9 @@ int drive_cmdline_options_init(void)
         return -1;
     }
 
+    if (drivethread_cmdline_options_init() < 0) {
+        return -1;
+    }
+
     return machine_drive_cmdline_options_init();
 }
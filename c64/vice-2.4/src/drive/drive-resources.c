@@ -34,6 +34,7 @@
 #include "drivecpu.h"
 #include "drivecpu65c02.h"
 #include "driverom.h"
+#include "drivethread.h"
 #include "drivetypes.h"
 #include "iecbus.h"
 #include "iecdrive.h"
@@ -293,6 +294,7 @@ int drive_resources_init(void)
     }
 
     return machine_drive_resources_init()
+        | drivethread_resources_init()
         | resources_register_int(resources_int);
 }
 
@@ -39,6 +39,7 @@
 #include "drivecpu.h"
 #include "drivecpu65c02.h"
 #include "drivemem.h"
+#include "drivethread.h"
 #include "driverom.h"
 #include "drivetypes.h"
 #include "gcr.h"
@@ -118,6 +119,8 @@ int drive_snapshot_write_module(snapshot_t *s, int save_disks, int save_roms)
     int sync_factor;
     drive_t *drive;
 
+    drivethread_sync();
+
     resources_get_int("DriveTrueEmulation", &drive_true_emulation);
 
     if (vdrive_snapshot_module_write(s, drive_true_emulation ? 10 : 8) < 0)
@@ -302,6 +305,8 @@ int drive_snapshot_read_module(snapshot_t *s)
     int dummy;
     int half_track[DRIVE_NUM];
 
+    drivethread_sync();
+
     m = snapshot_module_open(s, snap_module_name,
                              &major_version, &minor_version);
     if (m == NULL) {
@@ -54,6 +54,7 @@
 #include "drivecpu65c02.h"
 #include "driveimage.h"
 #include "drivesync.h"
+#include "drivethread.h"
 #include "driverom.h"
 #include "drivetypes.h"
 #include "gcr.h"
@@ -93,6 +94,8 @@ void drive_set_disk_memory(BYTE *id, unsigned int track, unsigned int sector,
 {
     drive_t *drive;
 
+    drivethread_sync();
+
     drive = drv->drive;
 
     if (drive->type == DRIVE_TYPE_1541
@@ -116,6 +119,8 @@ void drive_set_last_read(unsigned int track, unsigned int sector, BYTE *buffer,
     drive_t *drive;
     int side = 0;
 
+    drivethread_sync();
+
     drive = drv->drive;
 
     drive_gcr_data_writeback(drive);
@@ -274,6 +279,8 @@ void drive_shutdown(void)
         return;
     }
 
+    drivethread_shutdown();
+
     for (dnr = 0; dnr < DRIVE_NUM; dnr++) {
         if (drive_context[dnr]->drive->type == DRIVE_TYPE_2000 || drive_context[dnr]->drive->type == DRIVE_TYPE_4000) {
             drivecpu65c02_shutdown(drive_context[dnr]);
@@ -405,6 +412,8 @@ int drive_enable(drive_context_t *drv)
     unsigned int dnr;
     drive_t *drive;
 
+    drivethread_sync();
+
     dnr = drv->mynumber;
     drive = drv->drive;
 
@@ -446,6 +455,8 @@ void drive_disable(drive_context_t *drv)
     int drive_true_emulation = 0;
     drive_t *drive;
 
+    drivethread_sync();
+
     drive = drv->drive;
 
     /* This must come first, because this might be called before the true
@@ -474,6 +485,8 @@ void drive_reset(void)
     unsigned int dnr;
     drive_t *drive;
 
+    drivethread_sync();
+
     for (dnr = 0; dnr < DRIVE_NUM; dnr++) {
         drive = drive_context[dnr]->drive;
 
@@ -602,6 +615,8 @@ void drive_gcr_data_writeback_all(void)
     drive_t *drive;
     unsigned int i;
 
+    drivethread_sync();
+
     for (i = 0; i < DRIVE_NUM; i++) {
         drive = drive_context[i]->drive;
         drive_gcr_data_writeback(drive);
@@ -731,8 +746,16 @@ void drive_vsync_hook(void)
 {
     unsigned int dnr;
 
+    /* The UI status is taken from the drive state, so the worker has to be
+       done with the previous frame first.  */
+    drivethread_sync();
+
     drive_update_ui_status();
 
+    if (drivethread_catch_up(maincpu_clk)) {
+        return;
+    }
+
     for (dnr = 0; dnr < DRIVE_NUM; dnr++) {
         drive_t *drive = drive_context[dnr]->drive;
         if (drive->enable) {
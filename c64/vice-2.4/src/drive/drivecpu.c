@@ -35,12 +35,14 @@
 
 #include "6510core.h"
 #include "alarm.h"
+#include "benchmark.h"
 #include "clkguard.h"
 #include "debug.h"
 #include "drive.h"
 #include "drivecpu.h"
 #include "drive-check.h"
 #include "drivemem.h"
+#include "drivethread.h"
 #include "drivetypes.h"
 #include "interrupt.h"
 #include "lib.h"
@@ -257,6 +259,7 @@ void drivecpu_reset(drive_context_t *drv)
 
 void drivecpu_trigger_reset(unsigned int dnr)
 {
+    drivethread_sync();
     interrupt_trigger_reset(drivecpu_int_status_ptr[dnr], drive_clk[dnr] + 1);
 }
 
@@ -345,6 +348,16 @@ void drivecpu_prevent_clk_overflow_all(CLOCK sub)
 {
     unsigned int dnr;
 
+    /* This runs every frame, right after the per-frame catch-up has been
+       handed to the drive thread.  The thread checks the drive clock
+       guards itself when it is done, so only wait for it when the clocks
+       have to be moved.  */
+    if (sub == 0 && drivethread_busy()) {
+        return;
+    }
+
+    drivethread_sync();
+
     for (dnr = 0; dnr < DRIVE_NUM; dnr++)
         drivecpu_prevent_clk_overflow(drive_context[dnr], sub);
 }
@@ -428,7 +441,7 @@ inline static int interrupt_check_irq_delay(interrupt_cpu_status_t *cs,
 /* -------------------------------------------------------------------------- */
 /* Execute up to the current main CPU clock value.  This automatically
    calculates the corresponding number of clock ticks in the drive.  */
-void drivecpu_execute(drive_context_t *drv, CLOCK clk_value)
+static void drivecpu_execute_core(drive_context_t *drv, CLOCK clk_value)
 {
     CLOCK cycles;
 	int tcycles;
@@ -445,8 +458,6 @@ void drivecpu_execute(drive_context_t *drv, CLOCK clk_value)
 
     cpu = drv->cpu;
 
-    drivecpu_wake_up(drv);
-
     /* Calculate number of main CPU clocks to emulate */
     if (clk_value > cpu->last_clk)
         cycles = clk_value - cpu->last_clk;
@@ -519,6 +530,24 @@ void drivecpu_execute(drive_context_t *drv, CLOCK clk_value)
 #pragma optimize("",on)
 #endif
 
+void drivecpu_execute(drive_context_t *drv, CLOCK clk_value)
+{
+    int benchmark_saved = BENCHMARK_CPU;
+
+    drivethread_sync();
+    BENCHMARK_ENTER(benchmark_saved, BENCHMARK_DRIVE);
+    drivecpu_wake_up(drv);
+    drivecpu_execute_core(drv, clk_value);
+    BENCHMARK_LEAVE(benchmark_saved);
+}
+
+/* Same as `drivecpu_execute()', but called on the drive thread.  The main
+   thread has already done the wake up in `drivethread_catch_up()'.  */
+void drivecpu_execute_thread(drive_context_t *drv, CLOCK clk_value)
+{
+    drivecpu_execute_core(drv, clk_value);
+}
+
 void drivecpu_execute_all(CLOCK clk_value)
 {
     unsigned int dnr;
@@ -543,10 +572,11 @@ static void drivecpu_set_bank_base(void *context)
 }
 
 /* Inlining this fuction makes no sense and would only bloat the code.  */
-static void drive_jam(drive_context_t *drv)
+static int drive_jam_main(void *data)
 {
     unsigned int tmp;
     char *dname = "  Drive";
+    drive_context_t *drv = (drive_context_t *)data;
     drivecpu_context_t *cpu;
 
     cpu = drv->cpu;
@@ -614,6 +644,13 @@ static void drive_jam(drive_context_t *drv)
       default:
         CLK++;
     }
+    return 0;
+}
+
+/* The JAM dialog and the monitor live on the main thread.  */
+static void drive_jam(drive_context_t *drv)
+{
+    drivethread_call_main(drive_jam_main, (void *)drv);
 }
 
 /* ------------------------------------------------------------------------- */
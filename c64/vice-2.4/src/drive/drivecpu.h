@@ -48,6 +48,8 @@ extern void drivecpu_reset_clk(struct drive_context_s *drv);
 extern void drivecpu_trigger_reset(unsigned int dnr);
 
 extern void drivecpu_execute(struct drive_context_s *drv, CLOCK clk_value);
+extern void drivecpu_execute_thread(struct drive_context_s *drv,
+                                    CLOCK clk_value);
 extern void drivecpu_execute_all(CLOCK clk_value);
 extern int drivecpu_snapshot_write_module(struct drive_context_s *drv,
                                           struct snapshot_s *s);
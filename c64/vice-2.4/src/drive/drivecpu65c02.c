@@ -31,12 +31,14 @@
 
 #include "6510core.h"   /* using 6510core.h because the registers are the same */
 #include "alarm.h"
+#include "benchmark.h"
 #include "clkguard.h"
 #include "debug.h"
 #include "drive.h"
 #include "drivecpu.h"
 #include "drive-check.h"
 #include "drivemem.h"
+#include "drivethread.h"
 #include "drivetypes.h"
 #include "interrupt.h"
 #include "lib.h"
@@ -422,6 +424,10 @@ void drivecpu65c02_execute(drive_context_t *drv, CLOCK clk_value)
     int tcycles;
     drivecpu_context_t *cpu;
     int cpu_type = CPU_R65C02;
+    int benchmark_saved = BENCHMARK_CPU;
+
+    drivethread_sync();
+    BENCHMARK_ENTER(benchmark_saved, BENCHMARK_DRIVE);
 
 #define reg_a   (cpu->cpu_regs.a)
 #define reg_x   (cpu->cpu_regs.x)
@@ -499,6 +505,7 @@ void drivecpu65c02_execute(drive_context_t *drv, CLOCK clk_value)
 
     cpu->last_clk = clk_value;
     drivecpu65c02_sleep(drv);
+    BENCHMARK_LEAVE(benchmark_saved);
 }
 
 #ifdef _MSC_VER
@@ -33,6 +33,7 @@
 #include "diskimage.h"
 #include "drive.h"
 #include "driveimage.h"
+#include "drivethread.h"
 #include "drivetypes.h"
 #include "gcr.h"
 #include "log.h"
@@ -119,6 +120,8 @@ int drive_image_attach(disk_image_t *image, unsigned int unit)
     if (unit < 8 || unit >= 8 + DRIVE_NUM)
         return -1;
 
+    drivethread_sync();
+
     dnr = unit - 8;
     drive = drive_context[dnr]->drive;
 
@@ -173,6 +176,8 @@ int drive_image_detach(disk_image_t *image, unsigned int unit)
     if (unit < 8 || unit >= 8 + DRIVE_NUM)
         return -1;
 
+    drivethread_sync();
+
     dnr = unit - 8;
     drive = drive_context[dnr]->drive;
 
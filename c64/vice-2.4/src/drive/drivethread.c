@@ -0,0 +1,403 @@
+/*
+ * drivethread.c - Run true drive emulation on a worker thread.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With true drive emulation the drive CPUs are run lazily: the main CPU
+   only makes them catch up when it touches the bus (`drivecpu_execute()')
+   and once per frame from `drive_vsync_hook()'.  The per-frame catch-up
+   does not need its result until the next bus access, so when
+   `DriveThread' is enabled it is handed to a worker thread while the main
+   CPU carries on.
+
+   Whoever owns the drives runs them up to exactly the same clock values
+   as in serial mode, and the main CPU never changes the bus without
+   syncing first, so the emulation stays cycle-identical.  Every main
+   thread path that touches drive state calls `drivethread_sync()' first,
+   which waits for an outstanding catch-up to finish.
+
+   Configurations where the drive code reaches into main thread state
+   (parallel cables, fast serial, drive sound, the monitor, ...) simply
+   keep running serially.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include "cmdline.h"
+#include "drive.h"
+#include "drivecpu.h"
+#include "drivethread.h"
+#include "drivetypes.h"
+#include "log.h"
+#include "monitor.h"
+#include "resources.h"
+#include "rotation.h"
+#include "translate.h"
+
+
+/* drive-resources.c */
+extern int drive_sound_emulation;
+
+/* Resource: hand the per-frame drive catch-up to a worker thread?  */
+static int drivethread_enabled = 0;
+
+#ifdef HAVE_PTHREAD_H
+
+/* Set by the main thread when a catch-up has been handed to the worker and
+   not waited for yet.  Only ever touched by the main thread.  */
+static int drivethread_posted = 0;
+
+/* Set by the main thread while it runs a call for the parked worker.  */
+static int drivethread_in_main_call = 0;
+
+static pthread_t drivethread_thread;
+static pthread_mutex_t drivethread_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t drivethread_cond = PTHREAD_COND_INITIALIZER;
+static int drivethread_running = 0;
+
+/* The following are protected by `drivethread_lock'.  */
+
+/* Nonzero while the worker owns the drives.  */
+static int job_pending = 0;
+static int job_quit = 0;
+static CLOCK job_clk;
+
+/* Call the worker wants the main thread to make on its behalf.  */
+static int (*main_call_func)(void *data) = NULL;
+static void *main_call_data;
+static int main_call_result;
+
+/* ------------------------------------------------------------------------- */
+
+static void *drivethread_main(void *unused)
+{
+    unsigned int dnr;
+    CLOCK clk_value;
+
+    pthread_mutex_lock(&drivethread_lock);
+
+    while (1) {
+        while (!job_pending && !job_quit) {
+            pthread_cond_wait(&drivethread_cond, &drivethread_lock);
+        }
+
+        if (job_quit) {
+            break;
+        }
+
+        clk_value = job_clk;
+        pthread_mutex_unlock(&drivethread_lock);
+
+        /* Same order and steps as the serial code in `drive_vsync_hook()'. */
+        for (dnr = 0; dnr < DRIVE_NUM; dnr++) {
+            drive_t *drive = drive_context[dnr]->drive;
+
+            if (drive->enable) {
+                if (drive->idling_method != DRIVE_IDLE_SKIP_CYCLES) {
+                    drivecpu_execute_thread(drive_context[dnr], clk_value);
+                }
+                if (drive->idling_method == DRIVE_IDLE_NO_IDLE) {
+                    rotation_rotate_disk(drive);
+                }
+            }
+        }
+
+        /* `drivecpu_prevent_clk_overflow_all()' leaves this to us while we
+           own the drives.  */
+        drivecpu_prevent_clk_overflow_all(0);
+
+        pthread_mutex_lock(&drivethread_lock);
+        job_pending = 0;
+        pthread_cond_broadcast(&drivethread_cond);
+    }
+
+    pthread_mutex_unlock(&drivethread_lock);
+
+    return NULL;
+}
+
+static int drivethread_start(void)
+{
+    if (drivethread_running) {
+        return 0;
+    }
+
+    job_pending = 0;
+    job_quit = 0;
+
+    if (pthread_create(&drivethread_thread, NULL, drivethread_main, NULL) != 0) {
+        log_error(LOG_DEFAULT, "Cannot create drive thread.");
+        return -1;
+    }
+
+    drivethread_running = 1;
+    return 0;
+}
+
+static void drivethread_stop(void)
+{
+    if (!drivethread_running) {
+        return;
+    }
+
+    drivethread_sync();
+
+    pthread_mutex_lock(&drivethread_lock);
+    job_quit = 1;
+    pthread_cond_broadcast(&drivethread_cond);
+    pthread_mutex_unlock(&drivethread_lock);
+
+    pthread_join(drivethread_thread, NULL);
+    drivethread_running = 0;
+}
+
+static int drivethread_in_worker(void)
+{
+    return drivethread_running
+           && pthread_equal(pthread_self(), drivethread_thread);
+}
+
+/* Can the drives currently be run away from the main thread?  Anything
+   that makes the drive code call into the machine, the sound system or
+   the UI rules it out.  */
+static int drivethread_eligible(void)
+{
+    unsigned int dnr;
+    int enabled = 0;
+
+    if (drive_sound_emulation) {
+        return 0;
+    }
+
+    for (dnr = 0; dnr < DRIVE_NUM; dnr++) {
+        drive_context_t *drv = drive_context[dnr];
+        drive_t *drive = drv->drive;
+
+        if (!drive->enable) {
+            continue;
+        }
+
+        if (drive->type != DRIVE_TYPE_1541
+            && drive->type != DRIVE_TYPE_1541II) {
+            return 0;
+        }
+
+        if (drive->parallel_cable != DRIVE_PC_NONE
+            || drive->extend_image_policy == DRIVE_EXTEND_ASK
+            || monitor_mask[drv->cpu->monspace]) {
+            return 0;
+        }
+
+        enabled = 1;
+    }
+
+    return enabled;
+}
+
+#endif /* HAVE_PTHREAD_H */
+
+/* ------------------------------------------------------------------------- */
+
+/* Hand the per-frame catch-up of all drives to `clk_value' to the worker.
+   Return nonzero if that happened, zero if the caller has to run the drives
+   itself.  */
+int drivethread_catch_up(CLOCK clk_value)
+{
+#ifdef HAVE_PTHREAD_H
+    unsigned int dnr;
+
+    if (!drivethread_enabled) {
+        return 0;
+    }
+
+    drivethread_sync();
+
+    if (!drivethread_eligible()) {
+        return 0;
+    }
+
+    if (drivethread_start() < 0) {
+        drivethread_enabled = 0;
+        return 0;
+    }
+
+    /* The skip check in `drivecpu_wake_up()' looks at the main CPU clock,
+       so it has to be done here and not on the worker.  */
+    for (dnr = 0; dnr < DRIVE_NUM; dnr++) {
+        drive_t *drive = drive_context[dnr]->drive;
+
+        if (drive->enable && drive->idling_method != DRIVE_IDLE_SKIP_CYCLES) {
+            drivecpu_wake_up(drive_context[dnr]);
+        }
+    }
+
+    pthread_mutex_lock(&drivethread_lock);
+    job_clk = clk_value;
+    job_pending = 1;
+    pthread_cond_broadcast(&drivethread_cond);
+    pthread_mutex_unlock(&drivethread_lock);
+
+    drivethread_posted = 1;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/* Wait until the worker has given the drives back.  Must be called by the
+   main thread before it looks at or changes any drive state.  */
+void drivethread_sync(void)
+{
+#ifdef HAVE_PTHREAD_H
+    if (!drivethread_posted || drivethread_in_main_call
+        || drivethread_in_worker()) {
+        return;
+    }
+
+    pthread_mutex_lock(&drivethread_lock);
+
+    while (job_pending) {
+        if (main_call_func != NULL) {
+            int (*func)(void *data) = main_call_func;
+            int result;
+
+            /* The worker is parked until we answer, so the drives are
+               ours for the duration of the call.  */
+            pthread_mutex_unlock(&drivethread_lock);
+            drivethread_in_main_call = 1;
+            result = func(main_call_data);
+            drivethread_in_main_call = 0;
+            pthread_mutex_lock(&drivethread_lock);
+
+            main_call_result = result;
+            main_call_func = NULL;
+            pthread_cond_broadcast(&drivethread_cond);
+            continue;
+        }
+        pthread_cond_wait(&drivethread_cond, &drivethread_lock);
+    }
+
+    pthread_mutex_unlock(&drivethread_lock);
+
+    drivethread_posted = 0;
+#endif
+}
+
+/* Return nonzero if the main thread has handed a catch-up to the worker
+   and not synced with it yet.  Always zero on the worker itself.  */
+int drivethread_busy(void)
+{
+#ifdef HAVE_PTHREAD_H
+    return !drivethread_in_worker() && drivethread_posted;
+#else
+    return 0;
+#endif
+}
+
+/* Run `func' on the main thread.  The worker blocks until the main thread
+   syncs with it, which it does before the next bus access at the latest.  */
+int drivethread_call_main(int (*func)(void *data), void *data)
+{
+#ifdef HAVE_PTHREAD_H
+    int result;
+
+    if (!drivethread_in_worker()) {
+        return func(data);
+    }
+
+    pthread_mutex_lock(&drivethread_lock);
+    main_call_func = func;
+    main_call_data = data;
+    pthread_cond_broadcast(&drivethread_cond);
+    while (main_call_func != NULL) {
+        pthread_cond_wait(&drivethread_cond, &drivethread_lock);
+    }
+    result = main_call_result;
+    pthread_mutex_unlock(&drivethread_lock);
+
+    return result;
+#else
+    return func(data);
+#endif
+}
+
+void drivethread_shutdown(void)
+{
+#ifdef HAVE_PTHREAD_H
+    drivethread_stop();
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_drivethread_enabled(int val, void *param)
+{
+    val = val ? 1 : 0;
+
+#ifdef HAVE_PTHREAD_H
+    if (!val) {
+        drivethread_stop();
+    }
+#else
+    if (val) {
+        log_warning(LOG_DEFAULT, "Drive thread not available, running drives serially.");
+        val = 0;
+    }
+#endif
+
+    drivethread_enabled = val;
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "DriveThread", 0, RES_EVENT_NO, NULL,
+      &drivethread_enabled, set_drivethread_enabled, NULL },
+    { NULL }
+};
+
+int drivethread_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] = {
+    { "-drivethread", SET_RESOURCE, 0,
+      NULL, NULL, "DriveThread", (void *)1,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Run true drive emulation on a worker thread" },
+    { "+drivethread", SET_RESOURCE, 0,
+      NULL, NULL, "DriveThread", (void *)0,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Run true drive emulation on the main thread" },
+    { NULL }
+};
+
+int drivethread_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
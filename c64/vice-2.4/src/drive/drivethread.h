@@ -0,0 +1,38 @@
+/*
+ * drivethread.h - Run true drive emulation on a worker thread.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_DRIVETHREAD_H
+#define VICE_DRIVETHREAD_H
+
+#include "types.h"
+
+extern int drivethread_resources_init(void);
+extern int drivethread_cmdline_options_init(void);
+extern void drivethread_shutdown(void);
+
+extern int drivethread_catch_up(CLOCK clk_value);
+extern void drivethread_sync(void);
+extern int drivethread_busy(void);
+extern int drivethread_call_main(int (*func)(void *data), void *data);
+
+#endif
@@ -39,6 +39,7 @@
 #include "fliplist.h"
 #include "fsdevice.h"
 #include "gfxoutput.h"
+#include "init.h"
 #include "initcmdline.h"
 #include "joy.h"
 #include "joystick.h"
@@ -59,10 +60,12 @@
 #include "romset.h"
 #include "screenshot.h"
 #include "signals.h"
+#include "snapshot.h"
 #include "sysfile.h"
 #include "uiapi.h"
 #include "vdrive.h"
 #include "vice-event.h"
+#include "vsyncapi.h"
 
 
 static void init_resource_fail(const char *module)
@@ -118,6 +121,10 @@ int init_resources(void)
         init_resource_fail("event");
         return -1;
     }
+    if (snapshot_resources_init() < 0) {
+        init_resource_fail("snapshot");
+        return -1;
+    }
     if (debug_resources_init() < 0) {
         init_resource_fail("debug");
         return -1;
@@ -204,6 +211,10 @@ int init_cmdline_options(void)
             init_cmdline_options_fail("event");
             return -1;
         }
+        if (snapshot_cmdline_options_init() < 0) {
+            init_cmdline_options_fail("snapshot");
+            return -1;
+        }
     }
     if (monitor_cmdline_options_init() < 0) {
         init_cmdline_options_fail("monitor");
@@ -306,3 +317,58 @@ int init_main(void)
     return 0;
 }
 
+/* ------------------------------------------------------------------------- */
+
+/* Time from the end of `archdep_init()' to the first frame, and the time
+   spent in the phases of startup that matter most for it.  */
+static unsigned long profile_start;
+static unsigned long profile_begin[INIT_PROFILE_NUM];
+static unsigned long profile_ticks[INIT_PROFILE_NUM];
+static int profile_count[INIT_PROFILE_NUM];
+static int profile_done;
+
+static const char *profile_name[INIT_PROFILE_NUM] = {
+    "resources init",
+    "command-line options init",
+    "sysfile_load",
+    "ROM loading"
+};
+
+void init_profile_start(void)
+{
+    profile_start = vsyncarch_gettime();
+}
+
+void init_profile_begin(int phase)
+{
+    profile_begin[phase] = vsyncarch_gettime();
+}
+
+void init_profile_end(int phase)
+{
+    profile_ticks[phase] += vsyncarch_gettime() - profile_begin[phase];
+    profile_count[phase]++;
+}
+
+static double profile_ms(unsigned long ticks)
+{
+    return 1000.0 * (double)ticks / vsyncarch_frequency();
+}
+
+void init_profile_first_frame(void)
+{
+    int i;
+
+    if (profile_done) {
+        return;
+    }
+    profile_done = 1;
+
+    log_message(LOG_DEFAULT, "Startup: first frame %.1f ms after archdep init.",
+                profile_ms(vsyncarch_gettime() - profile_start));
+    for (i = 0; i < INIT_PROFILE_NUM; i++) {
+        log_message(LOG_DEFAULT, "Startup: %.1f ms in %s (%d calls).",
+                    profile_ms(profile_ticks[i]), profile_name[i],
+                    profile_count[i]);
+    }
+}
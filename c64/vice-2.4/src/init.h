@@ -31,5 +31,17 @@ extern int init_resources(void);
 extern int init_cmdline_options(void);
 extern int init_main(void);
 
+/* Startup profile, logged when the first frame is done.  */
+#define INIT_PROFILE_RESOURCES          0
+#define INIT_PROFILE_CMDLINE_OPTIONS    1
+#define INIT_PROFILE_SYSFILE_LOAD       2
+#define INIT_PROFILE_ROM_LOAD           3
+#define INIT_PROFILE_NUM                4
+
+extern void init_profile_start(void);
+extern void init_profile_begin(int phase);
+extern void init_profile_end(int phase);
+extern void init_profile_first_frame(void);
+
 #endif
 
@@ -33,6 +33,7 @@
 #include <string.h>
 
 #include "6510core.h"
+#include "drivethread.h"
 #include "interrupt.h"
 #include "lib.h"
 #include "log.h"
@@ -324,6 +325,10 @@ void interrupt_maincpu_trigger_trap(void (*trap_func)(WORD, void *data),
 void interrupt_do_trap(interrupt_cpu_status_t *cs, WORD address)
 {
     cs->global_pending_int &= ~IK_TRAP;
+
+    /* Traps run snapshots, attach images and so on; give them the drives.  */
+    drivethread_sync();
+
     cs->trap_func(address, cs->trap_data);
 }
 
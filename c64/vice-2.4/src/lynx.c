@@ -0,0 +1,398 @@
+/*
+ * lynx.c - Support for Lynx archives in VICE.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* A Lynx archive is a BASIC stub followed by a directory and the files,
+   every one padded to whole blocks of 254 bytes.  This unpacks it the way
+   `c1541 -unlynx' does, but into a D64 image in memory that is formatted
+   and filled here: zfile uses it in programs that have no vdrive.  */
+
+#include "vice.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "cbmdos.h"
+#include "diskimage.h"
+#include "lynx.h"
+#include "types.h"
+#include "util.h"
+#include "vdrive-bam.h"
+#include "vdrive-dir.h"
+
+#define LYNX_TRACKS     35
+#define LYNX_DIR_TRACK  18
+#define LYNX_INTERLEAVE 10
+
+#define BAM_NAME_1541   0x90
+#define BAM_ID_1541     0xa2
+
+/* Directory sectors in the order the 1541 uses them.  */
+static const BYTE dir_sectors[] = {
+    1, 4, 7, 10, 13, 16, 2, 5, 8, 11, 14, 17, 3, 6, 9, 12, 15, 18
+};
+
+typedef struct lynx_image_s {
+    BYTE *data;
+    BYTE *bam;
+    int dir_entries;
+} lynx_image_t;
+
+/* ------------------------------------------------------------------------- */
+
+static unsigned int sectors_per_track(unsigned int track)
+{
+    return (track <= 17) ? 21 : (track <= 24) ? 19 : (track <= 30) ? 18 : 17;
+}
+
+static BYTE *sector_data(lynx_image_t *image, unsigned int track,
+                         unsigned int sector)
+{
+    unsigned int t, offset = 0;
+
+    for (t = 1; t < track; t++) {
+        offset += sectors_per_track(t);
+    }
+    return image->data + (offset + sector) * 256;
+}
+
+static BYTE *bam_entry(lynx_image_t *image, unsigned int track)
+{
+    return image->bam + BAM_BIT_MAP + 4 * (track - 1);
+}
+
+static int sector_is_free(lynx_image_t *image, unsigned int track,
+                          unsigned int sector)
+{
+    return bam_entry(image, track)[1 + (sector >> 3)] & (1 << (sector & 7));
+}
+
+static void allocate_sector(lynx_image_t *image, unsigned int track,
+                            unsigned int sector)
+{
+    BYTE *entry = bam_entry(image, track);
+
+    entry[1 + (sector >> 3)] &= ~(1 << (sector & 7));
+    entry[0]--;
+}
+
+/* Allocate the first free sector on `track' at or after `sector', wrapping
+   around.  Return -1 if the track is full.  */
+static int allocate_on_track(lynx_image_t *image, unsigned int track,
+                             unsigned int sector)
+{
+    unsigned int i, spt = sectors_per_track(track);
+
+    if (bam_entry(image, track)[0] == 0) {
+        return -1;
+    }
+    for (i = 0; i < spt; i++) {
+        if (sector_is_free(image, track, (sector + i) % spt)) {
+            allocate_sector(image, track, (sector + i) % spt);
+            return (int)((sector + i) % spt);
+        }
+    }
+    return -1;
+}
+
+/* Allocate the next block of a file after `*track'/`*sector', or its first
+   one if `*track' is 0.  Like the 1541, the blocks are spread with an
+   interleave, the tracks next to the directory first.  */
+static int allocate_block(lynx_image_t *image, unsigned int *track,
+                          unsigned int *sector)
+{
+    int s, dist;
+    unsigned int t;
+
+    if (*track != 0) {
+        s = allocate_on_track(image, *track, *sector + LYNX_INTERLEAVE);
+        if (s >= 0) {
+            *sector = (unsigned int)s;
+            return 0;
+        }
+    }
+
+    for (dist = 1; dist < LYNX_TRACKS; dist++) {
+        t = LYNX_DIR_TRACK - dist;
+        if (t >= 1 && (s = allocate_on_track(image, t, 0)) >= 0) {
+            break;
+        }
+        t = LYNX_DIR_TRACK + dist;
+        if (t <= LYNX_TRACKS && (s = allocate_on_track(image, t, 0)) >= 0) {
+            break;
+        }
+    }
+    if (dist == LYNX_TRACKS) {
+        return -1;
+    }
+
+    *track = t;
+    *sector = (unsigned int)s;
+    return 0;
+}
+
+static void format_image(lynx_image_t *image)
+{
+    unsigned int track, sector;
+    BYTE *dir;
+
+    memset(image->data, 0, D64_FILE_SIZE_35);
+    image->bam = sector_data(image, LYNX_DIR_TRACK, 0);
+    image->dir_entries = 0;
+
+    image->bam[BAM_FIRST_TRACK] = LYNX_DIR_TRACK;
+    image->bam[BAM_FIRST_SECTOR] = 1;
+    image->bam[BAM_FORMAT_TYPE] = 65;
+    for (track = 1; track <= LYNX_TRACKS; track++) {
+        for (sector = 0; sector < sectors_per_track(track); sector++) {
+            bam_entry(image, track)[1 + (sector >> 3)] |= 1 << (sector & 7);
+            bam_entry(image, track)[0]++;
+        }
+    }
+    memset(image->bam + BAM_NAME_1541, 0xa0, 27);
+    memcpy(image->bam + BAM_NAME_1541, "LYNXIMAGE", 9);
+    memcpy(image->bam + BAM_ID_1541, "00", 2);
+    image->bam[BAM_VERSION_1541] = 50;
+    image->bam[BAM_VERSION_1541 + 1] = 65;
+
+    allocate_sector(image, LYNX_DIR_TRACK, 0);
+    allocate_sector(image, LYNX_DIR_TRACK, dir_sectors[0]);
+    dir = sector_data(image, LYNX_DIR_TRACK, dir_sectors[0]);
+    dir[0] = 0;
+    dir[1] = 0xff;
+}
+
+/* Return the next free directory slot, NULL if the directory is full.  */
+static BYTE *new_slot(lynx_image_t *image)
+{
+    int n = image->dir_entries;
+    BYTE *dir;
+
+    if (n == 8 * (int)sizeof(dir_sectors)) {
+        return NULL;
+    }
+
+    if (n > 0 && n % 8 == 0) {
+        /* Link in the next directory sector.  */
+        dir = sector_data(image, LYNX_DIR_TRACK, dir_sectors[n / 8 - 1]);
+        dir[0] = LYNX_DIR_TRACK;
+        dir[1] = dir_sectors[n / 8];
+        allocate_sector(image, LYNX_DIR_TRACK, dir_sectors[n / 8]);
+        dir = sector_data(image, LYNX_DIR_TRACK, dir_sectors[n / 8]);
+        dir[0] = 0;
+        dir[1] = 0xff;
+    }
+
+    image->dir_entries++;
+    dir = sector_data(image, LYNX_DIR_TRACK, dir_sectors[n / 8]);
+    return dir + (n % 8) * 32;
+}
+
+static int write_file(lynx_image_t *image, const BYTE *name,
+                      unsigned int name_len, int filetype,
+                      const BYTE *data, unsigned int len)
+{
+    unsigned int track = 0, sector = 0, blocks = 0, n;
+    BYTE *slot, *block = NULL;
+
+    slot = new_slot(image);
+    if (slot == NULL) {
+        return -1;
+    }
+
+    /* Even an empty file has one block.  */
+    do {
+        if (allocate_block(image, &track, &sector) < 0) {
+            return -1;
+        }
+        if (block == NULL) {
+            slot[SLOT_FIRST_TRACK] = (BYTE)track;
+            slot[SLOT_FIRST_SECTOR] = (BYTE)sector;
+        } else {
+            block[0] = (BYTE)track;
+            block[1] = (BYTE)sector;
+        }
+        block = sector_data(image, track, sector);
+
+        n = (len > 254) ? 254 : len;
+        memcpy(block + 2, data, n);
+        block[0] = 0;
+        block[1] = (BYTE)(n + 1);
+        data += n;
+        len -= n;
+        blocks++;
+    } while (len > 0);
+
+    slot[SLOT_TYPE_OFFSET] = (BYTE)(CBMDOS_FT_CLOSED | filetype);
+    memset(slot + SLOT_NAME_OFFSET, 0xa0, CBMDOS_SLOT_NAME_LENGTH);
+    memcpy(slot + SLOT_NAME_OFFSET, name,
+           (name_len > CBMDOS_SLOT_NAME_LENGTH)
+           ? CBMDOS_SLOT_NAME_LENGTH : name_len);
+    slot[SLOT_NR_BLOCKS] = (BYTE)(blocks & 0xff);
+    slot[SLOT_NR_BLOCKS + 1] = (BYTE)(blocks >> 8);
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Return the line at `*pos' ending with a carriage return and its length in
+   `len', and move `*pos' past it.  Return NULL if there is none.  */
+static const BYTE *read_line(const BYTE *data, size_t size, size_t *pos,
+                             unsigned int *len)
+{
+    size_t p = *pos;
+    const BYTE *line = data + p;
+
+    while (p < size && data[p] != 13) {
+        p++;
+    }
+    if (p == size) {
+        return NULL;
+    }
+    *len = (unsigned int)(p - *pos);
+    *pos = p + 1;
+    return line;
+}
+
+/* Read a line that starts with a number.  */
+static int read_number(const BYTE *data, size_t size, size_t *pos,
+                       long *value)
+{
+    const BYTE *line;
+    unsigned int len;
+    char buf[256];
+
+    line = read_line(data, size, pos, &len);
+    if (line == NULL || len >= sizeof(buf)) {
+        return -1;
+    }
+    memcpy(buf, line, len);
+    buf[len] = 0;
+
+    return util_string_to_long(buf, NULL, 10, value);
+}
+
+/* Read the header and leave `*pos' at the first directory entry.  */
+static int read_header(const BYTE *data, size_t size, size_t *pos,
+                       long *dir_blocks, long *entries)
+{
+    size_t p;
+    int zeros = 0;
+
+    /* A BASIC program at $0801...  */
+    if (size < 3 || data[0] != 1 || data[1] != 8) {
+        return -1;
+    }
+    for (p = 2; p < size && zeros < 3; p++) {
+        zeros = data[p] ? 0 : zeros + 1;
+    }
+
+    /* ...followed by a carriage return, the number of directory blocks and
+       the number of files.  */
+    if (p == size || data[p++] != 13
+        || read_number(data, size, &p, dir_blocks) < 0 || *dir_blocks <= 0
+        || read_number(data, size, &p, entries) < 0 || *entries <= 0) {
+        return -1;
+    }
+
+    *pos = p;
+    return 0;
+}
+
+int lynx_check_header(const BYTE *data, size_t size)
+{
+    size_t pos;
+    long dir_blocks, entries;
+
+    return read_header(data, size, &pos, &dir_blocks, &entries);
+}
+
+int lynx_to_d64(const BYTE *data, size_t size, BYTE *image_data)
+{
+    lynx_image_t image;
+    size_t pos, file_pos;
+    int filetype;
+    long dir_blocks, entries, blocks, last_size, len;
+    const BYTE *name, *type;
+    unsigned int name_len, type_len;
+
+    if (read_header(data, size, &pos, &dir_blocks, &entries) < 0) {
+        return -1;
+    }
+
+    file_pos = (size_t)dir_blocks * 254;
+    if (file_pos > size) {
+        return -1;
+    }
+
+    image.data = image_data;
+    format_image(&image);
+
+    while (entries-- > 0) {
+        name = read_line(data, size, &pos, &name_len);
+        if (name == NULL
+            || read_number(data, size, &pos, &blocks) < 0 || blocks <= 0) {
+            return -1;
+        }
+        type = read_line(data, size, &pos, &type_len);
+        if (type == NULL || type_len == 0) {
+            return -1;
+        }
+        switch (type[0]) {
+          case 'D':
+            filetype = CBMDOS_FT_DEL;
+            break;
+          case 'S':
+            filetype = CBMDOS_FT_SEQ;
+            break;
+          case 'U':
+            filetype = CBMDOS_FT_USR;
+            break;
+          case 'R':
+            /* Relative files are not supported, like in c1541.  */
+            return -1;
+          case 'P':
+          default:
+            filetype = CBMDOS_FT_PRG;
+        }
+        if (read_number(data, size, &pos, &last_size) < 0
+            || last_size < 1 || last_size > 255) {
+            return -1;
+        }
+
+        len = (blocks - 1) * 254 + last_size - 1;
+        if (len < 0 || (size_t)len > size - file_pos
+            || write_file(&image, name, name_len, filetype,
+                          data + file_pos, (unsigned int)len) < 0) {
+            return -1;
+        }
+
+        /* The last block is padded, unless it ends the archive.  */
+        file_pos += (size_t)blocks * 254;
+        if (file_pos > size) {
+            file_pos = size;
+        }
+    }
+
+    return 0;
+}
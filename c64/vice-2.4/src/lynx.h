@@ -0,0 +1,40 @@
+/*
+ * lynx.h - Support for Lynx archives in VICE.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_LYNX_H
+#define VICE_LYNX_H
+
+#include <stddef.h>
+
+#include "types.h"
+
+/* Unpack the Lynx archive in memory at `data' into a new D64 image of
+   `D64_FILE_SIZE_35' bytes at `image'.  Return 0 on success, -1 if `data'
+   is no Lynx archive or its files do not fit on the disk.  */
+extern int lynx_to_d64(const BYTE *data, size_t size, BYTE *image);
+
+/* Return 0 if the first `size' bytes at `data' hold the BASIC stub and the
+   header of a Lynx archive, -1 otherwise.  */
+extern int lynx_check_header(const BYTE *data, size_t size);
+
+#endif
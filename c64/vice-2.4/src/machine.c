@@ -58,6 +58,7 @@
 #include "printer.h"
 #include "resources.h"
 #include "romset.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "sysfile.h"
 #include "tape.h"
@@ -231,6 +232,8 @@ void machine_shutdown(void)
 
     autostart_shutdown();
 
+    snapshot_shutdown();
+
 #ifdef HAS_JOYSTICK
     joystick_close();
 #endif
@@ -112,6 +112,10 @@ int main_program(int argc, char **argv)
 
     archdep_init(&argc, argv);
 
+    /* Not any earlier: archdep_init() may set up the timer the profile
+       reads (SDL_Init() restarts SDL's ticks).  */
+    init_profile_start();
+
     if (atexit(main_exit) < 0) {
         archdep_startup_log_error("atexit");
         return -1;
@@ -127,9 +131,17 @@ int main_program(int argc, char **argv)
 
     gfxoutput_early_init();
 
-    if (init_resources() < 0 || init_cmdline_options() < 0) {
+    init_profile_begin(INIT_PROFILE_RESOURCES);
+    if (init_resources() < 0) {
+        return -1;
+    }
+    init_profile_end(INIT_PROFILE_RESOURCES);
+
+    init_profile_begin(INIT_PROFILE_CMDLINE_OPTIONS);
+    if (init_cmdline_options() < 0) {
         return -1;
     }
+    init_profile_end(INIT_PROFILE_CMDLINE_OPTIONS);
 
     /* Set factory defaults.  */
     if (resources_set_defaults() < 0) {
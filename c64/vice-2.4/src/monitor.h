@@ -129,6 +129,20 @@ typedef struct monitor_interface_s monitor_interface_t;
 /* Externals */
 extern unsigned monitor_mask[NUM_MEMSPACES];
 
+/* One bit for every address of a memory space, set if an exec, load or
+   store checkpoint (enabled or not) covers it.  */
+extern BYTE monitor_exec_map[NUM_MEMSPACES][0x10000 / 8];
+extern BYTE monitor_load_map[NUM_MEMSPACES][0x10000 / 8];
+extern BYTE monitor_store_map[NUM_MEMSPACES][0x10000 / 8];
+
+/* Non-zero for the pages (address >> 8) of a memory space that hold a
+   watched address; memory modules only need to hook these.  */
+extern BYTE monitor_load_pages[NUM_MEMSPACES][0x100];
+extern BYTE monitor_store_pages[NUM_MEMSPACES][0x100];
+
+#define MONITOR_MAP_TEST(map, mem, addr) \
+    ((map)[(mem)][((addr) & 0xffff) >> 3] & (1 << ((addr) & 7)))
+
 
 /* Prototypes */
 extern monitor_cpu_type_t* monitor_find_cpu_type_from_string(const char *cpu_type);
@@ -136,8 +136,63 @@ static checkpoint_t *find_checkpoint(int brknum)
     return NULL;
 }
 
+static void mark_checkpoint_list(BYTE *map, checkpoint_list_t *ptr)
+{
+    unsigned loc, end;
+
+    while (ptr) {
+        loc = addr_location(ptr->checkpt->start_addr);
+        end = loc;
+        if (mon_is_valid_addr(ptr->checkpt->end_addr)) {
+            end = addr_location(ptr->checkpt->end_addr);
+        }
+
+        /* Ranges may wrap around 0xffff, see mon_is_in_range().  */
+        for (;;) {
+            map[loc >> 3] |= 1 << (loc & 7);
+            if (loc == end) {
+                break;
+            }
+            loc = (loc + 1) & 0xffff;
+        }
+        ptr = ptr->next;
+    }
+}
+
+static void mark_checkpoint_pages(BYTE *pages, const BYTE *map)
+{
+    unsigned int page, i;
+
+    for (page = 0; page < 0x100; page++) {
+        pages[page] = 0;
+        for (i = 0; i < 0x100 / 8; i++) {
+            if (map[page * (0x100 / 8) + i]) {
+                pages[page] = 1;
+                break;
+            }
+        }
+    }
+}
+
+/* Rebuild the address maps of a memory space from its checkpoint lists.  */
+static void update_checkpoint_maps(MEMSPACE mem)
+{
+    memset(monitor_exec_map[mem], 0, sizeof(monitor_exec_map[mem]));
+    memset(monitor_load_map[mem], 0, sizeof(monitor_load_map[mem]));
+    memset(monitor_store_map[mem], 0, sizeof(monitor_store_map[mem]));
+
+    mark_checkpoint_list(monitor_exec_map[mem], breakpoints[mem]);
+    mark_checkpoint_list(monitor_load_map[mem], watchpoints_load[mem]);
+    mark_checkpoint_list(monitor_store_map[mem], watchpoints_store[mem]);
+
+    mark_checkpoint_pages(monitor_load_pages[mem], monitor_load_map[mem]);
+    mark_checkpoint_pages(monitor_store_pages[mem], monitor_store_map[mem]);
+}
+
 static void update_checkpoint_state(MEMSPACE mem)
 {
+    update_checkpoint_maps(mem);
+
     if (watchpoints_load[mem] != NULL || watchpoints_store[mem] != NULL) {
         monitor_mask[mem] |= MI_WATCH;
         mon_interfaces[mem]->toggle_watchpoints_func(
@@ -583,6 +638,7 @@ void mon_breakpoint_unset(MON_ADDR address)
     if (ptr) {
         /* there's a breakpoint, so remove it */
         remove_checkpoint_from_list( &breakpoints[mem], ptr->checkpt );
+        update_checkpoint_state(mem);
     }
 }
 
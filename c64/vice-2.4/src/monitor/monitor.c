@@ -51,6 +51,7 @@
 #include "datasette.h"
 #include "drive.h"
 #include "drivecpu.h"
+#include "drivethread.h"
 
 #ifdef HAVE_FULLSCREEN
 #include "fullscreenarch.h"
@@ -179,6 +180,11 @@ bool asm_mode;
 MON_ADDR asm_mode_addr;
 static unsigned int next_or_step_stop;
 unsigned monitor_mask[NUM_MEMSPACES];
+BYTE monitor_exec_map[NUM_MEMSPACES][0x10000 / 8];
+BYTE monitor_load_map[NUM_MEMSPACES][0x10000 / 8];
+BYTE monitor_store_map[NUM_MEMSPACES][0x10000 / 8];
+BYTE monitor_load_pages[NUM_MEMSPACES][0x100];
+BYTE monitor_store_pages[NUM_MEMSPACES][0x100];
 
 static bool watch_load_occurred;
 static bool watch_store_occurred;
@@ -1991,7 +1997,8 @@ void monitor_watch_push_load_addr(WORD addr, MEMSPACE mem)
         return;
     }
 
-    if (watch_load_count[mem] == 9) {
+    if (watch_load_count[mem] == 9
+        || !MONITOR_MAP_TEST(monitor_load_map, mem, addr)) {
          return;
     }
 
@@ -2006,7 +2013,8 @@ void monitor_watch_push_store_addr(WORD addr, MEMSPACE mem)
         return;
     }
 
-    if (watch_store_count[mem] == 9) {
+    if (watch_store_count[mem] == 9
+        || !MONITOR_MAP_TEST(monitor_store_map, mem, addr)) {
         return;
     }
 
@@ -2135,6 +2143,10 @@ void monitor_check_icount_interrupt(void)
 
 int monitor_check_breakpoints(MEMSPACE mem, WORD addr)
 {
+    if (!MONITOR_MAP_TEST(monitor_exec_map, mem, addr)) {
+        return 0;
+    }
+
     return mon_breakpoint_check_checkpoint(mem, addr, 0, e_exec); /* FIXME */
 }
 
@@ -2394,6 +2406,8 @@ void monitor_startup(MEMSPACE mem)
 {
     char prompt[40];
 
+    drivethread_sync();
+
     if (mem != e_default_space)
         default_memspace = mem;
 
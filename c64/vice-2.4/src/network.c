@@ -47,6 +47,7 @@
 #include "mos6510.h"
 #include "network.h"
 #include "resources.h"
+#include "snapshot.h"
 #include "translate.h"
 #include "types.h"
 #include "uiapi.h"
@@ -372,6 +373,8 @@ static void network_server_connect_trap(WORD addr, void *data)
     /* Create snapshot and send it */
     snapshotfilename = archdep_tmpnam();
     if (machine_write_snapshot(snapshotfilename, 1, 1, 0) == 0) {
+        /* It may still be being written in the background.  */
+        snapshot_write_sync();
         f = fopen(snapshotfilename, MODE_READ);
         if (f == NULL) {
             ui_error(translate_text(IDGS_CANNOT_LOAD_SNAPSHOT_TRANSFER));
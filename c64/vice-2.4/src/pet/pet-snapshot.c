@@ -33,7 +33,6 @@
 #include "6809.h"
 #include "crtc.h"
 #include "drive-snapshot.h"
-#include "ioutil.h"
 #include "joystick.h"
 #include "keyboard.h"
 #include "log.h"
@@ -90,12 +89,12 @@ int pet_snapshot_write(const char *name, int save_roms, int save_disks,
     if ((!ef) && petres.superpet)
         ef = acia1_snapshot_write_module(s);
 
-    snapshot_close(s);
-
-    if (ef)
-        ioutil_remove(name);
+    if (ef) {
+        snapshot_abort(s);
+        return ef;
+    }
 
-    return ef;
+    return snapshot_close(s);
 }
 
 int pet_snapshot_read(const char *name, int event_mode)
@@ -28,6 +28,7 @@
 #include "vice.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #include "lib.h"
 #include "machine.h"
@@ -38,15 +39,97 @@
 #include "viewport.h"
 
 
+/* Storage for the spans handed to `video_canvas_refresh()'.  */
+static video_refresh_span_t refresh_spans[VIDEO_REFRESH_SPANS_MAX];
+
+/* Collect the runs of changed lines within [y; y + h) so that the video
+   backend only needs to convert those.  Each run grows by `extend' lines
+   on both sides.  Return the number of runs, or 0 if the whole area has to
+   be redrawn anyway.  */
+static unsigned int collect_refresh_spans(raster_canvas_area_t *area,
+                                          int y, int h, int extend)
+{
+    unsigned int count = 0;
+    int line, start, end;
+
+    if (area->dirty_lines == NULL || h <= 0) {
+        return 0;
+    }
+
+    for (line = (int)area->ys; line <= (int)area->ye; line++) {
+        if (line < (int)area->dirty_lines_num && !area->dirty_lines[line]) {
+            continue;
+        }
+
+        start = line;
+        while (line < (int)area->ye
+               && (line + 1 >= (int)area->dirty_lines_num
+                   || area->dirty_lines[line + 1])) {
+            line++;
+        }
+        end = line + 1;
+
+        start = MAX(start - extend, y);
+        end = MIN(end + extend, y + h);
+        if (start >= end) {
+            continue;
+        }
+
+        if (count > 0 && start <= (int)(refresh_spans[count - 1].ys
+                                        + refresh_spans[count - 1].h)) {
+            refresh_spans[count - 1].h = end - refresh_spans[count - 1].ys;
+        } else if (count == VIDEO_REFRESH_SPANS_MAX) {
+            /* Too fragmented, let the last run cover the rest.  */
+            refresh_spans[count - 1].h = y + h - refresh_spans[count - 1].ys;
+            break;
+        } else {
+            refresh_spans[count].ys = start;
+            refresh_spans[count].h = end - start;
+            count++;
+        }
+    }
+
+    if (count == 1 && refresh_spans[0].ys == (unsigned int)y
+        && refresh_spans[0].h == (unsigned int)h) {
+        return 0;
+    }
+
+    return count;
+}
+
+static void clear_dirty_lines(raster_t *raster)
+{
+    raster_canvas_area_t *update_area = raster->update_area;
+    unsigned int height = raster->canvas->draw_buffer->draw_buffer_height;
+
+    if (update_area->dirty_lines_num < height) {
+        /* The frame buffer has grown; start over with all lines clean, the
+           area of this frame has been redrawn as a whole.  */
+        lib_free(update_area->dirty_lines);
+        update_area->dirty_lines = lib_calloc(height, 1);
+        update_area->dirty_lines_num = height;
+        return;
+    }
+
+    if (update_area->ys < update_area->dirty_lines_num) {
+        memset(update_area->dirty_lines + update_area->ys, 0,
+               MIN(update_area->ye + 1, update_area->dirty_lines_num)
+               - update_area->ys);
+    }
+}
+
 inline static void refresh_canvas(raster_t *raster)
 {
     raster_canvas_area_t *update_area;
     viewport_t *viewport;
+    draw_buffer_t *draw_buffer;
     int x, y, xx, yy;
     int w, h;
+    int extend = 0;
 
     update_area = raster->update_area;
     viewport = raster->canvas->viewport;
+    draw_buffer = raster->canvas->draw_buffer;
 
 #if (!defined(GP2X) || defined(GP2X_SDL)) && (!defined(WIZ) || defined(WIZ_SDL))
     if (update_area->is_null)
@@ -77,6 +160,7 @@ inline static void refresh_canvas(raster_t *raster)
         y --;
         yy --;
         h += 2;
+        extend = 1;
     }
 
     if (xx < 0) {
@@ -95,12 +179,22 @@ inline static void refresh_canvas(raster_t *raster)
     xx += viewport->x_offset;
     yy += viewport->y_offset;
 
-    if ((int)(raster->canvas->draw_buffer->canvas_height) >= yy
-        && (int)(raster->canvas->draw_buffer->canvas_width) >= xx)
-        video_canvas_refresh(raster->canvas, x, y, xx, yy,
-            MIN(w, (int)(raster->canvas->draw_buffer->canvas_width - xx)),
-            MIN(h, (int)(raster->canvas->draw_buffer->canvas_height - yy)));
+    if ((int)(draw_buffer->canvas_height) >= yy
+        && (int)(draw_buffer->canvas_width) >= xx) {
+        w = MIN(w, (int)(draw_buffer->canvas_width - xx));
+        h = MIN(h, (int)(draw_buffer->canvas_height - yy));
+
+        draw_buffer->refresh_span_count
+            = collect_refresh_spans(update_area, y, h, extend);
+        draw_buffer->refresh_spans = refresh_spans;
+
+        video_canvas_refresh(raster->canvas, x, y, xx, yy, w, h);
+
+        draw_buffer->refresh_span_count = 0;
+        draw_buffer->refresh_spans = NULL;
+    }
 
+    clear_dirty_lines(raster);
     update_area->is_null = 1;
 }
 
@@ -130,10 +224,15 @@ void raster_canvas_init(raster_t *raster)
     raster->update_area = lib_malloc(sizeof(raster_canvas_area_t));
 
     raster->update_area->is_null = 1;
+    raster->update_area->dirty_lines = NULL;
+    raster->update_area->dirty_lines_num = 0;
 }
 
 void raster_canvas_shutdown(raster_t *raster)
 {
+   if (raster->update_area != NULL) {
+       lib_free(raster->update_area->dirty_lines);
+   }
    lib_free(raster->update_area);
 }
 
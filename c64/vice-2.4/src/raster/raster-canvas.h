@@ -27,6 +27,8 @@
 #ifndef VICE_RASTER_CANVAS_H
 #define VICE_RASTER_CANVAS_H
 
+#include "types.h"
+
 struct raster_s;
 
 /* A simple convenience type for defining a rectangular area on the screen.  */
@@ -36,6 +38,9 @@ struct raster_canvas_area_s {
     unsigned int xe;
     unsigned int ye;
     int is_null;
+    /* Lines within ys..ye that have actually changed.  */
+    BYTE *dirty_lines;
+    unsigned int dirty_lines_num;
 };
 typedef struct raster_canvas_area_s raster_canvas_area_t;
 
@@ -52,7 +52,8 @@ unsigned int raster_line_get_real_mode(raster_t *raster)
         return raster->video_mode;
 }
 
-/* Increase `area' so that it also includes [xs; xe] at line y.  */
+/* Increase `area' so that it also includes [xs; xe] at line y, and mark
+   line y as changed.  */
 inline static void add_line_to_area(raster_canvas_area_t *area, unsigned int y,
                                     unsigned int xs, unsigned int xe)
 {
@@ -67,6 +68,10 @@ inline static void add_line_to_area(raster_canvas_area_t *area, unsigned int y,
         area->ys = MIN(y, area->ys);
         area->ye = MAX(y, area->ye);
     }
+
+    if (y < area->dirty_lines_num) {
+        area->dirty_lines[y] = 1;
+    }
 }
 
 inline void raster_line_draw_blank(raster_t *raster, unsigned int start,
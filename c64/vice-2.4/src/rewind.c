@@ -0,0 +1,613 @@
+/*
+ * rewind.c - Keep a history of recent machine states to rewind to.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Every `RewindInterval' frames the machine writes an in-memory snapshot
+   (without ROMs and disk images).  Most of a snapshot does not change
+   between two captures, so only every `RewindKeyframeInterval'th capture is
+   kept as is; the ones in between are stored as the difference to the
+   keyframe before them, in the same format frotz uses for its undo
+   buffers: a zero byte followed by the length of a run of unchanged bytes,
+   or the XOR of a changed byte with the keyframe.
+
+   Every delta only depends on its keyframe, so restoring any capture costs
+   one copy and one pass over its delta.  The history is a ring that drops
+   the oldest keyframe and its deltas when `RewindMemoryLimit' is exceeded,
+   so each capture is freed exactly once and a capture costs the same no
+   matter how much history is kept.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cmdline.h"
+#include "interrupt.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "network.h"
+#include "resources.h"
+#include "rewind.h"
+#include "snapshot.h"
+#include "translate.h"
+#include "types.h"
+#include "vice-event.h"
+#include "vsync.h"
+#include "vsyncapi.h"
+
+/* Captures between two stats messages.  */
+#define REWIND_STATS_CAPTURES 100
+
+typedef struct rewind_entry_s {
+    /* The snapshot, or its difference to `key'.  */
+    BYTE *data;
+    size_t len;
+
+    /* Size of the snapshot.  */
+    size_t full_len;
+
+    /* Keyframe this is a delta of, NULL for keyframes.  */
+    const BYTE *key;
+} rewind_entry_t;
+
+static int (*rewind_write_func)(struct snapshot_s *s) = NULL;
+static int (*rewind_read_func)(struct snapshot_s *s) = NULL;
+
+/* The history, oldest first.  */
+static rewind_entry_t *rewind_ring = NULL;
+static unsigned int rewind_ring_size = 0;
+static unsigned int rewind_ring_first = 0;
+static unsigned int rewind_ring_count = 0;
+
+/* Bytes of snapshot data held in the ring.  */
+static size_t rewind_bytes = 0;
+
+/* Newest keyframe and the number of captures taken since.  */
+static const BYTE *rewind_key = NULL;
+static size_t rewind_key_len = 0;
+static unsigned int rewind_key_age = 0;
+
+/* Set when the memory limit can only be kept by starting a new keyframe.  */
+static int rewind_force_key = 0;
+
+/* Frames since the last capture.  */
+static unsigned int rewind_frames = 0;
+
+/* Work buffer for deltas and restoring, and its size.  */
+static BYTE *rewind_buffer = NULL;
+static size_t rewind_buffer_size = 0;
+
+/* Statistics for `RewindStats'.  */
+static unsigned long rewind_stats_time = 0;
+static unsigned int rewind_stats_captures = 0;
+
+static log_t rewind_log = LOG_DEFAULT;
+
+/* Resources.  */
+static int rewind_enabled = 0;
+static int rewind_interval = 10;
+static int rewind_keyframe_interval = 30;
+static int rewind_memory_limit = 16384;
+static int rewind_stats = 0;
+
+/* ------------------------------------------------------------------------- */
+
+static rewind_entry_t *rewind_entry(unsigned int i)
+{
+    return &rewind_ring[(rewind_ring_first + i) % rewind_ring_size];
+}
+
+static BYTE *rewind_get_buffer(size_t size)
+{
+    if (size > rewind_buffer_size) {
+        lib_free(rewind_buffer);
+        rewind_buffer = lib_malloc(size);
+        rewind_buffer_size = size;
+    }
+    return rewind_buffer;
+}
+
+/* Store the difference between `key' and `data' in `out', which must be
+   able to hold `len * 3 / 2 + 3' bytes.  Return its size.  */
+static size_t rewind_diff(const BYTE *key, const BYTE *data, size_t len,
+                          BYTE *out)
+{
+    BYTE *p = out;
+    size_t i = 0, run;
+
+    while (1) {
+        run = i;
+        while (i + 8 <= len && memcmp(key + i, data + i, 8) == 0) {
+            i += 8;
+        }
+        while (i < len && key[i] == data[i]) {
+            i++;
+        }
+        if (i == len) {
+            break;
+        }
+        run = i - run;
+
+        while (run > 0x8000) {
+            *p++ = 0;
+            *p++ = 0xff;
+            *p++ = 0xff;
+            run -= 0x8000;
+        }
+        if (run > 0) {
+            *p++ = 0;
+            run--;
+            if (run <= 0x7f) {
+                *p++ = (BYTE)run;
+            } else {
+                *p++ = (BYTE)((run & 0x7f) | 0x80);
+                *p++ = (BYTE)(run >> 7);
+            }
+        }
+        *p++ = key[i] ^ data[i];
+        i++;
+    }
+
+    return (size_t)(p - out);
+}
+
+/* Apply the difference at `diff' to the `len' bytes at `dest'.  */
+static void rewind_undiff(const BYTE *diff, size_t diff_len, BYTE *dest,
+                          size_t len)
+{
+    const BYTE *end = diff + diff_len;
+    size_t i = 0;
+
+    while (diff < end && i < len) {
+        BYTE c = *diff++;
+
+        if (c == 0) {
+            size_t run;
+
+            if (diff == end) {
+                return;
+            }
+            run = *diff++;
+            if (run & 0x80) {
+                if (diff == end) {
+                    return;
+                }
+                run = (run & 0x7f) | ((size_t)*diff++ << 7);
+            }
+            i += run + 1;
+        } else {
+            dest[i++] ^= c;
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void rewind_free_entry(rewind_entry_t *e)
+{
+    rewind_bytes -= e->len;
+    lib_free(e->data);
+    e->data = NULL;
+}
+
+/* Find the newest keyframe after the newest captures have been dropped.  */
+static void rewind_find_key(void)
+{
+    unsigned int i = rewind_ring_count;
+
+    rewind_key = NULL;
+    rewind_key_len = 0;
+    rewind_key_age = 0;
+
+    while (i > 0) {
+        rewind_entry_t *e = rewind_entry(--i);
+
+        if (e->key == NULL) {
+            rewind_key = e->data;
+            rewind_key_len = e->full_len;
+            return;
+        }
+        rewind_key_age++;
+    }
+}
+
+static void rewind_push(BYTE *data, size_t len, size_t full_len,
+                        const BYTE *key)
+{
+    rewind_entry_t *e;
+
+    if (rewind_ring_count == rewind_ring_size) {
+        unsigned int i, size = rewind_ring_size ? rewind_ring_size * 2 : 64;
+        rewind_entry_t *ring = lib_malloc(size * sizeof(rewind_entry_t));
+
+        for (i = 0; i < rewind_ring_count; i++) {
+            ring[i] = *rewind_entry(i);
+        }
+        lib_free(rewind_ring);
+        rewind_ring = ring;
+        rewind_ring_size = size;
+        rewind_ring_first = 0;
+    }
+
+    e = rewind_entry(rewind_ring_count++);
+    e->data = data;
+    e->len = len;
+    e->full_len = full_len;
+    e->key = key;
+    rewind_bytes += len;
+}
+
+/* Drop the oldest keyframes and their deltas until the history fits in the
+   memory limit again.  */
+static void rewind_trim(void)
+{
+    size_t limit = (size_t)rewind_memory_limit * 1024;
+
+    while (rewind_bytes > limit) {
+        unsigned int n = 1;
+
+        while (n < rewind_ring_count && rewind_entry(n)->key != NULL) {
+            n++;
+        }
+        if (n == rewind_ring_count) {
+            /* Only the newest keyframe is left; it can go once there is a
+               new one.  */
+            rewind_force_key = 1;
+            return;
+        }
+
+        rewind_ring_count -= n;
+        while (n-- > 0) {
+            rewind_free_entry(rewind_entry(0));
+            rewind_ring_first = (rewind_ring_first + 1) % rewind_ring_size;
+        }
+    }
+}
+
+void rewind_clear(void)
+{
+    while (rewind_ring_count > 0) {
+        rewind_free_entry(rewind_entry(--rewind_ring_count));
+    }
+    rewind_ring_first = 0;
+    rewind_find_key();
+    rewind_force_key = 0;
+    rewind_frames = 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void rewind_stats_update(unsigned long time)
+{
+    double seconds;
+
+    rewind_stats_time += time;
+    if (++rewind_stats_captures < REWIND_STATS_CAPTURES) {
+        return;
+    }
+
+    seconds = (double)rewind_ring_count * rewind_interval
+              / vsync_get_refresh_frequency();
+
+    log_message(rewind_log,
+                "%lu us per capture, %lu bytes per second of history (%lu KB for %.1f s).",
+                (unsigned long)(rewind_stats_time * 1000000.0 / vsyncarch_frequency()
+                                / rewind_stats_captures),
+                (unsigned long)(seconds > 0 ? rewind_bytes / seconds : 0),
+                (unsigned long)(rewind_bytes / 1024), seconds);
+
+    rewind_stats_time = 0;
+    rewind_stats_captures = 0;
+}
+
+static void rewind_capture(void)
+{
+    snapshot_t *s;
+    BYTE *data;
+    size_t len;
+    unsigned long start = 0;
+
+    if (rewind_stats) {
+        start = vsyncarch_gettime();
+    }
+
+    rewind_frames = 0;
+
+    s = snapshot_memory_create(0, 0, machine_get_name());
+    if (rewind_write_func(s) < 0) {
+        snapshot_abort(s);
+        log_error(rewind_log, "Cannot save machine state, rewinding disabled.");
+        resources_set_int("Rewind", 0);
+        return;
+    }
+    data = snapshot_memory_close(s, &len);
+
+    if (rewind_key != NULL && rewind_key_len == len && !rewind_force_key
+        && rewind_key_age + 1 < (unsigned int)rewind_keyframe_interval) {
+        BYTE *delta = rewind_get_buffer(len * 3 / 2 + 3);
+        size_t delta_len = rewind_diff(rewind_key, data, len, delta);
+
+        /* Not worth it if most of the state has changed.  */
+        if (delta_len <= len / 2) {
+            lib_free(data);
+            data = lib_malloc(delta_len ? delta_len : 1);
+            memcpy(data, delta, delta_len);
+            rewind_push(data, delta_len, len, rewind_key);
+            rewind_key_age++;
+            goto done;
+        }
+    }
+
+    rewind_push(data, len, len, NULL);
+    rewind_key = data;
+    rewind_key_len = len;
+    rewind_key_age = 0;
+    rewind_force_key = 0;
+
+done:
+    rewind_trim();
+
+    if (rewind_stats) {
+        rewind_stats_update(vsyncarch_gettime() - start);
+    }
+}
+
+static void rewind_capture_trap(WORD addr, void *data)
+{
+    if (rewind_enabled) {
+        rewind_capture();
+    }
+}
+
+void rewind_vsync_hook(void)
+{
+    if (!rewind_enabled || rewind_write_func == NULL) {
+        return;
+    }
+
+    if (++rewind_frames < (unsigned int)rewind_interval) {
+        return;
+    }
+
+    /* Rewinding would break recordings and network play.  */
+    if (network_connected() || event_record_active()
+        || event_playback_active()) {
+        rewind_frames = 0;
+        return;
+    }
+
+    /* There is only one trap; if someone else has it, try again on the next
+       frame.  */
+    if (!(maincpu_int_status->global_pending_int & IK_TRAP)) {
+        interrupt_maincpu_trigger_trap(rewind_capture_trap, NULL);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+int rewind_back(unsigned int frames)
+{
+    rewind_entry_t *e;
+    snapshot_t *s;
+    const BYTE *data;
+    BYTE major, minor;
+    unsigned int steps = 0;
+
+    if (rewind_ring_count == 0 || rewind_read_func == NULL) {
+        return -1;
+    }
+
+    /* The newest capture is `rewind_frames' old, each one before that
+       another `RewindInterval' frames.  */
+    if (frames > rewind_frames) {
+        steps = (frames - rewind_frames + rewind_interval - 1) / rewind_interval;
+    }
+    if (steps >= rewind_ring_count) {
+        steps = rewind_ring_count - 1;
+    }
+
+    /* The future is gone now.  */
+    while (steps-- > 0) {
+        rewind_free_entry(rewind_entry(--rewind_ring_count));
+    }
+    rewind_find_key();
+
+    e = rewind_entry(rewind_ring_count - 1);
+    if (e->key == NULL) {
+        data = e->data;
+    } else {
+        BYTE *buffer = rewind_get_buffer(e->full_len);
+
+        memcpy(buffer, e->key, e->full_len);
+        rewind_undiff(e->data, e->len, buffer, e->full_len);
+        data = buffer;
+    }
+
+    rewind_frames = 0;
+
+    s = snapshot_memory_open(data, e->full_len, &major, &minor,
+                             machine_get_name());
+    if (s == NULL || rewind_read_func(s) < 0) {
+        if (s != NULL) {
+            snapshot_close(s);
+        }
+        log_error(rewind_log, "Cannot restore machine state.");
+        rewind_clear();
+        machine_trigger_reset(MACHINE_RESET_MODE_SOFT);
+        return -1;
+    }
+    snapshot_close(s);
+
+    return 0;
+}
+
+static void rewind_back_trap(WORD addr, void *data)
+{
+    rewind_back((unsigned int)vice_ptr_to_uint(data));
+}
+
+int rewind_trigger(unsigned int frames)
+{
+    if (rewind_ring_count == 0 || rewind_read_func == NULL) {
+        return -1;
+    }
+
+    interrupt_maincpu_trigger_trap(rewind_back_trap, uint_to_void_ptr(frames));
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+void rewind_init(int (*write_func)(struct snapshot_s *s),
+                 int (*read_func)(struct snapshot_s *s))
+{
+    rewind_log = log_open("Rewind");
+    rewind_write_func = write_func;
+    rewind_read_func = read_func;
+}
+
+void rewind_shutdown(void)
+{
+    rewind_clear();
+    lib_free(rewind_ring);
+    rewind_ring = NULL;
+    rewind_ring_size = 0;
+    lib_free(rewind_buffer);
+    rewind_buffer = NULL;
+    rewind_buffer_size = 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_rewind_enabled(int val, void *param)
+{
+    rewind_enabled = val ? 1 : 0;
+
+    if (!rewind_enabled) {
+        rewind_clear();
+    }
+    return 0;
+}
+
+static int set_rewind_interval(int val, void *param)
+{
+    if (val < 1) {
+        return -1;
+    }
+
+    rewind_interval = val;
+    rewind_clear();
+    return 0;
+}
+
+static int set_rewind_keyframe_interval(int val, void *param)
+{
+    if (val < 1) {
+        return -1;
+    }
+
+    rewind_keyframe_interval = val;
+    return 0;
+}
+
+static int set_rewind_memory_limit(int val, void *param)
+{
+    if (val < 1) {
+        return -1;
+    }
+
+    rewind_memory_limit = val;
+    rewind_trim();
+    return 0;
+}
+
+static int set_rewind_stats(int val, void *param)
+{
+    rewind_stats = val ? 1 : 0;
+    rewind_stats_time = 0;
+    rewind_stats_captures = 0;
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "Rewind", 0, RES_EVENT_NO, NULL,
+      &rewind_enabled, set_rewind_enabled, NULL },
+    { "RewindInterval", 10, RES_EVENT_NO, NULL,
+      &rewind_interval, set_rewind_interval, NULL },
+    { "RewindKeyframeInterval", 30, RES_EVENT_NO, NULL,
+      &rewind_keyframe_interval, set_rewind_keyframe_interval, NULL },
+    { "RewindMemoryLimit", 16384, RES_EVENT_NO, NULL,
+      &rewind_memory_limit, set_rewind_memory_limit, NULL },
+    { "RewindStats", 0, RES_EVENT_NO, NULL,
+      &rewind_stats, set_rewind_stats, NULL },
+    { NULL }
+};
+
+int rewind_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] = {
+    { "-rewind", SET_RESOURCE, 0,
+      NULL, NULL, "Rewind", (void *)1,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Keep a history of machine states to rewind to" },
+    { "+rewind", SET_RESOURCE, 0,
+      NULL, NULL, "Rewind", (void *)0,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Do not keep a history of machine states" },
+    { "-rewindinterval", SET_RESOURCE, 1,
+      NULL, NULL, "RewindInterval", NULL,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      "<frames>", "Save the machine state every <frames> frames" },
+    { "-rewindkeyframes", SET_RESOURCE, 1,
+      NULL, NULL, "RewindKeyframeInterval", NULL,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      "<number>", "Keep every <number>th machine state whole, the others as differences" },
+    { "-rewindmemory", SET_RESOURCE, 1,
+      NULL, NULL, "RewindMemoryLimit", NULL,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      "<KB>", "Use at most <KB> kilobytes for the rewind history" },
+    { "-rewindstats", SET_RESOURCE, 0,
+      NULL, NULL, "RewindStats", (void *)1,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Log the time taken and memory used by the rewind history" },
+    { "+rewindstats", SET_RESOURCE, 0,
+      NULL, NULL, "RewindStats", (void *)0,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Do not log rewind statistics" },
+    { NULL }
+};
+
+int rewind_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
@@ -0,0 +1,49 @@
+/*
+ * rewind.h - Keep a history of recent machine states to rewind to.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_REWIND_H
+#define VICE_REWIND_H
+
+struct snapshot_s;
+
+/* Called by machines that support rewinding with the functions that save
+   and restore their state.  */
+extern void rewind_init(int (*write_func)(struct snapshot_s *s),
+                        int (*read_func)(struct snapshot_s *s));
+extern int rewind_resources_init(void);
+extern int rewind_cmdline_options_init(void);
+extern void rewind_shutdown(void);
+
+/* To be called at the end of every frame.  */
+extern void rewind_vsync_hook(void);
+
+/* Go back at least `frames' frames.  `rewind_back()' must be called from a
+   trap, `rewind_trigger()' schedules it.  Both return -1 if there is no
+   history.  */
+extern int rewind_back(unsigned int frames);
+extern int rewind_trigger(unsigned int frames);
+
+/* Forget all history.  */
+extern void rewind_clear(void);
+
+#endif
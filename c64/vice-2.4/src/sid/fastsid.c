@@ -33,6 +33,10 @@
 #include <string.h>
 #include <math.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "fastsid.h"
 #include "lib.h"
 #include "log.h"
@@ -637,96 +641,193 @@ inline static void setup_voice(voice_t *pv)
     pv->gateflip = 0;
 }
 
-static SWORD fastsid_calculate_single_sample(sound_t *psid, int i)
+/* Number of samples rendered per pass of the block renderer.  */
+#define FASTSID_BLOCK 64
+
+/* Advance the oscillators and envelopes of all voices by `n' samples and
+   store the raw (unfiltered) voice outputs in `o0', `o1' and `o2'.  */
+static void fastsid_clock_block(sound_t *psid, DWORD *o0, DWORD *o1,
+                                DWORD *o2, int n)
 {
-    DWORD o0, o1, o2;
+    int i;
     int dosync1, dosync2;
     voice_t *v0, *v1, *v2;
 
-    setup_sid(psid);
     v0 = &psid->v[0];
-    setup_voice(v0);
     v1 = &psid->v[1];
-    setup_voice(v1);
     v2 = &psid->v[2];
-    setup_voice(v2);
-
-    /* addfptrs, noise & hard sync test */
-    dosync1 = 0;
-    if ((v0->f += v0->fs) < v0->fs) {
-        v0->rv = NSHIFT(v0->rv, 16);
-        if (v1->sync)
-            dosync1 = 1;
-    }
-    dosync2 = 0;
-    if ((v1->f += v1->fs) < v1->fs) {
-        v1->rv = NSHIFT(v1->rv, 16);
-        if (v2->sync)
-            dosync2 = 1;
-    }
-    if ((v2->f += v2->fs) < v2->fs) {
-        v2->rv = NSHIFT(v2->rv, 16);
-        if (v0->sync) {
+
+    for (i = 0; i < n; i++) {
+        /* addfptrs, noise & hard sync test */
+        dosync1 = 0;
+        if ((v0->f += v0->fs) < v0->fs) {
+            v0->rv = NSHIFT(v0->rv, 16);
+            if (v1->sync)
+                dosync1 = 1;
+        }
+        dosync2 = 0;
+        if ((v1->f += v1->fs) < v1->fs) {
+            v1->rv = NSHIFT(v1->rv, 16);
+            if (v2->sync)
+                dosync2 = 1;
+        }
+        if ((v2->f += v2->fs) < v2->fs) {
+            v2->rv = NSHIFT(v2->rv, 16);
+            if (v0->sync) {
+            /* hard sync */
+                v0->rv = NSHIFT(v0->rv, v0->f >> 28);
+                v0->f = 0;
+            }
+        }
+
         /* hard sync */
-            v0->rv = NSHIFT(v0->rv, v0->f >> 28);
-            v0->f = 0;
+        if (dosync2) {
+            v2->rv = NSHIFT(v2->rv, v2->f >> 28);
+            v2->f = 0;
+        }
+        if (dosync1) {
+            v1->rv = NSHIFT(v1->rv, v1->f >> 28);
+            v1->f = 0;
         }
+
+        /* do adsr */
+        if ((v0->adsr += v0->adsrs) + 0x80000000 < v0->adsrz + 0x80000000)
+            trigger_adsr(v0);
+        if ((v1->adsr += v1->adsrs) + 0x80000000 < v1->adsrz + 0x80000000)
+            trigger_adsr(v1);
+        if ((v2->adsr += v2->adsrs) + 0x80000000 < v2->adsrz + 0x80000000)
+            trigger_adsr(v2);
+
+        /* oscillators */
+        o0[i] = v0->adsr >> 16;
+        o1[i] = v1->adsr >> 16;
+        o2[i] = v2->adsr >> 16;
+        if (o0[i])
+            o0[i] *= doosc(v0);
+        if (o1[i])
+            o1[i] *= doosc(v1);
+        if (psid->has3 && o2[i])
+            o2[i] *= doosc(v2);
+        else
+            o2[i] = 0;
     }
+}
 
-    /* hard sync */
-    if (dosync2) {
-        v2->rv = NSHIFT(v2->rv, v2->f >> 28);
-        v2->f = 0;
+/* Run `n' outputs of one voice through the filter.  */
+static void fastsid_filter_block(voice_t *pv, DWORD *o, int n)
+{
+    int i;
+
+    if (!pv->filter) {
+        /* `dofilter()' would leave the value alone.  */
+        for (i = 0; i < n; i++) {
+            pv->filtIO = ampMod1x8[(o[i] >> 22)];
+            o[i] = ((DWORD)(pv->filtIO) + 0x80) << (7 + 15);
+        }
+        return;
     }
-    if (dosync1) {
-        v1->rv = NSHIFT(v1->rv, v1->f >> 28);
-        v1->f = 0;
+
+    for (i = 0; i < n; i++) {
+        pv->filtIO = ampMod1x8[(o[i] >> 22)];
+        dofilter(pv);
+        o[i] = ((DWORD)(pv->filtIO) + 0x80) << (7 + 15);
     }
+}
 
-    /* do adsr */
-    if ((v0->adsr += v0->adsrs) + 0x80000000 < v0->adsrz + 0x80000000)
-        trigger_adsr(v0);
-    if ((v1->adsr += v1->adsrs) + 0x80000000 < v1->adsrz + 0x80000000)
-        trigger_adsr(v1);
-    if ((v2->adsr += v2->adsrs) + 0x80000000 < v2->adsrz + 0x80000000)
-        trigger_adsr(v2);
-
-    /* oscillators */
-    o0 = v0->adsr >> 16;
-    o1 = v1->adsr >> 16;
-    o2 = v2->adsr >> 16;
-    if (o0)
-        o0 *= doosc(v0);
-    if (o1)
-        o1 *= doosc(v1);
-    if (psid->has3 && o2)
-        o2 *= doosc(v2);
-    else
-        o2 = 0;
-    /* sample */
-    if (psid->emulatefilter) {
-        v0->filtIO = ampMod1x8[(o0 >> 22)];
-        dofilter(v0);
-        o0 = ((DWORD)(v0->filtIO) + 0x80) << (7 + 15);
-        v1->filtIO = ampMod1x8[(o1 >> 22)];
-        dofilter(v1);
-        o1 = ((DWORD)(v1->filtIO) + 0x80) << (7 + 15);
-        v2->filtIO = ampMod1x8[(o2 >> 22)];
-        dofilter(v2);
-        o2 = ((DWORD)(v2->filtIO) + 0x80) << (7 + 15);
+/* Mix `n' samples of the three voices into `pbuf'.  The sum shifted down
+   by 20 bits minus 0x600 always fits in 12 bits plus sign, so the volume
+   multiplication can be done on 16-bit lanes.  */
+static void fastsid_mix_block(const DWORD *o0, const DWORD *o1,
+                              const DWORD *o2, SWORD *pbuf, int n, int vol)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i bias = _mm_set1_epi32(0x600);
+    const __m128i volume = _mm_set1_epi16((short)vol);
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i lo, hi;
+
+        lo = _mm_add_epi32(_mm_loadu_si128((const __m128i *)&o0[i]),
+                           _mm_loadu_si128((const __m128i *)&o1[i]));
+        lo = _mm_add_epi32(lo, _mm_loadu_si128((const __m128i *)&o2[i]));
+        lo = _mm_sub_epi32(_mm_srli_epi32(lo, 20), bias);
+
+        hi = _mm_add_epi32(_mm_loadu_si128((const __m128i *)&o0[i + 4]),
+                           _mm_loadu_si128((const __m128i *)&o1[i + 4]));
+        hi = _mm_add_epi32(hi, _mm_loadu_si128((const __m128i *)&o2[i + 4]));
+        hi = _mm_sub_epi32(_mm_srli_epi32(hi, 20), bias);
+
+        _mm_storeu_si128((__m128i *)&pbuf[i],
+                         _mm_mullo_epi16(_mm_packs_epi32(lo, hi), volume));
     }
+#endif
 
-    return (SWORD)(((SDWORD)((o0 + o1 + o2) >> 20) - 0x600) * psid->vol);
+    for (; i < n; i++) {
+        pbuf[i] = (SWORD)(((SDWORD)((o0[i] + o1[i] + o2[i]) >> 20) - 0x600)
+                          * vol);
+    }
 }
 
-static int fastsid_calculate_samples(sound_t *psid, SWORD *pbuf, int nr,
-                                     int interleave, int *delta_t)
+/* Render `nr' samples into every `interleave'th slot of `pbuf', mixing
+   them with what is already there if `mix' is set.
+
+   Registers cannot change while this runs, because every store flushes the
+   sound buffer first.  So the SID and voice setup is done once up front,
+   and the samples are then produced in blocks: first the oscillators and
+   envelopes, then the filters, then the final mix.  The output is the same
+   as when computing one sample at a time.  */
+static void fastsid_render(sound_t *psid, SWORD *pbuf, int nr,
+                           int interleave, int mix)
 {
-    int i;
+    DWORD o[3][FASTSID_BLOCK];
+    SWORD buf[FASTSID_BLOCK];
+    SWORD *out;
+    int i, n;
+
+    setup_sid(psid);
+    setup_voice(&psid->v[0]);
+    setup_voice(&psid->v[1]);
+    setup_voice(&psid->v[2]);
+
+    while (nr > 0) {
+        n = nr < FASTSID_BLOCK ? nr : FASTSID_BLOCK;
+
+        fastsid_clock_block(psid, o[0], o[1], o[2], n);
+
+        if (psid->emulatefilter) {
+            fastsid_filter_block(&psid->v[0], o[0], n);
+            fastsid_filter_block(&psid->v[1], o[1], n);
+            fastsid_filter_block(&psid->v[2], o[2], n);
+        }
 
-    for (i = 0; i < nr; i++) {
-        pbuf[i * interleave] = fastsid_calculate_single_sample(psid, i);
+        out = (interleave == 1 && !mix) ? pbuf : buf;
+
+        fastsid_mix_block(o[0], o[1], o[2], out, n, psid->vol);
+
+        if (out != pbuf) {
+            if (mix) {
+                for (i = 0; i < n; i++) {
+                    pbuf[i * interleave] =
+                        sound_audio_mix(pbuf[i * interleave], buf[i]);
+                }
+            } else {
+                for (i = 0; i < n; i++) {
+                    pbuf[i * interleave] = buf[i];
+                }
+            }
+        }
+
+        pbuf += n * interleave;
+        nr -= n;
     }
+}
+
+static int fastsid_calculate_samples(sound_t *psid, SWORD *pbuf, int nr,
+                                     int interleave, int *delta_t)
+{
+    fastsid_render(psid, pbuf, nr, interleave, 0);
 
     return nr;
 }
@@ -734,11 +835,7 @@ static int fastsid_calculate_samples(sound_t *psid, SWORD *pbuf, int nr,
 int fastsid_calculate_samples_mix(sound_t *psid, SWORD *pbuf, int nr,
                                   int interleave, int *delta_t)
 {
-    int i;
-
-    for (i = 0; i< nr; i++) {
-        pbuf[i * interleave] = sound_audio_mix(pbuf[i * interleave], fastsid_calculate_single_sample(psid, i));
-    }
+    fastsid_render(psid, pbuf, nr, interleave, 1);
 
     return nr;
 }
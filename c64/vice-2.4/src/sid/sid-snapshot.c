@@ -161,6 +161,8 @@ static int sid_snapshot_write_module_extended(snapshot_t *s)
         )
         return 0;
 
+    /* fastsid does not fill in the state.  */
+    memset(&sid_state, 0, sizeof(sid_state));
     sid_state_read(0, &sid_state);
 
     m = snapshot_module_create(s, snap_module_name_extended,
@@ -24,29 +24,54 @@
  *
  */
 
+/* Snapshots are built up in memory and written out in one go when they
+   are closed, optionally gzip compressed and from a separate thread, so
+   that saving does not stall the emulation with thousands of tiny writes.
+   Likewise a snapshot is read into memory as a whole when it is opened.
+   Compression uses zlib if VICE is built with it, and otherwise the
+   in-tree deflate coder (zdeflate.c, zinflate.c), which compresses less
+   but writes and reads the same gzip format.  */
+
 #include "vice.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #include "archdep.h"
+#include "cmdline.h"
+#include "crc32.h"
 #include "lib.h"
 #include "ioutil.h"
 #include "log.h"
+#include "resources.h"
 #include "snapshot.h"
+#include "translate.h"
 #include "types.h"
 #include "vsync.h"
+#include "zdeflate.h"
 #include "zfile.h"
+#include "zinflate.h"
 
 
 char snapshot_magic_string[] = "VICE Snapshot File\032";
 
 #define SNAPSHOT_MAGIC_LEN              19
 
+/* Initial size of the buffer a snapshot is built up in.  */
+#define SNAPSHOT_BUFFER_SIZE            0x10000
+
 struct snapshot_module_s {
-    /* File descriptor.  */
-    FILE *file;
+    /* Snapshot the module belongs to.  */
+    snapshot_t *snapshot;
 
     /* Flag: are we writing it?  */
     int write_mode;
@@ -54,240 +79,308 @@ struct snapshot_module_s {
     /* Size of the module.  */
     DWORD size;
 
-    /* Offset of the module in the file.  */
-    long offset;
+    /* Offset of the module in the snapshot.  */
+    size_t offset;
 
-    /* Offset of the size field in the file.  */
-    long size_offset;
+    /* Offset of the size field in the snapshot.  */
+    size_t size_offset;
 };
 
 struct snapshot_s {
-    /* File descriptor.  */
-    FILE *file;
+    /* Contents of the snapshot.  */
+    BYTE *data;
+
+    /* Number of valid bytes in `data', and its allocated size.  */
+    size_t len;
+    size_t alloc;
+
+    /* Current read/write position.  */
+    size_t pos;
 
     /* Offset of the first module.  */
-    long first_module_offset;
+    size_t first_module_offset;
 
     /* Flag: are we writing it?  */
     int write_mode;
+
+    /* File the snapshot is written to when it is closed, NULL for
+       snapshots kept in memory.  */
+    FILE *file;
+    char *filename;
+
+    /* Flag: does `data' belong to the caller?  */
+    int borrowed;
 };
 
+/* Resources.  */
+static int snapshot_compress = 0;
+static int snapshot_async_write = 0;
+
 /* ------------------------------------------------------------------------- */
 
-static int snapshot_write_byte(FILE *f, BYTE data)
+/* Make room for `num' more bytes at the current position.  */
+static BYTE *snapshot_reserve(snapshot_t *s, size_t num)
 {
-    if (fputc(data, f) == EOF)
-        return -1;
+    BYTE *p;
 
-    return 0;
+    if (s->pos + num > s->alloc) {
+        size_t alloc = s->alloc ? s->alloc : SNAPSHOT_BUFFER_SIZE;
+
+        while (s->pos + num > alloc) {
+            alloc *= 2;
+        }
+        s->data = lib_realloc(s->data, alloc);
+        s->alloc = alloc;
+    }
+
+    p = s->data + s->pos;
+    s->pos += num;
+    if (s->pos > s->len) {
+        s->len = s->pos;
+    }
+
+    return p;
 }
 
-static int snapshot_write_word(FILE *f, WORD data)
+/* Return a pointer to the next `num' bytes to read, or NULL if there are
+   not enough left.  */
+static const BYTE *snapshot_consume(snapshot_t *s, size_t num)
 {
-    if (snapshot_write_byte(f, (BYTE)(data & 0xff)) < 0
-        || snapshot_write_byte(f, (BYTE)(data >> 8)) < 0)
-        return -1;
+    const BYTE *p;
 
-    return 0;
+    if (s->pos > s->len || num > s->len - s->pos) {
+        return NULL;
+    }
+
+    p = s->data + s->pos;
+    s->pos += num;
+    return p;
 }
 
-static int snapshot_write_dword(FILE *f, DWORD data)
+static void snapshot_put_word(BYTE *p, WORD data)
 {
-    if (snapshot_write_word(f, (WORD)(data & 0xffff)) < 0
-        || snapshot_write_word(f, (WORD)(data >> 16)) < 0)
-        return -1;
+    p[0] = (BYTE)(data & 0xff);
+    p[1] = (BYTE)(data >> 8);
+}
+
+static void snapshot_put_dword(BYTE *p, DWORD data)
+{
+    snapshot_put_word(p, (WORD)(data & 0xffff));
+    snapshot_put_word(p + 2, (WORD)(data >> 16));
+}
+
+static WORD snapshot_get_word(const BYTE *p)
+{
+    return (WORD)(p[0] | (p[1] << 8));
+}
+
+static DWORD snapshot_get_dword(const BYTE *p)
+{
+    return snapshot_get_word(p) | ((DWORD)snapshot_get_word(p + 2) << 16);
+}
+
+/* ------------------------------------------------------------------------- */
 
+static int snapshot_write_byte(snapshot_t *s, BYTE data)
+{
+    *snapshot_reserve(s, 1) = data;
+    return 0;
+}
+
+static int snapshot_write_word(snapshot_t *s, WORD data)
+{
+    snapshot_put_word(snapshot_reserve(s, 2), data);
     return 0;
 }
 
-static int snapshot_write_double(FILE *f, double data)
+static int snapshot_write_dword(snapshot_t *s, DWORD data)
 {
-   BYTE *byte_data = (BYTE *)&data;
-   int i;
+    snapshot_put_dword(snapshot_reserve(s, 4), data);
+    return 0;
+}
 
-   for (i = 0; i < sizeof(double); i++) {
-      if (snapshot_write_byte(f, byte_data[i]) < 0) {
-         return -1;
-      }
-   }
-   return 0;
+static int snapshot_write_double(snapshot_t *s, double data)
+{
+    memcpy(snapshot_reserve(s, sizeof(double)), &data, sizeof(double));
+    return 0;
 }
 
-static int snapshot_write_padded_string(FILE *f, const char *s, BYTE pad_char,
-                                        int len)
+static int snapshot_write_padded_string(snapshot_t *s, const char *str,
+                                        BYTE pad_char, int len)
 {
+    BYTE *p = snapshot_reserve(s, (size_t)len);
     int i, found_zero;
-    BYTE c;
 
     for (i = found_zero = 0; i < len; i++) {
-        if (!found_zero && s[i] == 0)
+        if (!found_zero && str[i] == 0)
             found_zero = 1;
-        c = found_zero ? (BYTE)pad_char : (BYTE) s[i];
-        if (snapshot_write_byte(f, c) < 0)
-            return -1;
+        p[i] = found_zero ? (BYTE)pad_char : (BYTE)str[i];
     }
 
     return 0;
 }
 
-static int snapshot_write_byte_array(FILE *f, const BYTE *data, unsigned int num)
+static int snapshot_write_byte_array(snapshot_t *s, const BYTE *data,
+                                     unsigned int num)
 {
-    if (num > 0 && fwrite(data, (size_t)num, 1, f) < 1)
-        return -1;
+    if (num > 0)
+        memcpy(snapshot_reserve(s, num), data, num);
 
     return 0;
 }
 
-
-static int snapshot_write_word_array(FILE *f, const WORD *data, unsigned int num)
+static int snapshot_write_word_array(snapshot_t *s, const WORD *data,
+                                     unsigned int num)
 {
+    BYTE *p = snapshot_reserve(s, (size_t)num * 2);
     unsigned int i;
 
-    for (i = 0; i < num; i++)
-        if (snapshot_write_word(f, data[i]) < 0)
-            return -1;
+    for (i = 0; i < num; i++, p += 2)
+        snapshot_put_word(p, data[i]);
 
     return 0;
 }
 
-static int snapshot_write_dword_array(FILE *f, const DWORD *data, unsigned int num)
+static int snapshot_write_dword_array(snapshot_t *s, const DWORD *data,
+                                      unsigned int num)
 {
+    BYTE *p = snapshot_reserve(s, (size_t)num * 4);
     unsigned int i;
 
-    for (i = 0; i < num; i++)
-        if (snapshot_write_dword(f, data[i]) < 0)
-            return -1;
+    for (i = 0; i < num; i++, p += 4)
+        snapshot_put_dword(p, data[i]);
 
     return 0;
 }
 
-
-static int snapshot_write_string(FILE *f, const char *s)
+static int snapshot_write_string(snapshot_t *s, const char *str)
 {
-    size_t len, i;
+    size_t len;
 
-    len = s ? (strlen(s) + 1) : 0;      /* length includes nullbyte */
+    len = str ? (strlen(str) + 1) : 0;      /* length includes nullbyte */
 
-    if (snapshot_write_word(f, (WORD)len) < 0)
-        return -1;
-
-    for (i = 0; i < len; i++)
-        if (snapshot_write_byte(f, s[i]) < 0)
-            return -1;
+    snapshot_write_word(s, (WORD)len);
+    if (len > 0)
+        memcpy(snapshot_reserve(s, len), str, len);
 
     return (int)(len + sizeof(WORD));
 }
 
-static int snapshot_read_byte(FILE *f, BYTE *b_return)
+static int snapshot_read_byte(snapshot_t *s, BYTE *b_return)
 {
-    int c;
+    const BYTE *p = snapshot_consume(s, 1);
 
-    c = fgetc(f);
-    if (c == EOF)
+    if (p == NULL)
         return -1;
-    *b_return = (BYTE)c;
+
+    *b_return = *p;
     return 0;
 }
 
-static int snapshot_read_word(FILE *f, WORD *w_return)
+static int snapshot_read_word(snapshot_t *s, WORD *w_return)
 {
-    BYTE lo, hi;
+    const BYTE *p = snapshot_consume(s, 2);
 
-    if (snapshot_read_byte(f, &lo) < 0 || snapshot_read_byte(f, &hi) < 0)
+    if (p == NULL)
         return -1;
 
-    *w_return = lo | (hi << 8);
+    *w_return = snapshot_get_word(p);
     return 0;
 }
 
-static int snapshot_read_dword(FILE *f, DWORD *dw_return)
+static int snapshot_read_dword(snapshot_t *s, DWORD *dw_return)
 {
-    WORD lo, hi;
+    const BYTE *p = snapshot_consume(s, 4);
 
-    if (snapshot_read_word(f, &lo) < 0 || snapshot_read_word(f, &hi) < 0)
+    if (p == NULL)
         return -1;
 
-    *dw_return = lo | (hi << 16);
+    *dw_return = snapshot_get_dword(p);
     return 0;
 }
 
-static int snapshot_read_double(FILE *f, double *d_return)
+static int snapshot_read_double(snapshot_t *s, double *d_return)
 {
-    int i;
-    int c;
-    double val;
-    BYTE *byte_val = (BYTE *)&val;
+    const BYTE *p = snapshot_consume(s, sizeof(double));
 
-    for (i = 0; i < sizeof(double); i++) {
-        c = fgetc(f);
-        if (c == EOF) {
-            return -1;
-        }
-        byte_val[i] = (BYTE)c;
-    }
-    *d_return = val;
+    if (p == NULL)
+        return -1;
+
+    memcpy(d_return, p, sizeof(double));
     return 0;
 }
 
-static int snapshot_read_byte_array(FILE *f, BYTE *b_return, unsigned int num)
+static int snapshot_read_byte_array(snapshot_t *s, BYTE *b_return,
+                                    unsigned int num)
 {
-    if (num > 0 && fread(b_return, (size_t)num, 1, f) < 1)
+    const BYTE *p = snapshot_consume(s, num);
+
+    if (p == NULL)
         return -1;
 
+    if (num > 0)
+        memcpy(b_return, p, num);
+
     return 0;
 }
 
-
-static int snapshot_read_word_array(FILE *f, WORD *w_return, unsigned int num)
+static int snapshot_read_word_array(snapshot_t *s, WORD *w_return,
+                                    unsigned int num)
 {
+    const BYTE *p = snapshot_consume(s, (size_t)num * 2);
     unsigned int i;
 
-    for (i = 0; i < num; i++)
-        if (snapshot_read_word(f, w_return + i) < 0)
-            return -1;
+    if (p == NULL)
+        return -1;
+
+    for (i = 0; i < num; i++, p += 2)
+        w_return[i] = snapshot_get_word(p);
 
     return 0;
 }
 
-static int snapshot_read_dword_array(FILE *f, DWORD *dw_return,
+static int snapshot_read_dword_array(snapshot_t *s, DWORD *dw_return,
                                      unsigned int num)
 {
+    const BYTE *p = snapshot_consume(s, (size_t)num * 4);
     unsigned int i;
 
-    for (i = 0; i < num; i++)
-        if (snapshot_read_dword(f, dw_return + i) < 0)
-            return -1;
+    if (p == NULL)
+        return -1;
+
+    for (i = 0; i < num; i++, p += 4)
+        dw_return[i] = snapshot_get_dword(p);
 
     return 0;
 }
 
-
-static int snapshot_read_string(FILE *f, char **s)
+static int snapshot_read_string(snapshot_t *s, char **str)
 {
-    int i, len;
+    int len;
     WORD w;
-    char *p = NULL;
+    const BYTE *p;
+    char *q;
 
     /* first free the previous string */
-    lib_free(*s);
-    *s = NULL;      /* don't leave a bogus pointer */
+    lib_free(*str);
+    *str = NULL;      /* don't leave a bogus pointer */
 
-    if (snapshot_read_word(f, &w) < 0)
+    if (snapshot_read_word(s, &w) < 0)
         return -1;
 
     len = (int)w;
 
     if (len) {
-        p = lib_malloc(len);
-        *s = p;
-
-        for (i = 0; i < len; i++) {
-            if (snapshot_read_byte(f, (BYTE *)(p + i)) < 0) {
-                p[0] = 0;
-                return -1;
-            }
+        p = snapshot_consume(s, (size_t)len);
+        q = lib_malloc(len);
+        *str = q;
+
+        if (p == NULL) {
+            q[0] = 0;
+            return -1;
         }
-        p[len - 1] = 0;   /* just to be save */
+        memcpy(q, p, (size_t)len);
+        q[len - 1] = 0;   /* just to be save */
     }
     return 0;
 }
@@ -296,7 +389,7 @@ static int snapshot_read_string(FILE *f, char **s)
 
 int snapshot_module_write_byte(snapshot_module_t *m, BYTE b)
 {
-    if (snapshot_write_byte(m->file, b) < 0)
+    if (snapshot_write_byte(m->snapshot, b) < 0)
         return -1;
 
     m->size++;
@@ -305,7 +398,7 @@ int snapshot_module_write_byte(snapshot_module_t *m, BYTE b)
 
 int snapshot_module_write_word(snapshot_module_t *m, WORD w)
 {
-    if (snapshot_write_word(m->file, w) < 0)
+    if (snapshot_write_word(m->snapshot, w) < 0)
         return -1;
 
     m->size += 2;
@@ -314,7 +407,7 @@ int snapshot_module_write_word(snapshot_module_t *m, WORD w)
 
 int snapshot_module_write_dword(snapshot_module_t *m, DWORD dw)
 {
-    if (snapshot_write_dword(m->file, dw) < 0)
+    if (snapshot_write_dword(m->snapshot, dw) < 0)
         return -1;
 
     m->size += 4;
@@ -323,7 +416,7 @@ int snapshot_module_write_dword(snapshot_module_t *m, DWORD dw)
 
 int snapshot_module_write_double(snapshot_module_t *m, double db)
 {
-    if (snapshot_write_double(m->file, db) < 0) {
+    if (snapshot_write_double(m->snapshot, db) < 0) {
         return -1;
     }
 
@@ -334,7 +427,7 @@ int snapshot_module_write_double(snapshot_module_t *m, double db)
 int snapshot_module_write_padded_string(snapshot_module_t *m, const char *s,
                                         BYTE pad_char, int len)
 {
-    if (snapshot_write_padded_string(m->file, s, (BYTE)pad_char, len) < 0)
+    if (snapshot_write_padded_string(m->snapshot, s, (BYTE)pad_char, len) < 0)
         return -1;
 
     m->size += len;
@@ -344,7 +437,7 @@ int snapshot_module_write_padded_string(snapshot_module_t *m, const char *s,
 int snapshot_module_write_byte_array(snapshot_module_t *m, const BYTE *b,
                                      unsigned int num)
 {
-    if (snapshot_write_byte_array(m->file, b, num) < 0)
+    if (snapshot_write_byte_array(m->snapshot, b, num) < 0)
         return -1;
 
     m->size += num;
@@ -354,7 +447,7 @@ int snapshot_module_write_byte_array(snapshot_module_t *m, const BYTE *b,
 int snapshot_module_write_word_array(snapshot_module_t *m, const WORD *w,
                                      unsigned int num)
 {
-    if (snapshot_write_word_array(m->file, w, num) < 0)
+    if (snapshot_write_word_array(m->snapshot, w, num) < 0)
         return -1;
 
     m->size += num * sizeof(WORD);
@@ -364,7 +457,7 @@ int snapshot_module_write_word_array(snapshot_module_t *m, const WORD *w,
 int snapshot_module_write_dword_array(snapshot_module_t *m, const DWORD *dw,
                                       unsigned int num)
 {
-    if (snapshot_write_dword_array(m->file, dw, num) < 0)
+    if (snapshot_write_dword_array(m->snapshot, dw, num) < 0)
         return -1;
 
     m->size += num * sizeof(DWORD);
@@ -375,7 +468,7 @@ int snapshot_module_write_dword_array(snapshot_module_t *m, const DWORD *dw,
 int snapshot_module_write_string(snapshot_module_t *m, const char *s)
 {
     int len;
-    len = snapshot_write_string(m->file, s);
+    len = snapshot_write_string(m->snapshot, s);
     if (len < 0)
         return -1;
 
@@ -385,73 +478,80 @@ int snapshot_module_write_string(snapshot_module_t *m, const char *s)
 
 /* ------------------------------------------------------------------------- */
 
+/* Are there `num' more bytes left in module `m'?  */
+static int snapshot_module_has(snapshot_module_t *m, size_t num)
+{
+    size_t pos = m->snapshot->pos;
+    size_t end = m->offset + m->size;
+
+    return pos <= end && num <= end - pos;
+}
+
 int snapshot_module_read_byte(snapshot_module_t *m, BYTE *b_return)
 {
-    if (ftell(m->file) + sizeof(BYTE) > m->offset + m->size)
+    if (!snapshot_module_has(m, sizeof(BYTE)))
         return -1;
 
-    return snapshot_read_byte(m->file, b_return);
+    return snapshot_read_byte(m->snapshot, b_return);
 }
 
 int snapshot_module_read_word(snapshot_module_t *m, WORD *w_return)
 {
-    if (ftell(m->file) + sizeof(WORD) > m->offset + m->size)
+    if (!snapshot_module_has(m, sizeof(WORD)))
         return -1;
 
-    return snapshot_read_word(m->file, w_return);
+    return snapshot_read_word(m->snapshot, w_return);
 }
 
 int snapshot_module_read_dword(snapshot_module_t *m, DWORD *dw_return)
 {
-    if (ftell(m->file) + sizeof(DWORD) > m->offset + m->size)
+    if (!snapshot_module_has(m, sizeof(DWORD)))
         return -1;
 
-    return snapshot_read_dword(m->file, dw_return);
+    return snapshot_read_dword(m->snapshot, dw_return);
 }
 
 int snapshot_module_read_double(snapshot_module_t *m, double *db_return)
 {
-    if (ftell(m->file) + sizeof(double) > m->offset + m->size)
+    if (!snapshot_module_has(m, sizeof(double)))
         return -1;
 
-    return snapshot_read_double(m->file, db_return);
+    return snapshot_read_double(m->snapshot, db_return);
 }
 
 int snapshot_module_read_byte_array(snapshot_module_t *m, BYTE *b_return,
                                     unsigned int num)
 {
-    if ((long)(ftell(m->file) + num) > (long)(m->offset + m->size))
+    if (!snapshot_module_has(m, num))
         return -1;
 
-    return snapshot_read_byte_array(m->file, b_return, num);
+    return snapshot_read_byte_array(m->snapshot, b_return, num);
 }
 
 int snapshot_module_read_word_array(snapshot_module_t *m, WORD *w_return,
                                     unsigned int num)
 {
-    if ((long)(ftell(m->file) + num * sizeof(WORD))
-        > (long)(m->offset + m->size))
+    if (!snapshot_module_has(m, (size_t)num * sizeof(WORD)))
         return -1;
 
-    return snapshot_read_word_array(m->file, w_return, num);
+    return snapshot_read_word_array(m->snapshot, w_return, num);
 }
 
 int snapshot_module_read_dword_array(snapshot_module_t *m, DWORD *dw_return,
                                      unsigned int num)
 {
-    if ((long)(ftell(m->file) + num * sizeof(DWORD))
-        > (long)(m->offset + m->size))
+    if (!snapshot_module_has(m, (size_t)num * sizeof(DWORD)))
         return -1;
 
-    return snapshot_read_dword_array(m->file, dw_return, num);
+    return snapshot_read_dword_array(m->snapshot, dw_return, num);
 }
 
 int snapshot_module_read_string(snapshot_module_t *m, char **charp_return)
 {
-    if (ftell(m->file) + sizeof(WORD) > m->offset + m->size)
+    if (!snapshot_module_has(m, sizeof(WORD)))
         return -1;
 
-    return snapshot_read_string(m->file, charp_return);
+    return snapshot_read_string(m->snapshot, charp_return);
 }
 
 int snapshot_module_read_byte_into_int(snapshot_module_t *m, int *value_return)
@@ -516,23 +616,21 @@ snapshot_module_t *snapshot_module_create(snapshot_t *s,
     snapshot_module_t *m;
 
     m = lib_malloc(sizeof(snapshot_module_t));
-    m->file = s->file;
-    m->offset = ftell(s->file);
-    if (m->offset == -1) {
-        lib_free(m);
-        return NULL;
-    }
+    m->snapshot = s;
+    m->offset = s->pos;
     m->write_mode = 1;
 
-    if (snapshot_write_padded_string(s->file, name, (BYTE)0,
+    if (snapshot_write_padded_string(s, name, (BYTE)0,
                                      SNAPSHOT_MODULE_NAME_LEN) < 0
-        || snapshot_write_byte(s->file, major_version) < 0
-        || snapshot_write_byte(s->file, minor_version) < 0
-        || snapshot_write_dword(s->file, 0) < 0)
+        || snapshot_write_byte(s, major_version) < 0
+        || snapshot_write_byte(s, minor_version) < 0
+        || snapshot_write_dword(s, 0) < 0) {
+        lib_free(m);
         return NULL;
+    }
 
-    m->size = ftell(s->file) - m->offset;
-    m->size_offset = ftell(s->file) - sizeof(DWORD);
+    m->size = (DWORD)(s->pos - m->offset);
+    m->size_offset = s->pos - sizeof(DWORD);
 
     return m;
 }
@@ -546,11 +644,10 @@ snapshot_module_t *snapshot_module_open(snapshot_t *s,
     char n[SNAPSHOT_MODULE_NAME_LEN];
     unsigned int name_len = (unsigned int)strlen(name);
 
-    if (fseek(s->file, s->first_module_offset, SEEK_SET) < 0)
-        return NULL;
+    s->pos = s->first_module_offset;
 
     m = lib_malloc(sizeof(snapshot_module_t));
-    m->file = s->file;
+    m->snapshot = s;
     m->write_mode = 0;
 
     m->offset = s->first_module_offset;
@@ -558,11 +655,11 @@ snapshot_module_t *snapshot_module_open(snapshot_t *s,
     /* Search for the module name.  This is quite inefficient, but I don't
        think we care.  */
     while (1) {
-        if (snapshot_read_byte_array(s->file, (BYTE *)n,
+        if (snapshot_read_byte_array(s, (BYTE *)n,
                                      SNAPSHOT_MODULE_NAME_LEN) < 0
-            || snapshot_read_byte(s->file, major_version_return) < 0
-            || snapshot_read_byte(s->file, minor_version_return) < 0
-            || snapshot_read_dword(s->file, &m->size))
+            || snapshot_read_byte(s, major_version_return) < 0
+            || snapshot_read_byte(s, minor_version_return) < 0
+            || snapshot_read_dword(s, &m->size))
             goto fail;
 
         /* Found?  */
@@ -571,31 +668,31 @@ snapshot_module_t *snapshot_module_open(snapshot_t *s,
             break;
 
         m->offset += m->size;
-        if (fseek(s->file, m->offset, SEEK_SET) < 0)
+        if (m->size == 0 || m->offset > s->len)
             goto fail;
+        s->pos = m->offset;
     }
 
-    m->size_offset = ftell(s->file) - sizeof(DWORD);
+    m->size_offset = s->pos - sizeof(DWORD);
 
     return m;
 
 fail:
-    fseek(s->file, s->first_module_offset, SEEK_SET);
+    s->pos = s->first_module_offset;
     lib_free(m);
     return NULL;
 }
 
 int snapshot_module_close(snapshot_module_t *m)
 {
+    snapshot_t *s = m->snapshot;
+
     /* Backpatch module size if writing.  */
-    if (m->write_mode
-        && (fseek(m->file, m->size_offset, SEEK_SET) < 0
-            || snapshot_write_dword(m->file, m->size) < 0))
-        return -1;
+    if (m->write_mode)
+        snapshot_put_dword(s->data + m->size_offset, m->size);
 
     /* Skip module.  */
-    if (fseek(m->file, m->offset + m->size, SEEK_SET) < 0)
-        return -1;
+    s->pos = m->offset + m->size;
 
     lib_free(m);
     return 0;
@@ -603,6 +700,275 @@ int snapshot_module_close(snapshot_module_t *m)
 
 /* ------------------------------------------------------------------------- */
 
+/* A finished snapshot on its way to disk.  */
+typedef struct snapshot_write_job_s {
+    FILE *file;
+    char *filename;
+    BYTE *data;
+    size_t len;
+    int compress;
+
+    /* Set by `snapshot_write_job_run()'.  */
+    int compress_failed;
+    int result;
+} snapshot_write_job_t;
+
+#ifdef HAVE_ZLIB
+/* Compress `len' bytes at `data' into a gzip stream.  Return the size of the
+   result in `*out_len', or NULL on failure.  */
+static BYTE *snapshot_gzip(const BYTE *data, size_t len, size_t *out_len)
+{
+    z_stream zs;
+    BYTE *out;
+    size_t out_alloc = len / 2 + 64;
+    int ret;
+
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS,
+                     8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return NULL;
+    }
+
+    out = lib_malloc(out_alloc);
+    zs.next_in = (Bytef *)data;
+    zs.avail_in = (uInt)len;
+
+    do {
+        if (zs.total_out == out_alloc) {
+            out_alloc *= 2;
+            out = lib_realloc(out, out_alloc);
+        }
+        zs.next_out = out + zs.total_out;
+        zs.avail_out = (uInt)(out_alloc - zs.total_out);
+        ret = deflate(&zs, Z_FINISH);
+    } while (ret == Z_OK || ret == Z_BUF_ERROR);
+
+    *out_len = zs.total_out;
+    deflateEnd(&zs);
+
+    if (ret != Z_STREAM_END) {
+        lib_free(out);
+        return NULL;
+    }
+
+    return out;
+}
+
+/* Uncompress the gzip stream at `data'.  Return NULL on failure.  */
+static BYTE *snapshot_gunzip(const BYTE *data, size_t len, size_t *out_len)
+{
+    z_stream zs;
+    BYTE *out;
+    size_t out_alloc = len * 4;
+    int ret;
+
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) {
+        return NULL;
+    }
+
+    out = lib_malloc(out_alloc);
+    zs.next_in = (Bytef *)data;
+    zs.avail_in = (uInt)len;
+
+    do {
+        if (zs.total_out == out_alloc) {
+            out_alloc *= 2;
+            out = lib_realloc(out, out_alloc);
+        }
+        zs.next_out = out + zs.total_out;
+        zs.avail_out = (uInt)(out_alloc - zs.total_out);
+        ret = inflate(&zs, Z_NO_FLUSH);
+    } while (ret == Z_OK);
+
+    *out_len = zs.total_out;
+    inflateEnd(&zs);
+
+    if (ret != Z_STREAM_END) {
+        lib_free(out);
+        return NULL;
+    }
+
+    return out;
+}
+#else
+/* Gzip header: deflate, no flags, no time, Unix.  */
+static const BYTE snapshot_gzip_header[10] = {
+    0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3
+};
+
+static void snapshot_put_le_dword(BYTE *p, DWORD val)
+{
+    p[0] = (BYTE)val;
+    p[1] = (BYTE)(val >> 8);
+    p[2] = (BYTE)(val >> 16);
+    p[3] = (BYTE)(val >> 24);
+}
+
+static DWORD snapshot_get_le_dword(const BYTE *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((DWORD)p[3] << 24);
+}
+
+/* The same as above with the in-tree deflate coder.  */
+static BYTE *snapshot_gzip(const BYTE *data, size_t len, size_t *out_len)
+{
+    BYTE *out = lib_malloc(sizeof(snapshot_gzip_header)
+                           + ZDEFLATE_BOUND(len) + 8);
+    size_t pos;
+
+    memcpy(out, snapshot_gzip_header, sizeof(snapshot_gzip_header));
+    pos = sizeof(snapshot_gzip_header);
+    pos += zdeflate(out + pos, data, len);
+    snapshot_put_le_dword(out + pos,
+                          (DWORD)crc32_buf((const char *)data,
+                                           (unsigned int)len));
+    snapshot_put_le_dword(out + pos + 4, (DWORD)len);
+
+    *out_len = pos + 8;
+    return out;
+}
+
+static BYTE *snapshot_gunzip(const BYTE *data, size_t len, size_t *out_len)
+{
+    size_t pos = zinflate_gzip_offset(data, len);
+    size_t used, src_used;
+    DWORD usize;
+    BYTE *out;
+
+    if (pos == 0) {
+        return NULL;
+    }
+
+    /* Deflate packs at most 258 bytes into 2 bits.  */
+    usize = snapshot_get_le_dword(data + len - 4);
+    if (usize / 1032 > len) {
+        return NULL;
+    }
+    out = lib_malloc(usize > 0 ? usize : 1);
+    if (zinflate(out, usize, &used, data + pos, len - 8 - pos,
+                 &src_used) < 0
+        || used != usize || src_used != len - 8 - pos
+        || (DWORD)crc32_buf((const char *)out, (unsigned int)usize)
+           != snapshot_get_le_dword(data + len - 8)) {
+        lib_free(out);
+        return NULL;
+    }
+
+    *out_len = usize;
+    return out;
+}
+#endif
+
+/* Compress and write out the snapshot and set `job->result' to 0, or -1 on
+   failure.  This may run on the writer thread, so it only touches the job;
+   `snapshot_write_job_finish()' reports the outcome.  */
+static void snapshot_write_job_run(snapshot_write_job_t *job)
+{
+    BYTE *data = job->data;
+    size_t len = job->len;
+    int retval = 0;
+
+    if (job->compress) {
+        BYTE *packed = snapshot_gzip(job->data, job->len, &len);
+
+        if (packed != NULL) {
+            data = packed;
+        } else {
+            job->compress_failed = 1;
+            len = job->len;
+        }
+    }
+
+    if (fwrite(data, 1, len, job->file) != len) {
+        retval = -1;
+    }
+    if (fclose(job->file) == EOF) {
+        retval = -1;
+    }
+
+    if (data != job->data) {
+        lib_free(data);
+    }
+    lib_free(job->data);
+    job->data = NULL;
+
+    job->result = retval;
+}
+
+/* Log the outcome of a job that has been run, remove the file if writing it
+   failed and free the job.  Must be called on the main thread.  */
+static int snapshot_write_job_finish(snapshot_write_job_t *job)
+{
+    int retval = job->result;
+
+    if (job->compress_failed) {
+        log_warning(LOG_DEFAULT, "SNAPSHOT: Cannot compress `%s', wrote it uncompressed.", job->filename);
+    }
+
+    if (retval < 0) {
+        log_error(LOG_DEFAULT, "SNAPSHOT: Error writing `%s'.", job->filename);
+        ioutil_remove(job->filename);
+    }
+
+    lib_free(job->filename);
+    lib_free(job);
+
+    return retval;
+}
+
+#ifdef HAVE_PTHREAD_H
+static pthread_t snapshot_writer;
+static snapshot_write_job_t *snapshot_writer_job = NULL;
+
+static void *snapshot_writer_main(void *job)
+{
+    snapshot_write_job_run((snapshot_write_job_t *)job);
+    return NULL;
+}
+#endif
+
+/* Wait until the snapshot being written in the background, if any, is
+   complete, and report errors.  */
+void snapshot_write_sync(void)
+{
+#ifdef HAVE_PTHREAD_H
+    if (snapshot_writer_job != NULL) {
+        pthread_join(snapshot_writer, NULL);
+        snapshot_write_job_finish(snapshot_writer_job);
+        snapshot_writer_job = NULL;
+    }
+#endif
+}
+
+static int snapshot_write_out(snapshot_t *s)
+{
+    snapshot_write_job_t *job = lib_calloc(1, sizeof(snapshot_write_job_t));
+
+    job->file = s->file;
+    job->filename = s->filename;
+    job->data = s->data;
+    job->len = s->len;
+    job->compress = snapshot_compress;
+
+#ifdef HAVE_PTHREAD_H
+    if (snapshot_async_write) {
+        snapshot_write_sync();
+        if (pthread_create(&snapshot_writer, NULL, snapshot_writer_main,
+                           job) == 0) {
+            snapshot_writer_job = job;
+            return 0;
+        }
+        log_warning(LOG_DEFAULT, "SNAPSHOT: Cannot start writer thread.");
+    }
+#endif
+
+    snapshot_write_job_run(job);
+    return snapshot_write_job_finish(job);
+}
+
+/* ------------------------------------------------------------------------- */
+
 snapshot_t *snapshot_create(const char *filename,
                             BYTE major_version, BYTE minor_version,
                             const char *snapshot_machine_name)
@@ -610,67 +976,96 @@ snapshot_t *snapshot_create(const char *filename,
     FILE *f;
     snapshot_t *s;
 
+    /* Don't let a pending write clobber the new file.  */
+    snapshot_write_sync();
+
     f = fopen(filename, MODE_WRITE);
     if (f == NULL)
         return NULL;
 
+    s = snapshot_memory_create(major_version, minor_version,
+                               snapshot_machine_name);
+    s->file = f;
+    s->filename = lib_stralloc(filename);
+
+    return s;
+}
+
+/* Start a snapshot that is only built up in memory; `snapshot_memory_close()'
+   hands out the result.  */
+snapshot_t *snapshot_memory_create(BYTE major_version, BYTE minor_version,
+                                   const char *snapshot_machine_name)
+{
+    snapshot_t *s;
+
+    s = lib_calloc(1, sizeof(snapshot_t));
+    s->write_mode = 1;
+
     /* Magic string.  */
-    if (snapshot_write_padded_string(f, snapshot_magic_string,
-                                     (BYTE)0, SNAPSHOT_MAGIC_LEN) < 0)
-        goto fail;
+    snapshot_write_padded_string(s, snapshot_magic_string,
+                                 (BYTE)0, SNAPSHOT_MAGIC_LEN);
 
     /* Version number.  */
-    if (snapshot_write_byte(f, major_version) < 0
-        || snapshot_write_byte(f, minor_version) < 0)
-        goto fail;
+    snapshot_write_byte(s, major_version);
+    snapshot_write_byte(s, minor_version);
 
     /* Machine.  */
-    if (snapshot_write_padded_string(f, snapshot_machine_name, (BYTE)0,
-                                     SNAPSHOT_MACHINE_NAME_LEN) < 0)
-        goto fail;
+    snapshot_write_padded_string(s, snapshot_machine_name, (BYTE)0,
+                                 SNAPSHOT_MACHINE_NAME_LEN);
 
-    s = lib_malloc(sizeof(snapshot_t));
-    s->file = f;
-    s->first_module_offset = ftell(f);
-    s->write_mode = 1;
+    s->first_module_offset = s->pos;
 
     return s;
+}
 
-fail:
-    fclose(f);
-    ioutil_remove(filename);
-    return NULL;
+/* Read all of `f' into memory.  */
+static BYTE *snapshot_read_file(FILE *f, size_t *len_return)
+{
+    BYTE *data = NULL;
+    size_t len = 0, alloc = 0, n;
+
+    do {
+        if (len == alloc) {
+            alloc = alloc ? alloc * 2 : SNAPSHOT_BUFFER_SIZE;
+            data = lib_realloc(data, alloc);
+        }
+        n = fread(data + len, 1, alloc - len, f);
+        len += n;
+    } while (n > 0);
+
+    if (ferror(f)) {
+        lib_free(data);
+        return NULL;
+    }
+
+    *len_return = len;
+    return data;
 }
 
-snapshot_t *snapshot_open(const char *filename,
-                          BYTE *major_version_return,
-                          BYTE *minor_version_return,
-                          const char *snapshot_machine_name)
+/* Check the header of the snapshot at `s->data' and position `s' at the
+   first module.  */
+static int snapshot_read_header(snapshot_t *s, BYTE *major_version_return,
+                                BYTE *minor_version_return,
+                                const char *snapshot_machine_name)
 {
-    FILE *f;
     char magic[SNAPSHOT_MAGIC_LEN];
     char read_name[SNAPSHOT_MACHINE_NAME_LEN];
-    snapshot_t *s = NULL;
     int machine_name_len;
 
-    f = zfile_fopen(filename, MODE_READ);
-    if (f == NULL)
-        return NULL;
-
     /* Magic string.  */
-    if (snapshot_read_byte_array(f, (BYTE *)magic, SNAPSHOT_MAGIC_LEN) < 0
+    if (snapshot_read_byte_array(s, (BYTE *)magic, SNAPSHOT_MAGIC_LEN) < 0
         || memcmp(magic, snapshot_magic_string, SNAPSHOT_MAGIC_LEN) != 0)
-        goto fail;
+        return -1;
 
     /* Version number.  */
-    if (snapshot_read_byte(f, major_version_return) < 0
-        || snapshot_read_byte(f, minor_version_return) < 0)
-        goto fail;
+    if (snapshot_read_byte(s, major_version_return) < 0
+        || snapshot_read_byte(s, minor_version_return) < 0)
+        return -1;
 
     /* Machine.  */
-    if (snapshot_read_byte_array(f, (BYTE *)read_name,
+    if (snapshot_read_byte_array(s, (BYTE *)read_name,
                                  SNAPSHOT_MACHINE_NAME_LEN) < 0)
-        goto fail;
+        return -1;
 
     /* Check machine name.  */
     machine_name_len = (int)strlen(snapshot_machine_name);
@@ -678,39 +1073,195 @@ snapshot_t *snapshot_open(const char *filename,
         || (machine_name_len != SNAPSHOT_MODULE_NAME_LEN
             && read_name[machine_name_len] != 0)) {
         log_error(LOG_DEFAULT, "SNAPSHOT: Wrong machine type.");
-        goto fail;
+        return -1;
     }
 
-    s = lib_malloc(sizeof(snapshot_t));
-    s->file = f;
-    s->first_module_offset = ftell(f);
+    s->first_module_offset = s->pos;
     s->write_mode = 0;
 
+    return 0;
+}
+
+snapshot_t *snapshot_open(const char *filename,
+                          BYTE *major_version_return,
+                          BYTE *minor_version_return,
+                          const char *snapshot_machine_name)
+{
+    FILE *f;
+    snapshot_t *s = NULL;
+
+    /* The file may still be being written.  */
+    snapshot_write_sync();
+
+    f = zfile_fopen(filename, MODE_READ);
+    if (f == NULL)
+        return NULL;
+
+    s = lib_calloc(1, sizeof(snapshot_t));
+    s->data = snapshot_read_file(f, &s->len);
+    zfile_fclose(f);
+
+    if (s->data == NULL)
+        goto fail;
+    s->alloc = s->len;
+
+    /* Compressed with `SnapshotCompress'?  */
+    if (s->len >= 2 && s->data[0] == 0x1f && s->data[1] == 0x8b) {
+        size_t len;
+        BYTE *data = snapshot_gunzip(s->data, s->len, &len);
+
+        if (data == NULL)
+            goto fail;
+        lib_free(s->data);
+        s->data = data;
+        s->len = s->alloc = len;
+    }
+
+    if (snapshot_read_header(s, major_version_return, minor_version_return,
+                             snapshot_machine_name) < 0)
+        goto fail;
+
     vsync_suspend_speed_eval();
     return s;
 
 fail:
-    fclose(f);
+    lib_free(s->data);
+    lib_free(s);
     return NULL;
 }
 
+/* Open the snapshot in the `len' bytes at `data', as written by
+   `snapshot_memory_create()'.  The data must stay around until the snapshot
+   is closed.  */
+snapshot_t *snapshot_memory_open(const BYTE *data, size_t len,
+                                 BYTE *major_version_return,
+                                 BYTE *minor_version_return,
+                                 const char *snapshot_machine_name)
+{
+    snapshot_t *s;
+
+    s = lib_calloc(1, sizeof(snapshot_t));
+    s->data = (BYTE *)data;
+    s->len = s->alloc = len;
+    s->borrowed = 1;
+
+    if (snapshot_read_header(s, major_version_return, minor_version_return,
+                             snapshot_machine_name) < 0) {
+        lib_free(s);
+        return NULL;
+    }
+
+    return s;
+}
+
 int snapshot_close(snapshot_t *s)
 {
-    int retval;
-
-    if (!s->write_mode) {
-        if (zfile_fclose(s->file) == EOF)
-            retval = -1;
-        else
-            retval = 0;
-    } else {
-        if (fclose(s->file) == EOF)
-            retval = -1;
-        else
-            retval = 0;
+    int retval = 0;
+
+    if (s->write_mode && s->file != NULL) {
+        /* The buffer and file now belong to the writer.  */
+        retval = snapshot_write_out(s);
+    } else if (!s->borrowed) {
+        lib_free(s->data);
     }
 
     lib_free(s);
     return retval;
 }
 
+/* Finish a snapshot started with `snapshot_memory_create()' and return its
+   contents, which the caller has to free.  */
+BYTE *snapshot_memory_close(snapshot_t *s, size_t *len_return)
+{
+    BYTE *data = s->data;
+
+    *len_return = s->len;
+    lib_free(s);
+    return data;
+}
+
+void snapshot_abort(snapshot_t *s)
+{
+    if (s->write_mode && s->file != NULL) {
+        fclose(s->file);
+        ioutil_remove(s->filename);
+        lib_free(s->filename);
+    }
+
+    lib_free(s->data);
+    lib_free(s);
+}
+
+void snapshot_shutdown(void)
+{
+    snapshot_write_sync();
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_snapshot_compress(int val, void *param)
+{
+    snapshot_compress = val ? 1 : 0;
+    return 0;
+}
+
+static int set_snapshot_async_write(int val, void *param)
+{
+    val = val ? 1 : 0;
+
+#ifndef HAVE_PTHREAD_H
+    if (val) {
+        log_warning(LOG_DEFAULT, "SNAPSHOT: Background writing not available.");
+        val = 0;
+    }
+#else
+    if (!val) {
+        snapshot_write_sync();
+    }
+#endif
+
+    snapshot_async_write = val;
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "SnapshotCompress", 0, RES_EVENT_NO, NULL,
+      &snapshot_compress, set_snapshot_compress, NULL },
+    { "SnapshotAsyncWrite", 0, RES_EVENT_NO, NULL,
+      &snapshot_async_write, set_snapshot_async_write, NULL },
+    { NULL }
+};
+
+int snapshot_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] = {
+    { "-snapshotcompress", SET_RESOURCE, 0,
+      NULL, NULL, "SnapshotCompress", (void *)1,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Write gzip compressed snapshots" },
+    { "+snapshotcompress", SET_RESOURCE, 0,
+      NULL, NULL, "SnapshotCompress", (void *)0,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Write uncompressed snapshots" },
+    { "-snapshotasync", SET_RESOURCE, 0,
+      NULL, NULL, "SnapshotAsyncWrite", (void *)1,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Write snapshots to disk in the background" },
+    { "+snapshotasync", SET_RESOURCE, 0,
+      NULL, NULL, "SnapshotAsyncWrite", (void *)0,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      NULL, "Write snapshots to disk before continuing" },
+    { NULL }
+};
+
+int snapshot_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
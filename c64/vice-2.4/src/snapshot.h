@@ -27,6 +27,8 @@
 #ifndef SNAPSHOT_H
 #define SNAPSHOT_H
 
+#include <stddef.h>
+
 #include "types.h"
 
 #define SNAPSHOT_MACHINE_NAME_LEN       16
@@ -114,5 +116,23 @@ extern snapshot_t *snapshot_open(const char *filename,
                                  BYTE *minor_version_return,
                                  const char *snapshot_machine_name);
 extern int snapshot_close(snapshot_t *s);
+/* Close a snapshot being written without saving it.  */
+extern void snapshot_abort(snapshot_t *s);
+
+/* Snapshots that never leave memory.  */
+extern snapshot_t *snapshot_memory_create(BYTE major_version,
+                                          BYTE minor_version,
+                                          const char *snapshot_machine_name);
+extern BYTE *snapshot_memory_close(snapshot_t *s, size_t *len_return);
+extern snapshot_t *snapshot_memory_open(const BYTE *data, size_t len,
+                                        BYTE *major_version_return,
+                                        BYTE *minor_version_return,
+                                        const char *snapshot_machine_name);
+
+extern void snapshot_write_sync(void);
+extern void snapshot_shutdown(void);
+
+extern int snapshot_resources_init(void);
+extern int snapshot_cmdline_options_init(void);
 
 #endif
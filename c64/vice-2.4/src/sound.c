@@ -40,6 +40,7 @@
 #endif
 
 #include "archdep.h"
+#include "benchmark.h"
 #include "clkguard.h"
 #include "cmdline.h"
 #include "debug.h"
@@ -842,6 +843,10 @@ int sound_open(void)
             } else {
                 snddata.sound_output_channels = channels;
             }
+        } else {
+            /* Devices without an init, like the dummy one, take any
+               number of channels.  */
+            snddata.sound_output_channels = channels;
         }
         snddata.issuspended = 0;
 
@@ -972,6 +977,7 @@ static int sound_run_sound(void)
     int delta_t = 0;
     SWORD *bufferptr;
     static int overflow_warning_count = 0;
+    int benchmark_saved = BENCHMARK_CPU;
 
     /* XXX: implement the exact ... */
     if (!playback_enabled || (suspend_time > 0 && disabletime)) {
@@ -989,12 +995,14 @@ static int sound_run_sound(void)
     if (cycle_based) {
         delta_t = maincpu_clk - snddata.lastclk;
         bufferptr = snddata.buffer + snddata.bufptr * snddata.sound_output_channels;
+        BENCHMARK_ENTER(benchmark_saved, BENCHMARK_SOUND);
         nr = sound_machine_calculate_samples(snddata.psid,
                                              bufferptr,
                                              SOUND_BUFSIZE - snddata.bufptr,
                                              snddata.sound_output_channels,
                                              snddata.sound_chip_channels,
                                              &delta_t);
+        BENCHMARK_LEAVE(benchmark_saved);
         if (volume < 100) {
             for (i = 0; i < (nr * snddata.sound_output_channels); i++) {
                 bufferptr[i] = (volume!=0) ? (bufferptr[i]/(100 / volume)) : 0;
@@ -1023,12 +1031,14 @@ static int sound_run_sound(void)
             return sound_error(translate_text(IDGS_SOUND_BUFFER_OVERFLOW));
         }
         bufferptr = snddata.buffer + snddata.bufptr * snddata.sound_output_channels;
+        BENCHMARK_ENTER(benchmark_saved, BENCHMARK_SOUND);
         sound_machine_calculate_samples(snddata.psid,
                                         bufferptr,
                                         nr,
                                         snddata.sound_output_channels,
                                         snddata.sound_chip_channels,
                                         &delta_t);
+        BENCHMARK_LEAVE(benchmark_saved);
         if (volume < 100) {
             for (i = 0; i < (nr * snddata.sound_output_channels); i++) {
                     bufferptr[i] = (volume != 0) ? (bufferptr[i] / (100 / volume)) : 0;
@@ -1037,6 +1047,8 @@ static int sound_run_sound(void)
         snddata.fclk += nr * snddata.clkstep;
     }
 
+    benchmark_sound_samples(bufferptr, nr * snddata.sound_output_channels);
+
     snddata.bufptr += nr;
     snddata.lastclk = maincpu_clk;
 
@@ -34,6 +34,7 @@
 #include "cmdline.h"
 #include "embedded.h"
 #include "findpath.h"
+#include "init.h"
 #include "ioutil.h"
 #include "lib.h"
 #include "log.h"
@@ -215,7 +216,8 @@ int sysfile_locate(const char *name, char **complete_path_return)
  * into the end of the memory range.
  * If minsize < 0, load it at the start.
  */
-int sysfile_load(const char *name, BYTE *dest, int minsize, int maxsize)
+static int sysfile_load_file(const char *name, BYTE *dest, int minsize,
+                             int maxsize)
 {
     FILE *fp = NULL;
     size_t rsize = 0;
@@ -298,3 +300,14 @@ fail:
     lib_free(complete_path);
     return -1;
 }
+
+int sysfile_load(const char *name, BYTE *dest, int minsize, int maxsize)
+{
+    int rsize;
+
+    init_profile_begin(INIT_PROFILE_SYSFILE_LOAD);
+    rsize = sysfile_load_file(name, dest, minsize, maxsize);
+    init_profile_end(INIT_PROFILE_SYSFILE_LOAD);
+
+    return rsize;
+}
@@ -49,9 +49,26 @@ typedef struct tap_s {
     /* File descriptor.  */
     FILE *fd;
 
+    /* Position of `fd' after the last `tap_write()', -1 if `fd' may have
+       been used for something else since.  */
+    long fd_write_pos;
+
     /* Size of the image.  */
     int size;
 
+    /* Contents of the image after the header, read in or mapped by
+       tap_open().  Record mode writes go through tap_write().  */
+    BYTE *data;
+
+    /* Size of the mapping of `data', 0 if `data' has been read in.  */
+    size_t data_mapped;
+
+    /* Allocated size of `data' if it has been read in.  */
+    size_t data_alloc;
+
+    /* Position of the file decoder in `data'.  */
+    int data_pos;
+
     /* The TAP version byte.  */
     BYTE version;
 
@@ -110,6 +127,7 @@ extern void tap_get_header(tap_t *tap, BYTE *name);
 extern struct tape_file_record_s *tap_get_current_file_record(tap_t *tap);
 
 extern int tap_read(tap_t *tap, BYTE *buf, size_t size);
+extern int tap_write(tap_t *tap, const BYTE *buf, size_t size);
 
 #endif
 
@@ -31,6 +31,15 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#define TAP_MMAP
+#endif
+
 #include "archdep.h"
 #include "datasette.h"
 #include "lib.h"
@@ -94,6 +103,40 @@ static int tap_header_read(tap_t *tap, FILE *fd)
     return 0;
 }
 
+/* Read in or map the contents of the image after the header.  */
+static int tap_data_read(tap_t *tap)
+{
+#ifdef TAP_MMAP
+    void *map;
+
+    map = mmap(NULL, TAP_HDR_SIZE + tap->size, PROT_READ, MAP_PRIVATE,
+               fileno(tap->fd), 0);
+    if (map != MAP_FAILED) {
+        tap->data_mapped = TAP_HDR_SIZE + tap->size;
+        tap->data = (BYTE *)map + TAP_HDR_SIZE;
+        return 0;
+    }
+#endif
+
+    tap->data_alloc = (size_t)tap->size;
+    tap->data = lib_malloc(tap->data_alloc);
+    return util_fpread(tap->fd, tap->data, (size_t)tap->size, TAP_HDR_SIZE);
+}
+
+static void tap_data_free(tap_t *tap)
+{
+#ifdef TAP_MMAP
+    if (tap->data_mapped > 0) {
+        munmap(tap->data - TAP_HDR_SIZE, tap->data_mapped);
+        tap->data_mapped = 0;
+        tap->data = NULL;
+    }
+#endif
+    lib_free(tap->data);
+    tap->data = NULL;
+    tap->data_alloc = 0;
+}
+
 static tap_t *tap_new(void)
 {
     tap_t *tap;
@@ -109,6 +152,7 @@ static tap_t *tap_new(void)
     tap->current_file_number = -1;
     tap->current_file_data = NULL;
     tap->current_file_size = 0;
+    tap->fd_write_pos = -1;
 
     return tap;
 }
@@ -145,7 +189,8 @@ tap_t *tap_open(const char *name, unsigned int *read_only)
 
     new->size = (int)util_file_length(fd) - TAP_HDR_SIZE;
 
-    if (new->size < 3) {
+    if (new->size < 3 || tap_data_read(new) < 0) {
+        tap_data_free(new);
         zfile_fclose(new->fd);
         lib_free(new);
         return NULL;
@@ -176,6 +221,7 @@ int tap_close(tap_t *tap)
         retval = 0;
     }
 
+    tap_data_free(tap);
     lib_free(tap->current_file_data);
     lib_free(tap->file_name);
     lib_free(tap->tap_file_record);
@@ -215,35 +261,83 @@ int tap_create(const char *name)
     return 0;
 }
 
+/* Write `size' bytes at the current position of the datasette, to the file
+   and to `data', and move the position past them.  */
+int tap_write(tap_t *tap, const BYTE *buf, size_t size)
+{
+    size_t end = (size_t)tap->current_file_seek_position + size;
+    long pos = tap->offset + tap->current_file_seek_position;
+    size_t alloc;
+    BYTE *data;
+
+    /* Recording writes one pulse after the other, and seeking flushes the
+       buffer of the file, so only seek when the tape has been wound.  */
+    if (pos != tap->fd_write_pos && fseek(tap->fd, pos, SEEK_SET) < 0) {
+        tap->fd_write_pos = -1;
+        return -1;
+    }
+    if (fwrite(buf, size, 1, tap->fd) < 1) {
+        tap->fd_write_pos = -1;
+        return -1;
+    }
+    tap->fd_write_pos = pos + (long)size;
+
+    if (tap->data_mapped > 0 || end > tap->data_alloc) {
+        /* Copy the mapping, which is read-only, or make room.  */
+        alloc = (end > (size_t)tap->size ? end : (size_t)tap->size) + 0x10000;
+        data = lib_malloc(alloc);
+        memcpy(data, tap->data, (size_t)tap->size);
+        tap_data_free(tap);
+        tap->data = data;
+        tap->data_alloc = alloc;
+    }
+    memcpy(tap->data + tap->current_file_seek_position, buf, size);
+
+    tap->current_file_seek_position = (int)end;
+    if (tap->size < tap->current_file_seek_position)
+        tap->size = tap->current_file_seek_position;
+    tap->has_changed = 1;
+
+    return 0;
+}
+
 
 /* ------------------------------------------------------------------------- */
 
 static int tap_find_pilot(tap_t *tap, int type);
 
+/* Return the 3 byte length of a long pulse at `pos', -1 past the end.  */
+inline static int tap_get_long_pulse(tap_t *tap, int pos)
+{
+    const BYTE *size = tap->data + pos;
+
+    if (pos + 3 > tap->size)
+        return -1;
+
+    return ((size[2] << 16) | (size[1] << 8) | size[0]) >> 3;
+}
+
 inline static int tap_get_pulse(tap_t *tap, int *pos_advance)
 {
     BYTE data;
-    DWORD pulse_length = 0;
-    size_t res;
+    int pulse_length = 0, pulse_length2;
+    int pos = tap->data_pos;
 
     *pos_advance = 0;
-    res = fread(&data, 1, 1, tap->fd);
 
-    if (res == 0)
+    if (pos >= tap->size)
         return -1;
 
-    *pos_advance += (int)res;
+    data = tap->data[pos++];
 
     if (data == 0) {
         if (tap->version == 0) {
             pulse_length = 256;
         } else if ((tap->version == 1) || (tap->version == 2)) {
-            BYTE size[3];
-            res = fread(size, 3, 1, tap->fd);
-            if (res == 0)
+            pulse_length = tap_get_long_pulse(tap, pos);
+            if (pulse_length < 0)
                 return -1;
-            *pos_advance += 3;
-            pulse_length = ((size[2] << 16) | (size[1] << 8) | size[0]) >> 3;
+            pos += 3;
         }
     } else {
         pulse_length = data;
@@ -251,20 +345,15 @@ inline static int tap_get_pulse(tap_t *tap, int *pos_advance)
 
     /*  Handle Halfwave format for C16 tapes */
     if (tap->version == 2) {
-        DWORD pulse_length2;
-
-        res = fread(&data, 1, 1, tap->fd);
-
-        if (res == 0)
+        if (pos >= tap->size)
             return -1;
-        *pos_advance += (int)res;
+
+        data = tap->data[pos++];
         if (data == 0) {
-            BYTE size[3];
-            res = fread(size, 3, 1, tap->fd);
-            if (res == 0)
+            pulse_length2 = tap_get_long_pulse(tap, pos);
+            if (pulse_length2 < 0)
                 return -1;
-            *pos_advance += 3;
-            pulse_length2 = ((size[2] << 16) | (size[1] << 8) | size[0]) >> 3;
+            pos += 3;
         } else {
             pulse_length2 = data;
         }
@@ -273,6 +362,9 @@ inline static int tap_get_pulse(tap_t *tap, int *pos_advance)
         pulse_length += pulse_length2;
     }
 
+    *pos_advance = pos - tap->data_pos;
+    tap->data_pos = pos;
+
 #if TAP_DEBUG > 2
     if ( TAP_PULSE_SHORT(data) )
       log_debug("s"); 
@@ -364,7 +456,7 @@ static int tap_cbm_skip_pilot(tap_t *tap)
   
   errors  = 0;
   counter = 0;
-  current_filepos = ftell(tap->fd);
+  current_filepos = tap->data_pos;
   while (1)
     {
       /*  Save file position */
@@ -375,7 +467,7 @@ static int tap_cbm_skip_pilot(tap_t *tap)
       if ( TAP_PULSE_LONG(data) )
         {
           /* found an L pulse, try to read a byte */
-          fseek(tap->fd, fpos, SEEK_SET);
+          tap->data_pos = fpos;
           current_filepos = fpos;
           data = tap_cbm_read_byte(tap);
           if ( data==-1 ) 
@@ -389,14 +481,14 @@ static int tap_cbm_skip_pilot(tap_t *tap)
               if ( ++errors>50 ) return 0;
 
               /* Start over after the L pulse */
-              fseek(tap->fd, fpos2, SEEK_SET);
+              tap->data_pos = fpos2;
               current_filepos = fpos2;
               counter = 0;
             }
           else
             {
               /* success.  Go back to start of byte and return */
-              fseek(tap->fd, fpos, SEEK_SET);
+              tap->data_pos = fpos;
               current_filepos = fpos;
               return 0;
             }
@@ -726,14 +818,14 @@ static int tap_cbm_skip_file(tap_t *tap)
 
       while (1)
         {
-          fpos = ftell(tap->fd);
+          fpos = tap->data_pos;
 
           /* find next pilot */
           ret = tap_find_pilot(tap, PILOT_TYPE_CBM);
           if ( ret<0 ) 
             {
               /* no more pilot found => end of data */
-              fseek(tap->fd, fpos, SEEK_SET);
+              tap->data_pos = fpos;
               break;
             }
 
@@ -742,7 +834,7 @@ static int tap_cbm_skip_file(tap_t *tap)
           if ( ret<1 || buffer[0] != 2 )
             { 
               /* next block is not a data continuation block => end of data */
-              fseek(tap->fd, fpos, SEEK_SET);
+              tap->data_pos = fpos;
               break;
             }
         }
@@ -801,7 +893,7 @@ static int tap_tt_skip_pilot(tap_t *tap)
   int data;
 
 #if TAP_DEBUG > 1
-  log_debug("\nTAP_TT_SKIP_PILOT(0x%X", ftell(tap->fd));
+  log_debug("\nTAP_TT_SKIP_PILOT(0x%X", tap->data_pos);
 #endif
 
   /* turbo-tape pilot is just repeats of value 0x02 */
@@ -814,13 +906,13 @@ static int tap_tt_skip_pilot(tap_t *tap)
         {
           /* value != 0x02, we found the end of the pilot.  Go back
              so byte can be read again */
-          fseek(tap->fd, -8, SEEK_CUR);
+          tap->data_pos -= 8;
         }
     }
   while ( data==2 );
 
 #if TAP_DEBUG > 1
-  log_debug("-0x%X) ", ftell(tap->fd));
+  log_debug("-0x%X) ", tap->data_pos);
 #endif
 
   return 0;
@@ -1006,7 +1098,7 @@ static int tap_find_pilot(tap_t *tap, int type)
     int count;
     int data[256];
     long pos[257];
-    BYTE buffer[256];
+    int pos_advance;
 
     /* when looking for any pilot type, require CBM pilot to be longer
        than when specifically looking for CBM pilot.  A TurboTape L pulse
@@ -1018,7 +1110,7 @@ static int tap_find_pilot(tap_t *tap, int type)
        file */
     minCBM   = (type==PILOT_TYPE_ANY) ? 1000 : PILOT_MIN_LENGTH_CBM;
 
-    startCBM = ftell(tap->fd);
+    startCBM = tap->data_pos;
     startTT  = startCBM;
     countCBM = 0;
     countTT  = 0;
@@ -1029,81 +1121,13 @@ static int tap_find_pilot(tap_t *tap, int type)
 
     while ( (countCBM<minCBM) && (countTT<PILOT_MIN_LENGTH_TT*8) )
       {
-/*        count = fread(&data, 1, 256, tap->fd); */
-        int startpos = ftell(tap->fd);
-        int readlen = (int)fread(buffer, 1, 256, tap->fd);
-	DWORD pulse_length = 0;
-	int j = 0;
-        int needed;
-        int res;
-        for (i = 0; i < readlen; ) {
-            pos[j] = startpos + i;
-            if (buffer[i] == 0) {
-                if (tap->version == 0) {
-                    pulse_length = 256;
-                    i++;
-                } else if ((tap->version == 1) || (tap->version == 2)) {
-                    int still_in_buffer = readlen - (i + 1);
-                    needed = 3 - still_in_buffer;
-                    if (needed <= 0) {
-                        pulse_length = ((buffer[i + 3] << 16) | (buffer[i + 2] << 8) | buffer[i + 1]) >> 3;
-                        i += 4;
-                    } else {
-                        /* There is not enough in the buffer
-                           Read some more */
-                        memcpy(buffer, buffer + i + 1, still_in_buffer);
-                        res = (int)fread(buffer + still_in_buffer, 1, needed, tap->fd);
-                        i = readlen;
-                        if (res == 0) continue;
-                        pulse_length = ((buffer[2] << 16) | (buffer[1] << 8) | buffer[0]) >> 3;
-                    }
-                }
-            } else {
-                pulse_length = buffer[i];
-                i++;
-            }
-            data[j] = pulse_length;
-
-            if (tap->version == 2) {
-                DWORD pulse_length2;
-                /*  Read one more byte if run out of buffer */
-                if (i == readlen) {
-                    readlen = (int)fread(buffer, 1, 1, tap->fd);
-                    if (readlen == 0) continue;
-                    i = 0;
-                }
-                if (buffer[i] == 0) {
-                    int still_in_buffer = readlen - (i + 1);
-                    needed = 3 - still_in_buffer;
-                    if (needed <= 0) {
-                        pulse_length2 = ((buffer[i + 3] << 16) | (buffer[i + 2] << 8) | buffer[i + 1]) >> 3;
-                        i += 4;
-                    } else {
-                        /* There is not enough in the buffer
-                           Read some more */
-                        memcpy(buffer, buffer + i + 1, still_in_buffer);
-                        res = (int)fread(buffer + still_in_buffer, 1, needed, tap->fd);
-                        i = readlen;
-                        if (res == 0) continue;
-                        pulse_length2 = ((buffer[2] << 16) | (buffer[1] << 8) | buffer[0]) >> 3;
-                    }
-                } else {
-                    pulse_length2 = buffer[i];
-                    i++;
-                }
-                data[j] += pulse_length2;
-            }
-            j++;
-        }
-        count = j;
-        pos[j] = ftell(tap->fd);
-
-/*        for (i = 0, count = 0; i < 256; i++, count++) {
-            pos[i] = ftell(tap->fd);
-            data[i] = tap_get_pulse(tap);
+        for (i = 0, count = 0; i < 256; i++, count++) {
+            pos[i] = tap->data_pos;
+            data[i] = tap_get_pulse(tap, &pos_advance);
             if (data[i] < 0) break;
         }
-        pos[i] = ftell(tap->fd);*/
+        pos[i] = tap->data_pos;
+
         if (count < 1) return -1;
 
         for ( i=0; (i < count) && (countCBM < minCBM) && (countTT<PILOT_MIN_LENGTH_TT*8); i++ )
@@ -1168,12 +1192,12 @@ static int tap_find_pilot(tap_t *tap, int type)
         /* startTT points to a '1' bit which we assume to be part of the
            value 00000010.  Skip over the 1 and following 0 so we start
            at the beginning of a 00000010 sequence */
-        fseek(tap->fd, startTT+2, SEEK_SET);
+        tap->data_pos = startTT + 2;
         return 1;
       }
     else
       {
-        fseek(tap->fd, startCBM, SEEK_SET);
+        tap->data_pos = startCBM;
         return 0;
       }
 }
@@ -1195,7 +1219,7 @@ static int tap_find_header(tap_t *tap)
         }
 
       /* store current position in TAP file */
-      fpos = ftell(tap->fd);
+      fpos = tap->data_pos;
 
       /* try to read a header */
       if ( type==PILOT_TYPE_CBM )
@@ -1204,7 +1228,7 @@ static int tap_find_header(tap_t *tap)
           if ( res<0 ) 
             {
               int pos_advance;
-              fseek(tap->fd, fpos, SEEK_SET);
+              tap->data_pos = fpos;
               while ( TAP_PULSE_SHORT(tap_get_pulse(tap, &pos_advance)) );
             }
         }
@@ -1213,7 +1237,7 @@ static int tap_find_header(tap_t *tap)
           res = tap_tt_read_header(tap);
           if ( res<0 ) 
             {
-              fseek(tap->fd, fpos, SEEK_SET);
+              tap->data_pos = fpos;
               tap_tt_skip_pilot(tap);
             }
         }
@@ -1229,7 +1253,7 @@ static int tap_find_header(tap_t *tap)
             }
 
           /* success.  Rewind to start of header and return. */
-          fseek(tap->fd, fpos, SEEK_SET);
+          tap->data_pos = fpos;
           tap->current_file_seek_position = fpos;
           return type;
         }
@@ -1247,7 +1271,7 @@ static int tap_read_file(tap_t *tap)
 #endif
 
   /* store current position in TAP file */
-  fpos = ftell(tap->fd);
+  fpos = tap->data_pos;
 
   /* clear old file data */
   tap->current_file_size = 0;
@@ -1274,7 +1298,7 @@ static int tap_read_file(tap_t *tap)
     }
 
   /* go back to previous position in TAP file */
-  fseek(tap->fd, fpos, SEEK_SET);
+  tap->data_pos = fpos;
 
 #if TAP_DEBUG > 0
   log_debug("\nTAP_READ_FILE(END%i)\n",ret);
@@ -1331,7 +1355,7 @@ int tap_seek_start(tap_t *tap)
   
   tap->current_file_number = -1;
   tap->current_file_seek_position = 0;
-  fseek(tap->fd, tap->offset, SEEK_SET);
+  tap->data_pos = 0;
   return 0;
 }
 
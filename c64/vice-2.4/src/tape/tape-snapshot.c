@@ -88,6 +88,7 @@ static int tape_snapshot_write_tapimage_module(snapshot_t *s)
 
     /* remeber current position */
     pos = ftell(ftap);
+    ((tap_t*)tape_image_dev1->data)->fd_write_pos = -1;
 
     /* move to end and get size of file */
     if (fseek(ftap, 0, SEEK_END) != 0) {
@@ -275,6 +276,7 @@ int tape_snapshot_read_module(snapshot_t *s)
     unsigned int snap_type;
     char snap_module_name[] = "TAPE";
     tap_t *tap;
+    int size;
 
     if (tape_snapshot_read_tapimage_module(s) < 0
         || tape_snapshot_read_t64image_module(s) < 0)
@@ -311,8 +313,13 @@ int tape_snapshot_read_module(snapshot_t *s)
             break;
         case TAPE_TYPE_TAP:
             tap = (tap_t*)tape_image_dev1->data;
-            if (tap == NULL
-                || SMR_DW(m, (DWORD*)&tap->size) < 0
+            if (tap == NULL) {
+                snapshot_module_close(m);
+                return -1;
+            }
+            /* The contents of the attached image are all there is.  */
+            size = tap->size;
+            if (SMR_DW(m, (DWORD*)&tap->size) < 0
                 || SMR_B(m, &tap->version) < 0
                 || SMR_B(m, &tap->system) < 0
                 || SMR_DW(m, (DWORD*)&tap->current_file_seek_position) < 0
@@ -327,6 +334,16 @@ int tape_snapshot_read_module(snapshot_t *s)
                 snapshot_module_close(m);
                 return -1;
             }
+            if (tap->size < 0 || tap->size > size
+                || tap->current_file_seek_position < 0
+                || tap->current_file_seek_position > tap->size) {
+                log_error(tape_snapshot_log,
+                    "Tape in snapshot does not match the attached image.");
+                tap->size = size;
+                tap->current_file_seek_position = 0;
+                snapshot_module_close(m);
+                return -1;
+            }
 
             break;
         default:
@@ -62,16 +62,44 @@ int current_language_index = 0;
 
 /* --------------------------------------------------------------------- */
 
-static char *get_string_by_id(int id)
+/* Position + 1 in string_table of every ID, indexed by
+   ID - ID_START_65536, built on the first lookup.  */
+static int *string_index = NULL;
+static int string_index_size = 0;
+
+static void string_index_init(void)
 {
   unsigned int k;
+  int id;
 
   for (k = 0; k < countof(string_table); k++)
   {
-    if (string_table[k].resource_id==id)
-      return string_table[k].text;
+    id = string_table[k].resource_id - ID_START_65536;
+    if (id >= string_index_size)
+      string_index_size = id + 1;
   }
-  return NULL;
+
+  string_index = lib_calloc(string_index_size, sizeof(int));
+
+  /* backwards, so the first entry of an ID wins like in a linear search */
+  for (k = countof(string_table); k-- > 0;)
+  {
+    id = string_table[k].resource_id - ID_START_65536;
+    if (id >= 0)
+      string_index[id] = k + 1;
+  }
+}
+
+static char *get_string_by_id(int id)
+{
+  if (string_index == NULL)
+    string_index_init();
+
+  id -= ID_START_65536;
+  if (id < 0 || id >= string_index_size || string_index[id] == 0)
+    return NULL;
+
+  return string_table[string_index[id] - 1].text;
 }
 
 static char *sid_return = NULL;
@@ -159,31 +187,74 @@ static char *translate_and_build_sid_cmdline_option(int en_resource)
 
 static char *text_table[countof(translate_text_table)][countof(language_table)];
 
-static void translate_text_init(void)
+/* Languages whose column of text_table has been converted already.  */
+static int text_table_converted[countof(language_table)];
+
+/* Row + 1 in translate_text_table of every english ID, indexed by
+   ID - ID_START_65536, built on the first lookup.  */
+static int *text_index = NULL;
+static int text_index_size = 0;
+
+/* Convert the strings of a language on its first use only, most of them
+   are never asked for.  */
+static void translate_text_convert(int language)
 {
-  unsigned int i,j;
+  unsigned int j;
   char *temp;
 
-  for (i = 0; i < countof(language_table); i++)
+  if (text_table_converted[language])
+    return;
+
+  for (j = 0; j < countof(translate_text_table); j++)
+  {
+    if (translate_text_table[j][language]==0)
+      text_table[j][language]=NULL;
+    else
+    {
+      temp=get_string_by_id(translate_text_table[j][language]);
+      text_table[j][language]=intl_convert_cp(temp, language_cp_table[language]);
+    }
+  }
+  text_table_converted[language] = 1;
+}
+
+static int get_text_row_by_id(int id)
+{
+  unsigned int j;
+  int row;
+
+  if (text_index == NULL)
   {
     for (j = 0; j < countof(translate_text_table); j++)
     {
-      if (translate_text_table[j][i]==0)
-        text_table[j][i]=NULL;
-      else
-      {
-        temp=get_string_by_id(translate_text_table[j][i]);
-        text_table[j][i]=intl_convert_cp(temp, language_cp_table[i]);
-      }
+      row = translate_text_table[j][0] - ID_START_65536;
+      if (row >= text_index_size)
+        text_index_size = row + 1;
+    }
+
+    text_index = lib_calloc(text_index_size, sizeof(int));
+
+    /* backwards, so the first row of an ID wins like in a linear search */
+    for (j = countof(translate_text_table); j-- > 0;)
+    {
+      row = translate_text_table[j][0] - ID_START_65536;
+      if (row >= 0)
+        text_index[row] = j + 1;
     }
   }
+
+  id -= ID_START_65536;
+  if (id < 0 || id >= text_index_size)
+    return -1;
+
+  return text_index[id] - 1;
 }
 
 char translate_id_error_text[30];
 
 char *translate_text(int en_resource)
 {
-  unsigned int i;
+  int i;
   char *retval = NULL;
 
   if (en_resource == IDCLS_UNUSED)
@@ -208,16 +279,18 @@ char *translate_text(int en_resource)
   }
   else
   {
-    for (i = 0; i < countof(translate_text_table); i++)
+    i = get_text_row_by_id(en_resource);
+    if (i >= 0)
     {
-      if (translate_text_table[i][0] == en_resource)
+      translate_text_convert(current_language_index);
+      if (translate_text_table[i][current_language_index]!=0 &&
+          text_table[i][current_language_index]!=NULL &&
+          strlen(text_table[i][current_language_index])!=0)
+        retval = text_table[i][current_language_index];
+      else
       {
-        if (translate_text_table[i][current_language_index]!=0 &&
-            text_table[i][current_language_index]!=NULL &&
-            strlen(text_table[i][current_language_index])!=0)
-          retval = text_table[i][current_language_index];
-        else
-          retval = text_table[i][0];
+        translate_text_convert(0);
+        retval = text_table[i][0];
       }
     }
   }
@@ -270,7 +343,6 @@ static const resource_string_t resources_string[] = {
 int translate_resources_init(void)
 {
   intl_init();
-  translate_text_init();
 
   return resources_register_string(resources_string);
 }
@@ -281,11 +353,21 @@ void translate_resources_shutdown(void)
 
   for (i = 0; i < countof(language_table); i++)
   {
+    if (!text_table_converted[i])
+      continue;
     for (j = 0; j < countof(translate_text_table); j++)
     {
       lib_free(text_table[j][i]);
+      text_table[j][i] = NULL;
     }
+    text_table_converted[i] = 0;
   }
+  lib_free(text_index);
+  text_index = NULL;
+  text_index_size = 0;
+  lib_free(string_index);
+  string_index = NULL;
+  string_index_size = 0;
   intl_shutdown();
   lib_free(current_language);
 
@@ -34,7 +34,6 @@
 #include <stdio.h>
 
 #include "drive-snapshot.h"
-#include "ioutil.h"
 #include "joystick.h"
 #include "keyboard.h"
 #include "log.h"
@@ -81,8 +80,7 @@ int vic20_snapshot_write(const char *name, int save_roms, int save_disks,
         || tape_snapshot_write_module(s, save_disks) < 0
         || keyboard_snapshot_write_module(s)
         || joystick_snapshot_write_module(s)) {
-        snapshot_close(s);
-        ioutil_remove(name);
+        snapshot_abort(s);
         return -1;
     }
 
@@ -91,14 +89,12 @@ int vic20_snapshot_write(const char *name, int save_roms, int save_disks,
         if (viacore_snapshot_write_module(machine_context.ieeevia1, s) < 0
             || viacore_snapshot_write_module(machine_context.ieeevia2,
             s) < 0) {
-            snapshot_close(s);
-            ioutil_remove(name);
+            snapshot_abort(s);
             return 1;
         }
     }
 
-    snapshot_close(s);
-    return 0;
+    return snapshot_close(s);
 }
 
 int vic20_snapshot_read(const char *name, int event_mode)
@@ -398,8 +398,6 @@ int vic20_mem_disable_ram_block(int num)
 
 void mem_initialize_memory(void)
 {
-    int i;
-
     /* Setup zero page at $0000-$00FF. */
     set_mem(0x00, 0x00,
             zero_read, zero_store, ram_peek,
@@ -537,11 +535,6 @@ void mem_initialize_memory(void)
     _mem_read_base_tab_ptr = _mem_read_base_tab;
     mem_read_limit_tab_ptr = mem_read_limit_tab;
 
-    for (i = 0; i <= 0x100; i++) {
-        _mem_read_tab_watch[i] = read_watch;
-        _mem_write_tab_watch[i] = store_watch;
-    }
-
     mem_toggle_watchpoints(watchpoints_active, NULL);
     maincpu_resync_limits();
 }
@@ -554,9 +547,30 @@ void mem_mmu_translate(unsigned int addr, BYTE **base, int *start, int *limit) {
     *limit = mem_read_limit_tab_ptr[addr >> 8];
 }
 
+/* Only the pages holding a watched address go through the watch
+   functions, the others keep their own.  */
+static void mem_update_tab_watch(void)
+{
+    int i;
+
+    for (i = 0; i <= 0x100; i++) {
+        if (monitor_load_pages[e_comp_space][i & 0xff]) {
+            _mem_read_tab_watch[i] = read_watch;
+        } else {
+            _mem_read_tab_watch[i] = _mem_read_tab_nowatch[i];
+        }
+        if (monitor_store_pages[e_comp_space][i & 0xff]) {
+            _mem_write_tab_watch[i] = store_watch;
+        } else {
+            _mem_write_tab_watch[i] = _mem_write_tab_nowatch[i];
+        }
+    }
+}
+
 void mem_toggle_watchpoints(int flag, void *context)
 {
     if (flag) {
+        mem_update_tab_watch();
         _mem_read_tab_ptr = _mem_read_tab_watch;
         _mem_write_tab_ptr = _mem_write_tab_watch;
     } else {
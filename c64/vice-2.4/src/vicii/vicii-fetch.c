@@ -34,6 +34,7 @@
 #include <string.h>
 
 #include "alarm.h"
+#include "benchmark.h"
 #include "debug.h"
 #include "c64cart.h"
 #include "c64cartmem.h"
@@ -519,6 +520,9 @@ phi2noultimax:
 void vicii_fetch_alarm_handler(CLOCK offset, void *data)
 {
     CLOCK last_opcode_first_write_clk, last_opcode_last_write_clk;
+    int benchmark_saved = BENCHMARK_CPU;
+
+    BENCHMARK_ENTER(benchmark_saved, BENCHMARK_VIDEO);
 
     /* This kludgy thing is used to emulate the behavior of the 6510 when BA
        goes low.  When BA goes low, every read access stops the processor
@@ -592,6 +596,8 @@ void vicii_fetch_alarm_handler(CLOCK offset, void *data)
         if (leave)
             break;
     }
+
+    BENCHMARK_LEAVE(benchmark_saved);
 }
 
 void vicii_fetch_init(void)
@@ -49,6 +49,7 @@
 #include <string.h>
 
 #include "alarm.h"
+#include "benchmark.h"
 #include "c64.h"
 #include "cartridge.h"
 #include "c64cart.h"
@@ -271,6 +272,16 @@ void vicii_handle_pending_alarms_external_write(void)
         vicii_handle_pending_alarms(maincpu_rmw_flag + 1);
 }
 
+/* Return the first clock at which `vicii_handle_pending_alarms_external(0)'
+   has something to do, CLOCK_MAX if it never has.  */
+CLOCK vicii_pending_alarms_clk_external(void)
+{
+    if (!vicii.initialized)
+        return CLOCK_MAX;
+
+    return vicii.fetch_clk < vicii.draw_clk ? vicii.fetch_clk : vicii.draw_clk;
+}
+
 /* return pixel aspect ratio for current video mode
  * based on http://codebase64.com/doku.php?id=base:pixel_aspect_ratio
  */
@@ -1200,6 +1211,9 @@ void vicii_raster_draw_alarm_handler(CLOCK offset, void *data)
     BYTE prev_sprite_sprite_collisions;
     BYTE prev_sprite_background_collisions;
     int in_visible_area;
+    int benchmark_saved = BENCHMARK_CPU;
+
+    BENCHMARK_ENTER(benchmark_saved, BENCHMARK_VIDEO);
 
     prev_sprite_sprite_collisions = vicii.sprite_sprite_collisions;
     prev_sprite_background_collisions = vicii.sprite_background_collisions;
@@ -1403,6 +1417,8 @@ void vicii_raster_draw_alarm_handler(CLOCK offset, void *data)
     vicii.last_emulate_line_clk += vicii.cycles_per_line;
     vicii.draw_clk = vicii.last_emulate_line_clk + vicii.draw_cycle;
     alarm_set(vicii.raster_draw_alarm, vicii.draw_clk);
+
+    BENCHMARK_LEAVE(benchmark_saved);
 }
 
 void vicii_set_canvas_refresh(int enable)
@@ -31,6 +31,7 @@
 
 #include "vice.h"
 
+#include "benchmark.h"
 #include "debug.h"
 #include "maincpu.h"
 #include "types.h"
@@ -256,6 +257,9 @@ int vicii_cycle(void)
 {
     int ba_low = 0;
     int can_sprite_sprite, can_sprite_background;
+    int benchmark_saved = BENCHMARK_CPU;
+
+    BENCHMARK_ENTER(benchmark_saved, BENCHMARK_VIDEO);
 
     /*VICII_DEBUG_CYCLE(("cycle: line %i, clk %i", vicii.raster_line, vicii.raster_cycle));*/
 
@@ -482,6 +486,7 @@ int vicii_cycle(void)
         vicii_trigger_light_pen_internal(0);
     }
 
+    BENCHMARK_LEAVE(benchmark_saved);
     return ba_low;
 }
 
@@ -143,6 +143,11 @@ void vicii_handle_pending_alarms_external_write(void)
     return;
 }
 
+CLOCK vicii_pending_alarms_clk_external(void)
+{
+    return CLOCK_MAX;
+}
+
 /* return pixel aspect ratio for current video mode
  * based on http://codebase64.com/doku.php?id=base:pixel_aspect_ratio
  */
@@ -94,9 +94,23 @@ struct draw_buffer_s {
     unsigned int visible_width;
     /* Height of the visible subset of draw_buffer, in pixels */
     unsigned int visible_height;
+    /* Runs of changed lines within the area passed to video_canvas_refresh(),
+    or 0 if the whole area has to be redrawn. Only valid during the call. */
+    unsigned int refresh_span_count;
+    struct video_refresh_span_s *refresh_spans;
 };
 typedef struct draw_buffer_s draw_buffer_t;
 
+#define VIDEO_REFRESH_SPANS_MAX 16
+
+/* A run of changed draw_buffer lines, in the same units as the ys argument
+   of video_canvas_refresh() */
+struct video_refresh_span_s {
+    unsigned int ys;
+    unsigned int h;
+};
+typedef struct video_refresh_span_s video_refresh_span_t;
+
 struct cap_render_s {
     unsigned int sizex;
     unsigned int sizey;
@@ -158,6 +172,10 @@ struct video_render_color_tables_s {
     SDWORD line_yuv_0[VIDEO_MAX_OUTPUT_WIDTH * 3];
     SWORD prevrgbline[VIDEO_MAX_OUTPUT_WIDTH * 3];
     BYTE rgbscratchbuffer[VIDEO_MAX_OUTPUT_WIDTH * 4];
+    /* Y/U/V of the output line, for the RGB conversion kernels */
+    SDWORD line_y[VIDEO_MAX_OUTPUT_WIDTH];
+    SDWORD line_u[VIDEO_MAX_OUTPUT_WIDTH];
+    SDWORD line_v[VIDEO_MAX_OUTPUT_WIDTH];
 };
 typedef struct video_render_color_tables_s video_render_color_tables_t;
 
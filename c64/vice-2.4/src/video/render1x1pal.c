@@ -27,6 +27,7 @@
 #include "vice.h"
 
 #include "render1x1pal.h"
+#include "rendersimd.h"
 #include "types.h"
 #include "video-color.h"
 
@@ -141,7 +142,9 @@ void store_pixel_YVYU(BYTE *trg, SDWORD y1_, SDWORD u1, SDWORD v1, SDWORD y2_, S
     trg[3] = (BYTE)(u1 + 128);
 }
 
-/* PAL 1x1 renderers */
+/* PAL 1x1 renderers.  With `rgbkernel' set to 2 or 4 (bytes per pixel) the
+   line is collected and converted by the AVX2 kernels in rendersimd.c
+   instead of `store_func'.  */
 static inline void
 render_generic_1x1_pal(video_render_color_tables_t *color_tab, const BYTE *src, BYTE *trg,
                        unsigned int width, const unsigned int height,
@@ -152,7 +155,8 @@ render_generic_1x1_pal(video_render_color_tables_t *color_tab, const BYTE *src,
                        void (*store_func)(BYTE *trg,
                                           SDWORD y1, SDWORD u1, SDWORD v1,
                                           SDWORD y2, SDWORD u2, SDWORD v2),
-                       int yuvtarget, video_render_config_t *config)
+                       int yuvtarget, const int rgbkernel,
+                       video_render_config_t *config)
 {
     const SDWORD *cbtable = color_tab->cbtable;
     const SDWORD *crtable = color_tab->crtable;
@@ -250,8 +254,25 @@ render_generic_1x1_pal(video_render_color_tables_t *color_tab, const BYTE *src,
             line[1] = vnew;
             line += 2;
 
-            store_func(tmptrg, l1, u1, v1, l2, u2, v2);
-            tmptrg += pixelstride;
+            if (rgbkernel) {
+                color_tab->line_y[x * 2] = l1;
+                color_tab->line_u[x * 2] = u1;
+                color_tab->line_v[x * 2] = v1;
+                color_tab->line_y[x * 2 + 1] = l2;
+                color_tab->line_u[x * 2 + 1] = u2;
+                color_tab->line_v[x * 2 + 1] = v2;
+            } else {
+                store_func(tmptrg, l1, u1, v1, l2, u2, v2);
+                tmptrg += pixelstride;
+            }
+        }
+
+        if (rgbkernel == 2) {
+            render_yuv_line_16((WORD *)trg, color_tab->line_y,
+                               color_tab->line_u, color_tab->line_v, width * 2);
+        } else if (rgbkernel == 4) {
+            render_yuv_line_32((DWORD *)trg, color_tab->line_y,
+                               color_tab->line_u, color_tab->line_v, width * 2);
         }
 
         src += pitchs;
@@ -269,7 +290,7 @@ render_UYVY_1x1_pal(video_render_color_tables_t *color_tab,
 {
     render_generic_1x1_pal(color_tab, src, trg, width, height, xs, ys, xt, yt,
                            pitchs, pitcht,
-                           4, store_pixel_UYVY, 1, config);
+                           4, store_pixel_UYVY, 1, 0, config);
 }
 
 void
@@ -282,7 +303,7 @@ render_YUY2_1x1_pal(video_render_color_tables_t *color_tab,
 {
     render_generic_1x1_pal(color_tab, src, trg, width, height, xs, ys, xt, yt,
                            pitchs, pitcht,
-                           4, store_pixel_YUY2, 1, config);
+                           4, store_pixel_YUY2, 1, 0, config);
 }
 
 void
@@ -295,7 +316,7 @@ render_YVYU_1x1_pal(video_render_color_tables_t *color_tab,
 {
     render_generic_1x1_pal(color_tab, src, trg, width, height, xs, ys, xt, yt,
                            pitchs, pitcht,
-                           4, store_pixel_YVYU, 1, config);
+                           4, store_pixel_YVYU, 1, 0, config);
 }
 
 void
@@ -306,9 +327,15 @@ render_16_1x1_pal(video_render_color_tables_t *color_tab,
                   const unsigned int xt, const unsigned int yt,
                   const unsigned int pitchs, const unsigned int pitcht, video_render_config_t *config)
 {
-    render_generic_1x1_pal(color_tab, src, trg, width, height, xs, ys, xt, yt,
-                           pitchs, pitcht,
-                           4, store_pixel_2, 0, config);
+    if (render_simd_level() > RENDER_SIMD_NONE) {
+        render_generic_1x1_pal(color_tab, src, trg, width, height, xs, ys, xt, yt,
+                               pitchs, pitcht,
+                               4, NULL, 0, 2, config);
+    } else {
+        render_generic_1x1_pal(color_tab, src, trg, width, height, xs, ys, xt, yt,
+                               pitchs, pitcht,
+                               4, store_pixel_2, 0, 0, config);
+    }
 }
 
 void
@@ -321,7 +348,7 @@ render_24_1x1_pal(video_render_color_tables_t *color_tab,
 {
     render_generic_1x1_pal(color_tab, src, trg, width, height, xs, ys, xt, yt,
                            pitchs, pitcht,
-                           6, store_pixel_3, 0, config);
+                           6, store_pixel_3, 0, 0, config);
 }
 
 void
@@ -332,7 +359,13 @@ render_32_1x1_pal(video_render_color_tables_t *color_tab,
                   const unsigned int xt, const unsigned int yt,
                   const unsigned int pitchs, const unsigned int pitcht, video_render_config_t *config)
 {
-    render_generic_1x1_pal(color_tab, src, trg, width, height, xs, ys, xt, yt,
-                           pitchs, pitcht,
-                           8, store_pixel_4, 0, config);
+    if (render_simd_level() > RENDER_SIMD_NONE) {
+        render_generic_1x1_pal(color_tab, src, trg, width, height, xs, ys, xt, yt,
+                               pitchs, pitcht,
+                               8, NULL, 0, 4, config);
+    } else {
+        render_generic_1x1_pal(color_tab, src, trg, width, height, xs, ys, xt, yt,
+                               pitchs, pitcht,
+                               8, store_pixel_4, 0, 0, config);
+    }
 }
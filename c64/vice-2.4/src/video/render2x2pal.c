@@ -30,6 +30,7 @@
 
 #include "render2x2.h"
 #include "render2x2pal.h"
+#include "rendersimd.h"
 #include "types.h"
 #include "video-color.h"
 
@@ -260,6 +261,18 @@ void get_yuv_from_video(
     line[1] = vnew;
 }
 
+/* With `rgbkernel' set to 2 or 4 (bytes per pixel) the Y/U/V of a line
+   are collected here and the line and its scanline are stored by the AVX2
+   kernels in rendersimd.c instead of `store_func'.  */
+static inline
+void collect_yuv(video_render_color_tables_t *color_tab, unsigned int i,
+                 const SDWORD y, const SDWORD u, const SDWORD v)
+{
+    color_tab->line_y[i] = y;
+    color_tab->line_u[i] = u;
+    color_tab->line_v[i] = v;
+}
+
 static inline
 void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
                        const BYTE *src, BYTE *trg,
@@ -272,9 +285,12 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
                             BYTE *const line, BYTE *const scanline,
                             SWORD *const prevline, const int shade,
                             SDWORD l, SDWORD u, SDWORD v),
-                       const int write_interpolated_pixels, video_render_config_t *config)
+                       const int write_interpolated_pixels, const int rgbkernel,
+                       video_render_config_t *config)
 {
     SWORD *prevrgblineptr;
+    BYTE *linestart, *scanlinestart;
+    unsigned int n;
     const SDWORD *ytablel = color_tab->ytablel;
     const SDWORD *ytableh = color_tab->ytableh;
     const BYTE *tmpsrc;
@@ -379,6 +395,9 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
 
         /* actual line */
         prevrgblineptr = &color_tab->prevrgbline[0];
+        linestart = tmptrg;
+        scanlinestart = tmptrgscanline;
+        n = 0;
         if (wfirst) {
             l2 = ytablel[tmpsrc[1]] + ytableh[tmpsrc[2]] + ytablel[tmpsrc[3]];
             unew += cbtable[tmpsrc[3]];
@@ -389,7 +408,9 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
             tmpsrc += 1;
             line += 2;
 
-            if (write_interpolated_pixels) {
+            if (rgbkernel) {
+                collect_yuv(color_tab, n++, (l+l2)>>1, (u+u2)>>1, (v+v2)>>1);
+            } else if (write_interpolated_pixels) {
                 store_func(tmptrg, tmptrgscanline, prevrgblineptr, shade, (l+l2)>>1, (u+u2)>>1, (v+v2)>>1);
                 tmptrgscanline += pixelstride;
                 tmptrg += pixelstride;
@@ -401,10 +422,14 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
             v = v2;
         }
         for (x = 0; x < width; x++) {
-            store_func(tmptrg, tmptrgscanline, prevrgblineptr, shade, l, u, v);
-            tmptrgscanline += pixelstride;
-            tmptrg += pixelstride;
-            prevrgblineptr += 3;
+            if (rgbkernel) {
+                collect_yuv(color_tab, n++, l, u, v);
+            } else {
+                store_func(tmptrg, tmptrgscanline, prevrgblineptr, shade, l, u, v);
+                tmptrgscanline += pixelstride;
+                tmptrg += pixelstride;
+                prevrgblineptr += 3;
+            }
 
             l2 = ytablel[tmpsrc[1]] + ytableh[tmpsrc[2]] + ytablel[tmpsrc[3]];
             unew += cbtable[tmpsrc[3]];
@@ -415,7 +440,9 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
             tmpsrc += 1;
             line += 2;
 
-            if (write_interpolated_pixels) {
+            if (rgbkernel) {
+                collect_yuv(color_tab, n++, (l+l2)>>1, (u+u2)>>1, (v+v2)>>1);
+            } else if (write_interpolated_pixels) {
                 store_func(tmptrg, tmptrgscanline, prevrgblineptr, shade, (l+l2)>>1, (u+u2)>>1, (v+v2)>>1);
                 tmptrgscanline += pixelstride;
                 tmptrg += pixelstride;
@@ -427,7 +454,21 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
             v = v2;
         }
         if (wlast) {
-            store_func(tmptrg, tmptrgscanline, prevrgblineptr, shade, l, u, v);
+            if (rgbkernel) {
+                collect_yuv(color_tab, n++, l, u, v);
+            } else {
+                store_func(tmptrg, tmptrgscanline, prevrgblineptr, shade, l, u, v);
+            }
+        }
+
+        if (rgbkernel == 2) {
+            render_yuv_scanline_16((WORD *)linestart, (WORD *)scanlinestart,
+                                   color_tab->prevrgbline, color_tab->line_y,
+                                   color_tab->line_u, color_tab->line_v, n);
+        } else if (rgbkernel == 4) {
+            render_yuv_scanline_32((DWORD *)linestart, (DWORD *)scanlinestart,
+                                   color_tab->prevrgbline, color_tab->line_y,
+                                   color_tab->line_u, color_tab->line_v, n);
         }
 
         src += pitchs;
@@ -445,7 +486,7 @@ void render_UYVY_2x2_pal(video_render_color_tables_t *color_tab,
 {
     render_generic_2x2_pal(color_tab, src, trg, width, height, xs, ys,
                            xt, yt, pitchs, pitcht, viewport,
-                           4, store_line_and_scanline_UYVY, 0, config);
+                           4, store_line_and_scanline_UYVY, 0, 0, config);
 }
 
 void render_YUY2_2x2_pal(video_render_color_tables_t *color_tab,
@@ -458,7 +499,7 @@ void render_YUY2_2x2_pal(video_render_color_tables_t *color_tab,
 {
     render_generic_2x2_pal(color_tab, src, trg, width, height, xs, ys,
                            xt, yt, pitchs, pitcht, viewport,
-                           4, store_line_and_scanline_YUY2, 0, config);
+                           4, store_line_and_scanline_YUY2, 0, 0, config);
 }
 
 void render_YVYU_2x2_pal(video_render_color_tables_t *color_tab,
@@ -471,7 +512,7 @@ void render_YVYU_2x2_pal(video_render_color_tables_t *color_tab,
 {
     render_generic_2x2_pal(color_tab, src, trg, width, height, xs, ys,
                            xt, yt, pitchs, pitcht, viewport,
-                           4, store_line_and_scanline_YVYU, 0, config);
+                           4, store_line_and_scanline_YVYU, 0, 0, config);
 }
 
 void render_16_2x2_pal(video_render_color_tables_t *color_tab,
@@ -482,9 +523,15 @@ void render_16_2x2_pal(video_render_color_tables_t *color_tab,
                        const unsigned int pitchs, const unsigned int pitcht,
                        viewport_t *viewport, video_render_config_t *config)
 {
-    render_generic_2x2_pal(color_tab, src, trg, width, height, xs, ys,
-                           xt, yt, pitchs, pitcht, viewport,
-                           2, store_line_and_scanline_2, 1, config);
+    if (render_simd_level() > RENDER_SIMD_NONE) {
+        render_generic_2x2_pal(color_tab, src, trg, width, height, xs, ys,
+                               xt, yt, pitchs, pitcht, viewport,
+                               2, NULL, 1, 2, config);
+    } else {
+        render_generic_2x2_pal(color_tab, src, trg, width, height, xs, ys,
+                               xt, yt, pitchs, pitcht, viewport,
+                               2, store_line_and_scanline_2, 1, 0, config);
+    }
 }
 
 void render_24_2x2_pal(video_render_color_tables_t *color_tab,
@@ -497,7 +544,7 @@ void render_24_2x2_pal(video_render_color_tables_t *color_tab,
 {
     render_generic_2x2_pal(color_tab, src, trg, width, height, xs, ys,
                            xt, yt, pitchs, pitcht, viewport,
-                           3, store_line_and_scanline_3, 1, config);
+                           3, store_line_and_scanline_3, 1, 0, config);
 }
 
 void render_32_2x2_pal(video_render_color_tables_t *color_tab,
@@ -508,7 +555,13 @@ void render_32_2x2_pal(video_render_color_tables_t *color_tab,
                        const unsigned int pitchs, const unsigned int pitcht,
                        viewport_t *viewport, video_render_config_t *config)
 {
-    render_generic_2x2_pal(color_tab, src, trg, width, height, xs, ys,
-                           xt, yt, pitchs, pitcht, viewport,
-                           4, store_line_and_scanline_4, 1, config);
+    if (render_simd_level() > RENDER_SIMD_NONE) {
+        render_generic_2x2_pal(color_tab, src, trg, width, height, xs, ys,
+                               xt, yt, pitchs, pitcht, viewport,
+                               4, NULL, 1, 4, config);
+    } else {
+        render_generic_2x2_pal(color_tab, src, trg, width, height, xs, ys,
+                               xt, yt, pitchs, pitcht, viewport,
+                               4, store_line_and_scanline_4, 1, 0, config);
+    }
 }
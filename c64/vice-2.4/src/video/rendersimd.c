@@ -0,0 +1,377 @@
+/*
+ * rendersimd.c - YUV to RGB line kernels for the PAL renderer.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* On CPUs with AVX2 the 1x1 and 2x2 PAL renderers first sum up Y/U/V for
+   a whole output line and then hand it to one of the kernels below, which
+   convert eight pixels at a time including the gamma table lookups.  The
+   2x2 kernels also store the scanline below, averaged with the line above,
+   which takes three more gathers.  The kernels must produce exactly the
+   same pixels as the per-pixel code of the renderers; c64/bench/render.sh
+   checks that.  Whether they are used is decided at runtime, so a binary
+   built for i586 still picks them up when the CPU has AVX2.
+
+   Elsewhere the renderers keep storing pixel by pixel.  Collecting the
+   line first and converting it in plain C or with SSE2, which has no
+   gather, was no faster than that.  The plain C kernels below only finish
+   the last few pixels of a line.
+
+   The 24 bpp and YUV targets and the CRT and NTSC renderers have no
+   kernels; they store pixel by pixel on every CPU.  */
+
+#include "vice.h"
+
+#include "log.h"
+#include "rendersimd.h"
+#include "types.h"
+#include "video-color.h"
+
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) \
+    && (defined(__i386__) || defined(__x86_64__))
+#define RENDER_SIMD_X86
+#include <immintrin.h>
+#endif
+
+static int render_simd_current = -1;
+
+/* ------------------------------------------------------------------------- */
+
+/* These must match `yuv_to_rgb()' in the renderers.  */
+#define YUV_TO_RED(y, u, v) (((y) + (v)) >> 16)
+#define YUV_TO_GRN(y, u, v) (((y) - ((50 * (u) + 130 * (v)) >> 8)) >> 16)
+#define YUV_TO_BLU(y, u, v) (((y) + (u)) >> 16)
+
+#define GAMMA(r, g, b) \
+    (gamma_red[256 + (r)] | gamma_grn[256 + (g)] | gamma_blu[256 + (b)])
+
+/* The scanline below a 2x2 pixel: the average of it and the pixel above.  */
+#define GAMMA_FAC(r, g, b, prev) \
+    (gamma_red_fac[512 + (r) + (prev)[0]] \
+     | gamma_grn_fac[512 + (g) + (prev)[1]] \
+     | gamma_blu_fac[512 + (b) + (prev)[2]])
+
+static void yuv_line_16_c(WORD *line, const SDWORD *y, const SDWORD *u,
+                          const SDWORD *v, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        SDWORD red = YUV_TO_RED(y[i], u[i], v[i]);
+        SDWORD grn = YUV_TO_GRN(y[i], u[i], v[i]);
+        SDWORD blu = YUV_TO_BLU(y[i], u[i], v[i]);
+
+        line[i] = (WORD)GAMMA(red, grn, blu);
+    }
+}
+
+static void yuv_line_32_c(DWORD *line, const SDWORD *y, const SDWORD *u,
+                          const SDWORD *v, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        SDWORD red = YUV_TO_RED(y[i], u[i], v[i]);
+        SDWORD grn = YUV_TO_GRN(y[i], u[i], v[i]);
+        SDWORD blu = YUV_TO_BLU(y[i], u[i], v[i]);
+
+        line[i] = GAMMA(red, grn, blu) | alpha;
+    }
+}
+
+static void yuv_scanline_16_c(WORD *line, WORD *scanline, SWORD *prevrgb,
+                              const SDWORD *y, const SDWORD *u,
+                              const SDWORD *v, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++, prevrgb += 3) {
+        SDWORD red = YUV_TO_RED(y[i], u[i], v[i]);
+        SDWORD grn = YUV_TO_GRN(y[i], u[i], v[i]);
+        SDWORD blu = YUV_TO_BLU(y[i], u[i], v[i]);
+
+        scanline[i] = (WORD)GAMMA_FAC(red, grn, blu, prevrgb);
+        line[i] = (WORD)GAMMA(red, grn, blu);
+        prevrgb[0] = (SWORD)red;
+        prevrgb[1] = (SWORD)grn;
+        prevrgb[2] = (SWORD)blu;
+    }
+}
+
+static void yuv_scanline_32_c(DWORD *line, DWORD *scanline, SWORD *prevrgb,
+                              const SDWORD *y, const SDWORD *u,
+                              const SDWORD *v, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++, prevrgb += 3) {
+        SDWORD red = YUV_TO_RED(y[i], u[i], v[i]);
+        SDWORD grn = YUV_TO_GRN(y[i], u[i], v[i]);
+        SDWORD blu = YUV_TO_BLU(y[i], u[i], v[i]);
+
+        scanline[i] = GAMMA_FAC(red, grn, blu, prevrgb) | alpha;
+        line[i] = GAMMA(red, grn, blu) | alpha;
+        prevrgb[0] = (SWORD)red;
+        prevrgb[1] = (SWORD)grn;
+        prevrgb[2] = (SWORD)blu;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef RENDER_SIMD_X86
+
+#define AVX2_UV_TERM(u, v)                                              \
+    _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(u, 5),          \
+                                      _mm256_slli_epi32(u, 4)),         \
+                     _mm256_add_epi32(_mm256_slli_epi32(u, 1),          \
+                                      _mm256_add_epi32(_mm256_slli_epi32(v, 7), \
+                                                       _mm256_slli_epi32(v, 1))))
+
+/* Convert eight pixels to RGB.  */
+__attribute__((target("avx2")))
+static void avx2_yuv_to_rgb(const SDWORD *y, const SDWORD *u, const SDWORD *v,
+                            __m256i *red, __m256i *grn, __m256i *blu)
+{
+    __m256i vy = _mm256_loadu_si256((const __m256i *)y);
+    __m256i vu = _mm256_loadu_si256((const __m256i *)u);
+    __m256i vv = _mm256_loadu_si256((const __m256i *)v);
+    __m256i t = _mm256_srai_epi32(AVX2_UV_TERM(vu, vv), 8);
+
+    *red = _mm256_srai_epi32(_mm256_add_epi32(vy, vv), 16);
+    *grn = _mm256_srai_epi32(_mm256_sub_epi32(vy, t), 16);
+    *blu = _mm256_srai_epi32(_mm256_add_epi32(vy, vu), 16);
+}
+
+/* Look up eight pixels in the gamma tables `r', `g' and `b'.  */
+__attribute__((target("avx2")))
+static __m256i avx2_gamma(const DWORD *r, const DWORD *g, const DWORD *b,
+                          __m256i red, __m256i grn, __m256i blu)
+{
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_i32gather_epi32((const int *)r, red, 4),
+                        _mm256_i32gather_epi32((const int *)g, grn, 4)),
+        _mm256_i32gather_epi32((const int *)b, blu, 4));
+}
+
+/* Convert eight pixels and look them up in the gamma tables.  */
+__attribute__((target("avx2")))
+static __m256i avx2_yuv_to_pixels(const SDWORD *y, const SDWORD *u,
+                                  const SDWORD *v)
+{
+    __m256i red, grn, blu;
+
+    avx2_yuv_to_rgb(y, u, v, &red, &grn, &blu);
+    return avx2_gamma(&gamma_red[256], &gamma_grn[256], &gamma_blu[256],
+                      red, grn, blu);
+}
+
+/* Convert eight pixels, look them up in the gamma tables for the line
+   and, averaged with the RGB of the pixels above in `prevrgb', in the
+   ones for the scanline, and put their RGB into `prevrgb'.  The gathers
+   from `prevrgb' read two bytes past the eighth pixel.  */
+__attribute__((target("avx2")))
+static void avx2_yuv_to_pixels_scanline(__m256i *px, __m256i *scan,
+                                        SWORD *prevrgb, const SDWORD *y,
+                                        const SDWORD *u, const SDWORD *v)
+{
+    const __m256i idx = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256i one = _mm256_set1_epi32(1);
+    __m256i red, grn, blu, prev_red, prev_grn, prev_blu;
+    SDWORD rgb[3][8];
+    unsigned int i;
+
+    avx2_yuv_to_rgb(y, u, v, &red, &grn, &blu);
+
+    /* Each gather loads 32 bits, of which the low 16 are the wanted
+       SWORD.  */
+    prev_red = _mm256_i32gather_epi32((const int *)prevrgb, idx, 2);
+    prev_grn = _mm256_i32gather_epi32((const int *)prevrgb,
+                                      _mm256_add_epi32(idx, one), 2);
+    prev_blu = _mm256_i32gather_epi32((const int *)prevrgb,
+                                      _mm256_add_epi32(idx, _mm256_add_epi32(one, one)), 2);
+    prev_red = _mm256_srai_epi32(_mm256_slli_epi32(prev_red, 16), 16);
+    prev_grn = _mm256_srai_epi32(_mm256_slli_epi32(prev_grn, 16), 16);
+    prev_blu = _mm256_srai_epi32(_mm256_slli_epi32(prev_blu, 16), 16);
+
+    *px = avx2_gamma(&gamma_red[256], &gamma_grn[256], &gamma_blu[256],
+                     red, grn, blu);
+    *scan = avx2_gamma(&gamma_red_fac[512], &gamma_grn_fac[512],
+                       &gamma_blu_fac[512],
+                       _mm256_add_epi32(red, prev_red),
+                       _mm256_add_epi32(grn, prev_grn),
+                       _mm256_add_epi32(blu, prev_blu));
+
+    /* There is no scatter in AVX2.  */
+    _mm256_storeu_si256((__m256i *)rgb[0], red);
+    _mm256_storeu_si256((__m256i *)rgb[1], grn);
+    _mm256_storeu_si256((__m256i *)rgb[2], blu);
+    for (i = 0; i < 8; i++, prevrgb += 3) {
+        prevrgb[0] = (SWORD)rgb[0][i];
+        prevrgb[1] = (SWORD)rgb[1][i];
+        prevrgb[2] = (SWORD)rgb[2][i];
+    }
+}
+
+/* Keep the low 16 bits of eight pixels, in order.  */
+__attribute__((target("avx2")))
+static __m128i avx2_pack_16(__m256i px)
+{
+    px = _mm256_and_si256(px, _mm256_set1_epi32(0xffff));
+    px = _mm256_packus_epi32(px, px);
+    return _mm256_castsi256_si128(_mm256_permute4x64_epi64(px, 0x08));
+}
+
+__attribute__((target("avx2")))
+static void yuv_line_16_avx2(WORD *line, const SDWORD *y, const SDWORD *u,
+                             const SDWORD *v, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256i px = avx2_yuv_to_pixels(y + i, u + i, v + i);
+
+        _mm_storeu_si128((__m128i *)&line[i], avx2_pack_16(px));
+    }
+    yuv_line_16_c(line + i, y + i, u + i, v + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void yuv_line_32_avx2(DWORD *line, const SDWORD *y, const SDWORD *u,
+                             const SDWORD *v, unsigned int n)
+{
+    __m256i valpha = _mm256_set1_epi32((int)alpha);
+    unsigned int i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256i px = avx2_yuv_to_pixels(y + i, u + i, v + i);
+
+        _mm256_storeu_si256((__m256i *)&line[i], _mm256_or_si256(px, valpha));
+    }
+    yuv_line_32_c(line + i, y + i, u + i, v + i, n - i);
+}
+
+/* The last pixel is always left to the C kernel, so the gathers from
+   `prevrgb' stay inside the line.  */
+__attribute__((target("avx2")))
+static void yuv_scanline_16_avx2(WORD *line, WORD *scanline, SWORD *prevrgb,
+                                 const SDWORD *y, const SDWORD *u,
+                                 const SDWORD *v, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i + 8 < n; i += 8) {
+        __m256i px, scan;
+
+        avx2_yuv_to_pixels_scanline(&px, &scan, prevrgb + i * 3,
+                                    y + i, u + i, v + i);
+        _mm_storeu_si128((__m128i *)&line[i], avx2_pack_16(px));
+        _mm_storeu_si128((__m128i *)&scanline[i], avx2_pack_16(scan));
+    }
+    yuv_scanline_16_c(line + i, scanline + i, prevrgb + i * 3,
+                      y + i, u + i, v + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void yuv_scanline_32_avx2(DWORD *line, DWORD *scanline, SWORD *prevrgb,
+                                 const SDWORD *y, const SDWORD *u,
+                                 const SDWORD *v, unsigned int n)
+{
+    __m256i valpha = _mm256_set1_epi32((int)alpha);
+    unsigned int i;
+
+    for (i = 0; i + 8 < n; i += 8) {
+        __m256i px, scan;
+
+        avx2_yuv_to_pixels_scanline(&px, &scan, prevrgb + i * 3,
+                                    y + i, u + i, v + i);
+        _mm256_storeu_si256((__m256i *)&line[i], _mm256_or_si256(px, valpha));
+        _mm256_storeu_si256((__m256i *)&scanline[i],
+                            _mm256_or_si256(scan, valpha));
+    }
+    yuv_scanline_32_c(line + i, scanline + i, prevrgb + i * 3,
+                      y + i, u + i, v + i, n - i);
+}
+
+#endif /* RENDER_SIMD_X86 */
+
+/* ------------------------------------------------------------------------- */
+
+void (*render_yuv_line_16)(WORD *line, const SDWORD *y, const SDWORD *u,
+                           const SDWORD *v, unsigned int n) = yuv_line_16_c;
+void (*render_yuv_line_32)(DWORD *line, const SDWORD *y, const SDWORD *u,
+                           const SDWORD *v, unsigned int n) = yuv_line_32_c;
+void (*render_yuv_scanline_16)(WORD *line, WORD *scanline, SWORD *prevrgb,
+                               const SDWORD *y, const SDWORD *u,
+                               const SDWORD *v, unsigned int n)
+    = yuv_scanline_16_c;
+void (*render_yuv_scanline_32)(DWORD *line, DWORD *scanline, SWORD *prevrgb,
+                               const SDWORD *y, const SDWORD *u,
+                               const SDWORD *v, unsigned int n)
+    = yuv_scanline_32_c;
+
+static int render_simd_detect(void)
+{
+#ifdef RENDER_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return RENDER_SIMD_AVX2;
+    }
+#endif
+    return RENDER_SIMD_NONE;
+}
+
+void render_simd_init(int max_level)
+{
+    int level = render_simd_detect();
+
+    if (level > max_level) {
+        level = max_level;
+    }
+
+    if (level == render_simd_current) {
+        return;
+    }
+
+    render_yuv_line_16 = yuv_line_16_c;
+    render_yuv_line_32 = yuv_line_32_c;
+    render_yuv_scanline_16 = yuv_scanline_16_c;
+    render_yuv_scanline_32 = yuv_scanline_32_c;
+
+#ifdef RENDER_SIMD_X86
+    if (level == RENDER_SIMD_AVX2) {
+        render_yuv_line_16 = yuv_line_16_avx2;
+        render_yuv_line_32 = yuv_line_32_avx2;
+        render_yuv_scanline_16 = yuv_scanline_16_avx2;
+        render_yuv_scanline_32 = yuv_scanline_32_avx2;
+    }
+#endif
+
+    log_message(LOG_DEFAULT, "PAL renderer: %s.",
+                level == RENDER_SIMD_AVX2 ? "using AVX2 kernels"
+                : "storing pixel by pixel");
+    render_simd_current = level;
+}
+
+int render_simd_level(void)
+{
+    return render_simd_current;
+}
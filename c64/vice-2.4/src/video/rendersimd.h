@@ -0,0 +1,57 @@
+/*
+ * rendersimd.h - YUV to RGB line kernels for the PAL renderer.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_RENDERSIMD_H
+#define VICE_RENDERSIMD_H
+
+#include "types.h"
+
+#define RENDER_SIMD_NONE 0
+#define RENDER_SIMD_AVX2 1
+
+/* Select the best kernels the CPU supports, or at most `max_level'.  */
+extern void render_simd_init(int max_level);
+extern int render_simd_level(void);
+
+/* Convert `n' pixels of Y/U/V (as produced by the 1x1 PAL renderer) to RGB
+   and store them through the gamma tables.  */
+extern void (*render_yuv_line_16)(WORD *line,
+                                  const SDWORD *y, const SDWORD *u,
+                                  const SDWORD *v, unsigned int n);
+extern void (*render_yuv_line_32)(DWORD *line,
+                                  const SDWORD *y, const SDWORD *u,
+                                  const SDWORD *v, unsigned int n);
+
+/* The same for the 2x2 PAL renderer, which also stores the scanline below
+   the line, blended with the RGB of the line above in `prevrgb' (three
+   SWORDs per pixel), and then puts the RGB of the line into `prevrgb'.  */
+extern void (*render_yuv_scanline_16)(WORD *line, WORD *scanline,
+                                      SWORD *prevrgb, const SDWORD *y,
+                                      const SDWORD *u, const SDWORD *v,
+                                      unsigned int n);
+extern void (*render_yuv_scanline_32)(DWORD *line, DWORD *scanline,
+                                      SWORD *prevrgb, const SDWORD *y,
+                                      const SDWORD *u, const SDWORD *v,
+                                      unsigned int n);
+
+#endif
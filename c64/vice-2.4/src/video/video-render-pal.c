@@ -41,6 +41,7 @@
 #include "render2x2pal.h"
 #include "render2x2ntsc.h"
 #include "renderscale2x.h"
+#include "rendersimd.h"
 #include "resources.h"
 #include "types.h"
 #include "video-render.h"
@@ -227,6 +228,7 @@ static void video_render_pal_main(video_render_config_t *config,
 
 void video_render_pal_init(void)
 {
+    render_simd_init(RENDER_SIMD_AVX2);
     video_render_palfunc_set(video_render_pal_main);
 }
 
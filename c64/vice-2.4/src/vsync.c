@@ -52,9 +52,12 @@ int vsync_frame_counter;
 #include <limits.h>
 #endif
 
+#include "benchmark.h"
 #include "clkguard.h"
 #include "cmdline.h"
 #include "debug.h"
+#include "drivethread.h"
+#include "init.h"
 #include "log.h"
 #include "maincpu.h"
 #include "machine.h"
@@ -151,6 +154,21 @@ int vsync_resources_init(void)
 
 /* ------------------------------------------------------------------------- */
 
+/* Number of frames to run before quitting, 0 means no limit. */
+static int limit_frames;
+
+static int set_limit_frames(const char *param, void *extra_param)
+{
+    limit_frames = atoi(param);
+
+    return (limit_frames < 0) ? -1 : 0;
+}
+
+void vsync_set_frame_limit(int frames)
+{
+    limit_frames = frames;
+}
+
 /* Vsync-related command-line options. */
 static const cmdline_option_t cmdline_options[] = {
     { "-speed", SET_RESOURCE, 1,
@@ -173,6 +191,11 @@ static const cmdline_option_t cmdline_options[] = {
       USE_PARAM_STRING, USE_DESCRIPTION_ID,
       IDCLS_UNUSED, IDCLS_DISABLE_WARP_MODE,
       NULL, NULL },
+    { "-limitframes", CALL_FUNCTION, 1,
+      set_limit_frames, NULL, NULL, NULL,
+      USE_PARAM_STRING, USE_DESCRIPTION_STRING,
+      IDCLS_UNUSED, IDCLS_UNUSED,
+      "<frames>", "Quit after running the given number of frames and log the speed" },
     { NULL }
 };
 
@@ -253,9 +276,49 @@ static void display_speed(int num_frames)
     speed_eval_prev_clk = maincpu_clk;
 }
 
+/* Frames run, time and clock at the start of the -limitframes run. */
+static int limit_count;
+static unsigned long limit_start;
+static CLOCK limit_start_clk;
+
+/* Quit once -limitframes frames have been run, logging how fast they were
+   and the rest of the -benchmark report.  The count starts at the first
+   frame, after the machine has been set up. */
+static void check_frame_limit(void)
+{
+    double diff_sec;
+
+    if (limit_count++ == 0) {
+        limit_start = vsyncarch_gettime();
+        limit_start_clk = maincpu_clk;
+        benchmark_start();
+        return;
+    }
+
+    if (limit_count <= limit_frames) {
+        return;
+    }
+
+    diff_sec = (double)(signed long)(vsyncarch_gettime() - limit_start)
+               / vsyncarch_freq;
+    if (diff_sec <= 0.0) {
+        diff_sec = 1.0 / vsyncarch_freq;
+    }
+
+    log_message(LOG_DEFAULT,
+                "Frame limit: %d frames in %.3f s, %.1f fps, %.1f%% speed.",
+                limit_frames, diff_sec, limit_frames / diff_sec,
+                100.0 * (maincpu_clk - limit_start_clk)
+                / (cycles_per_sec * diff_sec));
+    benchmark_report(diff_sec, maincpu_clk - limit_start_clk);
+
+    exit(0);
+}
+
 static void clk_overflow_callback(CLOCK amount, void *data)
 {
     speed_eval_prev_clk -= amount;
+    limit_start_clk -= amount;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -350,6 +413,17 @@ int vsync_do_vsync(struct video_canvas_s *c, int been_skipped)
 
     vsync_frame_counter++;
 
+    if (vsync_frame_counter == 1) {
+        init_profile_first_frame();
+    }
+
+    if (limit_frames > 0) {
+        check_frame_limit();
+    }
+
+    /* The UI may look at or change drive state while we sleep.  */
+    drivethread_sync();
+
     /*
      * process everything wich should be done before the synchronisation
      * e.g. OS/2: exit the programm if trigger_shutdown set
@@ -0,0 +1,215 @@
+/*
+ * zdeflate.c - Encoder for deflate compressed data.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* This compresses snapshots when VICE is built without zlib.  Everything
+   goes into one block with the fixed Huffman code, and matches are found
+   greedily through hash chains of limited length.  That is much simpler
+   and somewhat weaker than zlib, but snapshots are mostly runs and
+   repeated memory, which it handles well.  No symbol takes more than 9
+   bits per byte it stands for, which gives the bound in zdeflate.h.  */
+
+#include "vice.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "lib.h"
+#include "types.h"
+#include "zdeflate.h"
+
+#define WINDOW_SIZE  32768
+#define HASH_BITS    15
+#define HASH_SIZE    (1 << HASH_BITS)
+#define MIN_MATCH    3
+#define MAX_MATCH    258
+#define MAX_CHAIN    32     /* Candidates tried per position.  */
+
+typedef struct zdeflate_state_s {
+    BYTE *dest;
+    size_t dest_pos;
+    DWORD bitbuf;
+    int bitcnt;
+} zdeflate_state_t;
+
+static const short length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const short length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const short dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const short dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/* ------------------------------------------------------------------------- */
+
+/* Append the low `n' bits of `val', least significant first.  */
+static void put_bits(zdeflate_state_t *s, DWORD val, int n)
+{
+    s->bitbuf |= val << s->bitcnt;
+    s->bitcnt += n;
+    while (s->bitcnt >= 8) {
+        s->dest[s->dest_pos++] = (BYTE)s->bitbuf;
+        s->bitbuf >>= 8;
+        s->bitcnt -= 8;
+    }
+}
+
+/* Append the Huffman code `code' of `len' bits, most significant first.  */
+static void put_code(zdeflate_state_t *s, unsigned int code, int len)
+{
+    DWORD rev = 0;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        rev = (rev << 1) | ((code >> i) & 1);
+    }
+    put_bits(s, rev, len);
+}
+
+/* Append literal/length symbol `sym' with the fixed code.  */
+static void put_symbol(zdeflate_state_t *s, int sym)
+{
+    if (sym < 144) {
+        put_code(s, 0x30 + sym, 8);
+    } else if (sym < 256) {
+        put_code(s, 0x190 + sym - 144, 9);
+    } else if (sym < 280) {
+        put_code(s, sym - 256, 7);
+    } else {
+        put_code(s, 0xc0 + sym - 280, 8);
+    }
+}
+
+static void put_match(zdeflate_state_t *s, int len, int dist)
+{
+    int code;
+
+    for (code = 28; length_base[code] > len; code--) {
+    }
+    put_symbol(s, 257 + code);
+    put_bits(s, (DWORD)(len - length_base[code]), length_extra[code]);
+
+    for (code = 29; dist_base[code] > dist; code--) {
+    }
+    put_code(s, (unsigned int)code, 5);
+    put_bits(s, (DWORD)(dist - dist_base[code]), dist_extra[code]);
+}
+
+static unsigned int hash(const BYTE *p)
+{
+    return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & (HASH_SIZE - 1);
+}
+
+/* ------------------------------------------------------------------------- */
+
+size_t zdeflate(BYTE *dest, const BYTE *src, size_t src_size)
+{
+    zdeflate_state_t s;
+    int *head, *prev;
+    size_t pos = 0, i;
+
+    s.dest = dest;
+    s.dest_pos = 0;
+    s.bitbuf = 0;
+    s.bitcnt = 0;
+
+    head = lib_malloc(HASH_SIZE * sizeof(int));
+    prev = lib_malloc(WINDOW_SIZE * sizeof(int));
+    for (i = 0; i < HASH_SIZE; i++) {
+        head[i] = -1;
+    }
+
+    /* The last block, fixed code.  */
+    put_bits(&s, 1, 1);
+    put_bits(&s, 1, 2);
+
+    while (pos < src_size) {
+        int best_len = 0, best_dist = 0;
+
+        if (pos + MIN_MATCH <= src_size) {
+            unsigned int h = hash(src + pos);
+            int cand = head[h];
+            int chain = MAX_CHAIN;
+            size_t max_len = src_size - pos;
+
+            if (max_len > MAX_MATCH) {
+                max_len = MAX_MATCH;
+            }
+            while (cand >= 0 && pos - (size_t)cand <= WINDOW_SIZE
+                   && chain-- > 0) {
+                const BYTE *a = src + cand, *b = src + pos;
+                size_t len = 0;
+
+                if (a[best_len] == b[best_len]) {
+                    while (len < max_len && a[len] == b[len]) {
+                        len++;
+                    }
+                    if ((int)len > best_len) {
+                        best_len = (int)len;
+                        best_dist = (int)(pos - (size_t)cand);
+                        if (len == max_len) {
+                            break;
+                        }
+                    }
+                }
+                cand = prev[cand & (WINDOW_SIZE - 1)];
+            }
+            prev[pos & (WINDOW_SIZE - 1)] = head[h];
+            head[h] = (int)pos;
+        }
+
+        if (best_len >= MIN_MATCH) {
+            put_match(&s, best_len, best_dist);
+            /* Hash the positions the match covers.  */
+            for (i = pos + 1; i < pos + best_len
+                 && i + MIN_MATCH <= src_size; i++) {
+                unsigned int h = hash(src + i);
+
+                prev[i & (WINDOW_SIZE - 1)] = head[h];
+                head[h] = (int)i;
+            }
+            pos += best_len;
+        } else {
+            put_symbol(&s, src[pos]);
+            pos++;
+        }
+    }
+
+    /* End of block, and flush.  */
+    put_symbol(&s, 256);
+    put_bits(&s, 0, 7);
+
+    lib_free(head);
+    lib_free(prev);
+
+    return s.dest_pos;
+}
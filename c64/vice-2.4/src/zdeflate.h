@@ -0,0 +1,39 @@
+/*
+ * zdeflate.h - Encoder for deflate compressed data.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_ZDEFLATE_H
+#define VICE_ZDEFLATE_H
+
+#include <stddef.h>
+
+#include "types.h"
+
+/* The most bytes `zdeflate()' can make of `src_size' bytes.  */
+#define ZDEFLATE_BOUND(src_size) ((src_size) + (src_size) / 8 + 16)
+
+/* Encode the `src_size' bytes at `src' into a raw deflate stream (RFC 1951)
+   in `dest', which must hold at least ZDEFLATE_BOUND(src_size) bytes.
+   Return the number of bytes written.  */
+extern size_t zdeflate(BYTE *dest, const BYTE *src, size_t src_size);
+
+#endif
@@ -49,12 +49,26 @@
 #include <strings.h>
 #endif
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#define ZFILE_MMAP
+#endif
+
 #include "archdep.h"
+#include "crc32.h"
+#include "diskimage.h"
 #include "ioutil.h"
 #include "lib.h"
 #include "log.h"
+#include "lynx.h"
+#include "types.h"
 #include "util.h"
 #include "zfile.h"
+#include "zinflate.h"
 #include "zipcode.h"
 
 
@@ -79,6 +93,20 @@ enum compression_type {
     COMPR_TZX
 };
 
+/* Contents of a file that has been uncompressed into memory, or mapped
+   into memory straight from an archive.  */
+typedef struct zfile_buffer_s {
+    BYTE *data;                  /* Uncompressed contents.  */
+    size_t size;                 /* Size of the contents.  */
+    BYTE *alloc;                 /* Heap block to free, if any.  */
+    void *map;                   /* Mapping to unmap, if any.  */
+    size_t map_size;             /* Size of the mapping.  */
+} zfile_buffer_t;
+
+/* Largest file that is uncompressed into memory; bigger ones are left to
+   the external programs.  */
+#define ZFILE_BUFFER_MAX (64 * 1024 * 1024)
+
 /* This defines a linked list of all the compressed files that have been
    opened.  */
 struct zfile_s {
@@ -91,6 +119,7 @@ struct zfile_s {
     struct zfile_s *prev, *next; /* Link to the previous and next nodes.  */
     zfile_action_t action;       /* action on close */
     char *request_string;        /* ui string for action=ZFILE_REQUEST */
+    zfile_buffer_t buffer;       /* Contents read by `stream', if in memory.*/
 };
 typedef struct zfile_s zfile_t;
 
@@ -102,6 +131,16 @@ static log_t zlog = LOG_ERR;
 
 static int zinit_done = 0;
 
+static void zfile_buffer_free(zfile_buffer_t *buffer)
+{
+#ifdef ZFILE_MMAP
+    if (buffer->map != NULL)
+        munmap(buffer->map, buffer->map_size);
+#endif
+    lib_free(buffer->alloc);
+    memset(buffer, 0, sizeof(zfile_buffer_t));
+}
+
 static void zfile_list_destroy(void)
 {
     zfile_t *p;
@@ -111,6 +150,7 @@ static void zfile_list_destroy(void)
 
         lib_free(p->orig_name);
         lib_free(p->tmp_name);
+        zfile_buffer_free(&p->buffer);
         next = p->next;
         lib_free(p);
         p = next;
@@ -137,7 +177,8 @@ static void zfile_list_add(const char *tmp_name,
                            const char *orig_name,
                            enum compression_type type,
                            int write_mode,
-                           FILE *stream, FILE *fd)
+                           FILE *stream, FILE *fd,
+                           zfile_buffer_t *buffer)
 {
     zfile_t *new_zfile = lib_malloc(sizeof(zfile_t));
 
@@ -152,6 +193,10 @@ static void zfile_list_add(const char *tmp_name,
     new_zfile->type = type;
     new_zfile->action = ZFILE_KEEP;
     new_zfile->request_string = NULL;
+    if (buffer != NULL)
+        new_zfile->buffer = *buffer;
+    else
+        memset(&new_zfile->buffer, 0, sizeof(zfile_buffer_t));
     new_zfile->next = zfile_list;
     new_zfile->prev = NULL;
     if (zfile_list != NULL)
@@ -516,168 +561,522 @@ static char *try_uncompress_archive(const char *name, int write_mode,
     return tmp_name;
 }
 
-#define C1541_NAME     "c1541"
+/* ------------------------------------------------------------------------- */
+
+/* Uncompression into memory.
 
-/* If this file looks like a zipcode, try to extract is using c1541. We have
-   to figure this out by reading the contents of the file */
-static char *try_uncompress_zipcode(const char *name, int write_mode)
+   The formats below are decoded by ourselves, so that no external program
+   and no temporary file is needed.  Each reader returns non-zero if it has
+   read `name'; unless `write_mode' is set, the contents are then in
+   `buffer'.  Archives that a reader cannot handle, for example because of
+   the compression method, are still left to the external programs.  */
+
+/* Read `size' bytes at `offset' of `fd' into a new block.  */
+static BYTE *read_block(FILE *fd, size_t offset, size_t size)
 {
-    char *tmp_name = NULL;
-    int i, count, sector, sectors = 0;
-    FILE *fd;
-    char tmp[256];
-    char *argv[5];
-    int exit_status;
+    BYTE *data;
 
-    /* The 2nd char has to be '!'?  */
-    util_fname_split(name, NULL, &tmp_name);
-    if (tmp_name == NULL)
+    if (fseek(fd, (long)offset, SEEK_SET) != 0)
         return NULL;
-    if (strlen(tmp_name) < 3 || tmp_name[1] != '!') {
-        lib_free(tmp_name);
+
+    data = lib_malloc(size > 0 ? size : 1);
+    if (fread(data, 1, size, fd) != size) {
+        lib_free(data);
         return NULL;
     }
-    lib_free(tmp_name);
+    return data;
+}
+
+/* Read the file `name' into a new block, if it is no larger than
+   `max_size'.  */
+static BYTE *read_file(const char *name, size_t max_size, size_t *size)
+{
+    FILE *fd;
+    BYTE *data = NULL;
 
-    /* Can we read this file?  */
     fd = fopen(name, MODE_READ);
     if (fd == NULL)
         return NULL;
-    /* Read first track to see if this is zipcode.  */
-    fseek(fd, 4, SEEK_SET);
-    for (count = 1; count < 21; count++) {
-        i = zipcode_read_sector(fd, 1, &sector, tmp);
-        if (i || sector < 0 || sector > 20 || (sectors & (1 << sector))) {
-            fclose(fd);
+
+    *size = util_file_length(fd);
+    if (*size <= max_size)
+        data = read_block(fd, 0, *size);
+
+    fclose(fd);
+    return data;
+}
+
+#ifdef ZFILE_MMAP
+/* Map `size' bytes at `offset' of `fd' into `buffer'.  */
+static int zfile_buffer_map(zfile_buffer_t *buffer, FILE *fd, size_t offset,
+                            size_t size)
+{
+    size_t start;
+    void *map;
+
+    if (size == 0)
+        return -1;
+
+    start = offset - offset % (size_t)sysconf(_SC_PAGESIZE);
+    map = mmap(NULL, offset - start + size, PROT_READ, MAP_PRIVATE,
+               fileno(fd), (off_t)start);
+    if (map == MAP_FAILED)
+        return -1;
+
+    buffer->map = map;
+    buffer->map_size = offset - start + size;
+    buffer->data = (BYTE *)map + (offset - start);
+    buffer->size = size;
+    return 0;
+}
+#endif
+
+/* Open a stream that reads the contents of `buffer'.  Without `fmemopen()'
+   the contents are written to a temporary file instead, whose name is
+   returned in `tmp_name', and `buffer' is freed.  */
+static FILE *zfile_buffer_open(zfile_buffer_t *buffer, char **tmp_name)
+{
+    FILE *stream;
+
+#ifdef HAVE_FMEMOPEN
+    if (buffer->size > 0) {
+        stream = fmemopen(buffer->data, buffer->size, MODE_READ);
+        if (stream != NULL)
+            return stream;
+    }
+#endif
+
+    stream = archdep_mkstemp_fd(tmp_name, MODE_WRITE);
+    if (stream == NULL)
+        return NULL;
+
+    if (fwrite(buffer->data, 1, buffer->size, stream) != buffer->size) {
+        fclose(stream);
+        ioutil_remove(*tmp_name);
+        lib_free(*tmp_name);
+        *tmp_name = NULL;
+        return NULL;
+    }
+    fclose(stream);
+    zfile_buffer_free(buffer);
+
+    stream = fopen(*tmp_name, MODE_READ);
+    if (stream == NULL) {
+        ioutil_remove(*tmp_name);
+        lib_free(*tmp_name);
+        *tmp_name = NULL;
+    }
+    return stream;
+}
+
+/* Zip archives.  This includes the ISO 9660 images made by mkizo, which
+   are zip archives of stored files at the same time; stored files are
+   mapped straight from the archive.  */
+
+#define ZIP_EOCD_SIZE       22
+#define ZIP_CENTRAL_SIZE    46
+#define ZIP_LOCAL_SIZE      30
+
+#define ZIP_METHOD_STORED   0
+#define ZIP_METHOD_DEFLATED 8
+
+typedef struct zip_entry_s {
+    unsigned int flags;
+    unsigned int method;
+    DWORD crc;
+    size_t csize;
+    size_t usize;
+    size_t offset;      /* Offset of the local header.  */
+} zip_entry_t;
+
+/* Read the central directory of the zip archive `fd' of `length' bytes
+   into a new block of `dir_size' bytes.  */
+static BYTE *zip_read_directory(FILE *fd, size_t length, size_t *dir_size)
+{
+    BYTE *tail;
+    size_t tail_size, i, dir_offset;
+
+    if (length < ZIP_EOCD_SIZE)
+        return NULL;
+
+    /* The end of central directory record is followed by a comment of up
+       to 64K.  */
+    tail_size = length;
+    if (tail_size > 0xffff + ZIP_EOCD_SIZE)
+        tail_size = 0xffff + ZIP_EOCD_SIZE;
+    tail = read_block(fd, length - tail_size, tail_size);
+    if (tail == NULL)
+        return NULL;
+
+    i = tail_size - ZIP_EOCD_SIZE;
+    while (memcmp(tail + i, "PK\005\006", 4) != 0) {
+        if (i == 0) {
+            lib_free(tail);
             return NULL;
         }
-        sectors |= 1 << sector;
+        i--;
     }
-    fclose(fd);
 
-    /* it is a zipcode. We cannot support write_mode */
-    if (write_mode)
-        return "";
+    *dir_size = util_le_buf_to_dword(tail + i + 12);
+    dir_offset = util_le_buf_to_dword(tail + i + 16);
+    lib_free(tail);
 
-    /* format image first */
-    tmp_name = archdep_tmpnam();
+    if (dir_offset > length || *dir_size > length - dir_offset)
+        return NULL;
 
-    /* ok, now extract the zipcode */
-    argv[0] = lib_stralloc(C1541_NAME);
-    argv[1] = lib_stralloc("-zcreate");
-    argv[2] = lib_stralloc(tmp_name);
-    argv[3] = archdep_filename_parameter(name);
-    argv[4] = NULL;
+    return read_block(fd, dir_offset, *dir_size);
+}
 
-    exit_status = archdep_spawn(C1541_NAME, argv, NULL, NULL);
+/* Parse the central directory entry at `*pos' into `entry' and move `*pos'
+   to the next one.  Return the name of the entry, which is `name_len'
+   bytes long and not terminated, or NULL after the last entry.  */
+static const char *zip_next_entry(BYTE *dir, size_t dir_size, size_t *pos,
+                                  zip_entry_t *entry, size_t *name_len)
+{
+    BYTE *p = dir + *pos;
+    size_t len;
 
-    lib_free(argv[0]);
-    lib_free(argv[1]);
-    lib_free(argv[2]);
-    lib_free(argv[3]);
+    if (dir_size - *pos < ZIP_CENTRAL_SIZE || memcmp(p, "PK\001\002", 4) != 0)
+        return NULL;
 
-    if (exit_status) {
-        ioutil_remove(tmp_name);
-        lib_free(tmp_name);
+    *name_len = util_le_buf_to_word(p + 28);
+    len = ZIP_CENTRAL_SIZE + *name_len + util_le_buf_to_word(p + 30)
+          + util_le_buf_to_word(p + 32);
+    if (len > dir_size - *pos)
         return NULL;
+
+    entry->flags = util_le_buf_to_word(p + 8);
+    entry->method = util_le_buf_to_word(p + 10);
+    entry->crc = util_le_buf_to_dword(p + 16);
+    entry->csize = util_le_buf_to_dword(p + 20);
+    entry->usize = util_le_buf_to_dword(p + 24);
+    entry->offset = util_le_buf_to_dword(p + 42);
+
+    *pos += len;
+    return (const char *)p + ZIP_CENTRAL_SIZE;
+}
+
+/* Read the contents of `entry' of the zip archive `fd' into `buffer'.  */
+static int zip_read_entry(FILE *fd, size_t length, const zip_entry_t *entry,
+                          zfile_buffer_t *buffer)
+{
+    BYTE header[ZIP_LOCAL_SIZE];
+    BYTE *src, *data;
+    size_t offset, used;
+
+    /* Encrypted files and other methods are left to unzip.  */
+    if ((entry->flags & 1)
+        || (entry->method != ZIP_METHOD_STORED
+        && entry->method != ZIP_METHOD_DEFLATED))
+        return 0;
+
+    if (entry->offset > length || length - entry->offset < ZIP_LOCAL_SIZE
+        || fseek(fd, (long)entry->offset, SEEK_SET) != 0
+        || fread(header, 1, ZIP_LOCAL_SIZE, fd) != ZIP_LOCAL_SIZE
+        || memcmp(header, "PK\003\004", 4) != 0)
+        return 0;
+
+    offset = entry->offset + ZIP_LOCAL_SIZE + util_le_buf_to_word(header + 26)
+             + util_le_buf_to_word(header + 28);
+    if (offset > length || entry->csize > length - offset)
+        return 0;
+
+    if (entry->method == ZIP_METHOD_STORED) {
+        if (entry->csize != entry->usize)
+            return 0;
+#ifdef ZFILE_MMAP
+        if (zfile_buffer_map(buffer, fd, offset, entry->usize) == 0) {
+            ZDEBUG(("zip_read_entry: mapped %u bytes at %u.",
+                    (unsigned int)entry->usize, (unsigned int)offset));
+            return 1;
+        }
+#endif
     }
-    /* everything ok */
-    return tmp_name;
+
+    if (entry->csize > ZFILE_BUFFER_MAX || entry->usize > ZFILE_BUFFER_MAX)
+        return 0;
+
+    src = read_block(fd, offset, entry->csize);
+    if (src == NULL)
+        return 0;
+
+    if (entry->method == ZIP_METHOD_STORED) {
+        data = src;
+    } else {
+        data = lib_malloc(entry->usize > 0 ? entry->usize : 1);
+        if (zinflate(data, entry->usize, &used, src, entry->csize, NULL) < 0
+            || used != entry->usize) {
+            ZDEBUG(("zip_read_entry: invalid deflate data."));
+            lib_free(data);
+            lib_free(src);
+            return 0;
+        }
+        lib_free(src);
+    }
+
+    if ((crc32_buf((char *)data, (unsigned int)entry->usize) & 0xffffffff)
+        != entry->crc) {
+        ZDEBUG(("zip_read_entry: CRC error."));
+        lib_free(data);
+        return 0;
+    }
+
+    buffer->data = buffer->alloc = data;
+    buffer->size = entry->usize;
+    return 1;
 }
 
-/* If the file looks like a lynx image, try to extract it using c1541. We have
-   to figure this out by reading the contsnts of the file */
-static char *try_uncompress_lynx(const char *name, int write_mode)
+/* Read the four files of the zipcoded disk of which `found_name' is one,
+   and unpack them into `buffer'.  */
+static int zip_read_zipcode(FILE *fd, size_t length, BYTE *dir,
+                            size_t dir_size, const char *found_name,
+                            size_t name_len, size_t nameoffset,
+                            zfile_buffer_t *buffer)
 {
-    char *tmp_name;
-    size_t i;
-    int count;
+    zfile_buffer_t parts[4];
+    const BYTE *part[4];
+    size_t part_size[4], pos, len;
+    zip_entry_t entry;
+    const char *entry_name;
+    int i, result = 0;
+
+    memset(parts, 0, sizeof(parts));
+
+    pos = 0;
+    while ((entry_name = zip_next_entry(dir, dir_size, &pos, &entry, &len))
+           != NULL) {
+        if (len != name_len || !is_zipcode_name((char *)entry_name + nameoffset)
+            || memcmp(entry_name, found_name, nameoffset) != 0
+            || memcmp(entry_name + nameoffset + 1, found_name + nameoffset + 1,
+                      len - nameoffset - 1) != 0)
+            continue;
+
+        i = entry_name[nameoffset] - '1';
+        if (parts[i].data == NULL && !zip_read_entry(fd, length, &entry,
+                                                     &parts[i]))
+            break;
+    }
+
+    for (i = 0; i < 4 && parts[i].data != NULL; i++) {
+        part[i] = parts[i].data;
+        part_size[i] = parts[i].size;
+    }
+    if (i == 4) {
+        buffer->alloc = lib_malloc(D64_FILE_SIZE_35);
+        if (zipcode_to_d64(part, part_size, buffer->alloc) == 0) {
+            buffer->data = buffer->alloc;
+            buffer->size = D64_FILE_SIZE_35;
+            result = 1;
+        } else {
+            zfile_buffer_free(buffer);
+        }
+    }
+
+    for (i = 0; i < 4; i++)
+        zfile_buffer_free(&parts[i]);
+
+    return result;
+}
+
+/* If `name' is a zip archive, search for the first file with a proper
+   extension and read it.  */
+static int try_read_zip(const char *name, int write_mode,
+                        zfile_buffer_t *buffer)
+{
+    size_t l = strlen(name), length, dir_size, pos, name_len, nameoffset = 0;
+    int result = 0;
     FILE *fd;
-    char tmp[256];
-    char *argv[20];
-    int exit_status;
+    BYTE *dir;
+    const char *entry_name;
+    char *found_name = NULL;
+    zip_entry_t entry;
+
+    if (l < 5 || (strcasecmp(name + l - 4, ".zip") != 0
+        && strcasecmp(name + l - 4, ".izo") != 0))
+        return 0;
 
-    /* can we read this file? */
     fd = fopen(name, MODE_READ);
     if (fd == NULL)
-        return NULL;
-    /* is this lynx -image? */
-    i = fread(tmp, 1, 2, fd);
-    if (i != 2 || tmp[0] != 1 || tmp[1] != 8) {
+        return 0;
+
+    length = util_file_length(fd);
+    dir = zip_read_directory(fd, length, &dir_size);
+    if (dir == NULL) {
+        ZDEBUG(("try_read_zip: no central directory in `%s'.", name));
         fclose(fd);
-        return NULL;
+        return 0;
     }
-    count = 0;
-    while (1) {
-        i = fread(tmp, 1, 1, fd);
-        if (i != 1) {
-            fclose(fd);
-            return NULL;
+
+    /* Names may have directories in front; the extension and the zipcode
+       prefix are checked on the file name itself.  */
+    pos = 0;
+    while ((entry_name = zip_next_entry(dir, dir_size, &pos, &entry,
+                                        &name_len)) != NULL) {
+        found_name = lib_malloc(name_len + 1);
+        memcpy(found_name, entry_name, name_len);
+        found_name[name_len] = 0;
+
+        for (nameoffset = name_len; nameoffset > 0; nameoffset--) {
+            if (found_name[nameoffset - 1] == '/')
+                break;
         }
-        if (tmp[0])
-            count = 0;
-        else
-            count++;
-        if (count == 3)
+        if (is_valid_extension(found_name, name_len, (int)nameoffset))
             break;
+
+        lib_free(found_name);
+        found_name = NULL;
     }
-    i = fread(tmp, 1, 1, fd);
-    if (i != 1 || tmp[0] != 13) {
-        fclose(fd);
-        return NULL;
+
+    if (found_name != NULL) {
+        ZDEBUG(("try_read_zip: found `%s'.", found_name));
+        if (write_mode) {
+            result = 1;
+        } else if (is_zipcode_name(found_name + nameoffset)) {
+            result = zip_read_zipcode(fd, length, dir, dir_size, found_name,
+                                      name_len, nameoffset, buffer);
+        } else {
+            result = zip_read_entry(fd, length, &entry, buffer);
+        }
+        lib_free(found_name);
     }
-    count = 0;
-    while (1) {
-        i = fread(&tmp[count], 1, 1, fd);
-        if (i != 1 || count == 254) {
-            fclose(fd);
-            return NULL;
+
+    lib_free(dir);
+    fclose(fd);
+
+    return result;
+}
+
+/* Gzip files.  Files with more than one member are left to zlib or
+   gzip.  */
+
+/* If `name' has a gzip-like extension, uncompress it into `buffer'.  */
+static int try_read_gzip(const char *name, zfile_buffer_t *buffer)
+{
+    BYTE *src, *data;
+    size_t size, pos, used, src_used;
+    DWORD usize;
+    int result = 0;
+
+    if (!archdep_file_is_gzip(name))
+        return 0;
+
+    src = read_file(name, ZFILE_BUFFER_MAX, &size);
+    if (src == NULL)
+        return 0;
+
+    pos = zinflate_gzip_offset(src, size);
+    if (pos > 0) {
+        usize = util_le_buf_to_dword(src + size - 4);
+        if (usize <= ZFILE_BUFFER_MAX) {
+            data = lib_malloc(usize > 0 ? usize : 1);
+            if (zinflate(data, usize, &used, src + pos, size - 8 - pos,
+                         &src_used) == 0
+                && used == usize && src_used == size - 8 - pos
+                && (crc32_buf((char *)data, usize) & 0xffffffff)
+                   == util_le_buf_to_dword(src + size - 8)) {
+                buffer->data = buffer->alloc = data;
+                buffer->size = usize;
+                result = 1;
+            } else {
+                ZDEBUG(("try_read_gzip: cannot uncompress `%s'.", name));
+                lib_free(data);
+            }
         }
-        if (tmp[count++] == 13)
-            break;
     }
-    tmp[count] = 0;
-    if (!atoi(tmp)) {
-        fclose(fd);
-        return NULL;
+
+    lib_free(src);
+    return result;
+}
+
+/* Zipcoded disks, which come as the four files `1!name' to `4!name'.  */
+static int try_read_zipcode(const char *name, int write_mode,
+                            zfile_buffer_t *buffer)
+{
+    char *file_name = NULL, *part_name;
+    const BYTE *part[4];
+    BYTE *parts[4];
+    size_t part_size[4], nameoffset;
+    int i, result = 0;
+
+    util_fname_split(name, NULL, &file_name);
+    if (file_name == NULL)
+        return 0;
+    if (strlen(file_name) < 3 || !is_zipcode_name(file_name)) {
+        lib_free(file_name);
+        return 0;
+    }
+    nameoffset = strlen(name) - strlen(file_name);
+    lib_free(file_name);
+
+    part_name = lib_stralloc(name);
+    for (i = 0; i < 4; i++) {
+        part_name[nameoffset] = '1' + i;
+        parts[i] = read_file(part_name, D64_FILE_SIZE_35, &part_size[i]);
+        part[i] = parts[i];
+    }
+    lib_free(part_name);
+
+    if (parts[0] != NULL && parts[1] != NULL && parts[2] != NULL
+        && parts[3] != NULL) {
+        buffer->alloc = lib_malloc(D64_FILE_SIZE_35);
+        if (zipcode_to_d64(part, part_size, buffer->alloc) == 0) {
+            buffer->data = buffer->alloc;
+            buffer->size = D64_FILE_SIZE_35;
+            result = 1;
+        }
     }
-    /* XXX: this is not a full check, but perhaps enough? */
 
-    fclose(fd);
+    for (i = 0; i < 4; i++)
+        lib_free(parts[i]);
 
-    /* it is a lynx image. We cannot support write_mode */
-    if (write_mode)
-        return "";
+    /* It is a zipcode.  We cannot support write_mode.  */
+    if (!result || write_mode)
+        zfile_buffer_free(buffer);
 
-    tmp_name = archdep_tmpnam();
+    return result;
+}
 
-    /* now create the image */
-    argv[0] = lib_stralloc("c1541");
-    argv[1] = lib_stralloc("-format");
-    argv[2] = lib_stralloc("lynximage,00");
-    argv[3] = lib_stralloc("x64");
-    argv[4] = lib_stralloc(tmp_name);
-    argv[5] = lib_stralloc("-unlynx");
-    argv[6] = archdep_filename_parameter(name);
-    argv[7] = NULL;
+/* Lynx archives.  The BASIC stub and the header lines are much shorter
+   than this.  */
+#define LYNX_HEADER_MAX 1024
 
-    exit_status = archdep_spawn("c1541", argv, NULL, NULL);
+static int try_read_lynx(const char *name, int write_mode,
+                         zfile_buffer_t *buffer)
+{
+    FILE *fd;
+    BYTE header[LYNX_HEADER_MAX], *src;
+    size_t size;
+    int result = 0;
 
-    lib_free(argv[0]);
-    lib_free(argv[1]);
-    lib_free(argv[2]);
-    lib_free(argv[3]);
-    lib_free(argv[4]);
-    lib_free(argv[5]);
-    lib_free(argv[6]);
+    /* Every file that is opened gets here, and any BASIC program starts
+       like a Lynx archive, so check the whole header before reading the
+       file.  */
+    fd = fopen(name, MODE_READ);
+    if (fd == NULL)
+        return 0;
+    size = fread(header, 1, sizeof(header), fd);
+    fclose(fd);
+    if (lynx_check_header(header, size) < 0)
+        return 0;
 
-    if (exit_status) {
-        ioutil_remove(tmp_name);
-        lib_free(tmp_name);
-        return NULL;
+    /* The archive cannot be much larger than the disk it unpacks to.  */
+    src = read_file(name, 2 * D64_FILE_SIZE_35, &size);
+    if (src == NULL)
+        return 0;
+
+    buffer->alloc = lib_malloc(D64_FILE_SIZE_35);
+    if (lynx_to_d64(src, size, buffer->alloc) == 0) {
+        buffer->data = buffer->alloc;
+        buffer->size = D64_FILE_SIZE_35;
+        result = 1;
     }
-    /* everything ok */
-    return tmp_name;
+    lib_free(src);
+
+    /* It is a lynx image.  We cannot support write_mode.  */
+    if (!result || write_mode)
+        zfile_buffer_free(buffer);
+
+    return result;
 }
 
 struct valid_archives_s {
@@ -711,17 +1110,27 @@ static const valid_archives_t valid_archives[] = {
 };
 
 /* Try to uncompress file `name' using the algorithms we know of.  If this is
-   not possible, return `COMPR_NONE'.  Otherwise, uncompress the file into a
-   temporary file, return the type of algorithm used and the name of the
-   temporary file in `tmp_name'.  If `write_mode' is non-zero and the
-   returned `tmp_name' has zero length, then the file cannot be accessed in
-   write mode.  */
+   not possible, return `COMPR_NONE'.  Otherwise, uncompress the file into
+   `buffer' or into a temporary file, return the type of algorithm used and
+   the name of the temporary file in `tmp_name', or NULL if the file is in
+   `buffer'.  If `write_mode' is non-zero and the returned `tmp_name' has
+   zero length, then the file cannot be accessed in write mode.  */
 static enum compression_type try_uncompress(const char *name,
                                             char **tmp_name,
+                                            zfile_buffer_t *buffer,
                                             int write_mode)
 {
     int i;
 
+    memset(buffer, 0, sizeof(zfile_buffer_t));
+    *tmp_name = NULL;
+
+    if (try_read_zip(name, write_mode, buffer)) {
+        if (write_mode)
+            *tmp_name = "";
+        return COMPR_ARCHIVE;
+    }
+
     for (i = 0; valid_archives[i].program; i++) {
         if ((*tmp_name = try_uncompress_archive(name, write_mode,
                         valid_archives[i].program,
@@ -735,17 +1144,34 @@ static enum compression_type try_uncompress(const char *name,
     }
 
     /* need this order or .tar.gz is misunderstood */
+    if (!write_mode && try_read_gzip(name, buffer))
+        return COMPR_GZIP;
+
+    /* In write mode, the file has to be recompressed when it is closed.  */
     if ((*tmp_name = try_uncompress_with_gzip(name)) != NULL)
         return COMPR_GZIP;
 
+    /* Without zlib or gzip, it can still be read.  */
+    if (write_mode && try_read_gzip(name, buffer)) {
+        zfile_buffer_free(buffer);
+        *tmp_name = "";
+        return COMPR_GZIP;
+    }
+
     if ((*tmp_name = try_uncompress_with_bzip(name)) != NULL)
         return COMPR_BZIP;
 
-    if ((*tmp_name = try_uncompress_zipcode(name, write_mode)) != NULL)
+    if (try_read_zipcode(name, write_mode, buffer)) {
+        if (write_mode)
+            *tmp_name = "";
         return COMPR_ZIPCODE;
+    }
 
-    if ((*tmp_name = try_uncompress_lynx(name, write_mode)) != NULL)
+    if (try_read_lynx(name, write_mode, buffer)) {
+        if (write_mode)
+            *tmp_name = "";
         return COMPR_LYNX;
+    }
 
     if ((*tmp_name = try_uncompress_with_tzx(name)) != NULL)
         return COMPR_TZX;
@@ -975,6 +1401,7 @@ FILE *zfile_fopen(const char *name, const char *mode)
     char *tmp_name;
     FILE *stream;
     enum compression_type type;
+    zfile_buffer_t buffer;
     int write_mode = 0;
 
     if (!zinit_done)
@@ -991,24 +1418,32 @@ FILE *zfile_fopen(const char *name, const char *mode)
     if (write_mode && ioutil_access(name, IOUTIL_ACCESS_W_OK) < 0)
         return NULL;
 
-    type = try_uncompress(name, &tmp_name, write_mode);
+    type = try_uncompress(name, &tmp_name, &buffer, write_mode);
     if (type == COMPR_NONE) {
         stream = fopen(name, mode);
         if (stream == NULL)
             return NULL;
-        zfile_list_add(NULL, name, type, write_mode, stream, NULL);
+        zfile_list_add(NULL, name, type, write_mode, stream, NULL, NULL);
         return stream;
-    } else if (*tmp_name == '\0') {
+    } else if (tmp_name != NULL && *tmp_name == '\0') {
         errno = EACCES;
         return NULL;
     }
 
     /* Open the uncompressed version of the file.  */
-    stream = fopen(tmp_name, mode);
-    if (stream == NULL)
-        return NULL;
+    if (tmp_name == NULL) {
+        stream = zfile_buffer_open(&buffer, &tmp_name);
+        if (stream == NULL) {
+            zfile_buffer_free(&buffer);
+            return NULL;
+        }
+    } else {
+        stream = fopen(tmp_name, mode);
+        if (stream == NULL)
+            return NULL;
+    }
 
-    zfile_list_add(tmp_name, name, type, write_mode, stream, NULL);
+    zfile_list_add(tmp_name, name, type, write_mode, stream, NULL, &buffer);
 
     /* now we don't need the archdep_tmpnam allocation any more */
     lib_free(tmp_name);
@@ -1076,6 +1511,7 @@ static int handle_close(zfile_t *ptr)
         lib_free(ptr->tmp_name);
     if (ptr->request_string)
         lib_free(ptr->request_string);
+    zfile_buffer_free(&ptr->buffer);
 
     lib_free(ptr);
 
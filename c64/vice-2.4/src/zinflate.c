@@ -0,0 +1,435 @@
+/*
+ * zinflate.c - Decoder for deflate compressed data.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* This decodes the deflated entries of zip archives and the contents of
+   gzip files and compressed snapshots without zlib.  Everything is decoded in one go from one
+   buffer into another, so the Huffman codes are decoded with the canonical
+   code counts, one bit at a time, with no tables to set up beyond those.  */
+
+#include "vice.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "types.h"
+#include "zinflate.h"
+
+#define MAXBITS   15    /* Longest code.  */
+#define MAXLCODES 286   /* Literal/length codes.  */
+#define MAXDCODES 30    /* Distance codes.  */
+#define FIXLCODES 288   /* Literal/length codes of the fixed code.  */
+
+typedef struct zinflate_state_s {
+    BYTE *dest;
+    size_t dest_size;
+    size_t dest_pos;
+    const BYTE *src;
+    size_t src_size;
+    size_t src_pos;
+    DWORD bitbuf;
+    int bitcnt;
+    int truncated;      /* Set when `src' ran out.  */
+} zinflate_state_t;
+
+/* A canonical Huffman code: the number of codes of every length and the
+   symbols ordered by code.  */
+typedef struct huffman_s {
+    short count[MAXBITS + 1];
+    short symbol[FIXLCODES];
+} huffman_t;
+
+static const short length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const short length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const short dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const short dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/* Order of the code length code lengths of a dynamic block.  */
+static const short code_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static huffman_t fixed_lencode, fixed_distcode;
+static int fixed_done = 0;
+
+/* ------------------------------------------------------------------------- */
+
+/* Return the next `need' bits, least significant first.  Past the end of
+   `src', zero bits are returned and `truncated' is set.  */
+static int bits(zinflate_state_t *s, int need)
+{
+    DWORD val = s->bitbuf;
+
+    while (s->bitcnt < need) {
+        if (s->src_pos == s->src_size) {
+            s->truncated = 1;
+            return 0;
+        }
+        val |= (DWORD)s->src[s->src_pos++] << s->bitcnt;
+        s->bitcnt += 8;
+    }
+    s->bitbuf = val >> need;
+    s->bitcnt -= need;
+
+    return (int)(val & ((1UL << need) - 1));
+}
+
+/* Set up `h' from the code lengths of `n' symbols.  Return 0 for a complete
+   code, a positive number for an incomplete one and a negative one for an
+   over-subscribed one.  */
+static int construct(huffman_t *h, const short *length, int n)
+{
+    int symbol, len, left;
+    short offs[MAXBITS + 1];
+
+    for (len = 0; len <= MAXBITS; len++) {
+        h->count[len] = 0;
+    }
+    for (symbol = 0; symbol < n; symbol++) {
+        h->count[length[symbol]]++;
+    }
+    if (h->count[0] == n) {
+        return 0;
+    }
+
+    left = 1;
+    for (len = 1; len <= MAXBITS; len++) {
+        left <<= 1;
+        left -= h->count[len];
+        if (left < 0) {
+            return left;
+        }
+    }
+
+    offs[1] = 0;
+    for (len = 1; len < MAXBITS; len++) {
+        offs[len + 1] = offs[len] + h->count[len];
+    }
+    for (symbol = 0; symbol < n; symbol++) {
+        if (length[symbol] != 0) {
+            h->symbol[offs[length[symbol]]++] = (short)symbol;
+        }
+    }
+
+    return left;
+}
+
+/* Decode one symbol with `h', -1 if the bits are no code of it.  */
+static int decode(zinflate_state_t *s, const huffman_t *h)
+{
+    int len, code = 0, first = 0, index = 0, count;
+
+    for (len = 1; len <= MAXBITS; len++) {
+        code |= bits(s, 1);
+        count = h->count[len];
+        if (code - count < first) {
+            return h->symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int stored(zinflate_state_t *s)
+{
+    unsigned int len;
+
+    /* The block starts at the next byte.  */
+    s->bitbuf = 0;
+    s->bitcnt = 0;
+
+    if (s->src_size - s->src_pos < 4) {
+        return -1;
+    }
+    len = s->src[s->src_pos] | (s->src[s->src_pos + 1] << 8);
+    if (s->src[s->src_pos + 2] != (~len & 0xff)
+        || s->src[s->src_pos + 3] != ((~len >> 8) & 0xff)) {
+        return -1;
+    }
+    s->src_pos += 4;
+
+    if (s->src_size - s->src_pos < len || s->dest_size - s->dest_pos < len) {
+        return -1;
+    }
+    memcpy(s->dest + s->dest_pos, s->src + s->src_pos, len);
+    s->dest_pos += len;
+    s->src_pos += len;
+
+    return 0;
+}
+
+static int codes(zinflate_state_t *s, const huffman_t *lencode,
+                 const huffman_t *distcode)
+{
+    int symbol;
+    size_t len, dist;
+    BYTE *from, *to;
+
+    do {
+        symbol = decode(s, lencode);
+        if (s->truncated || symbol < 0) {
+            return -1;
+        }
+        if (symbol < 256) {
+            if (s->dest_pos == s->dest_size) {
+                return -1;
+            }
+            s->dest[s->dest_pos++] = (BYTE)symbol;
+        } else if (symbol > 256) {
+            symbol -= 257;
+            if (symbol >= 29) {
+                return -1;
+            }
+            len = length_base[symbol] + bits(s, length_extra[symbol]);
+
+            symbol = decode(s, distcode);
+            if (symbol < 0 || symbol >= 30) {
+                return -1;
+            }
+            dist = dist_base[symbol] + bits(s, dist_extra[symbol]);
+            if (s->truncated || dist > s->dest_pos
+                || len > s->dest_size - s->dest_pos) {
+                return -1;
+            }
+
+            /* The copy may overlap its own output.  */
+            to = s->dest + s->dest_pos;
+            from = to - dist;
+            s->dest_pos += len;
+            while (len--) {
+                *to++ = *from++;
+            }
+        }
+    } while (symbol != 256);
+
+    return 0;
+}
+
+static int fixed(zinflate_state_t *s)
+{
+    int symbol;
+    short lengths[FIXLCODES];
+
+    if (!fixed_done) {
+        for (symbol = 0; symbol < 144; symbol++) {
+            lengths[symbol] = 8;
+        }
+        for (; symbol < 256; symbol++) {
+            lengths[symbol] = 9;
+        }
+        for (; symbol < 280; symbol++) {
+            lengths[symbol] = 7;
+        }
+        for (; symbol < FIXLCODES; symbol++) {
+            lengths[symbol] = 8;
+        }
+        construct(&fixed_lencode, lengths, FIXLCODES);
+
+        for (symbol = 0; symbol < MAXDCODES; symbol++) {
+            lengths[symbol] = 5;
+        }
+        construct(&fixed_distcode, lengths, MAXDCODES);
+
+        fixed_done = 1;
+    }
+
+    return codes(s, &fixed_lencode, &fixed_distcode);
+}
+
+static int dynamic(zinflate_state_t *s)
+{
+    int nlen, ndist, ncode;
+    int index, symbol, len, err;
+    short lengths[MAXLCODES + MAXDCODES];
+    huffman_t lencode, distcode;
+
+    nlen = bits(s, 5) + 257;
+    ndist = bits(s, 5) + 1;
+    ncode = bits(s, 4) + 4;
+    if (nlen > MAXLCODES || ndist > MAXDCODES) {
+        return -1;
+    }
+
+    for (index = 0; index < ncode; index++) {
+        lengths[code_order[index]] = (short)bits(s, 3);
+    }
+    for (; index < 19; index++) {
+        lengths[code_order[index]] = 0;
+    }
+    if (s->truncated || construct(&lencode, lengths, 19) != 0) {
+        return -1;
+    }
+
+    index = 0;
+    while (index < nlen + ndist) {
+        symbol = decode(s, &lencode);
+        if (s->truncated || symbol < 0) {
+            return -1;
+        }
+        if (symbol < 16) {
+            lengths[index++] = (short)symbol;
+        } else {
+            len = 0;
+            if (symbol == 16) {
+                if (index == 0) {
+                    return -1;
+                }
+                len = lengths[index - 1];
+                symbol = 3 + bits(s, 2);
+            } else if (symbol == 17) {
+                symbol = 3 + bits(s, 3);
+            } else {
+                symbol = 11 + bits(s, 7);
+            }
+            if (index + symbol > nlen + ndist) {
+                return -1;
+            }
+            while (symbol--) {
+                lengths[index++] = (short)len;
+            }
+        }
+    }
+
+    /* There has to be an end of block code.  */
+    if (lengths[256] == 0) {
+        return -1;
+    }
+
+    /* Incomplete codes are only allowed for a single length code.  */
+    err = construct(&lencode, lengths, nlen);
+    if (err && (err < 0 || nlen != lencode.count[0] + lencode.count[1])) {
+        return -1;
+    }
+    err = construct(&distcode, lengths + nlen, ndist);
+    if (err && (err < 0 || ndist != distcode.count[0] + distcode.count[1])) {
+        return -1;
+    }
+
+    return codes(s, &lencode, &distcode);
+}
+
+/* ------------------------------------------------------------------------- */
+
+int zinflate(BYTE *dest, size_t dest_size, size_t *dest_used,
+             const BYTE *src, size_t src_size, size_t *src_used)
+{
+    zinflate_state_t s;
+    int last, type, err;
+
+    s.dest = dest;
+    s.dest_size = dest_size;
+    s.dest_pos = 0;
+    s.src = src;
+    s.src_size = src_size;
+    s.src_pos = 0;
+    s.bitbuf = 0;
+    s.bitcnt = 0;
+    s.truncated = 0;
+
+    do {
+        last = bits(&s, 1);
+        type = bits(&s, 2);
+        if (s.truncated) {
+            return -1;
+        }
+        switch (type) {
+          case 0:
+            err = stored(&s);
+            break;
+          case 1:
+            err = fixed(&s);
+            break;
+          case 2:
+            err = dynamic(&s);
+            break;
+          default:
+            err = -1;
+        }
+        if (err < 0) {
+            return -1;
+        }
+    } while (!last);
+
+    if (dest_used != NULL) {
+        *dest_used = s.dest_pos;
+    }
+    if (src_used != NULL) {
+        *src_used = s.src_pos;
+    }
+    return 0;
+}
+
+size_t zinflate_gzip_offset(const BYTE *src, size_t size)
+{
+    size_t pos = 10;
+    BYTE flags;
+
+    /* Header and trailer, with the deflate method.  */
+    if (size < 18 || src[0] != 0x1f || src[1] != 0x8b || src[2] != 8)
+        return 0;
+
+    flags = src[3];
+    size -= 8;
+
+    if (flags & 4) {
+        /* Extra field.  */
+        if (size - pos < 2)
+            return 0;
+        pos += 2 + (src[pos] | (src[pos + 1] << 8));
+    }
+    if (flags & 8) {
+        /* Original file name.  */
+        while (pos < size && src[pos] != 0)
+            pos++;
+        pos++;
+    }
+    if (flags & 16) {
+        /* Comment.  */
+        while (pos < size && src[pos] != 0)
+            pos++;
+        pos++;
+    }
+    if (flags & 2) {
+        /* Header CRC.  */
+        pos += 2;
+    }
+
+    return (pos < size) ? pos : 0;
+}
@@ -0,0 +1,44 @@
+/*
+ * zinflate.h - Decoder for deflate compressed data.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_ZINFLATE_H
+#define VICE_ZINFLATE_H
+
+#include <stddef.h>
+
+#include "types.h"
+
+/* Decode the raw deflate stream (RFC 1951) in `src' into `dest'.  The
+   number of bytes written and of bytes of `src' used are returned in
+   `dest_used' and `src_used'.  Return 0 on success, -1 if the stream is
+   invalid, truncated or does not fit into `dest'.  */
+extern int zinflate(BYTE *dest, size_t dest_size, size_t *dest_used,
+                    const BYTE *src, size_t src_size, size_t *src_used);
+
+/* Return the offset of the deflate stream in the `size' bytes of gzip file
+   at `src', or 0 if the header is not valid.  The stream is followed by
+   the CRC32 and the size of the uncompressed data, 4 bytes each, little
+   endian.  Files with more than one member are not handled.  */
+extern size_t zinflate_gzip_offset(const BYTE *src, size_t size);
+
+#endif
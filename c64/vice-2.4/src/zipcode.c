@@ -27,6 +27,7 @@
 #include "vice.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #include "types.h"
 #include "zipcode.h"
@@ -95,3 +96,121 @@ int zipcode_read_sector(FILE *zip_fd, int track, int *sector, char *buf)
     return 0;
 }
 
+
+/* Same as `zipcode_read_sector()', on the file in memory at `data' of `size'
+   bytes, from the offset in `pos'.  Sectors that do not fit into 256 bytes
+   are refused.  */
+static int zipcode_unpack_sector(const BYTE *data, size_t size, size_t *pos,
+                                 int track, int *sector, BYTE *buf)
+{
+    BYTE trk, len, rep, chra;
+    unsigned int i, j, count, repnum;
+    size_t p = *pos;
+
+    if (size - p < 2) {
+        return -1;
+    }
+    trk = data[p++];
+    *sector = data[p++];
+
+    if ((trk & 0x3f) != track) {
+        return -1;
+    }
+
+    if (trk & 0x80) {
+        if (size - p < 2) {
+            return -2;
+        }
+        len = data[p++];
+        rep = data[p++];
+
+        count = 0;
+        for (i = 0; i < len; i++) {
+            if (p == size) {
+                return -3;
+            }
+            chra = data[p++];
+            if (chra != rep) {
+                if (count == 256) {
+                    return -3;
+                }
+                buf[count++] = chra;
+                continue;
+            }
+
+            if (size - p < 2) {
+                return 1;
+            }
+            repnum = data[p++];
+            chra = data[p++];
+            i += 2;
+            if (count + repnum > 256) {
+                return -3;
+            }
+            for (j = 0; j < repnum; j++) {
+                buf[count++] = chra;
+            }
+        }
+    } else if (trk & 0x40) {
+        if (p == size) {
+            return -4;
+        }
+        memset(buf, data[p++], 256);
+    } else {
+        if (size - p < 256) {
+            return -5;
+        }
+        memcpy(buf, data + p, 256);
+        p += 256;
+    }
+
+    *pos = p;
+    return 0;
+}
+
+int zipcode_to_d64(const BYTE *part[4], const size_t part_size[4],
+                   BYTE *image)
+{
+    int track, count, sector, sectors, num;
+    unsigned int offset = 0;
+    DWORD seen;
+    size_t pos = 0;
+    const BYTE *data = NULL;
+    size_t size = 0;
+    BYTE buf[256];
+
+    for (track = 1; track <= 35; track++) {
+        switch (track) {
+          case 1:
+          case 9:
+          case 17:
+          case 26:
+            /* The first part has a 4 byte header, the others 2 bytes.  */
+            num = (track == 1) ? 0 : (track == 9) ? 1 : (track == 17) ? 2 : 3;
+            data = part[num];
+            size = part_size[num];
+            pos = (track == 1) ? 4 : 2;
+            if (size < pos) {
+                return -1;
+            }
+            break;
+        }
+
+        sectors = (track <= 17) ? 21 : (track <= 24) ? 19
+                  : (track <= 30) ? 18 : 17;
+        /* Every sector of the track comes once, in any order.  */
+        seen = 0;
+        for (count = 0; count < sectors; count++) {
+            if (zipcode_unpack_sector(data, size, &pos, track, &sector,
+                                      buf) != 0
+                || sector >= sectors || (seen & (1 << sector))) {
+                return -1;
+            }
+            seen |= 1 << sector;
+            memcpy(image + offset + sector * 256, buf, 256);
+        }
+        offset += sectors * 256;
+    }
+
+    return 0;
+}
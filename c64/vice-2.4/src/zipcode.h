@@ -27,9 +27,18 @@
 #ifndef VICE_ZIPCODE_H
 #define VICE_ZIPCODE_H
 
+#include <stddef.h>
 #include <stdio.h>
 
+#include "types.h"
+
 extern int zipcode_read_sector(FILE *zip_fd, int track, int *sector, char *buf);
 
+/* Unpack the four files of a zipcoded disk, in memory at `part[0]' to
+   `part[3]', into the D64 image of `D64_FILE_SIZE_35' bytes at `image'.
+   Return 0 on success, -1 if they are no valid zipcode.  */
+extern int zipcode_to_d64(const BYTE *part[4], const size_t part_size[4],
+                          BYTE *image);
+
 #endif /* _ZIPCODE_H */
 
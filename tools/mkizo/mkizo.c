@@ -21,6 +21,8 @@ FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
 DEALINGS IN THE SOFTWARE.
 */
 
+#define _GNU_SOURCE // copy_file_range
+
 #include <assert.h>
 #include <unistd.h>
 #include <errno.h>
@@ -37,6 +39,7 @@ DEALINGS IN THE SOFTWARE.
 #include <sys/stat.h>
 #include <fcntl.h>    // O_RDONLY
 #include <ftw.h>
+#include <pthread.h>
 
 #include "iso9660.h"
 #include "ziphdr.h"
@@ -45,6 +48,8 @@ FILE *fpizo = NULL;
 const char *sourcepath = NULL;
 int verbose = 0; // -v bumps verbosity (only LOG and VERBOSE for now)
 int force = 0;   // -f unlinks an existing file
+int timing = 0;  // -t reports how long the file data took
+int nthreads = 0; // -j threads for the file data, default one per cpu
 
 #define MAX_FILES 256
 
@@ -343,6 +348,19 @@ ISODir * mkisodir(const char *dirname, const char *basename)
     return d;
 }
 
+// copy of r with a one byte id; it keeps the record_len of r, so make sure
+// all of that is allocated and zeroed
+DirectoryRecord *copydirrecord(const DirectoryRecord *r, char id)
+{
+    size_t len = MAX(r->record_len, sizeof(DirectoryRecord) + 1);
+    DirectoryRecord *d = (DirectoryRecord *) malloc(len);
+    memset(d, 0, len);
+    memcpy(d, r, sizeof(DirectoryRecord));
+    d->id_len = 1;
+    d->id[0] = id;
+    return d;
+}
+
 size_t dirsize(const ISODir *d)
 {
     size_t dirsize = 0;
@@ -373,23 +391,38 @@ int openmapfile(const char *fn, void **outptr, struct stat *outstat)
     return fd;
 }
 
+// The file data is crc'ed and copied by a pool of threads once all the
+// sectors have been allocated (see copy_files).
+typedef struct FileJob {
+    const char *localfn;
+    int fd;
+    size_t filesize;
+    int data_sector;
+    int is_bootloader;
+    ZipCentralDirFileHeader *chdr;
+    ZipLocalFileHeader *lhdr;
+    size_t lhdrlen;
+    int result;
+} FileJob;
+
+FileJob jobs[MAX_FILES];
+size_t njobs = 0;
+
 int mkfile(const char *localfn, const char *isodirname, const char *isofn)
 {
     ISODir *parent = find_isodir(isodirname);
 
-    char *contents = NULL;
-
     struct stat st;
-    int fd = openmapfile(localfn, (void **) &contents, &st);
+    STAT(localfn, &st);
+
+    int fd = open(localfn, O_RDONLY);
     if (fd < 0) {
+        perror(localfn);
         return -1;    
     }
 
     const size_t filesize = st.st_size;
 
-    // combine the crc and copy
-    uint32_t zipcrc = crc32(contents, filesize);
-
     int ziphdr_sector = alloc_sectors(sectors(filesize) + 1);
     int data_sector = (filesize == 0) ? ziphdr_sector : (ziphdr_sector + 1);
 
@@ -401,33 +434,24 @@ int mkfile(const char *localfn, const char *isodirname, const char *isofn)
         strcpy(fullfn, isofn);
     }
 
+    FileJob *job = &jobs[njobs++];
+    assert(njobs < MAX_FILES);
+    memset(job, 0, sizeof(*job));
+
+    job->localfn = strdup(localfn);
+    job->fd = fd;
+    job->filesize = filesize;
+    job->data_sector = data_sector;
+
     // check if this is the bootloader
     if (bootfn && strcmp(fullfn, bootfn) == 0) {
         bootloader_sector = data_sector;
-
-        // fixup the boot image with the -boot-info-table
-
-        uint32_t *bootinfotbl = (uint32_t *) &contents[8];
-        bootinfotbl[0] = 16; // pvd_sector;
-        bootinfotbl[1] = bootloader_sector;
-        bootinfotbl[2] = filesize;
-        bootinfotbl[3] = checksum32(&contents[64], filesize - 64);
-        memset(&bootinfotbl[4], 0, 40);
-    }
-
-    if (filesize > 0) {
-        FWRITEAT(fpizo, data_sector * SECTOR_SIZE, contents, filesize);
+        job->is_bootloader = 1;
     }
 
-    munmap((void *) contents, filesize);
-    close(fd);
-
     size_t id_len = strlen(isofn) + 2; // include space for ';1'
 
-    DirectoryRecord *r = (DirectoryRecord *) malloc(sizeof(DirectoryRecord) + id_len);
-
     int rlen=sizeof(DirectoryRecord) + id_len;
-    memset(r, 0, rlen);
 
     // 6.8.1.1: "Each subsequent Directory Record recorded in that Logical
     // Sector shall begin at the byte immediately following the last byte
@@ -439,6 +463,10 @@ int mkfile(const char *localfn, const char *isodirname, const char *isofn)
         rlen += bytes_left_in_sector;
     }
 
+    // the padding is part of the record, so it must be allocated and zeroed
+    DirectoryRecord *r = (DirectoryRecord *) malloc(rlen);
+    memset(r, 0, rlen);
+
     r->record_len = rlen;
 
     SET32_LSBMSB(*r, data_sector, data_sector);
@@ -467,7 +495,7 @@ int mkfile(const char *localfn, const char *isodirname, const char *isofn)
     memset(chdr, 0, chdrlen);
 
     size_t lhdrlen = sizeof(ZipLocalFileHeader) + id_len;
-    ZipLocalFileHeader * lhdr = (ZipLocalFileHeader *) alloca(lhdrlen);
+    ZipLocalFileHeader * lhdr = (ZipLocalFileHeader *) malloc(lhdrlen + 1);
     memset(lhdr, 0, lhdrlen);
 
     chdr->signature = 0x02014b50;
@@ -477,7 +505,6 @@ int mkfile(const char *localfn, const char *isodirname, const char *isofn)
 
     chdr->datetime = lhdr->datetime = MSDOSDateTime(st.st_mtime);
 
-    chdr->crc32 = lhdr->crc32 = zipcrc;
     chdr->comp_size = chdr->uncomp_size = 
         lhdr->comp_size = lhdr->uncomp_size = filesize;
     chdr->filename_len = lhdr->filename_len = id_len;
@@ -486,8 +513,10 @@ int mkfile(const char *localfn, const char *isodirname, const char *isofn)
     strcpy(chdr->filename, fullfn);
     strcpy(lhdr->filename, fullfn);
 
-    // write zip local header
-    FWRITEAT(fpizo, chdr->local_header_ofs, lhdr, lhdrlen);
+    // the zip local header is written once its crc is known
+    job->chdr = chdr;
+    job->lhdr = lhdr;
+    job->lhdrlen = lhdrlen;
 
     // save off central dir header for later
     ziphdrs[nzipfiles++] = chdr;
@@ -497,6 +526,152 @@ int mkfile(const char *localfn, const char *isodirname, const char *isofn)
     return 0;
 }
 
+// copy len bytes, which are also mapped at data, from infd to outfd at pos
+static int copyat(int outfd, off_t pos, int infd, const u8 *data, size_t len)
+{
+    off_t inpos = 0;
+    size_t done = 0;
+
+    while (done < len) {
+        ssize_t n;
+
+        if (infd >= 0) {
+            n = copy_file_range(infd, &inpos, outfd, &pos, len - done, 0);
+            if (n <= 0) {
+                // not possible between these files, write from the mapping
+                infd = -1;
+                continue;
+            }
+        } else {
+            n = pwrite(outfd, data + done, len - done, pos);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            pos += n;
+        }
+        done += n;
+    }
+
+    return 0;
+}
+
+int copy_file(FileJob *job)
+{
+    const size_t filesize = job->filesize;
+
+    if (filesize == 0) {
+        close(job->fd);
+        return 0;
+    }
+
+    // allow private writes for the boot-info-table
+    int prot = job->is_bootloader ? PROT_READ|PROT_WRITE : PROT_READ;
+    u8 *contents = mmap(NULL, filesize, prot, MAP_PRIVATE, job->fd, 0);
+    if (contents == MAP_FAILED) {
+        perror(job->localfn);
+        close(job->fd);
+        return -1;
+    }
+
+    uint32_t zipcrc = crc32(contents, filesize);
+    job->chdr->crc32 = job->lhdr->crc32 = zipcrc;
+
+    int infd = job->fd;
+    if (job->is_bootloader) {
+        // fixup the boot image with the -boot-info-table
+
+        uint32_t *bootinfotbl = (uint32_t *) &contents[8];
+        bootinfotbl[0] = 16; // pvd_sector;
+        bootinfotbl[1] = bootloader_sector;
+        bootinfotbl[2] = filesize;
+        bootinfotbl[3] = checksum32(&contents[64], filesize - 64);
+        memset(&bootinfotbl[4], 0, 40);
+
+        infd = -1; // the patched data is only in the mapping
+    }
+
+    int r = copyat(fileno(fpizo), (off_t) job->data_sector * SECTOR_SIZE,
+                   infd, contents, filesize);
+    if (r < 0) {
+        perror(job->localfn);
+    }
+
+    munmap((void *) contents, filesize);
+    close(job->fd);
+    return r;
+}
+
+static size_t next_job = 0;
+
+static void *copy_files_thread(void *arg)
+{
+    size_t i;
+    while ((i = __sync_fetch_and_add(&next_job, 1)) < njobs) {
+        jobs[i].result = copy_file(&jobs[i]);
+    }
+    return NULL;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// crc and copy the data of all files to their sectors, then write their zip
+// local headers in the order the files were found
+int copy_files(void)
+{
+    int n = nthreads;
+    if (n <= 0) {
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    n = MAX(1, MIN(n, (int) njobs));
+
+    double start = now();
+
+    fflush(fpizo);
+
+    pthread_t threads[n];
+    int i;
+    for (i=0; i < n; ++i) {
+        if (pthread_create(&threads[i], NULL, copy_files_thread, NULL) != 0) {
+            break;
+        }
+    }
+    if (i == 0) {
+        copy_files_thread(NULL);
+    }
+    while (i-- > 0) {
+        pthread_join(threads[i], NULL);
+    }
+
+    size_t j, total = 0;
+    for (j=0; j < njobs; ++j) {
+        if (jobs[j].result < 0) {
+            return -1;
+        }
+        total += jobs[j].filesize;
+    }
+
+    for (j=0; j < njobs; ++j) {
+        FWRITEAT(fpizo, jobs[j].chdr->local_header_ofs, jobs[j].lhdr, jobs[j].lhdrlen);
+        free(jobs[j].lhdr);
+    }
+
+    if (timing) {
+        double secs = now() - start;
+        LOG("%zu files, %.1f MB in %.3f s with %d threads: %.1f MB/s",
+            njobs, total / (double) MB, secs, n, total / (double) MB / secs);
+    }
+
+    return 0;
+}
+
 int ftw_mkfile_helper(const char *fpath, const struct stat *sb, int typeflag)
 {
     char *parentdirname = NULL;
@@ -573,16 +748,13 @@ int finalize_dir(ISODir *d)
     pathtablesize += ptelen;
 
     // copy that record as our 'self'
-    d->records[0] = newdirrecord(".");
-    memcpy(d->records[0], d->realrecord, sizeof(DirectoryRecord));
-    d->records[0]->id_len = 1;
-    d->records[0]->id[0] = 0x00; // replace '.'
+    d->records[0] = copydirrecord(d->realrecord, 0x00);
 
     // copy the parent (..) 'self' entry
     assert(d->parent->records[0]->data_sector > 0); // must be allocated already
-    memcpy(d->records[1], d->parent->records[0], sizeof(DirectoryRecord));
-    assert(d->records[1]->id_len == 1);
-    assert(d->records[1]->id[0] == 0x01);
+    assert(d->parent->records[0]->id_len == 1);
+    free(d->records[1]);
+    d->records[1] = copydirrecord(d->parent->records[0], 0x01);
 
     // descend into child directories, allocate and write them first
 
@@ -713,7 +885,7 @@ fill_pvd(PrimaryVolumeDescriptor *pvd)
 }
 
 void usage_and_exit(const char *binname) {
-    fprintf(stderr, "Usage: %s [-v] [-f] [-c <commentfn>] [-b <bootsectorfn>] -o <output-izo-name> <path-to-walk>\n", 
+    fprintf(stderr, "Usage: %s [-v] [-f] [-t] [-j <threads>] [-c <commentfn>] [-b <bootsectorfn>] -o <output-izo-name> <path-to-walk>\n", 
             binname);
     exit(EXIT_FAILURE);
 }
@@ -759,7 +931,7 @@ int main(int argc, char **argv)
 
     int opt;
 
-    while ((opt = getopt(argc, argv, "fc:o:b:v")) != -1) {
+    while ((opt = getopt(argc, argv, "fc:o:b:vtj:")) != -1) {
         switch (opt) {
         case 'b':         // file containing bootloader
             bootfn = strdup(optarg);
@@ -776,6 +948,12 @@ int main(int argc, char **argv)
         case 'v':
             verbose++;
             break;
+        case 't':         // report the time taken by the file data
+            timing = 1;
+            break;
+        case 'j':         // threads for the file data
+            nthreads = atoi(optarg);
+            break;
         default:
             usage_and_exit(argv[0]);
             break;
@@ -824,10 +1002,14 @@ int main(int argc, char **argv)
         exit(-1);
     }
 
+    if (copy_files() < 0) {
+        exit(-1);
+    }
+
     finalize_dir(&root);
 
     u8 boot_record[SECTOR_SIZE]; 
-    u8 boot_catalog[SECTOR_SIZE];
+    u8 boot_catalog[SECTOR_SIZE] = { 0 }; // unused entries must not be stack garbage
 
     el_torito(boot_record, boot_catalog, boot_catalog_sector);
     FWRITEAT(fpizo, boot_catalog_sector * SECTOR_SIZE, boot_catalog, SECTOR_SIZE);
@@ -1,9 +1,8 @@
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
-uint32_t crc32(const uint8_t *buf, size_t bufLen)
-{
-    static const unsigned long crcTable[256] = {
+static const uint32_t crcTable[256] = {
    0x00000000,0x77073096,0xEE0E612C,0x990951BA,0x076DC419,0x706AF48F,0xE963A535,
    0x9E6495A3,0x0EDB8832,0x79DCB8A4,0xE0D5E91E,0x97D2D988,0x09B64C2B,0x7EB17CBD,
    0xE7B82D07,0x90BF1D91,0x1DB71064,0x6AB020F2,0xF3B97148,0x84BE41DE,0x1ADAD47D,
@@ -41,11 +40,48 @@ uint32_t crc32(const uint8_t *buf, size_t bufLen)
    0x47B2CF7F,0x30B5FFE9,0xBDBDF21C,0xCABAC28A,0x53B39330,0x24B4A3A6,0xBAD03605,
    0xCDD70693,0x54DE5729,0x23D967BF,0xB3667A2E,0xC4614AB8,0x5D681B02,0x2A6F2B94,
    0xB40BBE37,0xC30C8EA1,0x5A05DF1B,0x2D02EF8D };
+
+// crcSlices[k][b] is the crc of byte b followed by k zero bytes, which lets
+// crc32() fold in 8 bytes per step ("slice-by-8")
+static uint32_t crcSlices[8][256];
+
+__attribute__ ((constructor))
+static void crc32_init(void)
+{
+    int i, k;
+
+    for (i=0; i < 256; i++) {
+        crcSlices[0][i] = crcTable[i];
+    }
+    for (k=1; k < 8; k++) {
+        for (i=0; i < 256; i++) {
+            uint32_t c = crcSlices[k-1][i];
+            crcSlices[k][i] = (c >> 8) ^ crcTable[c & 0xFF];
+        }
+    }
+}
+
+uint32_t crc32(const uint8_t *buf, size_t bufLen)
+{
     uint32_t crc32;
     size_t i;
 
     /** accumulate crc32 for buffer **/
     crc32 = 0xFFFFFFFF;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; bufLen >= 8; buf += 8, bufLen -= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, buf, 4);
+        memcpy(&hi, buf + 4, 4);
+        lo ^= crc32;
+        crc32 = crcSlices[7][lo & 0xFF] ^ crcSlices[6][(lo >> 8) & 0xFF]
+              ^ crcSlices[5][(lo >> 16) & 0xFF] ^ crcSlices[4][lo >> 24]
+              ^ crcSlices[3][hi & 0xFF] ^ crcSlices[2][(hi >> 8) & 0xFF]
+              ^ crcSlices[1][(hi >> 16) & 0xFF] ^ crcSlices[0][hi >> 24];
+    }
+#endif
+
     for (i=0; i < bufLen; i++) {
         crc32 = (crc32 >> 8) ^ crcTable[ (crc32 ^ buf[i]) & 0xFF ];
     }
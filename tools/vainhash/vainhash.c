@@ -9,16 +9,45 @@
 #include <unistd.h> // read
 #include <fcntl.h> // O_RDWR
 #include <getopt.h>
-#include <signal.h>
+#include <pthread.h>
 
 #include "sha1.h"
 
+// number of candidates hashed at once, one per SIMD lane
+#ifdef __AVX2__
+#define LANES 8
+#else
+#define LANES 4
+#endif
+
+typedef uint32_t vec __attribute__ ((vector_size (LANES * sizeof(uint32_t))));
+
+#define JUNK_SIZE 12
+
+// Everything before the last one or two 64-byte blocks is hashed once up
+// front; the search only runs these tail blocks, with the junk at junkofs.
+static vec midstate_lanes[5];
+static unsigned char tail[128 + 16];
+static vec tailwords[32];
+static size_t tailblocks;
+static size_t junkofs;
+
+// wanted prefix of the first two words of the hash
+static uint32_t wanted[2];
+static uint32_t wantedmask[2];
+
+static pthread_mutex_t found_lock = PTHREAD_MUTEX_INITIALIZER;
 static volatile int done = 0;
+static char found_junk[JUNK_SIZE];
+static int found_worker;
 
-static void SIGCHLD_handler(int signum)
+typedef struct
 {
-    ++done;
-}
+    pthread_t thread;
+    int num;
+    uint64_t junkval;
+    volatile unsigned long long num_tried;
+} worker_t;
 
 static void hex_print(const unsigned char *output, size_t n)
 {
@@ -30,6 +59,143 @@ static void hex_print(const unsigned char *output, size_t n)
     fprintf(stderr, "\n");
 }
 
+static void make_junk(char *junk, uint64_t j)
+{
+    int i;
+    for (i=0; i < 10; ++i) {
+        junk[i] = " ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_$#!+"[j & 0x3F];
+        j >>= 6;
+    }
+    junk[10] = '\n';
+    junk[11] = '\n';
+}
+
+static inline uint32_t get_be32(const unsigned char *b)
+{
+    return ((uint32_t) b[0] << 24) | ((uint32_t) b[1] << 16)
+         | ((uint32_t) b[2] << 8) | (uint32_t) b[3];
+}
+
+static inline vec rol(vec x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+// sha1_process() on LANES blocks at once; W is clobbered
+static inline void sha1_process_lanes(vec state[5], vec W[16])
+{
+    vec A = state[0], B = state[1], C = state[2], D = state[3], E = state[4];
+    vec f, k, temp;
+    int t;
+
+#pragma GCC unroll 80
+    for (t=0; t < 80; ++t) {
+        if (t >= 16) {
+            W[t & 15] = rol(W[(t - 3) & 15] ^ W[(t - 8) & 15]
+                          ^ W[(t - 14) & 15] ^ W[t & 15], 1);
+        }
+        if (t < 20) {
+            f = D ^ (B & (C ^ D));
+            k = (vec) { 0 } + 0x5A827999;
+        } else if (t < 40) {
+            f = B ^ C ^ D;
+            k = (vec) { 0 } + 0x6ED9EBA1;
+        } else if (t < 60) {
+            f = (B & C) | (D & (B | C));
+            k = (vec) { 0 } + 0x8F1BBCDC;
+        } else {
+            f = B ^ C ^ D;
+            k = (vec) { 0 } + 0xCA62C1D6;
+        }
+        temp = rol(A, 5) + f + E + k + W[t & 15];
+        E = D;
+        D = C;
+        C = rol(B, 30);
+        B = A;
+        A = temp;
+    }
+
+    state[0] += A;
+    state[1] += B;
+    state[2] += C;
+    state[3] += D;
+    state[4] += E;
+}
+
+// hash the tail with junk for junkval .. junkval+LANES-1; return the lane
+// whose hash has the wanted prefix, or -1
+static int try_junk(uint64_t junkval)
+{
+    const size_t first = junkofs / 4, last = (junkofs + JUNK_SIZE - 1) / 4;
+    vec junkwords[4];
+    vec state[5], W[16];
+    size_t b, i;
+    int l;
+
+    // only the (up to 4) words overlapping the junk differ between lanes
+    for (l=0; l < LANES; ++l) {
+        unsigned char words[16];
+        memcpy(words, &tail[first * 4], sizeof(words));
+        make_junk((char *) &words[junkofs - first * 4], junkval + l);
+        for (i=first; i <= last; ++i) {
+            junkwords[i - first][l] = get_be32(&words[(i - first) * 4]);
+        }
+    }
+
+    memcpy(state, midstate_lanes, sizeof(state));
+
+    for (b=0; b < tailblocks; ++b) {
+        for (i=0; i < 16; ++i) {
+            size_t t = b * 16 + i;
+            W[i] = (t >= first && t <= last) ? junkwords[t - first] : tailwords[t];
+        }
+        sha1_process_lanes(state, W);
+    }
+
+    vec miss = ((state[0] ^ wanted[0]) & wantedmask[0])
+             | ((state[1] ^ wanted[1]) & wantedmask[1]);
+
+    for (l=0; l < LANES; ++l) {
+        if (miss[l] == 0) {
+            return l;
+        }
+    }
+    return -1;
+}
+
+static void *search(void *arg)
+{
+    worker_t *wk = (worker_t *) arg;
+    uint64_t junkval = wk->junkval;
+
+    while (! done) {
+        int l = try_junk(junkval);
+        if (l >= 0) {
+            pthread_mutex_lock(&found_lock);
+            if (! done) {
+                make_junk(found_junk, junkval + l);
+                found_worker = wk->num;
+                done = 1;
+            }
+            pthread_mutex_unlock(&found_lock);
+            break;
+        }
+
+        junkval += LANES;
+        wk->num_tried += LANES;
+    }
+
+    return NULL;
+}
+
+static double elapsed_since(const struct timeval *tv_start)
+{
+    struct timeval tv_now;
+    gettimeofday(&tv_now, NULL);
+    return (tv_now.tv_sec - tv_start->tv_sec)
+         + (tv_now.tv_usec - tv_start->tv_usec) / 1e6;
+}
+
 int
 main(int argc, char *const argv[])
 {
@@ -73,6 +239,10 @@ main(int argc, char *const argv[])
         };
     };
 
+    if (num_workers < 1) {
+        num_workers = 1;
+    }
+
     const char *fn = argv[optind];
 
     struct stat st;
@@ -90,8 +260,7 @@ main(int argc, char *const argv[])
     sha1_context *ctx = (sha1_context *) malloc(sizeof(sha1_context));
     sha1_starts(ctx);
 
-    uint64_t junkval = 0;
-    char junk[12];
+    char junk[JUNK_SIZE];
 
     size_t bytes_left = st.st_size - sizeof(junk);
     while (bytes_left > 0)
@@ -100,7 +269,7 @@ main(int argc, char *const argv[])
         size_t maxreadsize = MIN(4096, bytes_left);
         ssize_t r = read(fd, buf, maxreadsize);
         if (r <= 0) {
-//            fprintf(stderr, "read %u/%u bytes (%u bytes_left)", 
+//            fprintf(stderr, "read %u/%u bytes (%u bytes_left)",
             perror("read()");
             exit(EXIT_FAILURE);
         }
@@ -135,25 +304,31 @@ main(int argc, char *const argv[])
     fprintf(stderr, "original SHA1 of %s: ", fn);
     hex_print(hash, 20);
 
-    // child exit indicates success.  parent then rebroadcasts to all workers.
-    signal(SIGCHLD, SIGCHLD_handler);
+    // precompute the midstate and lay out the tail: the bytes left over in
+    // the context, the junk, the padding and the length in bits
+    uint64_t bitlen = (uint64_t) st.st_size * 8;
+    size_t left = humblectx->total[0] & 0x3F;
+    int i;
+
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, humblectx->buffer, left);
+    junkofs = left;
+    tail[left + JUNK_SIZE] = 0x80;
+    tailblocks = (left + JUNK_SIZE + 1 + 8 + 63) / 64;
+    for (i=0; i < 8; ++i) {
+        tail[tailblocks * 64 - 1 - i] = bitlen >> (i * 8);
+    }
 
-    // spawn additional workers
-    pid_t children[1024] = { 0 };
-    int w;
-    for (w=1; w < num_workers; ++w) 
-    {
-        pid_t child = fork();
-        if (child < 0) {
-            perror("fork");
-            break;
-            // don't need to exit, just let the existing thread(s) work
-        } else if (child == 0) { // worker #w
-            break;
-        } else { // parent
-            children[w-1] = child;
-            // continue spawning, then fall through to do our own work
-        }
+    for (i=0; i < 5; ++i) {
+        midstate_lanes[i] = (vec) { 0 } + humblectx->state[i];
+    }
+    for (i=0; i < tailblocks * 16; ++i) {
+        tailwords[i] = (vec) { 0 } + get_be32(&tail[i * 4]);
+    }
+
+    for (i=0; i < vanitysize; ++i) {
+        wanted[i / 4] |= (uint32_t) (unsigned char) vanityvalue[i] << (24 - (i % 4) * 8);
+        wantedmask[i / 4] |= (uint32_t) 0xFF << (24 - (i % 4) * 8);
     }
 
     // save start time
@@ -161,81 +336,66 @@ main(int argc, char *const argv[])
     gettimeofday(&tv_start, NULL);
 
     // pre-populate junk (so restarted runs don't re-do the same junk)
-    junkval = (tv_start.tv_sec << 32) | tv_start.tv_usec;
-
-    // give each worker its own 56-bit segment of the space.
-    junkval &= 0x00FFFFFFFFFFFFFFULL;
-    junkval |= ((uint64_t) w) << 56;
-
-    unsigned long long num_tried = 0;
+    uint64_t junkval = (tv_start.tv_sec << 32) | tv_start.tv_usec;
 
-    while (! done) {
-        // restore state
-        memcpy(ctx, humblectx, sizeof(sha1_context));
+    worker_t *workers = (worker_t *) calloc(num_workers, sizeof(worker_t));
+    int w;
+    for (w=0; w < num_workers; ++w)
+    {
+        // give each worker its own 56-bit segment of the space.
+        workers[w].num = w + 1;
+        workers[w].junkval = (junkval & 0x00FFFFFFFFFFFFFFULL)
+                           | ((uint64_t) workers[w].num << 56);
 
-        uint64_t j = junkval;
-        for (int i=0; i < 10; ++i) {
-            junk[i] = " ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_$#!+"[j & 0x3F];
-            j >>= 6;
+        if (pthread_create(&workers[w].thread, NULL, search, &workers[w]) != 0) {
+            perror("pthread_create");
+            break;
+            // don't need to exit, just let the existing thread(s) work
         }
-        junk[10] = '\n';
-        junk[11] = '\n';
-
-        // try some junk
-        sha1_update(ctx, (const unsigned char *) &junk, sizeof(junk));
-        sha1_finish(ctx, hash);
-
-        // if the hash begins with the vanity bytes, update the file and quit
-        if (memcmp(hash, &vanityvalue, vanitysize) == 0) {
-            fprintf(stderr, "\n[worker %d] writing junk for vanity hash: ", w);
-            hex_print((const unsigned char *) &junk, sizeof(junk));
-
-            fprintf(stderr, "\nfinal hash: ");
-            hex_print(hash, 20);
+    }
+    num_workers = w;
+    if (num_workers == 0) {
+        exit(EXIT_FAILURE);
+    }
 
-            if (lseek(fd, -sizeof(junk), SEEK_END) < 0) {
-                perror("lseek");
-                exit(EXIT_FAILURE);
-            }
+    while (! done) {
+        usleep(1000000);
 
-            if (write(fd, &junk, sizeof(junk)) < sizeof(junk)) {
-                perror("junk write");
-                exit(EXIT_FAILURE);
-            }
+        double secs = elapsed_since(&tv_start);
+        unsigned long long total = 0;
 
-            break;
+        for (w=0; w < num_workers; ++w) {
+            unsigned long long n = workers[w].num_tried;
+            fprintf(stderr, "[worker %d] %.1fM/s ", workers[w].num, n / secs / 1e6);
+            total += n;
         }
+        fprintf(stderr, "total %llu in %ds; %.1fM/s\r", total, (int) secs, total / secs / 1e6);
+    }
 
-        ++num_tried;
-        ++junkval;
-
-        // trying to stagger worker status updates
-        if ((junkval & 0x00fffff) == (w << 19)) {
-            struct timeval tv_now;
-            gettimeofday(&tv_now, NULL);
+    for (w=0; w < num_workers; ++w) {
+        pthread_join(workers[w].thread, NULL);
+    }
 
-            int elapsed_secs = tv_now.tv_sec - tv_start.tv_sec;
-            int elapsed_usecs = tv_now.tv_usec - tv_start.tv_usec;
-            if (elapsed_usecs < 0) {
-                elapsed_secs -= 1;
-                elapsed_usecs += 1000000;
-            }
+    // double-check with the plain implementation
+    memcpy(ctx, humblectx, sizeof(sha1_context));
+    sha1_update(ctx, (const unsigned char *) found_junk, sizeof(found_junk));
+    sha1_finish(ctx, hash);
+    assert(memcmp(hash, &vanityvalue, vanitysize) == 0);
 
-            // assume other workers are getting as many done as we are
-            unsigned int rate = 0;
+    fprintf(stderr, "\n[worker %d] writing junk for vanity hash: ", found_worker);
+    hex_print((const unsigned char *) found_junk, sizeof(found_junk));
 
-            if (elapsed_secs > 0) {
-                rate = num_tried * num_workers / elapsed_secs;
-            }
+    fprintf(stderr, "\nfinal hash: ");
+    hex_print(hash, 20);
 
-            fprintf(stderr, "[worker %d] %llu in %ds; %u/s\r", w, num_tried, elapsed_secs, rate);
-        }
-    } // end while
+    if (lseek(fd, -sizeof(found_junk), SEEK_END) < 0) {
+        perror("lseek");
+        exit(EXIT_FAILURE);
+    }
 
-    if (w == num_workers) { // if we're the parent
-        for (w=0; w < num_workers-1; ++w) {
-            kill(children[w], SIGCHLD);
-        }
+    if (write(fd, found_junk, sizeof(found_junk)) < sizeof(found_junk)) {
+        perror("junk write");
+        exit(EXIT_FAILURE);
     }
 
     close(fd);
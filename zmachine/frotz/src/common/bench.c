@@ -0,0 +1,189 @@
+/* bench.c - Instruction counts and timing for benchmark builds
+ *
+ * This file is part of Frotz.
+ *
+ * Frotz is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Frotz is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+/* Only compiled into FROTZ_BENCH builds, see "make bench". */
+
+#include <stdlib.h>
+#include <time.h>
+#include "frotz.h"
+
+/* Executed instructions, indexed by the BENCH_* opcode numbers in
+   frotz.h. An extended instruction is counted once, under its own
+   number; the EXT prefix (0xbe) has no count of its own. */
+
+unsigned long bench_opcodes[BENCH_OPCODES];
+
+/* Lookups in the decoded string cache (text.c): misses, hits. */
+
+unsigned long bench_strings[2];
+
+/* Calls made by the front end to change the screen, and the number of
+   times the terminal was brought up to date (curses only). */
+
+unsigned long bench_screen_calls;
+unsigned long bench_screens;
+
+static const char *opcode_names[BENCH_OPCODES] = {
+    /* 2OP */
+    "2OP:illegal", "je", "jl", "jg", "dec_chk", "inc_chk", "jin", "test",
+    "or", "and", "test_attr", "set_attr", "clear_attr", "store",
+    "insert_obj", "loadw", "loadb", "get_prop", "get_prop_addr",
+    "get_next_prop", "add", "sub", "mul", "div", "mod", "call_2s",
+    "call_2n", "set_colour", "throw", "2OP:illegal", "2OP:illegal",
+    "2OP:illegal",
+    /* 1OP */
+    "jz", "get_sibling", "get_child", "get_parent", "get_prop_len", "inc",
+    "dec", "print_addr", "call_1s", "remove_obj", "print_obj", "ret",
+    "jump", "print_paddr", "load", "call_1n",
+    /* 0OP */
+    "rtrue", "rfalse", "print", "print_ret", "nop", "save", "restore",
+    "restart", "ret_popped", "catch", "quit", "new_line", "show_status",
+    "verify", "extended", "piracy",
+    /* VAR */
+    "call_vs", "storew", "storeb", "put_prop", "read", "print_char",
+    "print_num", "random", "push", "pull", "split_window", "set_window",
+    "call_vs2", "erase_window", "erase_line", "set_cursor", "get_cursor",
+    "set_text_style", "buffer_mode", "output_stream", "input_stream",
+    "sound_effect", "read_char", "scan_table", "not", "call_vn",
+    "call_vn2", "tokenise", "encode_text", "copy_table", "print_table",
+    "check_arg_count",
+    /* EXT */
+    "save_ext", "restore_ext", "log_shift", "art_shift", "set_font",
+    "draw_picture", "picture_data", "erase_picture", "set_margins",
+    "save_undo", "restore_undo", "print_unicode", "check_unicode",
+    "EXT:illegal", "EXT:illegal", "EXT:illegal", "move_window",
+    "window_size", "window_style", "get_wind_prop", "scroll_window",
+    "pop_stack", "read_mouse", "mouse_window", "push_stack",
+    "put_wind_prop", "print_form", "make_menu", "picture_table",
+    "EXT:reserved", "EXT:reserved", "EXT:reserved"
+};
+
+static clock_t start_time;
+static clock_t turn_time;
+static clock_t slowest_turn;
+static long turns;
+
+static void bench_report (void);
+
+/*
+ * bench_start
+ *
+ * Start the clock and have the report printed when the program exits,
+ * whichever way that happens.
+ *
+ */
+
+void bench_start (void)
+{
+
+    start_time = turn_time = clock ();
+
+    atexit (bench_report);
+
+}/* bench_start */
+
+/*
+ * bench_turn
+ *
+ * Called whenever the game asks for input, and once more at exit.
+ * Charges the time since the previous input to the turn that just ended.
+ *
+ */
+
+void bench_turn (void)
+{
+    clock_t now = clock ();
+
+    if (now - turn_time > slowest_turn)
+	slowest_turn = now - turn_time;
+
+    turn_time = now;
+    turns++;
+
+}/* bench_turn */
+
+static int compare_counts (const void *a, const void *b)
+{
+    unsigned long x = bench_opcodes[*(const int *) a];
+    unsigned long y = bench_opcodes[*(const int *) b];
+
+    if (x != y)
+	return (x < y) ? 1 : -1;
+
+    return *(const int *) a - *(const int *) b;
+
+}/* compare_counts */
+
+/*
+ * bench_report
+ *
+ * Print the instruction count, speed, time per turn and a histogram of
+ * the opcodes executed to stderr, so that stdout still only holds what
+ * the game printed.
+ *
+ */
+
+static void bench_report (void)
+{
+    int order[BENCH_OPCODES];
+    unsigned long total = 0;
+    double seconds;
+    int n = 0;
+    int i;
+
+    bench_turn ();			/* the stretch since the last input */
+
+    seconds = (double) (turn_time - start_time) / CLOCKS_PER_SEC;
+
+    for (i = 0; i < BENCH_OPCODES; i++)
+	if (bench_opcodes[i] != 0) {
+	    total += bench_opcodes[i];
+	    order[n++] = i;
+	}
+
+    qsort (order, n, sizeof (int), compare_counts);
+
+    fflush (stdout);
+
+    fprintf (stderr, "bench: %lu instructions in %.3f s", total, seconds);
+    if (seconds > 0)
+	fprintf (stderr, ", %.0f opcodes/sec", total / seconds);
+    fputc ('\n', stderr);
+
+    fprintf (stderr, "bench: %ld turns, %.3f ms per turn, slowest %.3f ms\n",
+	turns, 1000 * seconds / turns, 1000.0 * slowest_turn / CLOCKS_PER_SEC);
+
+    fprintf (stderr, "bench: %lu strings from the decoded string cache, %lu decoded",
+	bench_strings[1], bench_strings[0]);
+    if (bench_strings[0] + bench_strings[1] != 0)
+	fprintf (stderr, ", %.1f%% hits",
+	    100.0 * bench_strings[1] / (bench_strings[0] + bench_strings[1]));
+    fputc ('\n', stderr);
+
+    if (bench_screens != 0)
+	fprintf (stderr, "bench: %lu screens, %lu screen calls, %.1f per screen\n",
+	    bench_screens, bench_screen_calls,
+	    (double) bench_screen_calls / bench_screens);
+
+    for (i = 0; i < n; i++)
+	fprintf (stderr, "bench: %12lu %6.2f%%  %s\n",
+	    bench_opcodes[order[i]], 100.0 * bench_opcodes[order[i]] / total,
+	    opcode_names[order[i]]);
+
+}/* bench_report */
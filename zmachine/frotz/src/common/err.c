@@ -28,7 +28,7 @@
 
 /* int err_report_mode = ERR_DEFAULT_REPORT_MODE; */
 
-static int error_count[ERR_NUM_ERRORS];
+static SESSION_LOCAL int error_count[ERR_NUM_ERRORS];
 
 static char *err_messages[] = {
     "Text buffer overflow",
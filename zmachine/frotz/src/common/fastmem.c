@@ -49,6 +49,13 @@
 
 #endif
 
+#ifdef USE_MMAP
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 extern void seed_random (int);
 extern void restart_screen (void);
 extern void refresh_text_style (void);
@@ -65,24 +72,33 @@ extern zword restore_quetzal (FILE *, FILE *);
 
 extern void erase_window (zword);
 
-extern void (*op0_opcodes[]) (void);
-extern void (*op1_opcodes[]) (void);
+extern SESSION_LOCAL void (*op0_opcodes[]) (void);
+extern SESSION_LOCAL void (*op1_opcodes[]) (void);
 extern void (*op2_opcodes[]) (void);
 extern void (*var_opcodes[]) (void);
 
 /* char save_name[MAX_FILE_NAME + 1] = DEFAULT_SAVE_NAME; */
-char auxilary_name[MAX_FILE_NAME + 1] = DEFAULT_AUXILARY_NAME;
+SESSION_LOCAL char auxilary_name[MAX_FILE_NAME + 1] = DEFAULT_AUXILARY_NAME;
+
+SESSION_LOCAL zbyte far *zmp = NULL;
+SESSION_LOCAL zbyte far *pcp = NULL;
 
-zbyte far *zmp = NULL;
-zbyte far *pcp = NULL;
+static SESSION_LOCAL FILE *story_fp = NULL;
 
-static FILE *story_fp = NULL;
+SESSION_LOCAL long story_start = 0;		/* offset of the story in story_fp */
+
+#ifdef USE_MMAP
+static SESSION_LOCAL zbyte *story_map = NULL;	/* mapping that holds zmp, if any */
+static SESSION_LOCAL size_t story_map_size;
+#endif
 
 /*
  * Data for the undo mechanism.
  * This undo mechanism is based on the scheme used in Evin Robertson's
  * Nitfol interpreter.
  * Undo blocks are stored as differences between states.
+ * They live one after the other in a ring allocated once by init_undo,
+ * the oldest blocks being dropped when a new one needs their space.
  */
 
 typedef struct undo_struct undo_t;
@@ -97,10 +113,23 @@ struct undo_struct {
     /* undo diff and stack data follow */
 };
 
-static undo_t *first_undo = NULL, *last_undo = NULL, *curr_undo = NULL;
-static zbyte *undo_mem = NULL, *prev_zmp, *undo_diff;
+static SESSION_LOCAL undo_t *first_undo = NULL, *last_undo = NULL, *curr_undo = NULL;
+static SESSION_LOCAL zbyte *undo_mem = NULL, *prev_zmp, *undo_diff;
+static SESSION_LOCAL zbyte far *undo_ring = NULL;
+static SESSION_LOCAL long undo_ring_size = 0;
 
-static int undo_count = 0;
+/* Room set aside in the ring for each undo slot, on top of the largest
+   possible block.  A turn usually changes far less than this.  */
+#define UNDO_SLOT_SIZE 1024
+
+#define UNDO_ALIGN \
+    (sizeof (long) > sizeof (void *) ? sizeof (long) : sizeof (void *))
+
+#define undo_block_size(diff_size, stack_size) \
+    ((sizeof (undo_t) + (diff_size) + (stack_size) * sizeof (zword) \
+      + UNDO_ALIGN - 1) / UNDO_ALIGN * UNDO_ALIGN)
+
+static SESSION_LOCAL int undo_count = 0;
 
 /*
  * get_header_extension
@@ -202,6 +231,53 @@ void restart_header (void)
 
 }/* restart_header */
 
+#ifdef USE_MMAP
+
+/*
+ * map_story
+ *
+ * Map the story file into memory instead of reading it in. The mapping
+ * is private, so the pages of dynamic memory are copied as soon as the
+ * game writes to them, while static and high memory are read from the
+ * file only when they are first used. Return false if the story can't
+ * be mapped; it is then loaded the usual way.
+ *
+ */
+
+static bool map_story (void)
+{
+    struct stat st;
+    long page, offset;
+    void *p;
+
+    if (fstat (fileno (story_fp), &st) != 0)
+	return FALSE;
+    if (story_start + story_size > (long) st.st_size)
+	return FALSE;
+
+    if ((page = sysconf (_SC_PAGESIZE)) <= 0)
+	return FALSE;
+
+    offset = story_start - story_start % page;
+    story_map_size = story_size + (story_start - offset);
+
+    p = mmap (NULL, story_map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+	      fileno (story_fp), (off_t) offset);
+
+    if (p == MAP_FAILED)
+	return FALSE;
+
+    story_map = p;
+
+    free (zmp);
+    zmp = story_map + (story_start - offset);
+
+    return TRUE;
+
+}/* map_story */
+
+#endif
+
 /*
  * init_memory
  *
@@ -257,6 +333,10 @@ void init_memory (void)
     if ((story_fp = os_load_story()) == NULL)
         os_fatal ("Cannot open story file");
 
+    /* Blorb files hold the story in a chunk further on */
+
+    story_start = ftell (story_fp);
+
     /* Allocate memory for story header */
 
     if ((zmp = (zbyte far *) malloc (64)) == NULL)
@@ -328,8 +408,8 @@ void init_memory (void)
     } else {		/* some old games lack the file size entry */
 
 	fseek (story_fp, 0, SEEK_END);
-	story_size = ftell (story_fp);
-	fseek (story_fp, 64, SEEK_SET);
+	story_size = ftell (story_fp) - story_start;
+	fseek (story_fp, story_start + 64, SEEK_SET);
 
     }
 
@@ -355,6 +435,10 @@ void init_memory (void)
 	op1_opcodes[0x0f] = z_call_n;
     }
 
+#ifdef USE_MMAP
+    if (!map_story ()) {
+#endif
+
     /* Allocate memory for story data */
 
     if ((zmp = (zbyte far *) realloc (zmp, story_size)) == NULL)
@@ -376,6 +460,10 @@ void init_memory (void)
 
     }
 
+#ifdef USE_MMAP
+    }
+#endif
+
     /* Read header extension table */
 
     hx_table_size = get_header_extension (HX_TABLE_SIZE);
@@ -406,6 +494,25 @@ void init_undo (void)
     /* Allocate h_dynamic_size bytes for previous dynamic zmp state
        + 1.5 h_dynamic_size for Quetzal diff + 2. */
     undo_mem = malloc ((h_dynamic_size * 5) / 2 + 2);
+
+    /* The ring holds at least one block of the largest possible size,
+       plus some room for each of the other slots. */
+    if (undo_mem != NULL && f_setup.undo_slots > 0) {
+	long largest = undo_block_size ((h_dynamic_size * 3L) / 2 + 2,
+					STACK_SIZE);
+
+	undo_ring_size = largest + (long) f_setup.undo_slots * UNDO_SLOT_SIZE;
+	undo_ring = malloc (undo_ring_size);
+	if (undo_ring == NULL) {
+	    undo_ring_size = largest;
+	    undo_ring = malloc (undo_ring_size);
+	}
+	if (undo_ring == NULL) {
+	    free (undo_mem);
+	    undo_mem = NULL;
+	}
+    }
+
     if (undo_mem != NULL) {
 	prev_zmp = undo_mem;
 	undo_diff = undo_mem + h_dynamic_size;
@@ -427,16 +534,12 @@ void init_undo (void)
 
 static void free_undo (int count)
 {
-    undo_t *p;
-
     if (count > undo_count)
 	count = undo_count;
     while (count--) {
-	p = first_undo;
 	if (curr_undo == first_undo)
 	    curr_undo = curr_undo->next;
 	first_undo = first_undo->next;
-	free (p);
 	undo_count--;
     }
     if (first_undo)
@@ -445,6 +548,41 @@ static void free_undo (int count)
 	last_undo = NULL;
 }/* free_undo */
 
+/*
+ * alloc_undo
+ *
+ * Find room for an undo block of the given size in the ring, right
+ * after the newest block, freeing the oldest blocks that are in the way.
+ *
+ */
+
+static undo_t *alloc_undo (long size)
+{
+    long offset = 0;
+
+    if (last_undo != NULL) {
+	offset = (zbyte far *) last_undo - undo_ring
+	    + undo_block_size (last_undo->diff_size, last_undo->stack_size);
+	if (offset + size > undo_ring_size) {
+	    /* Wrap around.  The blocks between the newest one and the end
+	       of the ring are older than those at its start, so drop them
+	       first. */
+	    while (first_undo != NULL
+		   && (zbyte far *) first_undo - undo_ring >= offset)
+		free_undo (1);
+	    offset = 0;
+	}
+    }
+
+    while (first_undo != NULL
+	   && (zbyte far *) first_undo >= undo_ring + offset
+	   && (zbyte far *) first_undo - undo_ring < offset + size)
+	free_undo (1);
+
+    return (undo_t *) (undo_ring + offset);
+
+}/* alloc_undo */
+
 /*
  * reset_memory
  *
@@ -462,10 +600,20 @@ void reset_memory (void)
 	free_undo (undo_count);
 	free (undo_mem);
     }
+    if (undo_ring)
+	free (undo_ring);
 
     undo_mem = NULL;
+    undo_ring = NULL;
+    undo_ring_size = 0;
     undo_count = 0;
 
+#ifdef USE_MMAP
+    if (story_map) {
+	munmap (story_map, story_map_size);
+	story_map = NULL;
+    } else
+#endif
     if (zmp)
 	free (zmp);
     zmp = NULL;
@@ -481,8 +629,13 @@ void reset_memory (void)
 void storeb (zword addr, zbyte value)
 {
 
-    if (addr >= h_dynamic_size)
+    if (addr >= h_dynamic_size) {
 	runtime_error (ERR_STORE_RANGE);
+	return;
+    }
+
+    if (addr >= dictionary_low && addr < dictionary_high)
+	forget_dictionaries ();
 
     if (addr == H_FLAGS + 1) {	/* flags register is modified */
 
@@ -529,7 +682,7 @@ void storew (zword addr, zword value)
 
 void z_restart (void)
 {
-    static bool first_restart = TRUE;
+    static SESSION_LOCAL bool first_restart = TRUE;
 
     flush_buffer ();
 
@@ -539,11 +692,13 @@ void z_restart (void)
 
     if (!first_restart) {
 
-	fseek (story_fp, 0, SEEK_SET);
+	fseek (story_fp, story_start, SEEK_SET);
 
 	if (fread (zmp, 1, h_dynamic_size, story_fp) != h_dynamic_size)
 	    os_fatal ("Story file read error");
 
+	forget_dictionaries ();
+
     } else first_restart = FALSE;
 
     restart_header ();
@@ -642,6 +797,9 @@ void z_restore (void)
 
 	success = fread (zmp + zargs[0], 1, zargs[1], gfp);
 
+	forget_dictionaries ();
+	forget_decoded (zargs[0], zargs[1]);
+
 	/* Close auxilary file */
 
 	fclose (gfp);
@@ -697,7 +855,7 @@ void z_restore (void)
 		    stack[i] |= fgetc (gfp);
 		}
 
-		fseek (story_fp, 0, SEEK_SET);
+		fseek (story_fp, story_start, SEEK_SET);
 
 		for (addr = 0; addr < h_dynamic_size; addr++) {
 		    int skip = fgetc (gfp);
@@ -740,6 +898,8 @@ void z_restore (void)
 		/* Reload cached header fields. */
 		restart_header ();
 
+		forget_dictionaries ();
+
 		/*
 		 * Since QUETZAL files may be saved on many different machines,
 		 * the screen sizes may vary a lot. Erasing the status window
@@ -763,6 +923,33 @@ finished:
 
 }/* z_restore */
 
+/*
+ * mem_same
+ *
+ * Return the number of equal bytes at the start of a and b, comparing
+ * two machine words at a time as long as they match.
+ *
+ */
+
+static unsigned mem_same (const zbyte *a, const zbyte *b, unsigned size)
+{
+    unsigned long wa[2], wb[2];
+    unsigned n = 0;
+
+    while (size - n >= sizeof (wa)) {
+	memcpy (wa, a + n, sizeof (wa));
+	memcpy (wb, b + n, sizeof (wb));
+	if (((wa[0] ^ wb[0]) | (wa[1] ^ wb[1])) != 0)
+	    break;
+	n += sizeof (wa);
+    }
+    while (n < size && a[n] == b[n])
+	n++;
+
+    return n;
+
+}/* mem_same */
+
 /*
  * mem_diff
  *
@@ -782,9 +969,12 @@ static long mem_diff (zbyte *a, zbyte *b, zword mem_size, zbyte *diff)
     zbyte c;
 
     for (;;) {
-	for (j = 0; size > 0 && (c = *a++ ^ *b++) == 0; j++)
-	    size--;
+	j = mem_same (a, b, size);
+	a += j;
+	b += j;
+	size -= j;
 	if (size == 0) break;
+	c = *a++ ^ *b++;
 	size--;
 	if (j > 0x8000) {
 	    *p++ = 0;
@@ -853,7 +1043,7 @@ static void mem_undiff (zbyte *diff, long diff_length, zbyte *dest)
 
 int restore_undo (void)
 {
-    long pc = curr_undo->pc;
+    long pc;
 
     if (f_setup.undo_slots == 0)	/* undo feature unavailable */
 
@@ -865,6 +1055,7 @@ int restore_undo (void)
 
     /* undo possible */
 
+    pc = curr_undo->pc;
     memcpy (zmp, prev_zmp, h_dynamic_size);
     SET_PC (pc);
     sp = stack + STACK_SIZE - curr_undo->stack_size;
@@ -878,6 +1069,8 @@ int restore_undo (void)
 
     restart_header ();
 
+    forget_dictionaries ();
+
     return 2;
 
 }/* restore_undo */
@@ -986,7 +1179,7 @@ void z_save (void)
 		fputc ((int) lo (stack[i]), gfp);
 	    }
 
-	    fseek (story_fp, 0, SEEK_SET);
+	    fseek (story_fp, story_start, SEEK_SET);
 
 	    for (addr = 0, skip = 0; addr < h_dynamic_size; addr++)
 		if (zmp[addr] != fgetc (story_fp) || skip == 255 || addr + 1 == h_dynamic_size) {
@@ -1038,9 +1231,7 @@ int save_undo (void)
     /* save undo possible */
 
     while (last_undo != curr_undo) {
-	p = last_undo;
 	last_undo = last_undo->prev;
-	free (p);
 	undo_count--;
     }
     if (last_undo)
@@ -1053,13 +1244,7 @@ int save_undo (void)
 
     diff_size = mem_diff (zmp, prev_zmp, h_dynamic_size, undo_diff);
     stack_size = stack + STACK_SIZE - sp;
-    do {
-	p = malloc (sizeof (undo_t) + diff_size + stack_size * sizeof (*sp));
-	if (p == NULL)
-	    free_undo (1);
-    } while (!p && undo_count);
-    if (p == NULL)
-	return -1;
+    p = alloc_undo (undo_block_size (diff_size, stack_size));
     pc = p->pc;
     GET_PC (pc);	/* Turbo C doesn't like seeing p->pc here */
     p->pc = pc;
@@ -1107,15 +1292,29 @@ void z_save_undo (void)
 
 void z_verify (void)
 {
+    static SESSION_LOCAL zbyte buffer[0x1000];
     zword checksum = 0;
+    unsigned n, j;
     long i;
 
-    /* Sum all bytes in story file except header bytes */
+    /* Sum all bytes in story file except header bytes. They are read
+       from the file a block at a time rather than taken from memory,
+       which holds the game's changes and may not be loaded yet. */
 
-    fseek (story_fp, 64, SEEK_SET);
+    fseek (story_fp, story_start + 64, SEEK_SET);
 
-    for (i = 64; i < story_size; i++)
-	checksum += fgetc (story_fp);
+    for (i = 64; i < story_size; i += n) {
+
+	n = (story_size - i < (long) sizeof (buffer))
+	    ? (unsigned) (story_size - i) : sizeof (buffer);
+
+	if (fread (buffer, 1, n, story_fp) != n)
+	    break;
+
+	for (j = 0; j < n; j++)
+	    checksum += buffer[j];
+
+    }
 
     /* Branch if the checksums are equal */
 
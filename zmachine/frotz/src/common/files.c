@@ -41,11 +41,11 @@ extern bool read_yes_or_no (const char *);
 extern char latin1_to_ibm[];
 #endif
 
-static int script_width = 0;
+static SESSION_LOCAL int script_width = 0;
 
-static FILE *sfp = NULL;
-static FILE *rfp = NULL;
-static FILE *pfp = NULL;
+static SESSION_LOCAL FILE *sfp = NULL;
+static SESSION_LOCAL FILE *rfp = NULL;
+static SESSION_LOCAL FILE *pfp = NULL;
 
 /*
  * script_open
@@ -63,7 +63,7 @@ static FILE *pfp = NULL;
 
 void script_open (void)
 {
-    static bool script_valid = FALSE;
+    static SESSION_LOCAL bool script_valid = FALSE;
 
     char new_name[MAX_FILE_NAME + 1];
 
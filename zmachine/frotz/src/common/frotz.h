@@ -88,6 +88,18 @@ typedef struct {
     zword true_back;
 } Zwindow;
 
+/*** Sessions ***/
+
+/* With FROTZ_SESSIONS every thread runs a game of its own: all the
+   state of the interpreter and of the dumb interface is kept per thread
+   (see dumb/dumb_sessions.c). */
+
+#ifdef FROTZ_SESSIONS
+#define SESSION_LOCAL	__thread
+#else
+#define SESSION_LOCAL
+#endif
+
 
 #include "setup.h"
 
@@ -314,19 +326,23 @@ typedef struct {
 
 /*** Data access macros ***/
 
-#define SET_BYTE(addr,v)  { zmp[addr] = v; }
+/* Writes above dynamic memory drop any cached instructions there */
+#define FORGET_DECODED(addr,n) \
+	{ if ((long) (addr) + (n) > h_dynamic_size) forget_decoded ((long) (addr), n); }
+
+#define SET_BYTE(addr,v)  { zmp[addr] = v; FORGET_DECODED (addr, 1) }
 #define LOW_BYTE(addr,v)  { v = zmp[addr]; }
 #define CODE_BYTE(v)	  { v = *pcp++;    }
 
 #if defined (AMIGA)
 
-extern zbyte *pcp;
-extern zbyte *zmp;
+extern SESSION_LOCAL zbyte *pcp;
+extern SESSION_LOCAL zbyte *zmp;
 
 #define lo(v)	((zbyte *)&v)[1]
 #define hi(v)	((zbyte *)&v)[0]
 
-#define SET_WORD(addr,v)  { zmp[addr] = hi(v); zmp[addr+1] = lo(v); }
+#define SET_WORD(addr,v)  { zmp[addr] = hi(v); zmp[addr+1] = lo(v); FORGET_DECODED (addr, 2) }
 #define LOW_WORD(addr,v)  { hi(v) = zmp[addr]; lo(v) = zmp[addr+1]; }
 #define HIGH_WORD(addr,v) { hi(v) = zmp[addr]; lo(v) = zmp[addr+1]; }
 #define CODE_WORD(v)      { hi(v) = *pcp++; lo(v) = *pcp++; }
@@ -336,8 +352,8 @@ extern zbyte *zmp;
 #endif
 
 #if defined (MSDOS_16BIT)
-extern zbyte *pcp;
-extern zbyte *zmp;
+extern SESSION_LOCAL zbyte *pcp;
+extern SESSION_LOCAL zbyte *zmp;
 
 #define lo(v)   ((zbyte *)&v)[0]
 #define hi(v)   ((zbyte *)&v)[1]
@@ -411,13 +427,13 @@ extern zbyte *zmp;
 
 #if !defined (AMIGA) && !defined (MSDOS_16BIT)
 
-extern zbyte *pcp;
-extern zbyte *zmp;
+extern SESSION_LOCAL zbyte *pcp;
+extern SESSION_LOCAL zbyte *zmp;
 
 #define lo(v)	(v & 0xff)
 #define hi(v)	(v >> 8)
 
-#define SET_WORD(addr,v)  { zmp[addr] = hi(v); zmp[addr+1] = lo(v); }
+#define SET_WORD(addr,v)  { zmp[addr] = hi(v); zmp[addr+1] = lo(v); FORGET_DECODED (addr, 2) }
 #define LOW_WORD(addr,v)  { v = ((zword) zmp[addr] << 8) | zmp[addr+1]; }
 #define HIGH_WORD(addr,v) { v = ((zword) zmp[addr] << 8) | zmp[addr+1]; }
 #define CODE_WORD(v)      { v = ((zword) pcp[0] << 8) | pcp[1]; pcp += 2; }
@@ -428,85 +444,86 @@ extern zbyte *zmp;
 
 
 /*** Story file header data ***/
-extern zbyte h_version;
-extern zbyte h_config;
-extern zword h_release;
-extern zword h_resident_size;
-extern zword h_start_pc;
-extern zword h_dictionary;
-extern zword h_objects;
-extern zword h_globals;
-extern zword h_dynamic_size;
-extern zword h_flags;
-extern zbyte h_serial[6];
-extern zword h_abbreviations;
-extern zword h_file_size;
-extern zword h_checksum;
-extern zbyte h_interpreter_number;
-extern zbyte h_interpreter_version;
-extern zbyte h_screen_rows;
-extern zbyte h_screen_cols;
-extern zword h_screen_width;
-extern zword h_screen_height;
-extern zbyte h_font_height;
-extern zbyte h_font_width;
-extern zword h_functions_offset;
-extern zword h_strings_offset;
-extern zbyte h_default_background;
-extern zbyte h_default_foreground;
-extern zword h_terminating_keys;
-extern zword h_line_width;
-extern zbyte h_standard_high;
-extern zbyte h_standard_low;
-extern zword h_alphabet;
-extern zword h_extension_table;
-extern zbyte h_user_name[8];
-
-extern zword hx_table_size;
-extern zword hx_mouse_x;
-extern zword hx_mouse_y;
-extern zword hx_unicode_table;
-extern zword hx_flags;
-extern zword hx_fore_colour;
-extern zword hx_back_colour;
+extern SESSION_LOCAL zbyte h_version;
+extern SESSION_LOCAL zbyte h_config;
+extern SESSION_LOCAL zword h_release;
+extern SESSION_LOCAL zword h_resident_size;
+extern SESSION_LOCAL zword h_start_pc;
+extern SESSION_LOCAL zword h_dictionary;
+extern SESSION_LOCAL zword h_objects;
+extern SESSION_LOCAL zword h_globals;
+extern SESSION_LOCAL zword h_dynamic_size;
+extern SESSION_LOCAL zword h_flags;
+extern SESSION_LOCAL zbyte h_serial[6];
+extern SESSION_LOCAL zword h_abbreviations;
+extern SESSION_LOCAL zword h_file_size;
+extern SESSION_LOCAL zword h_checksum;
+extern SESSION_LOCAL zbyte h_interpreter_number;
+extern SESSION_LOCAL zbyte h_interpreter_version;
+extern SESSION_LOCAL zbyte h_screen_rows;
+extern SESSION_LOCAL zbyte h_screen_cols;
+extern SESSION_LOCAL zword h_screen_width;
+extern SESSION_LOCAL zword h_screen_height;
+extern SESSION_LOCAL zbyte h_font_height;
+extern SESSION_LOCAL zbyte h_font_width;
+extern SESSION_LOCAL zword h_functions_offset;
+extern SESSION_LOCAL zword h_strings_offset;
+extern SESSION_LOCAL zbyte h_default_background;
+extern SESSION_LOCAL zbyte h_default_foreground;
+extern SESSION_LOCAL zword h_terminating_keys;
+extern SESSION_LOCAL zword h_line_width;
+extern SESSION_LOCAL zbyte h_standard_high;
+extern SESSION_LOCAL zbyte h_standard_low;
+extern SESSION_LOCAL zword h_alphabet;
+extern SESSION_LOCAL zword h_extension_table;
+extern SESSION_LOCAL zbyte h_user_name[8];
+
+extern SESSION_LOCAL zword hx_table_size;
+extern SESSION_LOCAL zword hx_mouse_x;
+extern SESSION_LOCAL zword hx_mouse_y;
+extern SESSION_LOCAL zword hx_unicode_table;
+extern SESSION_LOCAL zword hx_flags;
+extern SESSION_LOCAL zword hx_fore_colour;
+extern SESSION_LOCAL zword hx_back_colour;
 
 /*** Various data ***/
 
-extern enum story story_id;
-extern long story_size;
+extern SESSION_LOCAL enum story story_id;
+extern SESSION_LOCAL long story_size;
+extern SESSION_LOCAL long story_start;
 
-extern zword stack[STACK_SIZE];
-extern zword *sp;
-extern zword *fp;
-extern zword frame_count;
+extern SESSION_LOCAL zword stack[STACK_SIZE];
+extern SESSION_LOCAL zword *sp;
+extern SESSION_LOCAL zword *fp;
+extern SESSION_LOCAL zword frame_count;
 
-extern zword zargs[8];
-extern int zargc;
+extern SESSION_LOCAL zword zargs[8];
+extern SESSION_LOCAL int zargc;
 
-extern bool ostream_screen;
-extern bool ostream_script;
-extern bool ostream_memory;
-extern bool ostream_record;
-extern bool istream_replay;
-extern bool message;
+extern SESSION_LOCAL bool ostream_screen;
+extern SESSION_LOCAL bool ostream_script;
+extern SESSION_LOCAL bool ostream_memory;
+extern SESSION_LOCAL bool ostream_record;
+extern SESSION_LOCAL bool istream_replay;
+extern SESSION_LOCAL bool message;
 
-extern int cwin;
-extern int mwin;
+extern SESSION_LOCAL int cwin;
+extern SESSION_LOCAL int mwin;
 
-extern int mouse_x;
-extern int mouse_y;
-extern int menu_selected;
-extern int mouse_button;
+extern SESSION_LOCAL int mouse_x;
+extern SESSION_LOCAL int mouse_y;
+extern SESSION_LOCAL int menu_selected;
+extern SESSION_LOCAL int mouse_button;
 
-extern bool enable_wrapping;
-extern bool enable_scripting;
-extern bool enable_scrolling;
-extern bool enable_buffering;
+extern SESSION_LOCAL bool enable_wrapping;
+extern SESSION_LOCAL bool enable_scripting;
+extern SESSION_LOCAL bool enable_scrolling;
+extern SESSION_LOCAL bool enable_buffering;
 
 
-extern char *option_zcode_path;	/* dg */
+extern SESSION_LOCAL char *option_zcode_path;	/* dg */
 
-extern long reserve_mem;
+extern SESSION_LOCAL long reserve_mem;
 
 
 /*** Z-machine opcodes ***/
@@ -694,6 +711,12 @@ void   init_sound (void);
 zchar	translate_from_zscii (zbyte);
 zbyte	translate_to_zscii (zchar);
 
+extern SESSION_LOCAL zword dictionary_low;		/* dynamic memory covered by */
+extern SESSION_LOCAL zword dictionary_high;		/* indexed dictionaries (text.c) */
+
+void	forget_dictionaries (void);
+void	forget_decoded (long, long);
+
 void 	flush_buffer (void);
 void	new_line (void);
 void	print_char (zchar);
@@ -716,6 +739,50 @@ void	storew (zword, zword);
 Zwindow * curwinrec( void);
 
 
+/*** Benchmark counters (bench.c) ***/
+
+/* Opcode numbers for the histogram: 2OP, 1OP, 0OP, VAR and EXT opcodes
+   each start at their own base. */
+
+#define BENCH_2OP	0x00
+#define BENCH_1OP	0x20
+#define BENCH_0OP	0x30
+#define BENCH_VAR	0x40
+#define BENCH_EXT	0x60
+#define BENCH_OPCODES	0x80
+
+#ifdef FROTZ_BENCH
+extern unsigned long bench_opcodes[BENCH_OPCODES];
+extern unsigned long bench_strings[2];
+extern unsigned long bench_screen_calls;
+extern unsigned long bench_screens;
+
+void	bench_start (void);
+void	bench_turn (void);
+
+#define BENCH_OPCODE(n)	(bench_opcodes[n]++)
+#define BENCH_STRING(hit) (bench_strings[(hit) ? 1 : 0]++)
+#define BENCH_SCREEN_CALL() (bench_screen_calls++)
+#define BENCH_SCREEN()	(bench_screens++)
+#define BENCH_TURN()	bench_turn ()
+#define BENCH_START()	bench_start ()
+#else
+#define BENCH_OPCODE(n)
+#define BENCH_STRING(hit)
+#define BENCH_SCREEN_CALL()
+#define BENCH_SCREEN()
+#define BENCH_TURN()
+#define BENCH_START()
+#endif
+
+#ifdef FROTZ_SESSIONS
+extern SESSION_LOCAL long session_turns;
+
+#define SESSION_TURN()	(session_turns++)
+#else
+#define SESSION_TURN()
+#endif
+
 /*** Interface functions ***/
 
 void 	os_beep (int);
@@ -172,6 +172,9 @@ void z_read (void)
     zbyte c;
     int i;
 
+    BENCH_TURN ();
+    SESSION_TURN ();
+
     /* Supply default arguments */
 
     if (zargc < 3)
@@ -277,6 +280,9 @@ void z_read_char (void)
 {
     zchar key;
 
+    BENCH_TURN ();
+    SESSION_TURN ();
+
     /* Supply default arguments */
 
     if (zargc < 2)
@@ -36,86 +36,88 @@ extern void interpret (void);
 extern void init_memory (void);
 extern void init_undo (void);
 extern void reset_memory (void);
+extern void reset_process (void);
+extern void reset_text (void);
 
 
 /* Story file name, id number and size */
 
-char *story_name = 0;
+SESSION_LOCAL char *story_name = 0;
 
-enum story story_id = UNKNOWN;
-long story_size = 0;
+SESSION_LOCAL enum story story_id = UNKNOWN;
+SESSION_LOCAL long story_size = 0;
 
 /* Story file header data */
 
-zbyte h_version = 0;
-zbyte h_config = 0;
-zword h_release = 0;
-zword h_resident_size = 0;
-zword h_start_pc = 0;
-zword h_dictionary = 0;
-zword h_objects = 0;
-zword h_globals = 0;
-zword h_dynamic_size = 0;
-zword h_flags = 0;
-zbyte h_serial[6] = { 0, 0, 0, 0, 0, 0 };
-zword h_abbreviations = 0;
-zword h_file_size = 0;
-zword h_checksum = 0;
-zbyte h_interpreter_number = 0;
-zbyte h_interpreter_version = 0;
-zbyte h_screen_rows = 0;
-zbyte h_screen_cols = 0;
-zword h_screen_width = 0;
-zword h_screen_height = 0;
-zbyte h_font_height = 1;
-zbyte h_font_width = 1;
-zword h_functions_offset = 0;
-zword h_strings_offset = 0;
-zbyte h_default_background = 0;
-zbyte h_default_foreground = 0;
-zword h_terminating_keys = 0;
-zword h_line_width = 0;
-zbyte h_standard_high = 1;
-zbyte h_standard_low = 0;
-zword h_alphabet = 0;
-zword h_extension_table = 0;
-zbyte h_user_name[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
-
-zword hx_table_size = 0;
-zword hx_mouse_x = 0;
-zword hx_mouse_y = 0;
-zword hx_unicode_table = 0;
+SESSION_LOCAL zbyte h_version = 0;
+SESSION_LOCAL zbyte h_config = 0;
+SESSION_LOCAL zword h_release = 0;
+SESSION_LOCAL zword h_resident_size = 0;
+SESSION_LOCAL zword h_start_pc = 0;
+SESSION_LOCAL zword h_dictionary = 0;
+SESSION_LOCAL zword h_objects = 0;
+SESSION_LOCAL zword h_globals = 0;
+SESSION_LOCAL zword h_dynamic_size = 0;
+SESSION_LOCAL zword h_flags = 0;
+SESSION_LOCAL zbyte h_serial[6] = { 0, 0, 0, 0, 0, 0 };
+SESSION_LOCAL zword h_abbreviations = 0;
+SESSION_LOCAL zword h_file_size = 0;
+SESSION_LOCAL zword h_checksum = 0;
+SESSION_LOCAL zbyte h_interpreter_number = 0;
+SESSION_LOCAL zbyte h_interpreter_version = 0;
+SESSION_LOCAL zbyte h_screen_rows = 0;
+SESSION_LOCAL zbyte h_screen_cols = 0;
+SESSION_LOCAL zword h_screen_width = 0;
+SESSION_LOCAL zword h_screen_height = 0;
+SESSION_LOCAL zbyte h_font_height = 1;
+SESSION_LOCAL zbyte h_font_width = 1;
+SESSION_LOCAL zword h_functions_offset = 0;
+SESSION_LOCAL zword h_strings_offset = 0;
+SESSION_LOCAL zbyte h_default_background = 0;
+SESSION_LOCAL zbyte h_default_foreground = 0;
+SESSION_LOCAL zword h_terminating_keys = 0;
+SESSION_LOCAL zword h_line_width = 0;
+SESSION_LOCAL zbyte h_standard_high = 1;
+SESSION_LOCAL zbyte h_standard_low = 0;
+SESSION_LOCAL zword h_alphabet = 0;
+SESSION_LOCAL zword h_extension_table = 0;
+SESSION_LOCAL zbyte h_user_name[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+SESSION_LOCAL zword hx_table_size = 0;
+SESSION_LOCAL zword hx_mouse_x = 0;
+SESSION_LOCAL zword hx_mouse_y = 0;
+SESSION_LOCAL zword hx_unicode_table = 0;
 
 /* Stack data */
 
-zword stack[STACK_SIZE];
-zword *sp = 0;
-zword *fp = 0;
-zword frame_count = 0;
+SESSION_LOCAL zword stack[STACK_SIZE];
+SESSION_LOCAL zword *sp = 0;
+SESSION_LOCAL zword *fp = 0;
+SESSION_LOCAL zword frame_count = 0;
 
 /* IO streams */
 
-bool ostream_screen = TRUE;
-bool ostream_script = FALSE;
-bool ostream_memory = FALSE;
-bool ostream_record = FALSE;
-bool istream_replay = FALSE;
-bool message = FALSE;
+SESSION_LOCAL bool ostream_screen = TRUE;
+SESSION_LOCAL bool ostream_script = FALSE;
+SESSION_LOCAL bool ostream_memory = FALSE;
+SESSION_LOCAL bool ostream_record = FALSE;
+SESSION_LOCAL bool istream_replay = FALSE;
+SESSION_LOCAL bool message = FALSE;
 
 /* Current window and mouse data */
 
-int cwin = 0;
-int mwin = 0;
+SESSION_LOCAL int cwin = 0;
+SESSION_LOCAL int mwin = 0;
 
-int mouse_y = 0;
-int mouse_x = 0;
+SESSION_LOCAL int mouse_y = 0;
+SESSION_LOCAL int mouse_x = 0;
 
 /* Window attributes */
 
-bool enable_wrapping = FALSE;
-bool enable_scripting = FALSE;
-bool enable_scrolling = FALSE;
-bool enable_buffering = FALSE;
+SESSION_LOCAL bool enable_wrapping = FALSE;
+SESSION_LOCAL bool enable_scripting = FALSE;
+SESSION_LOCAL bool enable_scrolling = FALSE;
+SESSION_LOCAL bool enable_buffering = FALSE;
 
 /* User options */
 
@@ -135,13 +137,13 @@ int option_script_cols = 80;
 int option_save_quetzal = 1;
 */
 
-int option_sound = 1;
-char *option_zcode_path;
+SESSION_LOCAL int option_sound = 1;
+SESSION_LOCAL char *option_zcode_path;
 
 
 /* Size of memory to reserve (in bytes) */
 
-long reserve_mem = 0;
+SESSION_LOCAL long reserve_mem = 0;
 
 /*
  * z_piracy, branch if the story file is a legal copy.
@@ -160,11 +162,16 @@ void z_piracy (void)
 /*
  * main
  *
- * Prepare and run the game.
+ * Prepare and run the game. Builds with FROTZ_SESSIONS call this once
+ * per game, on a thread of its own, as frotz_main.
  *
  */
 
+#ifdef FROTZ_SESSIONS
+int frotz_main (int argc, char *argv[])
+#else
 int cdecl main (int argc, char *argv[])
+#endif
 {
 
     os_init_setup ();
@@ -191,6 +198,10 @@ int cdecl main (int argc, char *argv[])
 
     reset_memory ();
 
+    reset_process ();
+
+    reset_text ();
+
     os_reset_screen ();
 
     return 0;
@@ -18,6 +18,7 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
  */
 
+#include <stdlib.h>
 #include "frotz.h"
 
 #ifdef DJGPP
@@ -25,15 +26,48 @@
 #endif
 
 
-zword zargs[8];
-int zargc;
+SESSION_LOCAL zword zargs[8];
+SESSION_LOCAL int zargc;
 
-static int finished = 0;
+static SESSION_LOCAL int finished = 0;
 
 static void __extended__ (void);
 static void __illegal__ (void);
 
-void (*op0_opcodes[0x10]) (void) = {
+/*
+ * Pre-decoded instructions, cached by PC. An entry holds what the main
+ * loop would otherwise decode again on every execution: the handler,
+ * the operands (constants, or the numbers of variables to be read at
+ * run time) and the length of the opcode and operands. Store and branch
+ * bytes are still read by the handlers themselves.
+ *
+ * Only code in static or high memory is cached; code in dynamic memory
+ * is decoded afresh each time. storeb and storew refuse to write above
+ * dynamic memory, but other writes (SET_BYTE and SET_WORD, loading an
+ * auxiliary file) don't check, so they call forget_decoded when they go
+ * there.
+ *
+ */
+
+#ifndef PREDECODE_SLOTS
+#define PREDECODE_SLOTS 0x4000		/* must be a power of two */
+#endif
+
+#define DECODED_MAX_LENGTH 19		/* call_vs2 with 8 large constants */
+
+typedef struct {
+    long pc;
+    void (*handler) (void);
+    zword args[8];
+    zbyte argc;
+    zbyte vars;				/* bit i set: args[i] is a variable */
+    zbyte length;
+    zbyte op;				/* BENCH_* opcode number */
+} decoded_t;
+
+static SESSION_LOCAL decoded_t *decoded = NULL;
+
+SESSION_LOCAL void (*op0_opcodes[0x10]) (void) = {
     z_rtrue,
     z_rfalse,
     z_print,
@@ -52,7 +86,7 @@ void (*op0_opcodes[0x10]) (void) = {
     z_piracy
 };
 
-void (*op1_opcodes[0x10]) (void) = {
+SESSION_LOCAL void (*op1_opcodes[0x10]) (void) = {
     z_jz,
     z_get_sibling,
     z_get_child,
@@ -180,9 +214,84 @@ void (*ext_opcodes[0x1d]) (void) = {
 
 void init_process (void)
 {
+    int i;
+
     finished = 0;
+
+    if (f_setup.predecode && decoded == NULL)
+	decoded = malloc (PREDECODE_SLOTS * sizeof (decoded_t));
+
+    if (decoded != NULL)
+	for (i = 0; i < PREDECODE_SLOTS; i++)
+	    decoded[i].pc = -1;
+
 } /* init_process */
 
+/*
+ * reset_process
+ *
+ * Release the instruction cache at the end of the game.
+ *
+ */
+
+void reset_process (void)
+{
+
+    free (decoded);
+    decoded = NULL;
+
+} /* reset_process */
+
+/*
+ * forget_decoded
+ *
+ * Drop the cached instructions that overlap the given bytes.
+ *
+ */
+
+void forget_decoded (long addr, long count)
+{
+    long pc;
+
+    if (decoded == NULL)
+	return;
+
+    if (count >= PREDECODE_SLOTS) {
+	for (pc = 0; pc < PREDECODE_SLOTS; pc++)
+	    decoded[pc].pc = -1;
+	return;
+    }
+
+    for (pc = addr - DECODED_MAX_LENGTH + 1; pc < addr + count; pc++)
+	if (decoded[pc & (PREDECODE_SLOTS - 1)].pc == pc)
+	    decoded[pc & (PREDECODE_SLOTS - 1)].pc = -1;
+
+} /* forget_decoded */
+
+/*
+ * load_variable
+ *
+ * Return the value of a variable operand.
+ *
+ */
+
+static zword load_variable (zbyte variable)
+{
+    zword value;
+
+    if (variable == 0)
+	value = *sp++;
+    else if (variable < 16)
+	value = *(fp - variable);
+    else {
+	zword addr = h_globals + 2 * (variable - 16);
+	LOW_WORD (addr, value)
+    }
+
+    return value;
+
+}/* load_variable */
+
 
 /*
  * load_operand
@@ -201,14 +310,7 @@ static void load_operand (zbyte type)
 
 	CODE_BYTE (variable)
 
-	if (variable == 0)
-	    value = *sp++;
-	else if (variable < 16)
-	    value = *(fp - variable);
-	else {
-	    zword addr = h_globals + 2 * (variable - 16);
-	    LOW_WORD (addr, value)
-	}
+	value = load_variable (variable);
 
     } else if (type & 1) { 		/* small constant */
 
@@ -248,6 +350,202 @@ static void load_all_operands (zbyte specifier)
 
 }/* load_all_operands */
 
+/*
+ * decode_operand
+ *
+ * Decode an operand into a pre-decoded instruction.
+ *
+ */
+
+static void decode_operand (decoded_t *d, zbyte type)
+{
+    zword value;
+
+    if (type & 2) { 			/* variable */
+
+	zbyte variable;
+
+	CODE_BYTE (variable)
+
+	d->vars |= 1 << d->argc;
+	value = variable;
+
+    } else if (type & 1) { 		/* small constant */
+
+	zbyte bvalue;
+
+	CODE_BYTE (bvalue)
+	value = bvalue;
+
+    } else CODE_WORD (value) 		/* large constant */
+
+    d->args[d->argc++] = value;
+
+}/* decode_operand */
+
+/*
+ * decode_all_operands
+ *
+ * Same as load_all_operands for a pre-decoded instruction.
+ *
+ */
+
+static void decode_all_operands (decoded_t *d, zbyte specifier)
+{
+    int i;
+
+    for (i = 6; i >= 0; i -= 2) {
+
+	zbyte type = (specifier >> i) & 0x03;
+
+	if (type == 3)
+	    break;
+
+	decode_operand (d, type);
+
+    }
+
+}/* decode_all_operands */
+
+/*
+ * decode
+ *
+ * Decode the instruction at the PC, leaving the PC after its operands.
+ *
+ */
+
+static void decode (decoded_t *d)
+{
+    long pc;
+    long end;
+    zbyte opcode;
+
+    GET_PC (pc)
+
+    d->pc = pc;
+    d->argc = 0;
+    d->vars = 0;
+
+    CODE_BYTE (opcode)
+
+    if (opcode < 0x80) {			/* 2OP opcodes */
+
+	decode_operand (d, (zbyte) (opcode & 0x40) ? 2 : 1);
+	decode_operand (d, (zbyte) (opcode & 0x20) ? 2 : 1);
+
+	d->handler = var_opcodes[opcode & 0x1f];
+	d->op = BENCH_2OP + (opcode & 0x1f);
+
+    } else if (opcode < 0xb0) {		/* 1OP opcodes */
+
+	decode_operand (d, (zbyte) (opcode >> 4));
+
+	d->handler = op1_opcodes[opcode & 0x0f];
+	d->op = BENCH_1OP + (opcode & 0x0f);
+
+    } else if (opcode == 0xbe) {		/* EXT opcodes */
+
+	zbyte specifier;
+
+	CODE_BYTE (opcode)
+	CODE_BYTE (specifier)
+
+	decode_all_operands (d, specifier);
+
+	d->handler = (opcode < 0x1d) ? ext_opcodes[opcode] : z_nop;
+	d->op = BENCH_EXT + ((opcode < 0x1d) ? opcode : 0x1d);
+
+    } else if (opcode < 0xc0) {		/* 0OP opcodes */
+
+	d->handler = op0_opcodes[opcode - 0xb0];
+	d->op = BENCH_0OP + (opcode - 0xb0);
+
+    } else {				/* VAR opcodes */
+
+	zbyte specifier1;
+	zbyte specifier2;
+
+	if (opcode == 0xec || opcode == 0xfa) {	/* opcodes 0xec */
+	    CODE_BYTE (specifier1)                  /* and 0xfa are */
+	    CODE_BYTE (specifier2)                  /* call opcodes */
+	    decode_all_operands (d, specifier1);	/* with up to 8 */
+	    decode_all_operands (d, specifier2);    /* arguments    */
+	} else {
+	    CODE_BYTE (specifier1)
+	    decode_all_operands (d, specifier1);
+	}
+
+	d->handler = var_opcodes[opcode - 0xc0];
+	d->op = (opcode < 0xe0) ?
+	    BENCH_2OP + (opcode - 0xc0) : BENCH_VAR + (opcode - 0xe0);
+
+    }
+
+    GET_PC (end)
+
+    d->length = (zbyte) (end - pc);
+
+}/* decode */
+
+/*
+ * interpret_decoded
+ *
+ * Z-code interpreter main loop running from the pre-decoded instructions.
+ *
+ */
+
+static void interpret_decoded (void)
+{
+
+    do {
+
+	decoded_t here;
+	decoded_t *d;
+	long pc;
+	int i;
+
+	GET_PC (pc)
+
+	if (pc >= h_dynamic_size) {
+
+	    d = &decoded[pc & (PREDECODE_SLOTS - 1)];
+
+	    if (d->pc == pc)
+		SET_PC (pc + d->length)
+	    else
+		decode (d);
+
+	} else {
+
+	    d = &here;
+	    decode (d);
+
+	}
+
+	/* The handler may run a nested interpreter loop that reuses the
+	   entry, so everything must be taken from it before the call */
+
+	zargc = d->argc;
+
+	for (i = 0; i < d->argc; i++)
+	    zargs[i] = (d->vars & (1 << i)) ?
+		load_variable ((zbyte) d->args[i]) : d->args[i];
+
+	BENCH_OPCODE (d->op);
+
+	d->handler ();
+
+#if defined(DJGPP) && defined(SOUND_SUPPORT)
+    if (end_of_sound_flag)
+	end_of_sound ();
+#endif
+
+    } while (finished == 0);
+
+    finished--;
+
+}/* interpret_decoded */
+
 /*
  * interpret
  *
@@ -258,6 +556,11 @@ static void load_all_operands (zbyte specifier)
 void interpret (void)
 {
 
+    if (decoded != NULL) {
+	interpret_decoded ();
+	return;
+    }
+
     do {
 
 	zbyte opcode;
@@ -271,16 +574,23 @@ void interpret (void)
 	    load_operand ((zbyte) (opcode & 0x40) ? 2 : 1);
 	    load_operand ((zbyte) (opcode & 0x20) ? 2 : 1);
 
+	    BENCH_OPCODE (BENCH_2OP + (opcode & 0x1f));
+
 	    var_opcodes[opcode & 0x1f] ();
 
 	} else if (opcode < 0xb0) {		/* 1OP opcodes */
 
 	    load_operand ((zbyte) (opcode >> 4));
 
+	    BENCH_OPCODE (BENCH_1OP + (opcode & 0x0f));
+
 	    op1_opcodes[opcode & 0x0f] ();
 
 	} else if (opcode < 0xc0) {		/* 0OP opcodes */
 
+	    if (opcode != 0xbe)			/* __extended__ counts EXT */
+		BENCH_OPCODE (BENCH_0OP + (opcode - 0xb0));
+
 	    op0_opcodes[opcode - 0xb0] ();
 
 	} else {				/* VAR opcodes */
@@ -298,6 +608,9 @@ void interpret (void)
 		load_all_operands (specifier1);
 	    }
 
+	    BENCH_OPCODE ((opcode < 0xe0) ?
+		BENCH_2OP + (opcode - 0xc0) : BENCH_VAR + (opcode - 0xe0));
+
 	    var_opcodes[opcode - 0xc0] ();
 
 	}
@@ -574,6 +887,8 @@ static void __extended__ (void)
 
     load_all_operands (specifier);
 
+    BENCH_OPCODE (BENCH_EXT + ((opcode < 0x1d) ? opcode : 0x1d));
+
     if (opcode < 0x1d)			/* extended opcodes from 0x1d on */
 	ext_opcodes[opcode] ();		/* are reserved for future spec' */
 
@@ -55,7 +55,7 @@ typedef unsigned long zlong;
  * dynamically rather than statically.
  */
 
-static zword frames[STACK_SIZE/4+1];
+static SESSION_LOCAL zword frames[STACK_SIZE/4+1];
 
 /*
  * ID types.
@@ -321,7 +321,7 @@ zword restore_quetzal (FILE *svf, FILE *stf)
 	    case ID_CMem:
 		if (!(progress & GOT_MEMORY))	/* Don't complain if two. */
 		{
-		    (void) fseek (stf, 0, SEEK_SET);
+		    (void) fseek (stf, story_start, SEEK_SET);
 		    i=0;	/* Bytes written to data area. */
 		    for (; currlen > 0; --currlen)
 		    {
@@ -442,7 +442,7 @@ zword save_quetzal (FILE *svf, FILE *stf)
     /* Write `CMem' chunk. */
     if ((cmempos = ftell (svf)) < 0)			return 0;
     if (!write_chnk (svf, ID_CMem, 0))			return 0;
-    (void) fseek (stf, 0, SEEK_SET);
+    (void) fseek (stf, story_start, SEEK_SET);
     /* j holds current run length. */
     for (i=0, j=0, cmemlen=0; i < h_dynamic_size; ++i)
     {
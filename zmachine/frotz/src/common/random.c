@@ -20,10 +20,10 @@
 
 #include "frotz.h"
 
-static long A = 1;
+static SESSION_LOCAL long A = 1;
 
-static int interval = 0;
-static int counter = 0;
+static SESSION_LOCAL int interval = 0;
+static SESSION_LOCAL int counter = 0;
 
 /*
  * seed_random
@@ -24,9 +24,9 @@
 
 extern zword get_max_width (zword);
 
-static int depth = -1;
+static SESSION_LOCAL int depth = -1;
 
-static struct {
+static SESSION_LOCAL struct {
     zword xsize;
     zword table;
     zword width;
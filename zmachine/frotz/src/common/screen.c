@@ -39,17 +39,17 @@ static struct {
     {   UNKNOWN,  0,   0,   0 }
 };
 
-static int font_height = 1;
-static int font_width = 1;
+static SESSION_LOCAL int font_height = 1;
+static SESSION_LOCAL int font_width = 1;
 
-static bool input_redraw = FALSE;
-static bool more_prompts = TRUE;
-static bool discarding = FALSE;
-static bool cursor = TRUE;
+static SESSION_LOCAL bool input_redraw = FALSE;
+static SESSION_LOCAL bool more_prompts = TRUE;
+static SESSION_LOCAL bool discarding = FALSE;
+static SESSION_LOCAL bool cursor = TRUE;
 
-static int input_window = 0;
+static SESSION_LOCAL int input_window = 0;
 
-static Zwindow wp[8], *cwp = wp;
+static SESSION_LOCAL Zwindow wp[8], *cwp;
 
 Zwindow * curwinrec() { return cwp;}
 
@@ -20,6 +20,7 @@ typedef struct frotz_setup_struct {
 	int save_quetzal;		/* done */
 	int sound;			/* done */
 	int err_report_mode;		/* done */
+	int predecode;			/* done */
 
 	char *story_file;
         char *story_name;
@@ -32,7 +33,7 @@ typedef struct frotz_setup_struct {
         char *zcode_path;
 } f_setup_t;
 
-extern f_setup_t f_setup;
+extern SESSION_LOCAL f_setup_t f_setup;
 
 /*** Story file header data ***/
 /*
@@ -31,13 +31,13 @@
 
 extern int direct_call (zword);
 
-static zword routine = 0;
+static SESSION_LOCAL zword routine = 0;
 
-static int next_sample = 0;
-static int next_volume = 0;
+static SESSION_LOCAL int next_sample = 0;
+static SESSION_LOCAL int next_volume = 0;
 
-static bool locked = FALSE;
-static bool playing = FALSE;
+static SESSION_LOCAL bool locked = FALSE;
+static SESSION_LOCAL bool playing = FALSE;
 
 /*
  * init_sound
@@ -18,6 +18,8 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
  */
 
+#include <stdlib.h>
+#include <string.h>
 #include "frotz.h"
 
 enum string_type {
@@ -26,8 +28,14 @@ enum string_type {
 
 extern zword object_name (zword);
 
-static zchar decoded[10];
-static zword encoded[3];
+static SESSION_LOCAL zchar decoded[10];
+static SESSION_LOCAL zword encoded[3];
+
+/* Position of each character in the alphabet as 26 * set + index + 1,
+   or 0 if it isn't there; see index_alphabet. */
+
+static SESSION_LOCAL zbyte alphabet_index[256];
+static SESSION_LOCAL bool alphabet_indexed = FALSE;
 
 /*
  * According to Matteo De Luigi <matteo.de.luigi@libero.it>,
@@ -190,6 +198,57 @@ static zchar alphabet (int set, int index)
 
 }/* alphabet */
 
+/*
+ * alphabet_fixed
+ *
+ * Return true if the alphabet cannot change, that is when the game's
+ * own alphabet and Unicode table (if any) are in static memory.
+ *
+ */
+
+static bool alphabet_fixed (void)
+{
+
+    if (h_alphabet != 0 && h_alphabet < h_dynamic_size)
+	return FALSE;
+    if (hx_unicode_table != 0 && hx_unicode_table < h_dynamic_size)
+	return FALSE;
+
+    return TRUE;
+
+}/* alphabet_fixed */
+
+/*
+ * index_alphabet
+ *
+ * Build the reverse of the alphabet table, so that encode_text needn't
+ * search all three character sets for every character it encodes. This
+ * is only possible while the alphabet is fixed.
+ *
+ */
+
+static bool index_alphabet (void)
+{
+    int set, index;
+
+    if (alphabet_indexed)
+	return TRUE;
+
+    if (!alphabet_fixed ())
+	return FALSE;
+
+    /* Go backwards, so that the first occurrence of a character wins */
+
+    for (set = 2; set >= 0; set--)
+	for (index = 25; index >= 0; index--)
+	    alphabet_index[alphabet (set, index)] = 26 * set + index + 1;
+
+    alphabet_indexed = TRUE;
+
+    return TRUE;
+
+}/* index_alphabet */
+
 /*
  * load_string
  *
@@ -266,10 +325,20 @@ static void encode_text (int padding)
 
 	    /* Search character in the alphabet */
 
-	    for (set = 0; set < 3; set++)
-		for (index = 0; index < 26; index++)
-		    if (c == alphabet (set, index))
-			goto letter_found;
+	    if (index_alphabet ()) {
+
+		if (alphabet_index[c] != 0) {
+		    set = (alphabet_index[c] - 1) / 26;
+		    index = (alphabet_index[c] - 1) % 26;
+		    goto letter_found;
+		}
+
+	    } else
+
+		for (set = 0; set < 3; set++)
+		    for (index = 0; index < 26; index++)
+			if (c == alphabet (set, index))
+			    goto letter_found;
 
 	    /* Character not found, store its ZSCII value */
 
@@ -354,6 +423,148 @@ void z_encode_text (void)
 
 }/* z_encode_text */
 
+/*
+ * Strings in static and high memory never change, so once decoded they
+ * are kept in a cache and printed straight from there the next time.
+ * An entry holds the characters to print, except that a new line is
+ * stored as STRING_ESC, 1 and an abbreviation as STRING_ESC, 2, n. The
+ * abbreviation table may be in dynamic memory, so abbreviation n is
+ * looked up again whenever the entry is printed. STRING_ESC itself is
+ * stored as STRING_ESC, 0.
+ *
+ */
+
+#ifndef STRING_SLOTS
+#define STRING_SLOTS 1024		/* must be a power of two */
+#endif
+#ifndef STRING_MAX
+#define STRING_MAX 1024			/* longest entry, in characters */
+#endif
+
+#define STRING_ESC 0
+
+typedef struct {
+    long addr;			/* byte address, -1 for an empty slot */
+    zword length;		/* length of the encoded string in bytes */
+    zword count;		/* number of characters in text */
+    zchar *text;
+} string_entry_t;
+
+static SESSION_LOCAL string_entry_t *strings = NULL;
+
+static void decode_text (enum string_type, zword);
+
+/*
+ * string_slot
+ *
+ * Return the cache entry for a string, or NULL if the string has to be
+ * decoded every time.
+ *
+ */
+
+static string_entry_t *string_slot (long addr)
+{
+    int i;
+
+    if (!f_setup.predecode || addr < h_dynamic_size || !alphabet_fixed ())
+	return NULL;
+
+    if (strings == NULL) {
+
+	if ((strings = malloc (STRING_SLOTS * sizeof (string_entry_t))) == NULL)
+	    return NULL;
+
+	for (i = 0; i < STRING_SLOTS; i++) {
+	    strings[i].addr = -1;
+	    strings[i].text = NULL;
+	}
+
+    }
+
+    return &strings[((addr >> 1) ^ (addr >> 11)) & (STRING_SLOTS - 1)];
+
+}/* string_slot */
+
+/*
+ * print_cached_string
+ *
+ * Print a string from the cache. Return false if it isn't there.
+ *
+ */
+
+static bool print_cached_string (string_entry_t *entry, long addr, enum string_type st)
+{
+    zchar text[STRING_MAX];
+    int count;
+    int i;
+
+    if (entry->addr != addr) {
+	BENCH_STRING (FALSE);
+	return FALSE;
+    }
+
+    BENCH_STRING (TRUE);
+
+    /* Printing may run an interrupt routine that reuses the entry */
+
+    count = entry->count;
+    memcpy (text, entry->text, count * sizeof (zchar));
+
+    if (st == EMBEDDED_STRING) {
+	long pc = addr + entry->length;
+	SET_PC (pc);
+    }
+
+    for (i = 0; i < count; i++)
+
+	if (text[i] != STRING_ESC)
+	    print_char (text[i]);
+	else if (text[++i] == 0)
+	    print_char (STRING_ESC);
+	else if (text[i] == 1)
+	    new_line ();
+	else {
+
+	    zword ptr_addr = h_abbreviations + 2 * text[++i];
+	    zword abbr_addr;
+
+	    LOW_WORD (ptr_addr, abbr_addr)
+	    decode_text (ABBREVIATION, abbr_addr);
+
+	}
+
+    return TRUE;
+
+}/* print_cached_string */
+
+/*
+ * cache_string
+ *
+ * Put a freshly decoded string into the cache.
+ *
+ */
+
+static void cache_string (string_entry_t *entry, long addr, long length, const zchar *text, int count)
+{
+    zchar *copy;
+
+    if (length > 0xffff || addr + length > story_size)
+	return;
+
+    if ((copy = malloc (count * sizeof (zchar) + 1)) == NULL)
+	return;
+
+    memcpy (copy, text, count * sizeof (zchar));
+
+    free (entry->text);
+
+    entry->addr = addr;
+    entry->length = (zword) length;
+    entry->count = count;
+    entry->text = copy;
+
+}/* cache_string */
+
 /*
  * decode_text
  *
@@ -375,11 +586,17 @@ void z_encode_text (void)
  *
  */
 
-#define outchar(c)	if (st==VOCABULARY) *ptr++=c; else print_char(c)
+#define outchar(c)	do { if (st==VOCABULARY) *ptr++=c; else { print_char(c); record(c); } } while (0)
+#define record(c)	do { if (entry != NULL) { if (c == STRING_ESC) text[count++] = STRING_ESC; text[count++] = c; } } while (0)
+#define record_esc(c)	do { if (entry != NULL) { text[count++] = STRING_ESC; text[count++] = c; } } while (0)
 
 static void decode_text (enum string_type st, zword addr)
 {
+    string_entry_t *entry = NULL;
+    zchar text[STRING_MAX];
+    int count = 0;
     zchar *ptr;
+    long start = 0;
     long byte_addr;
     zchar c2;
     zword code;
@@ -413,6 +630,24 @@ static void decode_text (enum string_type st, zword addr)
 
     }
 
+    /* Print the string from the cache if it's there */
+
+    if (st != VOCABULARY) {
+
+	if (st == LOW_STRING)
+	    start = addr;
+	else if (st == EMBEDDED_STRING)
+	    GET_PC (start)
+	else
+	    start = byte_addr;
+
+	entry = string_slot (start);
+
+	if (entry != NULL && print_cached_string (entry, start, st))
+	    return;
+
+    }
+
     /* Loop until a 16bit word has the highest bit set */
 
     if (st == VOCABULARY)
@@ -422,6 +657,11 @@ static void decode_text (enum string_type st, zword addr)
 
 	int i;
 
+	/* Its three Z-characters add at most nine characters to the entry */
+
+	if (count + 9 > STRING_MAX)
+	    entry = NULL;
+
 	/* Fetch the next 16bit word */
 
 	if (st == LOW_STRING || st == VOCABULARY) {
@@ -449,11 +689,15 @@ static void decode_text (enum string_type st, zword addr)
 		if (shift_state == 2 && c == 6)
 		    status = 2;
 
-		else if (h_version == V1 && c == 1)
+		else if (h_version == V1 && c == 1) {
 		    new_line ();
+		    record_esc (1);
+		}
 
-		else if (h_version >= V2 && shift_state == 2 && c == 7)
+		else if (h_version >= V2 && shift_state == 2 && c == 7) {
 		    new_line ();
+		    record_esc (1);
+		}
 
 		else if (c >= 6)
 		    outchar (alphabet (shift_state, c - 6));
@@ -489,6 +733,12 @@ static void decode_text (enum string_type st, zword addr)
 		LOW_WORD (ptr_addr, abbr_addr)
 		decode_text (ABBREVIATION, abbr_addr);
 
+		if (entry != NULL) {
+		    text[count++] = STRING_ESC;
+		    text[count++] = 2;
+		    text[count++] = 32 * (prev_c - 1) + c;
+		}
+
 		status = 0;
 		break;
 
@@ -516,9 +766,28 @@ static void decode_text (enum string_type st, zword addr)
     if (st == VOCABULARY)
 	*ptr = 0;
 
+    /* Remember the string for next time */
+
+    if (entry != NULL) {
+
+	long end;
+
+	if (st == LOW_STRING)
+	    end = start + ((zword) (addr - start));
+	else if (st == EMBEDDED_STRING)
+	    GET_PC (end)
+	else
+	    end = byte_addr;
+
+	cache_string (entry, start, end - start, text, count);
+
+    }
+
 }/* decode_text */
 
 #undef outchar
+#undef record
+#undef record_esc
 
 /*
  * z_new_line, print a new line.
@@ -764,6 +1033,245 @@ void z_print_unicode (void)
 
 }/* z_print_unicode */
 
+/*
+ * Exact lookups, as done when tokenising, go through a hash index of the
+ * encoded words in a dictionary, which is built the first time that
+ * dictionary is searched. Dictionaries in static memory cannot change.
+ * For those in dynamic memory storeb watches the range from
+ * dictionary_low to dictionary_high, and the indexes are thrown away
+ * when the game writes into it or when memory is restored wholesale.
+ *
+ */
+
+#define DICT_INDEXES 8
+
+typedef struct {
+    zword dct;			/* dictionary address, 0 for a free slot */
+    zword entries;		/* address of the first entry */
+    zbyte entry_len;
+    zword mask;			/* number of table slots minus one */
+    zword *table;		/* entry number + 1, or 0 for an empty slot */
+} dict_index_t;
+
+static SESSION_LOCAL dict_index_t dict_indexes[DICT_INDEXES];
+static SESSION_LOCAL int next_dict_index = 0;
+
+SESSION_LOCAL zword dictionary_low = 0;
+SESSION_LOCAL zword dictionary_high = 0;
+
+/*
+ * hash_word
+ *
+ * Hash an encoded dictionary word.
+ *
+ */
+
+static zword hash_word (const zword *word, int resolution)
+{
+    unsigned long h = 0;
+    int i;
+
+    for (i = 0; i < resolution; i++)
+	h = ((h ^ word[i]) * 2654435761UL) & 0xffffffffUL;
+
+    return (zword) (h >> 16);
+
+}/* hash_word */
+
+/*
+ * same_word
+ *
+ * Compare an encoded word to the given dictionary entry.
+ *
+ */
+
+static bool same_word (const dict_index_t *di, int entry_number, const zword *word, int resolution)
+{
+    zword addr = di->entries + entry_number * di->entry_len;
+    zword entry;
+    int i;
+
+    for (i = 0; i < resolution; i++) {
+	LOW_WORD (addr, entry)
+	if (word[i] != entry)
+	    return FALSE;
+	addr += 2;
+    }
+
+    return TRUE;
+
+}/* same_word */
+
+/*
+ * index_dictionary
+ *
+ * Return the hash index of a dictionary, building it if necessary, or
+ * NULL if the dictionary has to be searched the old way. That is the
+ * case if it runs off the end of the story file, or if a sorted one
+ * has duplicate entries (where the binary search may find any of them;
+ * in an unsorted one the first is found, and only that one is indexed).
+ *
+ */
+
+static dict_index_t *index_dictionary (zword dct)
+{
+    dict_index_t *di;
+    zword entries;
+    zword entry_count;
+    zword word[3];
+    zword addr;
+    zbyte sep_count;
+    int resolution = (h_version <= V3) ? 2 : 3;
+    long size, end;
+    bool sorted;
+    int n, i;
+
+    for (i = 0; i < DICT_INDEXES; i++)
+	if (dict_indexes[i].dct == dct)
+	    return (dict_indexes[i].table != NULL) ? &dict_indexes[i] : NULL;
+
+    di = &dict_indexes[next_dict_index];
+    next_dict_index = (next_dict_index + 1) % DICT_INDEXES;
+
+    free (di->table);
+    di->table = NULL;
+    di->dct = dct;
+
+    LOW_BYTE (dct, sep_count)
+    entries = dct + 1 + sep_count;
+    LOW_BYTE (entries, di->entry_len)
+    entries += 1;
+    LOW_WORD (entries, entry_count)
+    entries += 2;
+    di->entries = entries;
+
+    if ((short) entry_count < 0) {
+	entry_count = - (short) entry_count;
+	sorted = FALSE;
+    } else sorted = TRUE;
+
+    end = (long) entries + (long) entry_count * di->entry_len;
+
+    if (entry_count != 0 && di->entry_len < 2 * resolution)
+	end += 2 * resolution - di->entry_len;
+
+    if (end > story_size || end > 0x10000L)
+	return NULL;
+
+    if (dct < h_dynamic_size) {
+
+	zword top = (end < h_dynamic_size) ? (zword) end : h_dynamic_size;
+
+	if (dictionary_low == dictionary_high) {
+	    dictionary_low = dct;
+	    dictionary_high = top;
+	} else {
+	    if (dct < dictionary_low)
+		dictionary_low = dct;
+	    if (top > dictionary_high)
+		dictionary_high = top;
+	}
+
+    }
+
+    for (size = 16; size < 2L * entry_count; size *= 2)
+	;
+
+    if ((di->table = calloc (size, sizeof (zword))) == NULL)
+	return NULL;
+
+    di->mask = (zword) (size - 1);
+
+    for (n = 0; n < entry_count; n++) {
+
+	zword h;
+
+	addr = entries + n * di->entry_len;
+
+	for (i = 0; i < resolution; i++) {
+	    LOW_WORD (addr, word[i])
+	    addr += 2;
+	}
+
+	h = hash_word (word, resolution) & di->mask;
+
+	while (di->table[h] != 0) {
+
+	    if (same_word (di, di->table[h] - 1, word, resolution))
+		break;
+
+	    h = (h + 1) & di->mask;
+
+	}
+
+	if (di->table[h] == 0)
+	    di->table[h] = n + 1;
+	else if (sorted) {
+	    free (di->table);
+	    di->table = NULL;
+	    return NULL;
+	}
+
+    }
+
+    return di;
+
+}/* index_dictionary */
+
+/*
+ * forget_dictionaries
+ *
+ * Throw away the indexes of all dictionaries in dynamic memory, after
+ * the game has written into one of them or memory has been restored.
+ *
+ */
+
+void forget_dictionaries (void)
+{
+    int i;
+
+    for (i = 0; i < DICT_INDEXES; i++)
+
+	if (dict_indexes[i].dct != 0 && dict_indexes[i].dct < h_dynamic_size) {
+	    free (dict_indexes[i].table);
+	    dict_indexes[i].table = NULL;
+	    dict_indexes[i].dct = 0;
+	}
+
+    dictionary_low = dictionary_high = 0;
+
+}/* forget_dictionaries */
+
+/*
+ * reset_text
+ *
+ * Release the string cache and the dictionary indexes at the end of
+ * the game.
+ *
+ */
+
+void reset_text (void)
+{
+    int i;
+
+    if (strings != NULL) {
+	for (i = 0; i < STRING_SLOTS; i++)
+	    free (strings[i].text);
+	free (strings);
+	strings = NULL;
+    }
+
+    for (i = 0; i < DICT_INDEXES; i++) {
+	free (dict_indexes[i].table);
+	dict_indexes[i].table = NULL;
+	dict_indexes[i].dct = 0;
+    }
+
+    next_dict_index = 0;
+    dictionary_low = dictionary_high = 0;
+
+}/* reset_text */
+
 /*
  * lookup_text
  *
@@ -791,9 +1299,27 @@ static zword lookup_text (int padding, zword dct)
     int lower, upper;
     int i;
     bool sorted;
+    dict_index_t *di;
 
     encode_text (padding);
 
+    if (padding == 0x05 && (di = index_dictionary (dct)) != NULL) {
+
+	zword h = hash_word (encoded, resolution) & di->mask;
+
+	while (di->table[h] != 0) {
+
+	    if (same_word (di, di->table[h] - 1, encoded, resolution))
+		return di->entries + (di->table[h] - 1) * di->entry_len;
+
+	    h = (h + 1) & di->mask;
+
+	}
+
+	return 0;
+
+    }
+
     LOW_BYTE (dct, sep_count)		/* skip word separators */
     dct += 1 + sep_count;
     LOW_BYTE (dct, entry_len)		/* get length of entries */
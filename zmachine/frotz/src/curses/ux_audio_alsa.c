@@ -0,0 +1,864 @@
+/*
+ * ux_audio_alsa.c - Sound support through ALSA, using tinyalsa
+ *
+ * Samples are decoded and resampled to the output rate once, when they
+ * are first prepared or played, and kept for the rest of the game.  A
+ * thread of its own mixes the playing samples and writes them to the
+ * sound card, so starting a sound costs nothing more than queueing a
+ * command for that thread.
+ *
+ * This file is part of Frotz.
+ *
+ * Frotz is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Frotz is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#define __UNIX_PORT_FILE
+
+#ifdef USE_NCURSES_H
+#include <ncurses.h>
+#else
+#include <curses.h>
+#endif
+
+#include "ux_frotz.h"
+
+#ifdef ALSA_SOUND	/* don't compile this if not using ALSA */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <time.h>
+
+#include <tinyalsa/asoundlib.h>
+
+#include "ux_blorb.h"
+
+extern void end_of_sound(void);
+
+/* Output format.  The period is the amount mixed in one go; it also
+   bounds how late a command takes effect. */
+
+#define MIX_RATE	44100
+#define MIX_PERIOD	1024
+#define MIX_PERIODS	4
+
+#define MIX_VOICES	8	/* samples that can be heard at once */
+#define MIX_FADE	441	/* frames to fade out a stopped sample */
+#define MIX_RING	64	/* entries in the command ring */
+#define MIX_POLL	100	/* ms between checks for the end of a sample */
+
+#define SAMPLES		256	/* sample numbers are a byte */
+
+typedef struct sample_struct {
+	short *data;		/* signed 16 bit at MIX_RATE, interleaved */
+	long frames;
+	int channels;		/* 1 or 2 */
+	int repeats;		/* from a .snd header, used by V3 games */
+} sample_t;
+
+/* Only the mixer thread touches the voices. */
+
+typedef struct voice_struct {
+	sample_t *sample;	/* NULL if the voice is free */
+	long pos;
+	int repeats;		/* repeats left, 255 is forever */
+	int gain;		/* 0 to 256 */
+	int fade;		/* frames of fading left, or 0 */
+	unsigned id;
+} voice_t;
+
+enum { MIX_PLAY, MIX_STOP, MIX_FINISH, MIX_QUIT };
+
+typedef struct mix_command_struct {
+	int op;
+	sample_t *sample;
+	int gain;
+	int repeats;
+	unsigned id;
+} mix_command_t;
+
+enum { SINK_PCM, SINK_WAV, SINK_NULL };
+
+static sample_t *samples[SAMPLES];
+static voice_t voices[MIX_VOICES];
+
+/* Commands go from the interpreter to the mixer through a ring with
+   one writer and one reader; the writer owns the head, the reader the
+   tail.  When a sample plays to the end, the mixer raises last_ended
+   to its id.  Ids only grow and the interpreter only cares about the
+   sample it started last, so this one number cannot overflow or lose
+   an end, however long the interpreter takes to look at it. */
+
+static mix_command_t commands[MIX_RING];
+static unsigned command_head, command_tail;
+
+static unsigned last_ended;
+
+static sem_t wakeup;		/* posted with every command */
+static sem_t ended;		/* posted when last_ended is raised */
+
+static pthread_t mixer;
+static int mixer_state;		/* 0 not started, 1 running, -1 failed */
+
+static unsigned current_id;	/* the sample started last... */
+static bool current_playing;	/* ...and whether it may still play */
+
+static int sink;
+static struct pcm *pcm;
+static FILE *wav_file;
+static unsigned long wav_bytes;
+
+#define ring_load(x)		__atomic_load_n (&(x), __ATOMIC_ACQUIRE)
+#define ring_store(x, v)	__atomic_store_n (&(x), (v), __ATOMIC_RELEASE)
+
+/*
+ * put_le
+ *
+ * Store a little endian number of the given size in bytes.
+ *
+ */
+
+static void put_le (unsigned char *p, unsigned long value, int size)
+{
+
+    while (size-- > 0) {
+	*p++ = value & 0xff;
+	value >>= 8;
+    }
+
+}/* put_le */
+
+/*
+ * write_wav_header
+ *
+ * Write the RIFF header of the WAV file sink, with the sizes of the
+ * data written so far.
+ *
+ */
+
+static void write_wav_header (void)
+{
+    unsigned char header[44];
+
+    memcpy (header, "RIFF", 4);
+    put_le (header + 4, 36 + wav_bytes, 4);
+    memcpy (header + 8, "WAVEfmt ", 8);
+    put_le (header + 16, 16, 4);
+    put_le (header + 20, 1, 2);			/* PCM */
+    put_le (header + 22, 2, 2);
+    put_le (header + 24, MIX_RATE, 4);
+    put_le (header + 28, MIX_RATE * 4, 4);
+    put_le (header + 32, 4, 2);
+    put_le (header + 34, 16, 2);
+    memcpy (header + 36, "data", 4);
+    put_le (header + 40, wav_bytes, 4);
+
+    fseek (wav_file, 0, SEEK_SET);
+    fwrite (header, 1, sizeof header, wav_file);
+    fseek (wav_file, 0, SEEK_END);
+
+}/* write_wav_header */
+
+/*
+ * open_sink
+ *
+ * Open the output given by the "sound_device" setting: "hw:card,device"
+ * for a sound card (card 0, device 0 if not set), "null" to throw the
+ * sound away, or the name of a WAV file to write it to.  The file and
+ * null sinks keep time like a sound card would, but only write while
+ * something plays, so the silences between samples are left out.
+ *
+ */
+
+static bool open_sink (void)
+{
+    const char *device = u_setup.sound_device;
+    unsigned card = 0, number = 0;
+    struct pcm_config config;
+
+    if (device != NULL && strcmp (device, "null") == 0) {
+	sink = SINK_NULL;
+	return TRUE;
+    }
+
+    if (device != NULL && strncmp (device, "hw:", 3) != 0) {
+	if ((wav_file = fopen (device, "wb")) == NULL)
+	    return FALSE;
+	sink = SINK_WAV;
+	write_wav_header ();
+	return TRUE;
+    }
+
+    if (device != NULL)
+	sscanf (device + 3, "%u,%u", &card, &number);
+
+    memset (&config, 0, sizeof config);
+    config.channels = 2;
+    config.rate = MIX_RATE;
+    config.period_size = MIX_PERIOD;
+    config.period_count = MIX_PERIODS;
+    config.format = PCM_FORMAT_S16_LE;
+
+    pcm = pcm_open (card, number, PCM_OUT, &config);
+    if (pcm == NULL || !pcm_is_ready (pcm)) {
+	if (pcm != NULL)
+	    pcm_close (pcm);
+	pcm = NULL;
+	return FALSE;
+    }
+
+    sink = SINK_PCM;
+    return TRUE;
+
+}/* open_sink */
+
+/*
+ * close_sink
+ *
+ * Close the output, completing the header of a WAV file.
+ *
+ */
+
+static void close_sink (void)
+{
+
+    if (sink == SINK_PCM)
+	pcm_close (pcm);
+
+    if (sink == SINK_WAV) {
+	write_wav_header ();
+	fclose (wav_file);
+    }
+
+}/* close_sink */
+
+/*
+ * mix_period
+ *
+ * Mix one period of the playing voices into the buffer.  Returns the
+ * number of voices that were playing.
+ *
+ */
+
+static int mix_period (short *out)
+{
+    static long acc[MIX_PERIOD * 2];
+    int playing = 0;
+    int i, n;
+
+    memset (acc, 0, sizeof acc);
+
+    for (n = 0; n < MIX_VOICES; n++) {
+
+	voice_t *v = &voices[n];
+	sample_t *s = v->sample;
+
+	if (s == NULL)
+	    continue;
+
+	playing++;
+
+	for (i = 0; i < MIX_PERIOD; i++) {
+
+	    const short *frame;
+	    long gain = v->gain;
+
+	    if (v->pos == s->frames) {
+		if (v->repeats != 255 && --v->repeats <= 0) {
+		    if (v->fade == 0 && (int) (v->id - last_ended) > 0) {
+			ring_store (last_ended, v->id);
+			sem_post (&ended);
+		    }
+		    v->sample = NULL;
+		    break;
+		}
+		v->pos = 0;
+	    }
+
+	    if (v->fade != 0) {
+		gain = gain * v->fade / MIX_FADE;
+		if (--v->fade == 0) {
+		    v->sample = NULL;
+		    break;
+		}
+	    }
+
+	    frame = s->data + v->pos++ * s->channels;
+	    acc[2 * i] += frame[0] * gain;
+	    acc[2 * i + 1] += frame[s->channels - 1] * gain;
+	}
+    }
+
+    for (i = 0; i < MIX_PERIOD * 2; i++) {
+	long x = acc[i] >> 8;
+	out[i] = (x > 32767) ? 32767 : (x < -32768) ? -32768 : x;
+    }
+
+    return playing;
+
+}/* mix_period */
+
+/*
+ * run_command
+ *
+ * Carry out a command from the interpreter.  A sample that is started
+ * replaces the one played before, which fades out underneath it.
+ *
+ */
+
+static void run_command (const mix_command_t *c)
+{
+    voice_t *v = NULL;
+    int n;
+
+    for (n = 0; n < MIX_VOICES; n++) {
+
+	voice_t *w = &voices[n];
+
+	if (w->sample == NULL) {
+	    if (v == NULL)
+		v = w;
+	    continue;
+	}
+
+	switch (c->op) {
+	case MIX_PLAY:
+	case MIX_STOP:
+	    if (w->fade == 0)
+		w->fade = MIX_FADE;
+	    break;
+	case MIX_FINISH:
+	    if (w->id == c->id && w->repeats != 0)
+		w->repeats = 1;
+	    break;
+	}
+    }
+
+    if (c->op != MIX_PLAY)
+	return;
+
+    if (v == NULL) {		/* all voices busy, take the quietest */
+	v = &voices[0];
+	for (n = 1; n < MIX_VOICES; n++)
+	    if (voices[n].fade < v->fade)
+		v = &voices[n];
+    }
+
+    v->sample = c->sample;
+    v->pos = 0;
+    v->repeats = c->repeats;
+    v->gain = c->gain;
+    v->fade = 0;
+    v->id = c->id;
+
+}/* run_command */
+
+/*
+ * mixer_thread
+ *
+ * Take commands from the ring and keep the sink supplied with sound.
+ * The thread sleeps while nothing plays.
+ *
+ */
+
+static void *mixer_thread (void *unused)
+{
+    static short out[MIX_PERIOD * 2];
+    struct timespec period = { 0, 1000000000L / MIX_RATE * MIX_PERIOD };
+
+    for (;;) {
+
+	unsigned head = ring_load (command_head);
+
+	while (command_tail != head) {
+	    mix_command_t *c = &commands[command_tail % MIX_RING];
+	    if (c->op == MIX_QUIT)
+		return NULL;
+	    run_command (c);
+	    ring_store (command_tail, command_tail + 1);
+	}
+
+	if (mix_period (out) == 0) {
+	    sem_wait (&wakeup);
+	    continue;
+	}
+
+	switch (sink) {
+	case SINK_PCM:
+	    pcm_write (pcm, out, sizeof out);
+	    break;
+	case SINK_WAV:
+	    wav_bytes += fwrite (out, 1, sizeof out, wav_file);
+	    /* fall through */
+	case SINK_NULL:
+	    nanosleep (&period, NULL);
+	    break;
+	}
+    }
+
+}/* mixer_thread */
+
+/*
+ * send_command
+ *
+ * Queue a command for the mixer thread, waiting for room if the ring
+ * is full.
+ *
+ */
+
+static void send_command (int op, sample_t *sample, int gain, int repeats, unsigned id)
+{
+    mix_command_t *c;
+
+    while (command_head - ring_load (command_tail) >= MIX_RING)
+	sched_yield ();
+
+    c = &commands[command_head % MIX_RING];
+    c->op = op;
+    c->sample = sample;
+    c->gain = gain;
+    c->repeats = repeats;
+    c->id = id;
+
+    ring_store (command_head, command_head + 1);
+    sem_post (&wakeup);
+
+}/* send_command */
+
+/*
+ * stop_mixer
+ *
+ * Stop the mixer thread at exit, and free the sample cache.
+ *
+ */
+
+static void stop_mixer (void)
+{
+    int i;
+
+    send_command (MIX_QUIT, NULL, 0, 0, 0);
+    pthread_join (mixer, NULL);
+    close_sink ();
+
+    for (i = 0; i < SAMPLES; i++)
+	if (samples[i] != NULL) {
+	    free (samples[i]->data);
+	    free (samples[i]);
+	    samples[i] = NULL;
+	}
+
+}/* stop_mixer */
+
+/*
+ * start_mixer
+ *
+ * Open the sink and start the mixer thread the first time a sample is
+ * needed.  Returns FALSE if there is no sound.
+ *
+ */
+
+static bool start_mixer (void)
+{
+
+    if (mixer_state != 0)
+	return mixer_state > 0;
+
+    mixer_state = -1;
+
+    if (!f_setup.sound || !open_sink ())
+	return FALSE;
+
+    sem_init (&wakeup, 0, 0);
+    sem_init (&ended, 0, 0);
+
+    if (pthread_create (&mixer, NULL, mixer_thread, NULL) != 0) {
+	close_sink ();
+	return FALSE;
+    }
+
+    atexit (stop_mixer);
+
+    mixer_state = 1;
+    return TRUE;
+
+}/* start_mixer */
+
+/*
+ * new_sample
+ *
+ * Resample decoded sound to the output rate, using linear
+ * interpolation, and wrap it up as a sample.  The input is freed.
+ *
+ */
+
+static sample_t *new_sample (short *data, long frames, int channels, double rate)
+{
+    sample_t *s;
+    long out_frames = frames;
+    short *out = data;
+
+    if (frames <= 0 || (s = malloc (sizeof (sample_t))) == NULL) {
+	free (data);
+	return NULL;
+    }
+
+    if (rate > 0 && (long) (rate + 0.5) != MIX_RATE) {
+
+	double step = rate / MIX_RATE;
+	long i;
+	int c;
+
+	out_frames = (long) (frames / step);
+	out = (out_frames > 0) ? malloc (out_frames * channels * sizeof (short)) : NULL;
+	if (out == NULL) {
+	    free (data);
+	    free (s);
+	    return NULL;
+	}
+
+	for (i = 0; i < out_frames; i++) {
+	    double x = i * step;
+	    long j = (long) x;
+	    long k = (j + 1 < frames) ? j + 1 : j;
+	    double f = x - j;
+
+	    for (c = 0; c < channels; c++)
+		out[i * channels + c] = data[j * channels + c]
+		    + (data[k * channels + c] - data[j * channels + c]) * f;
+	}
+
+	free (data);
+    }
+
+    s->data = out;
+    s->frames = out_frames;
+    s->channels = channels;
+    s->repeats = 1;
+    return s;
+
+}/* new_sample */
+
+/*
+ * decode_aiff
+ *
+ * Decode an AIFF sound from a Blorb file.  8, 16, 24 and 32 bit
+ * samples are understood, mono or stereo (other layouts are mixed down
+ * to their first two channels).
+ *
+ */
+
+static sample_t *decode_aiff (char *form, long length)
+{
+    unsigned char *comm, *ssnd, *p;
+    int channels, bits, bytes, used;
+    long frames, i;
+    double rate;
+    short *data;
+
+    if (length < 12 || memcmp (form + 8, "AIFF", 4) != 0)
+	return NULL;
+
+    comm = (unsigned char *) findchunk (form, "COMM", length);
+    ssnd = (unsigned char *) findchunk (form, "SSND", length);
+    if (comm == NULL || ssnd == NULL)
+	return NULL;
+
+    channels = ReadShort (comm);
+    frames = ReadLong (comm + 2);
+    bits = ReadShort (comm + 6);
+    rate = ReadExtended (comm + 8);
+
+    bytes = (bits + 7) / 8;
+    if (channels < 1 || bytes < 1 || bytes > 4)
+	return NULL;
+
+    p = ssnd + 8 + ReadLong (ssnd);
+    if (p > (unsigned char *) form + length)
+	return NULL;
+    if (frames > ((unsigned char *) form + length - p) / (channels * bytes))
+	frames = ((unsigned char *) form + length - p) / (channels * bytes);
+
+    used = (channels > 2) ? 2 : channels;
+    if ((data = malloc (frames * used * sizeof (short) + 1)) == NULL)
+	return NULL;
+
+    /* AIFF is big endian, so the top 16 bits come first */
+
+    for (i = 0; i < frames; i++, p += channels * bytes) {
+	int c;
+	for (c = 0; c < used; c++) {
+	    unsigned char *q = p + c * bytes;
+	    data[i * used + c] = (bytes == 1) ? (signed char) q[0] << 8
+		: (short) (q[0] << 8 | q[1]);
+	}
+    }
+
+    return new_sample (data, frames, used, rate);
+
+}/* decode_aiff */
+
+/*
+ * load_snd
+ *
+ * Read and decode a sound file in the format of Infocom's sound
+ * games: a 10 byte header with the number of repeats, the sample rate
+ * and the length, followed by unsigned 8 bit mono samples.  The files
+ * live in a "sound" directory next to the story, named after its first
+ * six letters and the sample number.
+ *
+ */
+
+static sample_t *load_snd (int number)
+{
+    char filename[FILENAME_MAX + 1];
+    unsigned char header[10];
+    unsigned char *raw;
+    short *data;
+    sample_t *s;
+    long length, i;
+    FILE *fp;
+
+    snprintf (filename, sizeof filename, "%s/sound/%.6s%02d.snd",
+	f_setup.story_path, f_setup.story_name, number);
+
+    if ((fp = fopen (filename, "rb")) == NULL)
+	return NULL;
+
+    if (fread (header, 1, sizeof header, fp) != sizeof header
+	|| (length = header[8] << 8 | header[9]) == 0
+	|| (raw = malloc (length)) == NULL) {
+	fclose (fp);
+	return NULL;
+    }
+
+    /* One of the Sherlock samples is shorter than it claims to be */
+
+    length = fread (raw, 1, length, fp);
+    fclose (fp);
+
+    if ((data = malloc (length * sizeof (short) + 1)) == NULL) {
+	free (raw);
+	return NULL;
+    }
+
+    for (i = 0; i < length; i++)
+	data[i] = (raw[i] - 128) << 8;
+    free (raw);
+
+    if ((s = new_sample (data, length, 1, header[4] << 8 | header[5])) != NULL)
+	s->repeats = header[2];
+
+    return s;
+
+}/* load_snd */
+
+/*
+ * load_sample
+ *
+ * Return a sample from the cache, decoding it first if this is the
+ * first time it is asked for.  Stories in a Blorb file take their
+ * sounds from there; Ogg Vorbis and MOD sounds are not supported.
+ *
+ */
+
+static sample_t *load_sample (int number)
+{
+    bb_result_t res;
+
+    if (number < 0 || number >= SAMPLES)
+	return NULL;
+
+    if (samples[number] != NULL)
+	return samples[number];
+
+    if (u_setup.use_blorb) {
+	if (bb_load_resource (blorb_map, bb_method_Memory, &res, bb_ID_Snd, number) == bb_err_None) {
+	    if (memcmp (res.data.ptr, "FORM", 4) == 0)
+		samples[number] = decode_aiff (res.data.ptr, res.length);
+	    bb_unload_chunk (blorb_map, res.chunknum);
+	}
+    } else samples[number] = load_snd (number);
+
+    return samples[number];
+
+}/* load_sample */
+
+/*
+ * check_ended
+ *
+ * See whether the sample started last has played to the end, and if
+ * so run the end-of-sound handling when run_eos is set.  The posts of
+ * the ended semaphore are used up first, so that a wait afterwards
+ * only returns for an end this call did not see.
+ *
+ */
+
+static void check_ended (bool run_eos)
+{
+
+    while (sem_trywait (&ended) == 0)
+	;
+
+    if (current_playing && ring_load (last_ended) == current_id) {
+	current_playing = FALSE;
+	if (run_eos)
+	    end_of_sound ();
+    }
+
+}/* check_ended */
+
+/*
+ * unix_check_sound
+ *
+ * Called from the input loop.  Runs the end-of-sound handling when the
+ * sample started last has finished, which has to happen here rather
+ * than in the mixer thread.  Returns how many ms the caller may wait
+ * before calling again, or -1 if nothing is playing.
+ *
+ */
+
+int unix_check_sound (void)
+{
+
+    check_ended (TRUE);
+
+    return current_playing ? MIX_POLL : -1;
+
+}/* unix_check_sound */
+
+/*
+ * os_beep
+ *
+ * Play a beep sound. Ideally, the sound should be high- (number == 1)
+ * or low-pitched (number == 2).
+ *
+ */
+
+void os_beep (int number)
+{
+
+    beep();
+
+}/* os_beep */
+
+/*
+ * os_prepare_sample
+ *
+ * Load the sample from the disk.
+ *
+ */
+
+void os_prepare_sample (int number)
+{
+
+    if (start_mixer ())
+	load_sample (number);
+
+}/* os_prepare_sample */
+
+/*
+ * os_start_sample
+ *
+ * Play the given sample at the given volume (ranging from 1 to 8 and
+ * 255 meaning a default volume). The sound is played once or several
+ * times in the background (255 meaning forever). In Z-code 3 the
+ * repeats value is always 0 and the number of repeats is taken from
+ * the sound file itself. The end_of_sound function is called as soon
+ * as the sound finishes.
+ *
+ */
+
+void os_start_sample (int number, int volume, int repeats, zword eos)
+{
+    sample_t *s;
+
+    if (!start_mixer () || (s = load_sample (number)) == NULL)
+	return;
+
+    if (repeats == 0)
+	repeats = (h_version == V3) ? s->repeats : 1;
+    if (repeats == 0)
+	repeats = 1;
+
+    if (volume < 1 || volume > 8)
+	volume = 8;
+
+    current_id++;
+    current_playing = TRUE;
+    send_command (MIX_PLAY, s, volume * 32, repeats, current_id);
+
+}/* os_start_sample */
+
+/*
+ * os_stop_sample
+ *
+ * Turn off the current sample.
+ *
+ */
+
+void os_stop_sample (int number)
+{
+
+    if (mixer_state <= 0)
+	return;
+
+    current_playing = FALSE;
+    send_command (MIX_STOP, NULL, 0, 0, 0);
+
+}/* os_stop_sample */
+
+/*
+ * os_finish_with_sample
+ *
+ * Remove the current sample from memory (if any).  The decoded sample
+ * stays in the cache instead, so that playing it again is free.
+ *
+ */
+
+void os_finish_with_sample (int number)
+{
+
+    /* Nothing to do */
+
+}/* os_finish_with_sample */
+
+/*
+ * os_wait_sample
+ *
+ * Stop repeating the current sample and wait until it finishes.
+ *
+ */
+
+void os_wait_sample (void)
+{
+
+    if (mixer_state <= 0 || !current_playing)
+	return;
+
+    send_command (MIX_FINISH, NULL, 0, 0, current_id);
+
+    for (;;) {
+	check_ended (FALSE);
+	if (!current_playing)
+	    break;
+	sem_wait (&ended);
+    }
+
+}/* os_wait_sample */
+
+#endif /* ALSA_SOUND */
@@ -62,12 +62,44 @@
 #ifdef OSS_SOUND
 # undef NO_SOUND
 #endif
+#ifdef ALSA_SOUND
+# undef NO_SOUND
+#endif
 
 /* Some regular curses (not ncurses) libraries don't do this correctly. */
 #ifndef getmaxyx
 #define getmaxyx(w, y, x)	(y) = getmaxy(w), (x) = getmaxx(w)
 #endif
 
+/* Benchmark builds count the calls that change the curses screen, and
+   the refreshes that bring the terminal up to date with it. */
+#ifdef FROTZ_BENCH
+#undef addch
+#undef addstr
+#undef addnstr
+#undef attrset
+#undef bkgdset
+#undef erase
+#undef move
+#undef mvaddch
+#undef mvaddstr
+#undef mvinch
+#undef refresh
+#undef scrl
+#define addch(c)		(BENCH_SCREEN_CALL(), waddch(stdscr, c))
+#define addstr(s)		(BENCH_SCREEN_CALL(), waddstr(stdscr, s))
+#define addnstr(s, n)		(BENCH_SCREEN_CALL(), waddnstr(stdscr, s, n))
+#define attrset(a)		(BENCH_SCREEN_CALL(), wattrset(stdscr, a))
+#define bkgdset(c)		(BENCH_SCREEN_CALL(), wbkgdset(stdscr, c))
+#define erase()			(BENCH_SCREEN_CALL(), werase(stdscr))
+#define move(y, x)		(BENCH_SCREEN_CALL(), wmove(stdscr, y, x))
+#define mvaddch(y, x, c)	(BENCH_SCREEN_CALL(), mvwaddch(stdscr, y, x, c))
+#define mvaddstr(y, x, s)	(BENCH_SCREEN_CALL(), mvwaddstr(stdscr, y, x, s))
+#define mvinch(y, x)		(BENCH_SCREEN_CALL(), mvwinch(stdscr, y, x))
+#define refresh()		(BENCH_SCREEN(), wrefresh(stdscr))
+#define scrl(n)			(BENCH_SCREEN_CALL(), wscrl(stdscr, n))
+#endif
+
 extern bool color_enabled;		/* ux_text */
 
 extern char stripped_story_name[FILENAME_MAX+1];
@@ -92,6 +124,7 @@ bool unix_init_pictures(void);		/* ux_pic.c */
 void unix_init_scrollback(void);	/* ux_screen.c */
 void unix_save_screen(int);		/* ux_screen.c */
 void unix_do_scrollback(void);		/* ux_screen.c */
+int unix_check_sound(void);		/* ux_audio_alsa.c */
 
 
 
@@ -68,7 +68,8 @@ Syntax: frotz [options] story-file\n\
   -h # screen height            \t -t   set Tandy bit\n\
   -i   ignore fatal errors      \t -u # slots for multiple undo\n\
   -l # left margin              \t -w # screen width\n\
-  -o   watch object movement    \t -x   expand abbreviations g/x/z"
+  -o   watch object movement    \t -x   expand abbreviations g/x/z\n\
+  -N   don't pre-decode instructions or strings"
 
 /*
 char stripped_story_name[FILENAME_MAX+1];
@@ -207,7 +208,7 @@ void os_process_arguments (int argc, char *argv[])
     /* Parse the options */
 
     do {
-	c = getopt(argc, argv, "aAb:c:def:Fh:il:oOpPQqr:s:S:tu:w:xZ:");
+	c = getopt(argc, argv, "aAb:c:def:Fh:il:NoOpPQqr:s:S:tu:w:xZ:");
 	switch(c) {
 	  case 'a': f_setup.attribute_assignment = 1; break;
 	  case 'A': f_setup.attribute_testing = 1; break;
@@ -237,6 +238,7 @@ void os_process_arguments (int argc, char *argv[])
           case 'h': u_setup.screen_height = atoi(optarg); break;
 	  case 'i': f_setup.ignore_errors = 1; break;
 	  case 'l': f_setup.left_margin = atoi(optarg); break;
+	  case 'N': f_setup.predecode = 0; break;
 	  case 'o': f_setup.object_movement = 1; break;
 	  case 'O': f_setup.object_locating = 1; break;
 	  case 'p': u_setup.plain_ascii = 1; break;
@@ -265,6 +267,9 @@ void os_process_arguments (int argc, char *argv[])
 #ifdef OSS_SOUND
 	printf("oss sound driver, ");
 #endif
+#ifdef ALSA_SOUND
+	printf("alsa sound driver, ");
+#endif
 
 #ifdef USE_NCURSES
 	printf("ncurses interface.");
@@ -507,6 +512,8 @@ void os_init_screen (void)
     }
     os_set_colour(h_default_foreground, h_default_background);
     os_erase_area(1, 1, h_screen_rows, h_screen_cols, 0);
+
+    BENCH_START();
 }/* os_init_screen */
 
 /*
@@ -775,6 +782,9 @@ int getconfig(char *configfile)
 		else if (strcmp(varname, "expand_abb") == 0) {
 			f_setup.expand_abbreviations = getbool(value);
 		}
+		else if (strcmp(varname, "predecode") == 0) {
+			f_setup.predecode = getbool(value);
+		}
 
 		/* now for stringtype yet still numeric variables */
 		else if (strcmp(varname, "background") == 0) {
@@ -822,6 +832,9 @@ int getconfig(char *configfile)
 			f_setup.story_file = malloc(strlen(value) * sizeof(char) + 1);
 			strncpy(f_setup.story_file, value, strlen(value) * sizeof(char));
 		}
+		else if (strcmp(varname, "sound_device") == 0) {
+			u_setup.sound_device = strdup(value);
+		}
 
 		/* The big nasty if-else thingy is finished */
 	} /* while */
@@ -992,9 +1005,11 @@ void os_init_setup(void)
 	f_setup.save_quetzal = 1;
 	f_setup.sound = 1;
 	f_setup.err_report_mode = ERR_DEFAULT_REPORT_MODE;
+	f_setup.predecode = 1;
 
 	u_setup.use_blorb = 0;
 	u_setup.exec_in_blorb = 0;
+	u_setup.sound_device = NULL;
 
 	u_setup.disable_color = 0;
 	u_setup.force_color = 0;
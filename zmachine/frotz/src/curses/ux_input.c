@@ -121,7 +121,15 @@ static int unix_read_char(int extkeys)
     int c;
 
     while(1) {
+#ifdef ALSA_SOUND
+	/* Wake up now and then while a sample plays, to notice its end */
+	int ms = timeout_to_ms(), sound_ms = unix_check_sound();
+	if (sound_ms >= 0 && (ms < 0 || ms > sound_ms))
+	    ms = sound_ms;
+	timeout(ms);
+#else
 	timeout( timeout_to_ms());
+#endif
 	c = getch();
 
 	/* Catch 98% of all input right here... */
@@ -46,7 +46,7 @@
 
 void os_erase_area (int top, int left, int bottom, int right, int win)
 {
-    int y, x, i, j;
+    int y, x, i, j, n;
 
     /* Catch the most common situation and do things the easy way */
     if ((top == 1) && (bottom == h_screen_rows) &&
@@ -62,15 +62,20 @@ void os_erase_area (int top, int left, int bottom, int right, int win)
       erase();
 #endif
     } else {
-        /* Sigh... */
+        /* Sigh... but at least blank whole rows at once */
+	static char blanks[64];
 	int saved_style = u_setup.current_text_style;
+	if (blanks[0] != ' ')
+	  memset(blanks, ' ', sizeof(blanks));
 	os_set_text_style(u_setup.current_color);
 	getyx(stdscr, y, x);
 	top--; left--; bottom--; right--;
 	for (i = top; i <= bottom; i++) {
 	  move(i, left);
-	  for (j = left; j <= right; j++)
-	    addch(' ');
+	  for (j = right - left + 1; j > 0; j -= n) {
+	    n = (j < (int) sizeof(blanks)) ? j : (int) sizeof(blanks);
+	    addnstr(blanks, n);
+	  }
 	}
 	move(y, x);
 	os_set_text_style(saved_style);
@@ -18,6 +18,8 @@ typedef struct unix_setup_struct {
 	bool use_blorb;
 	bool exec_in_blorb;
 
+	char *sound_device;		/* ux_audio_alsa.c */
+
 	int interpreter;		/* see frotz.h */
 } u_setup_t;
 
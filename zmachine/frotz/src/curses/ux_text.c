@@ -192,20 +192,47 @@ void os_set_font (int new_font)
 }/* os_set_font */
 
 /*
- * os_display_char
+ * Text goes to curses in runs of ASCII characters of the same style,
+ * one addnstr() per run rather than an addch() per character. Latin-1
+ * characters are still passed on one at a time with addch() unless
+ * they are turned into ASCII, so that curses treats them as before.
+ */
+
+#define RUN_MAX 128
+
+static char run[RUN_MAX + 3];
+static int run_length = 0;
+
+/*
+ * unix_flush_run
  *
- * Display a character of the current font using the current colours and
- * text style. The cursor moves to the next position. Printable codes are
- * all ASCII values from 32 to 126, ISO Latin-1 characters from 160 to
- * 255, ZC_GAP (gap between two sentences) and ZC_INDENT (paragraph
- * indentation). The screen should not be scrolled after printing to the
- * bottom right corner.
+ * Hand the characters collected so far to curses.
  *
  */
 
-void os_display_char (zchar c)
+static void unix_flush_run (void)
+{
+
+    if (run_length != 0) {
+	addnstr(run, run_length);
+	run_length = 0;
+    }
+
+}/* unix_flush_run */
+
+/*
+ * unix_add_to_run
+ *
+ * Add the ASCII form of a character to the current run.
+ *
+ */
+
+static void unix_add_to_run (zchar c)
 {
 
+    if (run_length >= RUN_MAX)
+	unix_flush_run();
+
     if (c >= ZC_LATIN1_MIN && c <= ZC_LATIN1_MAX) {
         if (u_setup.plain_ascii) {
 
@@ -214,36 +241,58 @@ void os_display_char (zchar c)
 	  char c2 = *ptr++;
 	  char c3 = *ptr++;
 
-	  addch(c1);
+	  run[run_length++] = c1;
 
 	  if (c2 != ' ')
-	    addch(c2);
+	    run[run_length++] = c2;
 	  if (c3 != ' ')
-	    addch(c3);
+	    run[run_length++] = c3;
 
-	} else
+	} else {
+	  unix_flush_run();
 	  addch(c);
+	}
 	return;
     }
     if (c >= ZC_ASCII_MIN && c <= ZC_ASCII_MAX) {
-        addch(c);
+        run[run_length++] = c;
 	return;
     }
     if (c == ZC_INDENT) {
-      addch(' '); addch(' '); addch(' ');
+      run[run_length++] = ' '; run[run_length++] = ' '; run[run_length++] = ' ';
       return;
     }
     if (c == ZC_GAP) {
-      addch(' '); addch(' ');
+      run[run_length++] = ' '; run[run_length++] = ' ';
       return;
     }
 
+}/* unix_add_to_run */
+
+/*
+ * os_display_char
+ *
+ * Display a character of the current font using the current colours and
+ * text style. The cursor moves to the next position. Printable codes are
+ * all ASCII values from 32 to 126, ISO Latin-1 characters from 160 to
+ * 255, ZC_GAP (gap between two sentences) and ZC_INDENT (paragraph
+ * indentation). The screen should not be scrolled after printing to the
+ * bottom right corner.
+ *
+ */
+
+void os_display_char (zchar c)
+{
+
+    unix_add_to_run(c);
+    unix_flush_run();
+
 }/* os_display_char */
 
 /*
  * os_display_string
  *
- * Pass a string of characters to os_display_char.
+ * Display a string of characters, a run of the same style at a time.
  *
  */
 
@@ -258,12 +307,16 @@ void os_display_string (const zchar *s)
 
             int arg = (unsigned char) *s++;
 
+            unix_flush_run();
+
             if (c == ZC_NEW_FONT)
                 os_set_font (arg);
             if (c == ZC_NEW_STYLE)
                 os_set_text_style (arg);
 
-        } else os_display_char (c);
+        } else unix_add_to_run (c);
+
+    unix_flush_run();
 
 }/* os_display_string */
 
@@ -337,9 +390,17 @@ int os_string_width (const zchar *s)
 
 void os_set_cursor (int y, int x)
 {
+    int cur_y, cur_x;
 
     /* Curses thinks the top left is (0,0) */
-    move(--y, --x);
+    y--; x--;
+
+    /* The core moves the cursor before every line and input, mostly to
+       where it already is.  In the last column a move also clears the
+       pending wrap after a character written there, so always do it. */
+    getyx(stdscr, cur_y, cur_x);
+    if (y != cur_y || x != cur_x || x >= getmaxx(stdscr) - 1)
+      move(y, x);
 
 }/* os_set_cursor */
 
@@ -15,7 +15,13 @@
 #include <time.h>
 
 /* from ../common/setup.h */
-extern f_setup_t f_setup;
+extern SESSION_LOCAL f_setup_t f_setup;
+
+/* dumb-init.c */
+extern SESSION_LOCAL FILE *dumb_in;
+extern SESSION_LOCAL FILE *dumb_out;
+void dumb_exit(int status);
+void dumb_reset(void);
 
 /* From input.c.  */
 bool is_terminator (zchar);
@@ -35,6 +41,14 @@ void dumb_display_user_input(char *);
 void dumb_discard_old_input(int num_chars);
 void dumb_elide_more_prompt(void);
 void dumb_set_picture_cell(int row, int col, char c);
+void dumb_reset_output(void);
 
 /* dumb-pic.c */
 void dumb_init_pictures(char *graphics_filename);
+void dumb_reset_pictures(void);
+
+#ifdef FROTZ_SESSIONS
+/* dumb-sessions.c */
+int frotz_main(int argc, char *argv[]);
+void dumb_session_exit(int status);
+#endif
@@ -7,7 +7,12 @@
 
 #include "dumb_frotz.h"
 
-f_setup_t f_setup;
+SESSION_LOCAL f_setup_t f_setup;
+
+/* Where the game reads its input and prints its output: stdin and
+ * stdout, or the files of one session (see dumb_sessions.c).  */
+SESSION_LOCAL FILE *dumb_in;
+SESSION_LOCAL FILE *dumb_out;
 
 #define INFORMATION "\
 An interpreter for all Infocom and other Z-Machine games.\n\
@@ -22,16 +27,17 @@ Syntax: dfrotz [options] story-file\n\
   -o   watch object movement   \t -t   set Tandy bit\n\
   -O   watch object locating   \t -u # slots for multiple undo\n\
   -p   plain ASCII output only \t -w # screen width\n\
-  -P   alter piracy opcode     \t -x   expand abbreviations g/x/z"
+  -P   alter piracy opcode     \t -x   expand abbreviations g/x/z\n\
+  -N   don't pre-decode instructions or strings"
 
 
 /* A unix-like getopt, but with the names changed to avoid any problems.  */
-static int zoptind = 1;
-static int zoptopt = 0;
-static char *zoptarg = NULL;
+static SESSION_LOCAL int zoptind = 1;
+static SESSION_LOCAL int zoptopt = 0;
+static SESSION_LOCAL char *zoptarg = NULL;
 static int zgetopt (int argc, char *argv[], const char *options)
 {
-    static int pos = 1;
+    static SESSION_LOCAL int pos = 1;
     const char *p;
     if (zoptind >= argc || argv[zoptind][0] != '-' || argv[zoptind][1] == 0)
 	return EOF;
@@ -61,13 +67,32 @@ error:
     return '?';
 }/* zgetopt */
 
-static int user_screen_width = 75;
-static int user_screen_height = 24;
-static int user_interpreter_number = -1;
-static int user_random_seed = -1;
-static int user_tandy_bit = 0;
-static char *graphics_filename = NULL;
-static bool plain_ascii = FALSE;
+static SESSION_LOCAL int user_screen_width = 75;
+static SESSION_LOCAL int user_screen_height = 24;
+static SESSION_LOCAL int user_interpreter_number = -1;
+static SESSION_LOCAL int user_random_seed = -1;
+static SESSION_LOCAL int user_tandy_bit = 0;
+static SESSION_LOCAL char *graphics_filename = NULL;
+static SESSION_LOCAL bool plain_ascii = FALSE;
+
+/* Make a default file name such as "zork1.qzl" from the story file name.
+ * The buffer is big enough for any name os_read_file_name may later
+ * copy over it.  */
+static char *default_file_name(const char *extension)
+{
+    const char *base = strrchr(f_setup.story_file, '/');
+    const char *dot;
+    char *name = malloc(MAX_FILE_NAME + 1);
+    int len;
+
+    base = base ? base + 1 : f_setup.story_file;
+    dot = strrchr(base, '.');
+    len = dot ? dot - base : strlen(base);
+    if (len > MAX_FILE_NAME - (int) strlen(extension))
+	len = MAX_FILE_NAME - strlen(extension);
+    sprintf(name, "%.*s%s", len, base, extension);
+    return name;
+}
 
 void os_process_arguments(int argc, char *argv[])
 {
@@ -75,13 +100,14 @@ void os_process_arguments(int argc, char *argv[])
 
     /* Parse the options */
     do {
-	c = zgetopt(argc, argv, "aAh:iI:oOpPQs:R:S:tu:w:xZ:");
+	c = zgetopt(argc, argv, "aAh:iI:NoOpPQs:R:S:tu:w:xZ:");
 	switch(c) {
 	  case 'a': f_setup.attribute_assignment = 1; break;
 	  case 'A': f_setup.attribute_testing = 1; break;
 	case 'h': user_screen_height = atoi(zoptarg); break;
 	  case 'i': f_setup.ignore_errors = 1; break;
 	  case 'I': f_setup.interpreter_number = atoi(zoptarg); break;
+	  case 'N': f_setup.predecode = 0; break;
 	  case 'o': f_setup.object_movement = 1; break;
 	  case 'O': f_setup.object_locating = 1; break;
 	  case 'P': f_setup.piracy = 1; break;
@@ -103,15 +129,15 @@ void os_process_arguments(int argc, char *argv[])
     } while (c != EOF);
 
     if (((argc - zoptind) != 1) && ((argc - zoptind) != 2)) {
-	printf("FROTZ V%s\tdumb interface.\n", VERSION);
-	puts(INFORMATION);
-	printf("\t-Z # error checking mode (default = %d)\n"
+	fprintf(dumb_out, "FROTZ V%s\tdumb interface.\n", VERSION);
+	fputs(INFORMATION "\n", dumb_out);
+	fprintf(dumb_out, "\t-Z # error checking mode (default = %d)\n"
 	    "\t     %d = don't report errors   %d = report first error\n"
 	    "\t     %d = report all errors     %d = exit after any error\n\n",
 	    ERR_DEFAULT_REPORT_MODE, ERR_REPORT_NEVER,
 	    ERR_REPORT_ONCE, ERR_REPORT_ALWAYS, ERR_REPORT_FATAL);
-	printf("While running, enter \"\\help\" to list the runtime escape sequences\n\n");
-	exit(1);
+	fprintf(dumb_out, "While running, enter \"\\help\" to list the runtime escape sequences\n\n");
+	dumb_exit(1);
     }
 /*
     if (((argc - zoptind) != 1) && ((argc - zoptind) != 2)) {
@@ -123,6 +149,11 @@ void os_process_arguments(int argc, char *argv[])
     if (zoptind < argc)
 	graphics_filename = argv[zoptind++];
 
+    f_setup.script_name = default_file_name(EXT_SCRIPT);
+    f_setup.command_name = default_file_name(EXT_COMMAND);
+    f_setup.save_name = default_file_name(EXT_SAVE);
+    f_setup.aux_name = default_file_name(EXT_AUX);
+
 }
 
 void os_init_screen(void)
@@ -149,6 +180,8 @@ void os_init_screen(void)
     dumb_init_input();
     dumb_init_output();
     dumb_init_pictures(graphics_filename);
+
+    BENCH_START();
 }
 
 int os_random_seed (void)
@@ -164,7 +197,18 @@ void os_restart_game (int stage) {}
 void os_fatal (const char *s, ...)
 {
     fprintf(stderr, "\nFatal error: %s\n", s);
-    exit(1);
+    dumb_exit(1);
+}
+
+/* Leave the game.  In a sessions build only the session ends, and the
+ * thread goes back to dumb_sessions.c.  */
+void dumb_exit(int status)
+{
+#ifdef FROTZ_SESSIONS
+    dumb_session_exit(status);
+#else
+    exit(status);
+#endif
 }
 
 FILE *os_load_story(void)
@@ -189,5 +233,22 @@ void os_init_setup(void)
 	f_setup.save_quetzal = 1;
 	f_setup.sound = 1;
 	f_setup.err_report_mode = ERR_DEFAULT_REPORT_MODE;
+	f_setup.predecode = 1;
+
+	if (dumb_in == NULL)
+		dumb_in = stdin;
+	if (dumb_out == NULL)
+		dumb_out = stdout;
 
 }
+
+/* Release what the interface allocated for the game that just ended.  */
+void dumb_reset(void)
+{
+    free(f_setup.script_name);
+    free(f_setup.command_name);
+    free(f_setup.save_name);
+    free(f_setup.aux_name);
+    dumb_reset_output();
+    dumb_reset_pictures();
+}
@@ -5,7 +5,6 @@
  */
 
 #include "dumb_frotz.h"
-f_setup_t f_setup;
 
 static char runtime_usage[] =
   "DUMB-FROTZ runtime help:\n"
@@ -53,8 +52,8 @@ static char runtime_usage[] =
   "            (blank) Any other output line.\n"
 ;
 
-static float speed = 1;
-static bool do_more_prompts = TRUE;
+static SESSION_LOCAL float speed = 1;
+static SESSION_LOCAL bool do_more_prompts = TRUE;
 
 enum input_type {
     INPUT_CHAR,
@@ -65,11 +64,11 @@ enum input_type {
 /* get a character.  Exit with no fuss on EOF.  */
 static int xgetchar(void)
 {
-    int c = getchar();
+    int c = getc(dumb_in);
     if (c == EOF) {
-	if (feof(stdin)) {
+	if (feof(dumb_in)) {
 	    fprintf(stderr, "\nEOT\n");
-	    exit(0);
+	    dumb_exit(0);
 	}
 	os_fatal(strerror(errno));
     }
@@ -94,7 +93,7 @@ static void dumb_getline(char *s)
     p[0] = '\0';
     while ((c = xgetchar()) != '\n')
  	;
-    printf("Line too long, truncated to %s\n", s - INPUT_BUFFER_SIZE);
+    fprintf(dumb_out, "Line too long, truncated to %s\n", s - INPUT_BUFFER_SIZE);
 }
 
 /* Translate in place all the escape characters in s.  */
@@ -138,7 +137,7 @@ static void translate_special_chars(char *s)
 
 
 /* The time in tenths of seconds that the user is ahead of z time.  */
-static int time_ahead = 0;
+static SESSION_LOCAL int time_ahead = 0;
 
 /* Called from os_read_key and os_read_line if they have input from
  * a previous call to dumb_read_line.
@@ -164,14 +163,14 @@ bool dumb_handle_setting(const char *setting, bool show_cursor, bool startup)
 {
     if (!strncmp(setting, "sf", 2)) {
 	speed = atof(&setting[2]);
-	printf("Speed Factor %g\n", speed);
+	fprintf(dumb_out, "Speed Factor %g\n", speed);
     } else if (!strncmp(setting, "mp", 2)) {
 	toggle(&do_more_prompts, setting[2]);
-	printf("More prompts %s\n", do_more_prompts ? "ON" : "OFF");
+	fprintf(dumb_out, "More prompts %s\n", do_more_prompts ? "ON" : "OFF");
     } else {
 	if (!strcmp(setting, "set")) {
-	    printf("Speed Factor %g\n", speed);
-	    printf("More Prompts %s\n", do_more_prompts ? "ON" : "OFF");
+	    fprintf(dumb_out, "Speed Factor %g\n", speed);
+	    fprintf(dumb_out, "More Prompts %s\n", do_more_prompts ? "ON" : "OFF");
 	}
 	return dumb_output_handle_setting(setting, show_cursor, startup);
     }
@@ -202,7 +201,7 @@ static bool dumb_read_line(char *s, char *prompt, bool show_cursor,
   for (;;) {
     char *command;
     if (prompt)
-      fputs(prompt, stdout);
+      fputs(prompt, dumb_out);
     else
       dumb_show_prompt(show_cursor, (timeout ? "tTD" : ")>}")[type]);
     dumb_getline(s);
@@ -254,7 +253,7 @@ static bool dumb_read_line(char *s, char *prompt, bool show_cursor,
       }
     } else if (!strcmp(command, "help")) {
       if (!do_more_prompts)
-	fputs(runtime_usage, stdout);
+	fputs(runtime_usage, dumb_out);
       else {
 	char *current_page, *next_page;
 	current_page = next_page = runtime_usage;
@@ -263,11 +262,11 @@ static bool dumb_read_line(char *s, char *prompt, bool show_cursor,
 	  for (i = 0; (i < h_screen_rows - 2) && *next_page; i++)
 	    next_page = strchr(next_page, '\n') + 1;
 	  /* next_page - current_page is width */
-	  printf("%.*s", next_page - current_page, current_page);
+	  fprintf(dumb_out, "%.*s", next_page - current_page, current_page);
 	  current_page = next_page;
 	  if (!*current_page)
 	    break;
-	  printf("HELP: Type <return> for more, or q <return> to stop: ");
+	  fprintf(dumb_out, "HELP: Type <return> for more, or q <return> to stop: ");
 	  dumb_getline(s);
 	  if (!strcmp(s, "q\n"))
 	    break;
@@ -294,10 +293,10 @@ static void dumb_read_misc_line(char *s, char *prompt)
 /* For allowing the user to input in a single line keys to be returned
  * for several consecutive calls to read_char, with no screen update
  * in between.  Useful for traversing menus.  */
-static char read_key_buffer[INPUT_BUFFER_SIZE];
+static SESSION_LOCAL char read_key_buffer[INPUT_BUFFER_SIZE];
 
 /* Similar.  Useful for using function key abbreviations.  */
-static char read_line_buffer[INPUT_BUFFER_SIZE];
+static SESSION_LOCAL char read_line_buffer[INPUT_BUFFER_SIZE];
 
 zchar os_read_key (int timeout, bool show_cursor)
 {
@@ -333,7 +332,7 @@ zchar os_read_line (int max, zchar *buf, int timeout, int width, int continued)
 {
   char *p;
   int terminator;
-  static bool timed_out_last_time;
+  static SESSION_LOCAL bool timed_out_last_time;
   int timed_out;
 
   /* Discard any keys read for single key input.  */
@@ -391,7 +390,7 @@ int os_read_file_name (char *file_name, const char *default_name, int flag)
   sprintf(prompt, "Please enter a filename [%s]: ", default_name);
   dumb_read_misc_line(buf, prompt);
   if (strlen(buf) > MAX_FILE_NAME) {
-    printf("Filename too long\n");
+    fprintf(dumb_out, "Filename too long\n");
     return FALSE;
   }
 
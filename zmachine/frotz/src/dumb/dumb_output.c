@@ -7,13 +7,11 @@
 
 #include "dumb_frotz.h"
 
-f_setup_t f_setup;
-
-static bool show_line_numbers = FALSE;
-static bool show_line_types = -1;
-static bool show_pictures = TRUE;
-static bool visual_bell = TRUE;
-static bool plain_ascii = FALSE;
+static SESSION_LOCAL bool show_line_numbers = FALSE;
+static SESSION_LOCAL bool show_line_types = -1;
+static SESSION_LOCAL bool show_pictures = TRUE;
+static SESSION_LOCAL bool visual_bell = TRUE;
+static SESSION_LOCAL bool plain_ascii = FALSE;
 
 static char latin1_to_ascii[] =
   "    !   c   L   >o< Y   |   S   ''  C   a   <<  not -   R   _   "
@@ -25,12 +23,12 @@ static char latin1_to_ascii[] =
 ;
 
 /* h_screen_rows * h_screen_cols */
-static int screen_cells;
+static SESSION_LOCAL int screen_cells;
 
 /* The in-memory state of the screen.  */
 /* Each cell contains a style in the upper byte and a char in the lower. */
 typedef unsigned short cell;
-static cell *screen_data;
+static SESSION_LOCAL cell *screen_data;
 
 static cell make_cell(int style, char c) {return (style << 8) | (0xff & c);}
 static char cell_char(cell c) {return c & 0xff;}
@@ -44,26 +42,26 @@ static int cell_style(cell c) {return c >> 8;}
  * the rv bit some company in that huge byte I allocated for it.)  */
 #define PICTURE_STYLE 16
 
-static int current_style = 0;
+static SESSION_LOCAL int current_style = 0;
 
 /* Which cells have changed (1 byte per cell).  */
-static char *screen_changes;
+static SESSION_LOCAL char *screen_changes;
 
-static int cursor_row = 0, cursor_col = 0;
+static SESSION_LOCAL int cursor_row = 0, cursor_col = 0;
 
 /* Compression styles.  */
-static enum {
+static SESSION_LOCAL enum {
   COMPRESSION_NONE, COMPRESSION_SPANS, COMPRESSION_MAX,
 } compression_mode = COMPRESSION_SPANS;
 static char *compression_names[] = {"NONE", "SPANS", "MAX"};
-static int hide_lines = 0;
+static SESSION_LOCAL int hide_lines = 0;
 
 /* Reverse-video display styles.  */
-static enum {
+static SESSION_LOCAL enum {
   RV_NONE, RV_DOUBLESTRIKE, RV_UNDERLINE, RV_CAPS,
 } rv_mode = RV_NONE;
 static char *rv_names[] = {"NONE", "DOUBLESTRIKE", "UNDERLINE", "CAPS"};
-static char rv_blank_char = ' ';
+static SESSION_LOCAL char rv_blank_char = ' ';
 
 static cell *dumb_row(int r) {return screen_data + r * h_screen_cols;}
 
@@ -241,26 +239,26 @@ int os_font_data(int font, int *height, int *width)
 void os_set_colour (int x, int y) {}
 void os_set_font (int x) {}
 
-/* Print a cell to stdout.  */
+/* Print a cell to dumb_out.  */
 static void show_cell(cell cel)
 {
     char c = cell_char(cel);
     switch (cell_style(cel)) {
     case 0:
-	putchar(c);
+	putc(c, dumb_out);
 	break;
     case PICTURE_STYLE:
-	putchar(show_pictures ? c : ' ');
+	putc(show_pictures ? c : ' ', dumb_out);
 	break;
     case REVERSE_STYLE:
 	if (c == ' ')
-	    putchar(rv_blank_char);
+	    putc(rv_blank_char, dumb_out);
 	else
 	    switch (rv_mode) {
-	    case RV_NONE: putchar(c); break;
-	    case RV_CAPS: putchar(toupper(c)); break;
-	    case RV_UNDERLINE: putchar('_'); putchar('\b'); putchar(c); break;
-	    case RV_DOUBLESTRIKE: putchar(c); putchar('\b'); putchar(c); break;
+	    case RV_NONE: putc(c, dumb_out); break;
+	    case RV_CAPS: putc(toupper(c), dumb_out); break;
+	    case RV_UNDERLINE: putc('_', dumb_out); putc('\b', dumb_out); putc(c, dumb_out); break;
+	    case RV_DOUBLESTRIKE: putc(c, dumb_out); putc('\b', dumb_out); putc(c, dumb_out); break;
 	    }
 	break;
     }
@@ -277,15 +275,15 @@ static bool will_print_blank(cell c)
 static void show_line_prefix(int row, char c)
 {
     if (show_line_numbers)
-	printf((row == -1) ? ".." : "%02d", (row + 1) % 100);
+	fprintf(dumb_out, (row == -1) ? ".." : "%02d", (row + 1) % 100);
     if (show_line_types)
-	putchar(c);
+	putc(c, dumb_out);
     /* Add a separator char (unless there's nothing to separate).  */
     if (show_line_numbers || show_line_types)
-	putchar(' ');
+	putc(' ', dumb_out);
 }
 
-/* Print a row to stdout.  */
+/* Print a row to dumb_out.  */
 static void show_row(int r)
 {
     if (r == -1) {
@@ -302,7 +300,7 @@ static void show_row(int r)
 	for (c = 0; c <= last; c++)
 	    show_cell(dumb_row(r)[c]);
     }
-    putchar('\n');
+    putc('\n', dumb_out);
 }
 
 /* Print the part of the cursor row before the cursor.  */
@@ -423,9 +421,9 @@ void os_reset_screen(void)
 void os_beep (int volume)
 {
     if (visual_bell)
-	printf("[%s-PITCHED BEEP]\n", (volume == 1) ? "HIGH" : "LOW");
+	fprintf(dumb_out, "[%s-PITCHED BEEP]\n", (volume == 1) ? "HIGH" : "LOW");
     else
-	putchar('\a'); /* so much for dumb.  */
+	putc('\a', dumb_out); /* so much for dumb.  */
 }
 
 
@@ -451,7 +449,7 @@ bool dumb_output_handle_setting(const char *setting, bool show_cursor,
 
     if (!strncmp(setting, "pb", 2)) {
 	toggle(&show_pictures, setting[2]);
-	printf("Picture outlines display %s\n", show_pictures ? "ON" : "OFF");
+	fprintf(dumb_out, "Picture outlines display %s\n", show_pictures ? "ON" : "OFF");
 	if (startup)
 	    return TRUE;
 	for (i = 0; i < screen_cells; i++)
@@ -459,14 +457,14 @@ bool dumb_output_handle_setting(const char *setting, bool show_cursor,
 	dumb_show_screen(show_cursor);
     } else if (!strncmp(setting, "vb", 2)) {
 	toggle(&visual_bell, setting[2]);
-	printf("Visual bell %s\n", visual_bell ? "ON" : "OFF");
+	fprintf(dumb_out, "Visual bell %s\n", visual_bell ? "ON" : "OFF");
 	os_beep(1); os_beep(2);
     } else if (!strncmp(setting, "ln", 2)) {
 	toggle(&show_line_numbers, setting[2]);
-	printf("Line numbering %s\n", show_line_numbers ? "ON" : "OFF");
+	fprintf(dumb_out, "Line numbering %s\n", show_line_numbers ? "ON" : "OFF");
     } else if (!strncmp(setting, "lt", 2)) {
 	toggle(&show_line_types, setting[2]);
-	printf("Line-type display %s\n", show_line_types ? "ON" : "OFF");
+	fprintf(dumb_out, "Line-type display %s\n", show_line_types ? "ON" : "OFF");
 
     } else if (*setting == 'c') {
 	switch (setting[1]) {
@@ -476,7 +474,7 @@ bool dumb_output_handle_setting(const char *setting, bool show_cursor,
 	case 'h': hide_lines = atoi(&setting[2]); break;
 	default: return FALSE;
 	}
-	printf("Compression mode %s, hiding top %d lines\n",
+	fprintf(dumb_out, "Compression mode %s, hiding top %d lines\n",
 	    compression_names[compression_mode], hide_lines);
     } else if (*setting == 'r') {
 	switch (setting[1]) {
@@ -487,29 +485,29 @@ bool dumb_output_handle_setting(const char *setting, bool show_cursor,
 	case 'b': rv_blank_char = setting[2] ? setting[2] : ' '; break;
 	default: return FALSE;
 	}
-	printf("Reverse-video mode %s, blanks reverse to '%c': ",
+	fprintf(dumb_out, "Reverse-video mode %s, blanks reverse to '%c': ",
 	    rv_names[rv_mode], rv_blank_char);
 
 	for (p = "sample reverse text"; *p; p++)
 	    show_cell(make_cell(REVERSE_STYLE, *p));
-	putchar('\n');
+	putc('\n', dumb_out);
 	for (i = 0; i < screen_cells; i++)
 	    screen_changes[i] = (cell_style(screen_data[i]) == REVERSE_STYLE);
 	dumb_show_screen(show_cursor);
     } else if (!strcmp(setting, "set")) {
 
-	printf("Compression Mode %s, hiding top %d lines\n",
+	fprintf(dumb_out, "Compression Mode %s, hiding top %d lines\n",
 	    compression_names[compression_mode], hide_lines);
-	printf("Picture Boxes display %s\n", show_pictures ? "ON" : "OFF");
-	printf("Visual Bell %s\n", visual_bell ? "ON" : "OFF");
+	fprintf(dumb_out, "Picture Boxes display %s\n", show_pictures ? "ON" : "OFF");
+	fprintf(dumb_out, "Visual Bell %s\n", visual_bell ? "ON" : "OFF");
 	os_beep(1); os_beep(2);
-	printf("Line Numbering %s\n", show_line_numbers ? "ON" : "OFF");
-	printf("Line-Type display %s\n", show_line_types ? "ON" : "OFF");
-	printf("Reverse-Video mode %s, Blanks reverse to '%c': ",
+	fprintf(dumb_out, "Line Numbering %s\n", show_line_numbers ? "ON" : "OFF");
+	fprintf(dumb_out, "Line-Type display %s\n", show_line_types ? "ON" : "OFF");
+	fprintf(dumb_out, "Reverse-Video mode %s, Blanks reverse to '%c': ",
 	    rv_names[rv_mode], rv_blank_char);
 	for (p = "sample reverse text"; *p; p++)
 	    show_cell(make_cell(REVERSE_STYLE, *p));
-	putchar('\n');
+	putc('\n', dumb_out);
     } else
 	return FALSE;
     return TRUE;
@@ -540,3 +538,11 @@ void dumb_init_output(void)
     os_erase_area(1, 1, h_screen_rows, h_screen_cols, -2);
     memset(screen_changes, 0, screen_cells);
 }
+
+void dumb_reset_output(void)
+{
+    free(screen_data);
+    free(screen_changes);
+    screen_data = NULL;
+    screen_changes = NULL;
+}
@@ -7,7 +7,6 @@
  */
 #include "dumb_frotz.h"
 
-f_setup_t f_setup;
 
 #define PIC_FILE_HEADER_FLAGS 1
 #define PIC_FILE_HEADER_NUM_IMAGES 4
@@ -18,14 +17,14 @@ f_setup_t f_setup;
 #define PIC_HEADER_WIDTH 2
 #define PIC_HEADER_HEIGHT 4
 
-static struct {
+static SESSION_LOCAL struct {
     int z_num;
     int width;
     int height;
     int orig_width;
     int orig_height;
 } *pict_info;
-static int num_pictures = 0;
+static SESSION_LOCAL int num_pictures = 0;
 
 static unsigned char lookupb(unsigned char *p, int n) {return p[n];}
 static unsigned short lookupw(unsigned char *p, int n)
@@ -91,6 +90,13 @@ void dumb_init_pictures (char *filename)
 	}
 }
 
+void dumb_reset_pictures (void)
+{
+    free(pict_info);
+    pict_info = NULL;
+    num_pictures = 0;
+}
+
 /* Convert a Z picture number to an index into pict_info.  */
 static int z_num_to_index(int n)
 {
@@ -0,0 +1,404 @@
+/* dumb-sessions.c
+ * Play many games in one process, stepped a line of input at a time.
+ *
+ * Built with FROTZ_SESSIONS, which keeps all the state of the
+ * interpreter and of the dumb interface per thread (see SESSION_LOCAL
+ * in ../common/frotz.h).  A session is a game with a thread of its own
+ * and two callbacks, one that hands it input and one that takes what it
+ * prints; dumb_in and dumb_out are streams over them.  The game only
+ * runs while it is being stepped.  When it wants input that the read
+ * callback does not have yet, it parks: its thread waits and the step
+ * returns.  A pool of -j workers steps the sessions that can go on, so
+ * no more than -j games run at a time however many are open.  As the
+ * state is thread-local, a parked game keeps its thread; the workers
+ * lend it their turn to run rather than running it themselves.
+ *
+ * Every game is started on a fresh thread, so it begins with the same
+ * state a new process would have, and in a working directory of its own
+ * (this needs Linux, see unshare(2)).  The story files are mapped
+ * privately by each game, and the pages nobody writes to are shared
+ * between them.
+ *
+ * Any use permitted provided this notice stays intact.
+ */
+
+#define _GNU_SOURCE
+#include "dumb_frotz.h"
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <setjmp.h>
+#include <sys/time.h>
+
+extern void reset_memory (void);
+extern void reset_process (void);
+extern void reset_text (void);
+
+#define USAGE "\
+Syntax: dfrotz-sessions [-j threads] list-file\n\
+Each line of the list file describes one game:\n\
+  directory input-file [dfrotz options] story-file\n\
+The game is played in the directory, which must exist.  It is given the\n\
+input file a line at a time, as if it was typed, and what it prints\n\
+goes to the file \"output\" there.  Up to -j games (default 1) run at\n\
+the same time, taking turns.\n"
+
+#define MAX_ARGS 32
+
+/* What a session reads and prints goes through these.  read returns
+ * the number of bytes it put in buf, 0 if there is no input yet, or -1
+ * at the end of the input.  */
+typedef struct {
+    ssize_t (*read)(void *ctx, char *buf, size_t size);
+    void (*write)(void *ctx, const char *buf, size_t size);
+    void *ctx;
+} session_io_t;
+
+enum { SESSION_NEW, SESSION_RUNNING, SESSION_PARKED, SESSION_ENDED };
+
+typedef struct {
+    char *dir;
+    int argc;
+    char *argv[MAX_ARGS + 1];
+    session_io_t io;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int state;
+    int status;
+    long turns;
+    long steps;
+} session_t;
+
+SESSION_LOCAL long session_turns;
+static SESSION_LOCAL jmp_buf session_end;
+static SESSION_LOCAL int session_status;
+
+/* Called through dumb_exit when a game quits early, on a fatal error or
+ * at the end of its input.  */
+void dumb_session_exit(int status)
+{
+    session_status = status;
+    longjmp(session_end, 1);
+}
+
+/* Wait, on the session's thread, until it is stepped again.  */
+static void park(session_t *s)
+{
+    pthread_mutex_lock(&s->lock);
+    s->state = SESSION_PARKED;
+    pthread_cond_broadcast(&s->cond);
+    while (s->state == SESSION_PARKED)
+	pthread_cond_wait(&s->cond, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+}
+
+static ssize_t session_read(void *cookie, char *buf, size_t size)
+{
+    session_t *s = cookie;
+    ssize_t n;
+
+    while ((n = s->io.read(s->io.ctx, buf, size)) == 0) {
+	fflush(dumb_out);
+	park(s);
+    }
+    return (n < 0) ? 0 : n;
+}
+
+static ssize_t session_write(void *cookie, const char *buf, size_t size)
+{
+    session_t *s = cookie;
+
+    s->io.write(s->io.ctx, buf, size);
+    return size;
+}
+
+/* Play one game from start to end, on a thread of its own.  */
+static void *run_session(void *arg)
+{
+    static const cookie_io_functions_t in_funcs = { session_read, NULL, NULL, NULL };
+    static const cookie_io_functions_t out_funcs = { NULL, session_write, NULL, NULL };
+    session_t *s = arg;
+
+    session_status = 1;
+    if (unshare(CLONE_FS) != 0 || chdir(s->dir) != 0)
+	fprintf(stderr, "dfrotz-sessions: cannot change to %s\n", s->dir);
+    else {
+	dumb_in = fopencookie(s, "r", in_funcs);
+	dumb_out = fopencookie(s, "w", out_funcs);
+
+	if (setjmp(session_end) == 0)
+	    session_status = frotz_main(s->argc, s->argv);
+
+	/* A game that ended through dumb_exit has not cleaned up.  */
+	reset_memory();
+	reset_process();
+	reset_text();
+	dumb_reset();
+
+	fclose(dumb_in);
+	fclose(dumb_out);
+    }
+
+    pthread_mutex_lock(&s->lock);
+    s->status = session_status;
+    s->turns = session_turns;
+    s->state = SESSION_ENDED;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+/* Let the session run until it parks or ends, and return which.  */
+static int step_session(session_t *s)
+{
+    int state;
+
+    pthread_mutex_lock(&s->lock);
+    if (s->state == SESSION_NEW) {
+	s->state = SESSION_RUNNING;
+	if (pthread_create(&s->thread, NULL, run_session, s) != 0) {
+	    fprintf(stderr, "dfrotz-sessions: cannot create thread\n");
+	    s->status = 1;
+	    s->state = SESSION_ENDED;
+	    pthread_mutex_unlock(&s->lock);
+	    return SESSION_ENDED;
+	}
+    } else {
+	s->state = SESSION_RUNNING;
+	pthread_cond_broadcast(&s->cond);
+    }
+    while (s->state == SESSION_RUNNING)
+	pthread_cond_wait(&s->cond, &s->lock);
+    state = s->state;
+    s->steps++;
+    pthread_mutex_unlock(&s->lock);
+
+    if (state == SESSION_ENDED)
+	pthread_join(s->thread, NULL);
+    return state;
+}
+
+/* ------------------------------------------------------------------ */
+
+/* The games of the list file play on terminals that type the input
+ * file a line per step and write the output to a file.  */
+typedef struct {
+    FILE *input;
+    FILE *output;
+    char line[1024];
+    size_t pos;
+    size_t pending;		/* bytes of line the game has not read */
+    int closed;			/* the input file is at its end */
+} terminal_t;
+
+static session_t *sessions;
+static terminal_t *terminals;
+static int num_sessions;
+
+/* Sessions waiting to be stepped, in the order they are stepped in.  */
+static session_t **ready;
+static int ready_head, ready_count;
+static int sessions_left;
+static pthread_mutex_t ready_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ready_cond = PTHREAD_COND_INITIALIZER;
+
+static ssize_t terminal_read(void *ctx, char *buf, size_t size)
+{
+    terminal_t *t = ctx;
+
+    if (t->pending == 0)
+	return t->closed ? -1 : 0;
+    if (size > t->pending)
+	size = t->pending;
+    memcpy(buf, t->line + t->pos, size);
+    t->pos += size;
+    t->pending -= size;
+    return size;
+}
+
+static void terminal_write(void *ctx, const char *buf, size_t size)
+{
+    terminal_t *t = ctx;
+
+    fwrite(buf, 1, size, t->output);
+}
+
+/* Type the next line of the input, once the last one has been read.  */
+static void terminal_type(terminal_t *t)
+{
+    if (t->pending != 0 || t->closed)
+	return;
+    if (fgets(t->line, sizeof t->line, t->input) == NULL)
+	t->closed = 1;
+    else {
+	t->pos = 0;
+	t->pending = strlen(t->line);
+    }
+}
+
+static bool terminal_open(terminal_t *t, const char *dir, const char *input)
+{
+    char name[FILENAME_MAX + 1];
+
+    if (input[0] == '/')
+	snprintf(name, sizeof name, "%s", input);
+    else
+	snprintf(name, sizeof name, "%s/%s", dir, input);
+    if ((t->input = fopen(name, "r")) == NULL) {
+	fprintf(stderr, "dfrotz-sessions: cannot read %s\n", name);
+	return FALSE;
+    }
+    snprintf(name, sizeof name, "%s/output", dir);
+    if ((t->output = fopen(name, "w")) == NULL) {
+	fprintf(stderr, "dfrotz-sessions: cannot write %s\n", name);
+	fclose(t->input);
+	return FALSE;
+    }
+    return TRUE;
+}
+
+/* Step sessions until all of them have ended.  */
+static void *run_worker(void *arg)
+{
+    session_t *s;
+    int state;
+
+    for (;;) {
+	pthread_mutex_lock(&ready_lock);
+	while (ready_count == 0 && sessions_left > 0)
+	    pthread_cond_wait(&ready_cond, &ready_lock);
+	if (ready_count == 0) {
+	    pthread_mutex_unlock(&ready_lock);
+	    break;
+	}
+	s = ready[ready_head];
+	ready_head = (ready_head + 1) % num_sessions;
+	ready_count--;
+	pthread_mutex_unlock(&ready_lock);
+
+	terminal_type(s->io.ctx);
+	state = step_session(s);
+
+	pthread_mutex_lock(&ready_lock);
+	if (state == SESSION_ENDED)
+	    sessions_left--;
+	else {
+	    ready[(ready_head + ready_count) % num_sessions] = s;
+	    ready_count++;
+	}
+	pthread_cond_broadcast(&ready_cond);
+	pthread_mutex_unlock(&ready_lock);
+    }
+    return NULL;
+}
+
+/* Read the list of games and open their terminals.  The strings are
+ * kept for the whole run.  */
+static void read_list(FILE *list)
+{
+    char line[1024];
+    char *word;
+    int size = 0;
+    session_t *s;
+
+    while (fgets(line, sizeof line, list) != NULL) {
+	if ((word = strtok(line, " \t\n")) == NULL || *word == '#')
+	    continue;
+	if (num_sessions == size) {
+	    size = size ? 2 * size : 64;
+	    sessions = realloc(sessions, size * sizeof(session_t));
+	    terminals = realloc(terminals, size * sizeof(terminal_t));
+	}
+	s = &sessions[num_sessions];
+	memset(s, 0, sizeof(session_t));
+	s->dir = strdup(word);
+	if ((word = strtok(NULL, " \t\n")) == NULL) {
+	    fprintf(stderr, "dfrotz-sessions: no input file for %s\n", s->dir);
+	    exit(2);
+	}
+	memset(&terminals[num_sessions], 0, sizeof(terminal_t));
+	if (!terminal_open(&terminals[num_sessions], s->dir, word))
+	    exit(2);
+	s->argv[s->argc++] = "dfrotz";
+	while ((word = strtok(NULL, " \t\n")) != NULL && s->argc < MAX_ARGS)
+	    s->argv[s->argc++] = strdup(word);
+	num_sessions++;
+    }
+
+    /* The terminals have not moved since.  */
+    for (s = sessions; s < sessions + num_sessions; s++) {
+	s->io.read = terminal_read;
+	s->io.write = terminal_write;
+	s->io.ctx = &terminals[s - sessions];
+	pthread_mutex_init(&s->lock, NULL);
+	pthread_cond_init(&s->cond, NULL);
+	s->state = SESSION_NEW;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t *workers;
+    struct timeval start, end;
+    int num_threads = 1;
+    long turns = 0, steps = 0;
+    double seconds;
+    int failed = 0;
+    FILE *list;
+    int i;
+
+    if (argc == 4 && !strcmp(argv[1], "-j")) {
+	num_threads = atoi(argv[2]);
+	argv += 2;
+	argc -= 2;
+    }
+    if (argc != 2 || num_threads < 1) {
+	fputs(USAGE, stderr);
+	return 2;
+    }
+    if ((list = fopen(argv[1], "r")) == NULL) {
+	fprintf(stderr, "dfrotz-sessions: cannot read %s\n", argv[1]);
+	return 2;
+    }
+    read_list(list);
+    fclose(list);
+
+    if (num_threads > num_sessions)
+	num_threads = num_sessions;
+    workers = malloc(num_threads * sizeof(pthread_t));
+
+    ready = malloc(num_sessions * sizeof(session_t *));
+    for (i = 0; i < num_sessions; i++)
+	ready[i] = &sessions[i];
+    ready_count = sessions_left = num_sessions;
+
+    gettimeofday(&start, NULL);
+    for (i = 0; i < num_threads; i++)
+	pthread_create(&workers[i], NULL, run_worker, NULL);
+    for (i = 0; i < num_threads; i++)
+	pthread_join(workers[i], NULL);
+    gettimeofday(&end, NULL);
+
+    for (i = 0; i < num_sessions; i++) {
+	turns += sessions[i].turns;
+	steps += sessions[i].steps;
+	fclose(terminals[i].input);
+	fclose(terminals[i].output);
+	if (sessions[i].status != 0) {
+	    fprintf(stderr, "dfrotz-sessions: %s failed\n", sessions[i].dir);
+	    failed = 1;
+	}
+    }
+
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+    fprintf(stderr, "sessions: %d sessions on %d threads, %ld turns in %ld steps, %.3f s",
+	    num_sessions, num_threads, turns, steps, seconds);
+    if (seconds > 0)
+	fprintf(stderr, ", %.0f turns/sec", turns / seconds);
+    fputc('\n', stderr);
+
+    free(ready);
+    free(workers);
+    return failed;
+}
@@ -1033,5 +1033,6 @@ void os_init_setup(void)
 	f_setup.save_quetzal = 1;
 	f_setup.sound = 1;
 	f_setup.err_report_mode = ERR_DEFAULT_REPORT_MODE;
+	f_setup.predecode = 1;
 
 }
@@ -0,0 +1,82 @@
+#!/bin/sh
+
+# Run the test stories through dfrotz-bench (see "make bench").
+#
+#	bench.sh [-u] dfrotz-bench [dfrotz options]
+#
+# Every run listed in "golden" feeds a story a scripted transcript with
+# a fixed random seed and compares the checksum of everything the story
+# printed with the one recorded there.  Timed input never times out on
+# its own (\sf0), so the output does not depend on how fast the machine
+# is.  With -u the recorded checksums are replaced by the current ones.
+#
+# The first lines of each report (instructions executed, opcodes per
+# second, time per turn and the hit rate of the decoded string cache)
+# are shown as the runs go; the reports with the opcode histograms are
+# collected in bench.log.
+
+UPDATE=0
+if [ "$1" = "-u" ] ; then
+	UPDATE=1
+	shift
+fi
+
+if [ $# -lt 1 ] ; then
+	echo "usage: $0 [-u] dfrotz-bench [dfrotz options]" >&2
+	exit 2
+fi
+
+BENCH_DIR=`dirname $0`
+BENCH_DIR=`cd $BENCH_DIR && pwd`
+TEST_DIR=`dirname $BENCH_DIR`
+GOLDEN="$BENCH_DIR/golden"
+BINARY=`cd \`dirname $1\` && pwd`/`basename $1`
+shift
+OPTIONS="$*"
+
+# The stories may save files, so run them somewhere harmless.
+SCRATCH="${TMPDIR:-/tmp}/frotz-bench.$$"
+mkdir "$SCRATCH" || exit 1
+trap 'rm -rf "$SCRATCH"' 0
+trap 'exit 1' 1 2 15
+
+LOG=bench.log
+: > $LOG
+: > "$SCRATCH/golden"
+FAILED=0
+
+while read NAME STORY SEED INPUT SUM SIZE ; do
+	case "$NAME" in
+	""|\#*)
+		continue ;;
+	esac
+
+	mkdir "$SCRATCH/$NAME"
+	(cd "$SCRATCH/$NAME" && \
+		"$BINARY" -s $SEED -R sf0 -R mp0 $OPTIONS "$TEST_DIR/$STORY" \
+		< "$BENCH_DIR/$INPUT" 2> "$SCRATCH/report") | cksum > "$SCRATCH/sum"
+	read OUT_SUM OUT_SIZE < "$SCRATCH/sum"
+	printf "%-15s %-23s %-7s %-23s %-15s %s\n" \
+		$NAME $STORY $SEED $INPUT $OUT_SUM $OUT_SIZE >> "$SCRATCH/golden"
+
+	if [ $UPDATE -eq 1 ] ; then
+		RESULT="recorded"
+	elif [ "$OUT_SUM" = "$SUM" ] && [ "$OUT_SIZE" = "$SIZE" ] ; then
+		RESULT="ok"
+	else
+		RESULT="FAILED (output $OUT_SUM $OUT_SIZE, expected $SUM $SIZE)"
+		FAILED=1
+	fi
+
+	echo "$NAME: $RESULT"
+	grep '^bench: [0-9][0-9]* [its]' "$SCRATCH/report"
+	echo "== $NAME ($STORY, seed $SEED, $INPUT): $RESULT" >> $LOG
+	grep '^bench:' "$SCRATCH/report" >> $LOG
+done < "$GOLDEN"
+
+if [ $UPDATE -eq 1 ] ; then
+	sed -n '/^#/p' "$GOLDEN" > "$SCRATCH/header"
+	cat "$SCRATCH/header" "$SCRATCH/golden" > "$GOLDEN"
+fi
+
+exit $FAILED
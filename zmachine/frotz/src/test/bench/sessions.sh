@@ -0,0 +1,79 @@
+#!/bin/sh
+
+# Play the runs in "golden" many times over in one process with
+# dfrotz-sessions (see "make sessions").
+#
+#	sessions.sh dfrotz-sessions [copies [threads]]
+#
+# Every run is listed the given number of times (default 8).  The list is
+# played once on a single thread and once on the given number of threads
+# (default: one per processor), each copy's output is compared with the
+# checksum recorded in "golden", and the turns per second of both passes
+# are shown.  Every copy is played in a directory of its own, as the
+# stories may save files.  dfrotz-sessions reports the games that end
+# with a fatal error as failed, here only the checksums count.
+
+if [ $# -lt 1 ] ; then
+	echo "usage: $0 dfrotz-sessions [copies [threads]]" >&2
+	exit 2
+fi
+
+BENCH_DIR=`dirname $0`
+BENCH_DIR=`cd $BENCH_DIR && pwd`
+TEST_DIR=`dirname $BENCH_DIR`
+GOLDEN="$BENCH_DIR/golden"
+BINARY=`cd \`dirname $1\` && pwd`/`basename $1`
+COPIES=${2:-8}
+THREADS=${3:-`getconf _NPROCESSORS_ONLN 2>/dev/null || echo 4`}
+
+SCRATCH="${TMPDIR:-/tmp}/frotz-sessions.$$"
+mkdir "$SCRATCH" || exit 1
+trap 'rm -rf "$SCRATCH"' 0
+trap 'exit 1' 1 2 15
+
+: > "$SCRATCH/list"
+while read NAME STORY SEED INPUT SUM SIZE ; do
+	case "$NAME" in
+	""|\#*)
+		continue ;;
+	esac
+
+	COPY=1
+	while [ $COPY -le $COPIES ] ; do
+		echo "$NAME.$COPY $BENCH_DIR/$INPUT" \
+			"-s $SEED -R sf0 -R mp0 $TEST_DIR/$STORY" >> "$SCRATCH/list"
+		COPY=`expr $COPY + 1`
+	done
+done < "$GOLDEN"
+
+FAILED=0
+
+for J in 1 $THREADS ; do
+	sed 's/ .*//' "$SCRATCH/list" | (cd "$SCRATCH" && xargs rm -rf)
+	sed 's/ .*//' "$SCRATCH/list" | (cd "$SCRATCH" && xargs mkdir)
+	(cd "$SCRATCH" && "$BINARY" -j $J list 2> report)
+
+	while read NAME STORY SEED INPUT SUM SIZE ; do
+		case "$NAME" in
+		""|\#*)
+			continue ;;
+		esac
+
+		COPY=1
+		while [ $COPY -le $COPIES ] ; do
+			OUT="$SCRATCH/$NAME.$COPY/output"
+			cksum < "$OUT" > "$SCRATCH/sum"
+			read OUT_SUM OUT_SIZE < "$SCRATCH/sum"
+			if [ "$OUT_SUM" != "$SUM" ] || [ "$OUT_SIZE" != "$SIZE" ] ; then
+				echo "$NAME copy $COPY on $J threads: FAILED" \
+					"(output $OUT_SUM $OUT_SIZE, expected $SUM $SIZE)"
+				FAILED=1
+			fi
+			COPY=`expr $COPY + 1`
+		done
+	done < "$GOLDEN"
+
+	grep '^sessions:' "$SCRATCH/report"
+done
+
+exit $FAILED
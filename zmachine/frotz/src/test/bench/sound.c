@@ -0,0 +1,196 @@
+/* sound.c - Play samples through the ALSA sound code without a sound card
+ *
+ * This file is part of Frotz.
+ *
+ * Frotz is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Frotz is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+/*
+ * Built with src/curses/ux_audio_alsa.c by "make sound-bench" and run by
+ * sound.sh:
+ *
+ *	frotz-sound-bench null|file.wav directory
+ *
+ * Three .snd files are written to directory/sound, and played the way
+ * the interpreter plays them, through the null sink or into a WAV file:
+ *
+ *	wait	each sample in turn, sample n repeated n times, waiting
+ *		for the end of each one
+ *	storm	a short sample started over and over, each time after the
+ *		last one ended, with no end-of-sound checks in between,
+ *		then one more sample which is waited for after it ended
+ *	check	a sample whose end is picked up by the input loop's check
+ *
+ * The program fails if a wait does not return within a few seconds, or
+ * if the end-of-sound handling does not run exactly once, for "check".
+ * What is played does not depend on timing, so the WAV file can be
+ * compared with a recorded checksum.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../common/frotz.h"
+#include "../../blorb/blorb.h"
+#include "../../curses/ux_setup.h"
+
+#define RATE		44100
+#define STORM		100	/* more than MIX_RING in ux_audio_alsa.c */
+#define WAIT_LIMIT	10	/* seconds */
+
+f_setup_t f_setup;
+u_setup_t u_setup;
+zbyte h_version = V5;
+
+int unix_check_sound (void);
+void os_wait_sample (void);
+
+static int eos_calls;
+
+/* Stubs for what ux_audio_alsa.c uses of the rest of frotz */
+
+void end_of_sound (void) { eos_calls++; }
+int beep (void) { return 0; }
+char *findchunk (char *pstart, char *fourcc, int n) { return NULL; }
+unsigned short ReadShort (const unsigned char *bytes) { return 0; }
+unsigned long ReadLong (const unsigned char *bytes) { return 0; }
+double ReadExtended (const unsigned char *bytes) { return 0; }
+bb_err_t bb_unload_chunk (bb_map_t *map, int chunknum) { return bb_err_None; }
+
+bb_err_t bb_load_resource (bb_map_t *map, int method, bb_result_t *res,
+	uint32 usage, int resnum)
+{
+    return bb_err_NotFound;
+}
+
+/*
+ * write_snd
+ *
+ * Write an Infocom sound file holding a triangle wave of the given
+ * length and rate.
+ *
+ */
+
+static void write_snd (const char *dir, int number, int length, int rate)
+{
+    char name[FILENAME_MAX + 1];
+    unsigned char header[10];
+    FILE *fp;
+    int i;
+
+    snprintf (name, sizeof name, "%s/sound/sound%02d.snd", dir, number);
+    if ((fp = fopen (name, "wb")) == NULL) {
+	perror (name);
+	exit (1);
+    }
+
+    memset (header, 0, sizeof header);
+    header[2] = 1;
+    header[4] = rate >> 8;
+    header[5] = rate & 0xff;
+    header[8] = length >> 8;
+    header[9] = length & 0xff;
+    fwrite (header, 1, sizeof header, fp);
+
+    for (i = 0; i < length; i++) {
+	int x = i * number * 3 % 200;
+	fputc (78 + (x < 100 ? x : 200 - x), fp);
+    }
+
+    fclose (fp);
+}
+
+static void timed_out (int sig)
+{
+    fprintf (stderr, "sound: a wait for the end of a sample never returned\n");
+    _exit (1);
+}
+
+static void nap (long ms)
+{
+    struct timespec t;
+
+    t.tv_sec = ms / 1000;
+    t.tv_nsec = ms % 1000 * 1000000L;
+    nanosleep (&t, NULL);
+}
+
+static void wait_sample (void)
+{
+    alarm (WAIT_LIMIT);
+    os_wait_sample ();
+    alarm (0);
+}
+
+static void report (const char *name, bool ok, int *failed)
+{
+    printf ("sound: %s %s\n", name, ok ? "ok" : "FAILED");
+    if (!ok)
+	*failed = 1;
+}
+
+int main (int argc, char *argv[])
+{
+    char dir[FILENAME_MAX + 1];
+    int failed = 0;
+    int i;
+
+    if (argc != 3) {
+	fprintf (stderr, "usage: %s null|file.wav directory\n", argv[0]);
+	return 2;
+    }
+
+    snprintf (dir, sizeof dir, "%s/sound", argv[2]);
+    mkdir (dir, 0777);
+    write_snd (argv[2], 1, 3000, RATE);
+    write_snd (argv[2], 2, 1024, RATE / 2);	/* resampled */
+    write_snd (argv[2], 3, 10, RATE);
+
+    f_setup.sound = 1;
+    f_setup.story_path = argv[2];
+    f_setup.story_name = "sound";
+    u_setup.sound_device = argv[1];
+    signal (SIGALRM, timed_out);
+
+    /* wait */
+    for (i = 1; i <= 3; i++) {
+	os_start_sample (i, 9 - 2 * i, i, 0);
+	wait_sample ();
+    }
+    report ("wait", eos_calls == 0 && unix_check_sound () == -1, &failed);
+
+    /* storm */
+    for (i = 0; i < STORM; i++) {
+	os_start_sample (3, 8, 0, 0);
+	nap (30);
+    }
+    os_start_sample (1, 8, 0, 0);
+    nap (200);
+    wait_sample ();
+    report ("storm", eos_calls == 0 && unix_check_sound () == -1, &failed);
+
+    /* check */
+    os_start_sample (2, 8, 0, 0);
+    for (i = 0; i < WAIT_LIMIT * 10 && unix_check_sound () != -1; i++)
+	nap (100);
+    report ("check", eos_calls == 1, &failed);
+
+    return failed;
+}
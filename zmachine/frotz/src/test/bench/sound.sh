@@ -0,0 +1,45 @@
+#!/bin/sh
+
+# Play samples through the ALSA sound code with the null and the WAV file
+# sinks (see "make sound-bench").
+#
+#	sound.sh frotz-sound-bench
+#
+# frotz-sound-bench (sound.c) is run once with each sink and has to pass
+# all its checks.  The WAV file it writes is compared with the checksum
+# recorded below, which is only to be changed after listening to it.
+
+WAV_SUM=3699875591
+WAV_SIZE=462892
+
+if [ $# -lt 1 ] ; then
+	echo "usage: $0 frotz-sound-bench" >&2
+	exit 2
+fi
+
+BINARY=`cd \`dirname $1\` && pwd`/`basename $1`
+
+SCRATCH="${TMPDIR:-/tmp}/frotz-sound.$$"
+mkdir "$SCRATCH" || exit 1
+trap 'rm -rf "$SCRATCH"' 0
+trap 'exit 1' 1 2 15
+
+FAILED=0
+
+echo "null:"
+"$BINARY" null "$SCRATCH" || FAILED=1
+
+echo "wav:"
+"$BINARY" "$SCRATCH/out.wav" "$SCRATCH" || FAILED=1
+
+cksum < "$SCRATCH/out.wav" > "$SCRATCH/sum"
+read OUT_SUM OUT_SIZE < "$SCRATCH/sum"
+if [ "$OUT_SUM" = "$WAV_SUM" ] && [ "$OUT_SIZE" = "$WAV_SIZE" ] ; then
+	echo "wav file: ok"
+else
+	echo "wav file: FAILED (output $OUT_SUM $OUT_SIZE," \
+		"expected $WAV_SUM $WAV_SIZE)"
+	FAILED=1
+fi
+
+exit $FAILED
@@ -0,0 +1,253 @@
+#!/usr/bin/env python3
+#
+# mkundo.py - Assemble undo.z5, the multiple undo stress test.
+#
+#	python3 mkundo.py undo.z5
+#
+# undo.z5 is the program of undo.inf, hand-translated into Z-code below
+# for want of an Inform compiler.  Keep the two in step.
+#
+# The story file has no objects, no dictionary entries and no strings;
+# text is printed a character at a time.  Dynamic memory is the header,
+# the globals and the 8K array.  Code starts right after it, at HIGH.
+
+import struct
+import sys
+
+GLOBALS = 0x0040
+OBJECTS = 0x0220
+ABBREVS = 0x0300
+ARRAY = 0x0400
+ASIZE = 0x2000
+DICT = ARRAY + ASIZE            # Also the start of static memory.
+HIGH = DICT + 0x100
+TURNS = 100                     # Saves made for each 's'.
+
+# Locals of Run.
+I, SEED, N, START, J, T, C, R, K, KEY, END = range(1, 12)
+
+# Operand types.
+LARGE, SMALL, VAR, OMIT = range(4)
+
+
+class Assembler:
+    """Z-code for version 5 with forward references.
+
+    Labels and routines are resolved from the previous pass, so the code
+    is assembled twice."""
+
+    def __init__(self, known):
+        self.code = bytearray()
+        self.labels = {}
+        self.known = known
+        self.fixups = []
+
+    def here(self):
+        return HIGH + len(self.code)
+
+    def label(self, name):
+        self.labels[name] = self.here()
+
+    def routine(self, name, nlocals):
+        while self.here() % 4:
+            self.code.append(0)
+        self.label(name)
+        self.code.append(nlocals)
+
+    def operand(self, v):
+        """An int is a constant, ('v', n) variable n and ('r', name)
+        the packed address of a routine."""
+        if isinstance(v, tuple) and v[0] == 'r':
+            return LARGE, struct.pack('>H', self.known.get(v[1], 0) // 4)
+        if isinstance(v, tuple):
+            return VAR, bytes([v[1]])
+        if 0 <= v <= 255:
+            return SMALL, bytes([v])
+        return LARGE, struct.pack('>H', v & 0xffff)
+
+    def operands(self, ops):
+        types = 0
+        data = b''
+        for i in range(4):
+            t = OMIT
+            if i < len(ops):
+                t, d = self.operand(ops[i])
+                data += d
+            types |= t << (6 - 2 * i)
+        return bytes([types]) + data
+
+    def finish(self, store, branch):
+        if store is not None:
+            self.code.append(store)
+        if branch is not None:
+            self.fixups.append(('branch', len(self.code)) + branch)
+            self.code.extend(b'\0\0')
+
+    def op2(self, op, a, b, store=None, branch=None):
+        self.code.append(0xc0 | op)
+        self.code.extend(self.operands([a, b]))
+        self.finish(store, branch)
+
+    def var(self, op, ops, store=None):
+        self.code.append(0xe0 | op)
+        self.code.extend(self.operands(ops))
+        self.finish(store, None)
+
+    def ext(self, op, store):
+        self.code.extend([0xbe, op])
+        self.code.extend(self.operands([]))
+        self.finish(store, None)
+
+    def op1(self, op, a, store=None, branch=None):
+        t, d = self.operand(a)
+        self.code.append(0x80 | t << 4 | op)
+        self.code.extend(d)
+        self.finish(store, branch)
+
+    def op0(self, op):
+        self.code.append(0xb0 | op)
+
+    def jump(self, name):
+        self.code.append(0x8c)
+        self.fixups.append(('jump', len(self.code), name, None))
+        self.code.extend(b'\0\0')
+
+    def text(self, s):
+        for ch in s:
+            self.var(0x05, [ord(ch)])           # print_char
+
+    def resolve(self):
+        for kind, pos, name, cond in self.fixups:
+            offset = self.labels.get(name, 0) - (HIGH + pos + 2) + 2
+            if kind == 'jump':
+                self.code[pos:pos + 2] = struct.pack('>h', offset)
+            else:
+                assert -8192 <= offset < 8192
+                word = (offset & 0x3fff) | (0x8000 if cond else 0)
+                self.code[pos:pos + 2] = struct.pack('>H', word)
+
+
+def v(n):
+    return ('v', n)
+
+
+def assemble(known):
+    a = Assembler(known)
+
+    # Main: call Run, then quit.
+    a.var(0x19, [('r', 'run')])                 # call_vn
+    a.op0(0x0a)                                 # quit
+
+    a.routine('run', 11)
+    a.op2(0x0d, I, 0)                           # store
+    a.op2(0x0d, SEED, 1)
+    a.label('cmd')
+    a.var(0x16, [1], store=KEY)                 # read_char
+    a.op2(0x01, v(KEY), ord('s'), branch=('save', True))    # je
+    a.op2(0x01, v(KEY), ord('u'), branch=('undo', True))
+    a.op2(0x01, v(KEY), ord('q'), branch=('quit', True))
+    a.jump('cmd')
+
+    a.label('save')
+    a.op2(0x14, v(I), TURNS, store=END)         # add
+    a.label('turn')
+    a.op2(0x01, v(I), v(END), branch=('cmd', True))
+    a.op2(0x16, v(SEED), 25173, store=SEED)     # mul
+    a.op2(0x14, v(SEED), 13849, store=SEED)
+    a.op2(0x09, v(I), 1, store=T)               # and
+    a.op1(0x00, v(T), branch=('even', True))    # jz
+    a.op2(0x09, v(SEED), ASIZE - 1, store=N)
+    a.jump('size')
+    a.label('even')
+    a.op2(0x09, v(SEED), 0x7f, store=N)
+    a.label('size')
+    a.op2(0x16, v(SEED), 25173, store=SEED)
+    a.op2(0x14, v(SEED), 13849, store=SEED)
+    a.op2(0x09, v(SEED), ASIZE - 1, store=START)
+    a.op2(0x0d, J, 0)
+    a.label('change')
+    a.op2(0x01, v(J), v(N), branch=('changed', True))
+    a.op2(0x14, v(START), v(J), store=K)
+    a.op2(0x09, v(K), ASIZE - 1, store=K)
+    a.op2(0x10, ARRAY, v(K), store=T)           # loadb
+    a.op2(0x14, v(T), 1, store=T)
+    a.var(0x02, [ARRAY, v(K), v(T)])            # storeb
+    a.op1(0x05, J)                              # inc
+    a.jump('change')
+    a.label('changed')
+    a.var(0x00, [('r', 'sum')], store=C)        # call_vs
+    a.ext(0x09, store=R)                        # save_undo
+    a.op2(0x01, v(R), 2, branch=('restored', True))
+    a.op1(0x05, I)
+    a.jump('turn')
+
+    a.label('restored')
+    a.var(0x00, [('r', 'sum')], store=T)
+    a.op2(0x01, v(T), v(C), branch=('ok', True))
+    a.text('BAD ')
+    a.label('ok')
+    a.var(0x06, [v(I)])                         # print_num
+    a.op0(0x0b)                                 # new_line
+    a.op1(0x05, I)
+    a.jump('cmd')
+
+    a.label('undo')
+    a.ext(0x0a, store=R)                        # restore_undo
+    a.text('none')
+    a.op0(0x0b)
+    a.jump('cmd')
+
+    a.label('quit')
+    a.op0(0x00)                                 # rtrue
+
+    # Sum: the checksum of the array.
+    a.routine('sum', 3)
+    a.label('sum-loop')
+    a.op2(0x01, v(1), ASIZE, branch=('sum-done', True))
+    a.op2(0x10, ARRAY, v(1), store=3)
+    a.op2(0x16, v(2), 31, store=2)
+    a.op2(0x14, v(2), v(3), store=2)
+    a.op1(0x05, 1)
+    a.jump('sum-loop')
+    a.label('sum-done')
+    a.op1(0x0b, v(2))                           # ret
+
+    a.resolve()
+    return a
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.stderr.write('usage: %s undo.z5\n' % sys.argv[0])
+        sys.exit(2)
+
+    a = assemble({})
+    a = assemble(a.labels)
+
+    mem = bytearray(HIGH) + a.code
+    while len(mem) % 4:
+        mem.append(0)
+
+    def word(addr, val):
+        mem[addr:addr + 2] = struct.pack('>H', val)
+
+    mem[0x00] = 5                               # version
+    word(0x02, 2)                               # release
+    word(0x04, HIGH)                            # high memory
+    word(0x06, HIGH)                            # initial PC
+    word(0x08, DICT)
+    word(0x0a, OBJECTS)
+    word(0x0c, GLOBALS)
+    word(0x0e, DICT)                            # static memory
+    mem[0x12:0x18] = b'261018'                  # serial
+    word(0x18, ABBREVS)
+    mem[DICT:DICT + 4] = bytes([0, 9, 0, 0])    # no separators or words
+    word(0x1a, len(mem) // 4)
+    word(0x1c, sum(mem[0x40:]) & 0xffff)
+
+    with open(sys.argv[1], 'wb') as f:
+        f.write(mem)
+
+
+if __name__ == '__main__':
+    main()